@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ThreadPool runs parallel loops on a fixed number of worker threads.
+// The thread which calls parallelFor also takes part in the loop, so
+// the number of threads is the number of workers + 1.
+class ThreadPool {
+public:
+    using Task = std::function<void(std::size_t index, std::size_t threadIndex)>;
+
+    explicit ThreadPool(std::size_t numWorkers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t getNumThreads() const { return workers.size() + 1; }
+
+    // Calls task(index, threadIndex) for each index in [0, count) and waits
+    // until all calls are finished. threadIndex is 0 for the calling thread and
+    // [1, getNumThreads()) for workers, so it can be used to access per-thread
+    // data (e.g. command pools) without locking.
+    // Should only be called from one thread at a time.
+    void parallelFor(std::size_t count, const Task& task);
+
+private:
+    void workerLoop(std::size_t threadIndex);
+    void runTasks(std::size_t threadIndex);
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable finishCondition;
+
+    // current loop
+    const Task* task{nullptr};
+    std::size_t taskCount{0};
+    std::atomic<std::size_t> nextIndex{0};
+    std::uint64_t generation{0}; // incremented by each parallelFor
+    std::size_t numBusyWorkers{0};
+    bool stopping{false};
+};
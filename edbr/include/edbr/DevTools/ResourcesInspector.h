@@ -1,9 +1,16 @@
 #pragma once
 
+class GPUMemoryStats;
 class ImageCache;
 class MaterialCache;
+class MeshCache;
 
 class ResourcesInspector {
 public:
-    void update(float dt, const ImageCache& imageCache, const MaterialCache& materialCache);
+    void update(
+        float dt,
+        const ImageCache& imageCache,
+        const MaterialCache& materialCache,
+        const MeshCache& meshCache,
+        const GPUMemoryStats& memoryStats);
 };
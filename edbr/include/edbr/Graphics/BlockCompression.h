@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// CPU encoders for BCn texture formats. They're made for offline cooking
+// (see texture_cooker), not for runtime: each block is encoded by fitting
+// endpoints along the principal axis of its colors ("range fit") and picking
+// the closest palette entry for each pixel. BC7 blocks are always encoded in
+// mode 6 (one subset, RGBA endpoints, 4 bit indices).
+// All encoders take 4x4 blocks of RGBA8 pixels (64 bytes, row by row) and
+// encode values as is - sRGB textures are encoded in gamma space.
+
+namespace graphics
+{
+enum class BlockFormat {
+    BC1, // RGB, 4 bpp (alpha is ignored)
+    BC3, // RGBA, 8 bpp (BC1 color + BC4 alpha)
+    BC4, // R, 4 bpp
+    BC5, // RG, 8 bpp (two BC4 blocks)
+    BC7, // RGBA, 8 bpp
+};
+
+// size of one encoded 4x4 block in bytes
+std::size_t getBlockSize(BlockFormat format);
+// images are padded to a multiple of 4 pixels
+std::size_t getCompressedImageSize(BlockFormat format, int width, int height);
+
+void compressBlock(BlockFormat format, const std::uint8_t* rgba, std::uint8_t* out);
+
+// rgba contains width * height RGBA8 pixels. Pixels of partial blocks
+// are clamped to the image edge.
+std::vector<std::uint8_t> compressImage(
+    BlockFormat format,
+    std::span<const std::uint8_t> rgba,
+    int width,
+    int height);
+}
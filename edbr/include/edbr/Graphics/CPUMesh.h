@@ -9,6 +9,7 @@
 #include <glm/vec4.hpp>
 
 #include <edbr/Graphics/Skeleton.h>
+#include <edbr/Graphics/VertexFormat.h>
 
 struct CPUMesh {
     std::vector<std::uint32_t> indices;
@@ -22,6 +23,8 @@ struct CPUMesh {
     };
     // interleaved vertices: temporary
     std::vector<Vertex> vertices;
+    // format in which vertices are stored on GPU (packed by MeshCache)
+    VertexFormat vertexFormat{VertexFormat::Full};
 
     struct SkinningData {
         glm::vec<4, std::uint32_t> jointIds;
@@ -33,6 +36,10 @@ struct CPUMesh {
 
     std::string name;
 
+    // average cache miss ratio before and after graphics::optimizeMesh
+    float acmrBefore{0.f};
+    float acmrAfter{0.f};
+
     glm::vec3 minPos;
     glm::vec3 maxPos;
 };
@@ -1,11 +1,25 @@
 #pragma once
 
+#include <array>
 #include <filesystem>
 
+#include <edbr/Graphics/ImageLoader.h>
+
 struct GPUImage;
 class GfxDevice;
 
+// Cubemap faces decoded on CPU
+struct CubemapData {
+    std::filesystem::path imagesDir;
+    // right, left, top, bottom, front, back
+    std::array<ImageData, 6> faces;
+};
+
 namespace graphics
 {
+// Only decodes images, so it can be called from any thread
+CubemapData loadCubemapData(const std::filesystem::path& imagesDir);
+GPUImage createCubemap(GfxDevice& gfxDevice, const CubemapData& data);
+
 GPUImage loadCubemap(GfxDevice& gfxDevice, const std::filesystem::path& imagesDir);
 }
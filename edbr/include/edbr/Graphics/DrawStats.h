@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+// Per-pass statistics, used for checking how well instancing/culling works
+struct DrawStats {
+    std::uint32_t numDrawCalls{0};
+    std::uint32_t numInstances{0};
+};
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <utility> // as_const
+#include <vector>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
@@ -52,6 +55,8 @@ struct Frustum {
         }
     }
 
+    Plane& getPlane(int i) { return const_cast<Plane&>(std::as_const(*this).getPlane(i)); }
+
     Plane farFace;
     Plane nearFace;
 
@@ -62,6 +67,31 @@ struct Frustum {
     Plane bottomFace;
 };
 
+// Bounding spheres stored as structure of arrays for batch culling (see edge::cullSpheres).
+// Arrays are padded to a multiple of 8 with spheres which are never visible,
+// so that SIMD code doesn't need to handle the tail.
+struct SphereSoA {
+    void clear();
+    void add(const math::Sphere& s);
+    std::size_t size() const { return numSpheres; }
+
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+
+private:
+    std::size_t numSpheres{0};
+};
+
+// Bit i is set if sphere i is visible
+struct VisibilityMask {
+    bool isVisible(std::size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+    std::size_t countVisible() const;
+
+    std::vector<std::uint64_t> words;
+};
+
 namespace edge
 {
 // NOTE: this doesn't work for cameras with inverse depth
@@ -70,6 +100,12 @@ std::array<glm::vec3, 8> calculateFrustumCornersWorldSpace(const Camera& camera)
 Frustum createFrustumFromCamera(const Camera& camera);
 bool isInFrustum(const Frustum& frustum, const math::Sphere& s);
 bool isInFrustum(const Frustum& frustum, const math::AABB& aabb);
+
+// Culls 8 (AVX) or 4 (SSE) spheres at a time, falls back to cullSpheresScalar
+// when SIMD is not available. Gives the same results as isInFrustum.
+void cullSpheres(const Frustum& frustum, const SphereSoA& spheres, VisibilityMask& mask);
+void cullSpheresScalar(const Frustum& frustum, const SphereSoA& spheres, VisibilityMask& mask);
+
 math::Sphere calculateBoundingSphereWorld(
     const glm::mat4& transform,
     const math::Sphere& s,
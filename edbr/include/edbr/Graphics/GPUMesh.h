@@ -1,31 +1,68 @@
 #pragma once
 
+#include <array>
+#include <string>
+#include <vector>
+
 #include <glm/vec3.hpp>
 
 #include <edbr/Math/Sphere.h>
 
+#include <edbr/Graphics/Common.h>
 #include <edbr/Graphics/IdTypes.h>
+#include <edbr/Graphics/MeshLod.h>
+#include <edbr/Graphics/OffsetAllocator.h>
+#include <edbr/Graphics/VertexFormat.h>
 #include <edbr/Graphics/Vulkan/GPUBuffer.h>
 
 struct GPUMesh {
-    GPUBuffer vertexBuffer;
-    GPUBuffer indexBuffer;
+    // ranges in MeshCache's arenas (in elements, not bytes)
+    // vertices are allocated in the arena of vertexFormat
+    OffsetAllocator::Allocation vertices;
+    OffsetAllocator::Allocation indices;
 
     std::uint32_t numVertices{0};
-    std::uint32_t numIndices{0};
+    std::uint32_t numIndices{0}; // LOD 0
+
+    // can be directly passed to vkCmdDrawIndexed (LOD 0)
+    std::uint32_t firstIndex{0};
+    std::int32_t vertexOffset{0};
+    // meshes with less than 64k vertices use 16 bit indices, 16 and 32 bit
+    // indices are allocated in different arenas
+    VkIndexType indexType{VK_INDEX_TYPE_UINT32};
+
+    // lods[0] is the full mesh, the other LODs are stored after it in the
+    // same index range (see MeshCache::setLodSettings)
+    std::vector<MeshLod> lods;
 
     MaterialId materialId{NULL_MATERIAL_ID};
 
-    // AABB
+    VertexFormat vertexFormat{VertexFormat::Full};
+
+    // AABB, also used for decoding of PackedQuantized positions
     glm::vec3 minPos;
     glm::vec3 maxPos;
     math::Sphere boundingSphere;
 
     bool hasSkeleton{false};
     // skinned meshes only
-    GPUBuffer skinningDataBuffer;
+    OffsetAllocator::Allocation skinningData;
+
+    // debug info (see ResourcesInspector)
+    std::string debugName;
+    float acmrBefore{0.f};
+    float acmrAfter{0.f};
 };
 
 struct SkinnedMesh {
-    GPUBuffer skinnedVertexBuffer;
+    // one buffer per frame in flight, so that skinning can run on async compute
+    // queue while the previous frame still reads its vertices
+    std::array<GPUBuffer, graphics::FRAME_OVERLAP> skinnedVertexBuffers;
+    // pose version which each buffer was last skinned with (0 - none)
+    std::array<std::uint64_t, graphics::FRAME_OVERLAP> skinnedPoseVersions{};
+    // Skinning recorded into the frame's command buffer is lost if the frame
+    // is not submitted, so its pose version is only trusted once the frame
+    // number advances (skinning on async compute is always submitted)
+    std::array<bool, graphics::FRAME_OVERLAP> skinningSubmitPending{};
+    std::array<std::uint32_t, graphics::FRAME_OVERLAP> skinnedFrameNumbers{};
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <optional>
 #include <span>
 
 #include <glm/vec3.hpp>
@@ -8,13 +9,19 @@
 #include <edbr/Graphics/Vulkan/GPUImage.h>
 
 #include <edbr/Graphics/Color.h>
+#include <edbr/Graphics/DrawStats.h>
+#include <edbr/Graphics/FrustumCulling.h>
 #include <edbr/Graphics/GPUMesh.h>
 #include <edbr/Graphics/Light.h>
 #include <edbr/Graphics/MeshDrawCommand.h>
 #include <edbr/Graphics/NBuffer.h>
+#include <edbr/Graphics/RenderGraph.h>
 
 #include <edbr/Graphics/Pipelines/CSMPipeline.h>
 #include <edbr/Graphics/Pipelines/DepthResolvePipeline.h>
+#include <edbr/Graphics/Pipelines/HiZPipeline.h>
+#include <edbr/Graphics/Pipelines/LightClusteringPipeline.h>
+#include <edbr/Graphics/Pipelines/MeshCullingPipeline.h>
 #include <edbr/Graphics/Pipelines/MeshPipeline.h>
 #include <edbr/Graphics/Pipelines/PostFXPipeline.h>
 #include <edbr/Graphics/Pipelines/SkinningPipeline.h>
@@ -47,16 +54,28 @@ public:
     void updateDevTools(float dt);
 
     void setSkyboxImage(ImageId skyboxImageId);
-    void beginDrawing();
+    // camera is used for selecting mesh LODs
+    void beginDrawing(const Camera& camera);
     void endDrawing();
 
     void addLight(const Light& light, const Transform& transform);
-    void drawMesh(MeshId id, const glm::mat4& transform, bool castShadow);
+    // LOD is selected by the mesh's size on the screen. If lod is not nullptr,
+    // it should contain the LOD which was selected for this mesh instance
+    // previously (0 initially) - it's used for hysteresis and gets updated.
+    void drawMesh(
+        MeshId id,
+        const glm::mat4& transform,
+        bool castShadow,
+        bool isStatic = false,
+        std::uint32_t* lod = nullptr);
+    // if poseVersion is not 0, skinning is skipped when skinned vertex
+    // buffers already contain vertices for this pose
     void drawSkinnedMesh(
         std::span<const MeshId> meshes,
-        std::span<const SkinnedMesh> skinnedMeshes,
+        std::span<SkinnedMesh> skinnedMeshes,
         const glm::mat4& transform,
-        std::span<const glm::mat4> jointMatrices);
+        std::span<const glm::mat4> jointMatrices,
+        std::uint64_t poseVersion = 0);
 
     GfxDevice& getGfxDevice() { return gfxDevice; }
 
@@ -66,39 +85,111 @@ public:
     VkFormat getDepthImageFormat() const;
 
 private:
-    void createDrawImage(const glm::ivec2& drawImageSize, bool firstCreate);
     void initSceneData();
+    void initLightDataBuffer();
 
     bool isMultisamplingEnabled() const;
     void onMultisamplingStateUpdate();
 
+    void drawGeometry(
+        VkCommandBuffer cmd,
+        const Camera& camera,
+        MeshCullingPipeline::Pass pass,
+        bool lastPass, // draws the sky and discards the MSAA images after the resolve
+        const GPUImage& drawImage,
+        const GPUImage& depthImage,
+        const GPUImage* resolveImage, // only with MSAA
+        const GPUImage* resolveDepthImage); // only with hardware depth resolve
+    void addSkinningJobs(const Camera& camera);
+    void resolveDepth(
+        VkCommandBuffer cmd,
+        const GPUImage& depthImage,
+        const GPUImage& resolveDepthImage);
+
     void sortDrawList();
+    std::uint32_t selectLod(
+        const GPUMesh& mesh,
+        const math::Sphere& worldBoundingSphere,
+        std::uint32_t prevLod) const;
+    // in pixels, infinity if the camera is inside the sphere
+    float getProjectedSize(const math::Sphere& worldBoundingSphere) const;
+    // requests the resolution of visible meshes' textures from TextureStreamer
+    void requestTextureMips(const Camera& camera);
 
     GfxDevice& gfxDevice;
     MeshCache& meshCache;
     MaterialCache& materialCache;
 
+    RenderGraph renderGraph;
+
     SkinningPipeline skinningPipeline;
     CSMPipeline csmPipeline;
+    MeshCullingPipeline meshCullingPipeline;
     MeshPipeline meshPipeline;
     SkyboxPipeline skyboxPipeline;
     DepthResolvePipeline depthResolvePipeline;
+    HiZPipeline hiZPipeline;
+    LightClusteringPipeline lightClusteringPipeline;
     PostFXPipeline postFXPipeline;
 
     std::vector<MeshDrawCommand> meshDrawCommands;
     std::vector<std::size_t> sortedMeshDrawCommands;
+    // bounding spheres of meshDrawCommands in sorted order - used for batch culling
+    SphereSoA drawBoundingSpheres;
+    VisibilityMask cameraVisibility;
 
     VkFormat drawImageFormat{VK_FORMAT_R16G16B16A16_SFLOAT};
     VkFormat depthImageFormat{VK_FORMAT_D32_SFLOAT};
 
-    ImageId drawImageId{NULL_IMAGE_ID};
-    ImageId resolveImageId{NULL_IMAGE_ID};
-    ImageId depthImageId{NULL_IMAGE_ID};
-    ImageId resolveDepthImageId{NULL_IMAGE_ID};
+    VkExtent3D drawImageExtent{};
     ImageId postFXDrawImageId{NULL_IMAGE_ID};
+    // transient depth image which is returned by getDepthImage (set by draw)
+    ImageId outputDepthImageId{NULL_IMAGE_ID};
+    // depth image view which the Hi-Z pyramid is currently built from
+    VkImageView hiZDepthImageView{VK_NULL_HANDLE};
 
     bool shadowsEnabled{true};
+    // if false, culling is done on CPU and each mesh is drawn with its own draw call
+    bool gpuCulling{true};
+    // two-pass Hi-Z occlusion culling, only done when culling on GPU
+    bool occlusionCulling{true};
+    // run skinning on async compute queue (if the device has one)
+    bool asyncCompute{true};
+    // record CSM cascades and CPU culled geometry into secondary command buffers
+    // on multiple threads
+    bool parallelRecording{true};
+    // don't split geometry into chunks smaller than this - not worth the overhead
+    static constexpr std::size_t MIN_BATCHES_PER_CHUNK = 64;
+
+    // mesh LOD selection (see drawMesh)
+    bool meshLodsEnabled{true};
+    // the coarsest LOD whose error on the screen is within this is selected
+    float lodMaxPixelError{1.f};
+    float lodHysteresis{0.1f};
+    // set by beginDrawing
+    glm::vec3 lodCameraPosition;
+    float lodProjectionScale{0.f}; // projected size in pixels of 1 unit at distance 1
+    bool lodCameraOrthographic{false};
+
+    // if false, the textures stay at the mips which are loaded initially
+    // (or which are already streamed in)
+    bool textureStreaming{true};
+    VisibilityMask streamingVisibility;
+
+    DrawStats geometryStats; // reset by the early pass
+    float pipelineCreationTime{0.f}; // in ms, measured in init
+
+    struct SkinningStats {
+        std::size_t numSkinnedMeshes{0};
+        std::size_t numCulled{0}; // not visible to the camera and don't cast visible shadows
+        std::size_t numReused{0}; // pose didn't change since the last time
+    };
+    SkinningStats skinningStats;
     VkSampleCountFlagBits samples{VK_SAMPLE_COUNT_1_BIT};
+    // resolve MSAA depth with VK_RESOLVE_MODE_MIN_BIT in the geometry passes
+    // instead of DepthResolvePipeline (which is used if it's not supported)
+    bool hardwareDepthResolve{false};
+    bool hardwareDepthResolveSupported{false};
 
     // keep in sync with scene_data.glsl
     struct GPUSceneData {
@@ -126,11 +217,18 @@ private:
         std::int32_t sunlightIndex;
 
         VkDeviceAddress materialsBuffer;
+
+        // light clusters
+        VkDeviceAddress lightClustersBuffer;
+        glm::vec2 screenSize;
+        float cameraZNear;
+        float cameraZFar;
     };
     NBuffer sceneDataBuffer;
 
     NBuffer lightDataBuffer;
-    static const int MAX_LIGHTS = 100;
+    // grows when more lights are added in a frame (see endDrawing)
+    std::size_t lightDataBufferCapacity{100};
     std::vector<GPULightData> lightDataCPU;
     const float pointLightMaxRange{25.f};
     const float spotLightMaxRange{64.f};
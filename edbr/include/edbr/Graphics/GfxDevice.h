@@ -2,7 +2,12 @@
 
 #include <array>
 #include <cstdint>
+#include <deque>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 // don't sort these includes
 // clang-format off
@@ -15,12 +20,17 @@
 
 #include <glm/vec4.hpp>
 
+#include <edbr/Core/ThreadPool.h>
 #include <edbr/Graphics/Color.h>
 #include <edbr/Graphics/Common.h>
 #include <edbr/Graphics/ImageCache.h>
+#include <edbr/Graphics/Vulkan/GPUBuffer.h>
+#include <edbr/Graphics/Vulkan/GPUMemoryStats.h>
 #include <edbr/Graphics/Vulkan/Swapchain.h>
 #include <edbr/Graphics/Vulkan/VulkanImGuiBackend.h>
 #include <edbr/Graphics/Vulkan/VulkanImmediateExecutor.h>
+#include <edbr/Graphics/Vulkan/VulkanPipelineCache.h>
+#include <edbr/Graphics/Vulkan/VulkanUploadQueue.h>
 #include <edbr/Version.h>
 
 namespace vkutil
@@ -28,8 +38,9 @@ namespace vkutil
 struct CreateImageInfo;
 }
 
-struct GPUBuffer;
 struct GPUImage;
+struct ImageData;
+struct CompressedImageData;
 
 struct SDL_Window;
 
@@ -39,6 +50,22 @@ public:
         VkCommandPool commandPool;
         VkCommandBuffer mainCommandBuffer;
         TracyVkCtx tracyVkCtx;
+
+        // async compute (only created if hasAsyncCompute() is true)
+        VkCommandPool computeCommandPool;
+        VkCommandBuffer computeCommandBuffer;
+        // value which computeSemaphore gets when the frame's compute work is finished
+        std::uint64_t computeSemaphoreValue{0};
+        bool computeSubmitted{false};
+        VkPipelineStageFlags2 computeWaitStage{VK_PIPELINE_STAGE_2_NONE};
+
+        // secondary command buffers, one pool per recording thread
+        struct ThreadCommandPool {
+            VkCommandPool pool;
+            std::vector<VkCommandBuffer> commandBuffers;
+            std::size_t numUsed{0};
+        };
+        std::vector<ThreadCommandPool> threadCommandPools;
     };
 
 public:
@@ -64,23 +91,75 @@ public:
     [[nodiscard]] GPUBuffer createBuffer(
         std::size_t allocSize,
         VkBufferUsageFlags usage,
-        VmaMemoryUsage memoryUsage = VMA_MEMORY_USAGE_AUTO) const;
+        MemoryClass memoryClass,
+        MemoryCategory memoryCategory) const;
     [[nodiscard]] VkDeviceAddress getBufferAddress(const GPUBuffer& buffer) const;
     void destroyBuffer(const GPUBuffer& buffer) const;
 
+    // true if MemoryClass::Streaming buffers are in device local memory (ReBAR/UMA)
+    bool isStreamingMemoryDeviceLocal() const { return streamingMemoryDeviceLocal; }
+
     bool deviceSupportsSamplingCount(VkSampleCountFlagBits sample) const;
     VkSampleCountFlagBits getMaxSupportedSamplingCount() const;
+    // VK_RESOLVE_MODE_SAMPLE_ZERO_BIT is always supported, other modes are optional
+    bool deviceSupportsDepthResolveMode(VkResolveModeFlagBits mode) const;
     float getMaxAnisotropy() const { return maxSamplerAnisotropy; }
+    // if false, block compressed (cooked) textures can't be used
+    bool hasTextureCompressionBC() const { return textureCompressionBCSupported; }
 
     VulkanImmediateExecutor createImmediateExecutor() const;
-    void immediateSubmit(std::function<void(VkCommandBuffer)>&& f) const;
+
+    // Threads which can record secondary command buffers in parallel
+    ThreadPool& getRecordingThreadPool() { return *recordingThreadPool; }
+    // Begins a secondary command buffer from the pool of threadIndex (see
+    // ThreadPool::parallelFor). Each thread should only use its own index.
+    // If renderingInfo is not null, the command buffer will be executed inside
+    // a render pass instance started with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT.
+    // Otherwise, it can begin and end rendering itself.
+    // Command buffers are valid until the frame is finished on GPU.
+    VkCommandBuffer beginSecondaryCommandBuffer(
+        std::size_t threadIndex,
+        const VkCommandBufferInheritanceRenderingInfo* renderingInfo = nullptr);
+    // Waits for pending uploads (see getUploadQueue) before submitting
+    void immediateSubmit(std::function<void(VkCommandBuffer)>&& f);
+
+    // Calls f once the frames which are in flight (including the one being
+    // recorded) are finished on GPU, so that it can destroy the resources which
+    // these frames still use. The remaining functions are called in cleanup.
+    void deferDestruction(std::function<void()>&& f);
+
+    // Buffer and image uploads are batched and submitted before the next frame
+    // is submitted. The frame waits for them, so resources can be used for
+    // drawing right away.
+    VulkanUploadQueue& getUploadQueue() { return uploadQueue; }
 
     void waitIdle() const;
 
+    // Async compute is only available when the device has a queue family which
+    // supports compute, but not graphics. Otherwise, compute work should be
+    // recorded into the main command buffer.
+    bool hasAsyncCompute() const { return asyncComputeSupported; }
+    // Begins the compute command buffer of the current frame. The work submitted
+    // to it runs on the compute queue and can overlap with graphics work of the
+    // previous frame which is still in flight.
+    VkCommandBuffer beginAsyncCompute();
+    // The graphics commands of the current frame will wait for the submitted
+    // compute commands to finish before waitStage
+    void submitAsyncCompute(VkCommandBuffer cmd, VkPipelineStageFlags2 waitStage);
+
+    // Should be passed to all pipeline builders. It's saved to disk on exit,
+    // so pipelines are created faster on the next runs.
+    VkPipelineCache getPipelineCache() const { return pipelineCache.getCache(); }
+    // for dev tools
+    std::size_t getLoadedPipelineCacheSize() const { return pipelineCache.getLoadedDataSize(); }
+
     BindlessSetManager& getBindlessSetManager();
     VkDescriptorSetLayout getBindlessDescSetLayout() const;
     const VkDescriptorSet& getBindlessDescSet() const;
-    void bindBindlessDescSet(VkCommandBuffer cmd, VkPipelineLayout layout) const;
+    void bindBindlessDescSet(
+        VkCommandBuffer cmd,
+        VkPipelineLayout layout,
+        VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
 
 public:
     [[nodiscard]] ImageId createImage(
@@ -97,11 +176,29 @@ public:
         VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
         VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT,
         bool mipMap = false);
+    // Same as loadImageFromFile, but the image was already decoded (e.g. on
+    // another thread). path is only used for caching.
+    [[nodiscard]] ImageId loadImageFromData(
+        const std::filesystem::path& path,
+        const ImageData& data,
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+        bool mipMap = false);
+    // Same as above, but for cooked images - format is the format which
+    // the image would have if it was loaded from path (used for caching)
+    [[nodiscard]] ImageId loadImageFromData(
+        const std::filesystem::path& path,
+        const CompressedImageData& data,
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT);
 
     ImageId addImageToCache(GPUImage image);
+    // Releases the reference to the image which was added to the cache or
+    // returned by loadImageFromFile/loadImageFromData (see ImageCache::releaseImage)
+    void releaseImage(ImageId id);
 
     [[nodiscard]] const GPUImage& getImage(ImageId id) const;
-    void uploadImageData(const GPUImage& image, void* pixelData, std::uint32_t layer = 0) const;
+    void uploadImageData(const GPUImage& image, void* pixelData, std::uint32_t layer = 0);
 
     ImageId getWhiteTextureID() { return whiteImageId; }
 
@@ -116,17 +213,63 @@ public:
         const std::filesystem::path& path,
         VkFormat format,
         VkImageUsageFlags usage,
-        bool mipMap) const;
+        bool mipMap);
+    [[nodiscard]] GPUImage createImageFromDataRaw(
+        const ImageData& data,
+        VkFormat format,
+        VkImageUsageFlags usage,
+        bool mipMap,
+        const std::string& debugName);
+    // Creates the image with the mips of data (they're uploaded as is). If
+    // data doesn't have the biggest mips, the image is smaller than data's size.
+    [[nodiscard]] GPUImage createCompressedImageRaw(
+        const CompressedImageData& data,
+        VkImageUsageFlags usage,
+        const std::string& debugName);
+
+    // Images which alias each other share memory allocated with allocateImageMemory
+    // (see RenderGraph). The memory should only be freed after its images are
+    // destroyed - they don't own it, so destroyImage doesn't free it.
+    VkMemoryRequirements getImageMemoryRequirements(
+        const vkutil::CreateImageInfo& createInfo) const;
+    // If lazilyAllocated is true, lazily allocated memory is used when the device
+    // has it (only for images with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+    [[nodiscard]] VmaAllocation allocateImageMemory(
+        const VkMemoryRequirements& requirements,
+        MemoryCategory category,
+        bool lazilyAllocated = false) const;
+    void freeImageMemory(VmaAllocation memory, MemoryCategory category) const;
+    // creates the image at the start of memory and adds it to the cache
+    [[nodiscard]] ImageId createAliasedImage(
+        const vkutil::CreateImageInfo& createInfo,
+        VmaAllocation memory,
+        const char* debugName = nullptr);
+
     // destroyImage should only be called on images not beloning to image cache / bindless set
     void destroyImage(const GPUImage& image) const;
 
     // for dev tools only - don't use directly
     const ImageCache& getImageCache() const { return imageCache; }
 
+    // Sizes of the allocated buffers/images by category and heap budgets,
+    // the budgets are updated in beginFrame
+    const GPUMemoryStats& getMemoryStats() const { return memoryStats; }
+    // Moves textures to reduce fragmentation of device memory and rewrites
+    // their bindless descriptors. Waits for GPU to be idle, so it should only be
+    // called when a stall is fine (e.g. between level loads).
+    VmaDefragmentationStats defragmentMemory();
+
+    TextureStreamer& getTextureStreamer() { return imageCache.getTextureStreamer(); }
+
 public:
     VkDevice getDevice() const { return device; }
 
     std::uint32_t getCurrentFrameIndex() const;
+    // incremented after each presented frame
+    std::uint32_t getFrameNumber() const { return frameNumber; }
+    // Waits until the frames which are still in flight are finished on GPU.
+    // Stalls the CPU, so it shouldn't be done often.
+    void waitForFramesInFlight() const;
 
     VkExtent2D getSwapchainExtent() const { return swapchain.getExtent(); }
     glm::ivec2 getSwapchainSize() const
@@ -142,7 +285,16 @@ public:
 private:
     void initVulkan(SDL_Window* window, const char* appName, const Version& appVersion);
     void checkDeviceCapabilities();
+    // creates a VMA pool for each MemoryClass
+    void initMemoryPools();
+    void setBufferSharingMode(VkBufferCreateInfo& bufferInfo) const;
+    VkImageCreateInfo getImageCreateInfo(const vkutil::CreateImageInfo& createInfo) const;
+    // fills GPUImage's fields from createInfo
+    GPUImage initImage(const vkutil::CreateImageInfo& createInfo, std::uint32_t mipLevels) const;
+    VkImageView createImageView(const GPUImage& image) const;
     void createCommandBuffers();
+    // calls deferred functions of the finished frames (or all of them if all is true)
+    void runDeferredDestructions(bool all);
 
     FrameData& getCurrentFrame();
 
@@ -151,10 +303,28 @@ private: // data
     vkb::PhysicalDevice physicalDevice;
     vkb::Device device;
     VmaAllocator allocator;
+    // indexed by MemoryClass, long-lived buffers of the same class are sub-allocated
+    // from the same blocks
+    std::array<VmaPool, 4> memoryPools{};
+    bool streamingMemoryDeviceLocal{false}; // true with ReBAR or on UMA
+    // mutable because buffers and images are created/destroyed by const functions
+    mutable GPUMemoryStats memoryStats;
 
     std::uint32_t graphicsQueueFamily;
     VkQueue graphicsQueue;
 
+    bool asyncComputeSupported{false};
+    std::uint32_t computeQueueFamily;
+    VkQueue computeQueue;
+    VkSemaphore computeSemaphore; // timeline semaphore
+    std::uint64_t computeSemaphoreValue{0};
+
+    // dedicated transfer queue (VK_NULL_HANDLE if the device doesn't have one)
+    std::uint32_t transferQueueFamily;
+    VkQueue transferQueue{VK_NULL_HANDLE};
+    // buffers are shared between all queue families used
+    std::vector<std::uint32_t> bufferQueueFamilies;
+
     VkSurfaceKHR surface;
     VkFormat swapchainFormat;
     Swapchain swapchain;
@@ -162,13 +332,26 @@ private: // data
     std::array<FrameData, graphics::FRAME_OVERLAP> frames{};
     std::uint32_t frameNumber{0};
 
+    struct DeferredDestruction {
+        std::uint32_t frameNumber; // when it was deferred
+        std::function<void()> f;
+    };
+    std::deque<DeferredDestruction> deferredDestructions;
+
     VulkanImmediateExecutor executor;
+    VulkanUploadQueue uploadQueue;
+    VulkanPipelineCache pipelineCache;
+
+    std::unique_ptr<ThreadPool> recordingThreadPool;
 
     VulkanImGuiBackend imGuiBackend;
 
     VkSampleCountFlagBits supportedSampleCounts;
     VkSampleCountFlagBits highestSupportedSamples{VK_SAMPLE_COUNT_1_BIT};
+    VkResolveModeFlags supportedDepthResolveModes{VK_RESOLVE_MODE_NONE};
+    std::uint32_t lazilyAllocatedMemoryTypeBits{0};
     float maxSamplerAnisotropy{1.f};
+    bool textureCompressionBCSupported{false};
 
     ImageCache imageCache;
 
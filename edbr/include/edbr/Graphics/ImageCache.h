@@ -1,15 +1,20 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <unordered_map>
 #include <vector>
 
 #include <edbr/Graphics/IdTypes.h>
+#include <edbr/Graphics/TextureStreamer.h>
 #include <edbr/Graphics/Vulkan/GPUImage.h>
 
 #include <edbr/Graphics/Vulkan/BindlessSetManager.h>
 
 class GfxDevice;
+struct ImageData;
+struct CompressedImageData;
 
 class ImageCache {
     friend class ResourcesInspector;
@@ -17,17 +22,48 @@ class ImageCache {
 public:
     ImageCache(GfxDevice& gfxDevice);
 
+    // Images are reference counted: loading an image which was already loaded
+    // returns the same id and adds a reference to it (see releaseImage).
+    // Mipmapped sampled images are loaded from cooked (block compressed)
+    // files if they're present - see util::loadCookedImage. Only their small
+    // mips are loaded, the rest are streamed in by TextureStreamer.
     ImageId loadImageFromFile(
         const std::filesystem::path& path,
         VkFormat format,
         VkImageUsageFlags usage,
         bool mipMap);
+    // Same as loadImageFromFile, but the image was already decoded
+    ImageId loadImageFromData(
+        const std::filesystem::path& path,
+        const ImageData& data,
+        VkFormat format,
+        VkImageUsageFlags usage,
+        bool mipMap);
+    // Same as loadImageFromData, but the image was loaded from the cooked file
+    ImageId loadImageFromData(
+        const std::filesystem::path& path,
+        const CompressedImageData& data,
+        VkFormat format,
+        VkImageUsageFlags usage);
 
     ImageId addImage(GPUImage image);
     ImageId addImage(ImageId id, GPUImage image);
+    // Replaces the image without changing its id and returns the old image.
+    // The old image's descriptor is rewritten, so it shouldn't be used by
+    // frames in flight.
+    [[nodiscard]] GPUImage replaceImage(ImageId id, GPUImage image);
     const GPUImage& getImage(ImageId id) const;
 
+    // Removes a reference to the loaded image, the image is removed when there
+    // are no references left. Images which were added with addImage only have
+    // one reference. The image is destroyed once the frames in flight are
+    // finished - then its id (and bindless slot) can be reused.
+    void releaseImage(ImageId id);
+
+    // returns the id which the next added image will get
     ImageId getFreeImageId() const;
+    // number of image slots, including the free ones
+    std::size_t getNumImages() const { return images.size(); }
 
     void destroyImages();
 
@@ -35,8 +71,27 @@ public:
 
     void setErrorImageId(ImageId id) { errorImageId = id; }
 
+    TextureStreamer& getTextureStreamer() { return textureStreamer; }
+    const TextureStreamer& getTextureStreamer() const { return textureStreamer; }
+
 private:
+    // returns the id of the image if it was loaded before and adds a reference to it
+    ImageId acquireLoadedImage(
+        const std::filesystem::path& path,
+        VkFormat format,
+        VkImageUsageFlags usage,
+        bool mipMap);
+    ImageId addLoadedImage(
+        GPUImage image,
+        const std::filesystem::path& path,
+        VkFormat format,
+        VkImageUsageFlags usage,
+        bool mipMap);
+    void removeImage(ImageId id);
+
     std::vector<GPUImage> images;
+    // ids of the removed images, reused by the next added images
+    std::vector<ImageId> freeImageIds;
     GfxDevice& gfxDevice;
 
     struct LoadedImageInfo {
@@ -44,7 +99,10 @@ private:
         VkFormat format;
         VkImageUsageFlags usage;
         bool mipMap;
+        std::uint32_t refCount{1};
     };
     std::unordered_map<ImageId, LoadedImageInfo> loadedImagesInfo;
     ImageId errorImageId{NULL_IMAGE_ID};
+
+    TextureStreamer textureStreamer;
 };
@@ -7,8 +7,8 @@ struct ImageData {
     ~ImageData();
 
     // move only
-    ImageData(ImageData&& o) = default;
-    ImageData& operator=(ImageData&& o) = default;
+    ImageData(ImageData&& o);
+    ImageData& operator=(ImageData&& o);
 
     // no copies
     ImageData(const ImageData& o) = delete;
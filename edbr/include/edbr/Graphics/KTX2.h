@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Block compressed 2D image with a pre-built mip chain, loaded from (or
+// written to) a KTX2 file. Only BC1, BC3, BC4, BC5 and BC7 formats without
+// supercompression are supported - that's what texture_cooker produces.
+// The biggest mips can be skipped on load (see TextureStreamer).
+struct CompressedImageData {
+    VkFormat format{VK_FORMAT_UNDEFINED};
+    std::uint32_t width{0}; // of mip 0 (even if it's not loaded)
+    std::uint32_t height{0};
+    std::uint32_t numMips{0}; // in the file
+    std::uint32_t firstMip{0}; // mip level of mips[0]
+    std::vector<std::vector<std::uint8_t>> mips; // firstMip first
+};
+
+namespace util
+{
+// Returns std::nullopt if the file doesn't exist, is corrupted or uses
+// an unsupported format. If maxSize is not 0, mips which are bigger than
+// maxSize are not loaded (the smallest mip is always loaded).
+std::optional<CompressedImageData> loadKTX2Image(
+    const std::filesystem::path& path,
+    std::uint32_t maxSize = 0);
+// image should have all mips
+bool writeKTX2Image(const std::filesystem::path& path, const CompressedImageData& image);
+
+// Size of one mip of a block compressed image (format should be supported by KTX2 functions)
+std::size_t getCompressedMipSize(VkFormat format, std::uint32_t width, std::uint32_t height);
+
+// Cooked images are stored next to their source images: "<image name>.ktx2"
+std::filesystem::path getCookedImagePath(const std::filesystem::path& imagePath);
+
+// Loads the cooked version of the image if it's up to date (not older than
+// the image) and can be used instead of the image uploaded with format:
+// sRGB formats can only be replaced with sRGB block formats and vice versa.
+// Returns std::nullopt otherwise. maxSize is the same as in loadKTX2Image.
+std::optional<CompressedImageData> loadCookedImage(
+    const std::filesystem::path& imagePath,
+    VkFormat format,
+    std::uint32_t maxSize = 0);
+}
@@ -18,6 +18,9 @@ public:
 
     MaterialId addMaterial(GfxDevice& gfxDevice, Material material);
     const Material& getMaterial(MaterialId id) const;
+    // The material's data can be read by frames in flight, so its id is only
+    // reused after they're finished. Material's textures are not released.
+    void removeMaterial(GfxDevice& gfxDevice, MaterialId id);
 
     MaterialId getFreeMaterialId() const;
 
@@ -26,6 +29,7 @@ public:
 
 private:
     std::vector<Material> materials;
+    std::vector<MaterialId> freeMaterialIds;
 
     static const auto MAX_MATERIALS = 1000;
     GPUBuffer materialDataBuffer;
@@ -3,19 +3,77 @@
 #include <vector>
 
 #include <edbr/Graphics/GPUMesh.h>
+#include <edbr/Graphics/MeshLod.h>
+#include <edbr/Graphics/MeshUploadData.h>
+#include <edbr/Graphics/OffsetAllocator.h>
+#include <edbr/Graphics/Vulkan/GPUBuffer.h>
 
 class GfxDevice;
 struct CPUMesh;
 
+// All mesh geometry is sub-allocated from a few big buffers (arenas), so
+// that the whole scene can be drawn with a single index buffer bound.
+// Meshes only store their ranges in the arenas (see GPUMesh).
 class MeshCache {
+    friend class ResourcesInspector;
+
 public:
     void cleanup(const GfxDevice& gfxDevice);
 
     MeshId addMesh(GfxDevice& gfxDevice, const CPUMesh& cpuMesh, MaterialId materialId);
+    // data is copied to GPU as is (LOD settings are not used)
+    MeshId addMesh(GfxDevice& gfxDevice, const MeshUploadData& data, MaterialId materialId);
     const GPUMesh& getMesh(MeshId id) const;
 
+    // LOD chains are generated for meshes added after this call (LODs are
+    // disabled by default). Skinned meshes don't get LODs.
+    void setLodSettings(const MeshLodSettings& settings) { lodSettings = settings; }
+    const MeshLodSettings& getLodSettings() const { return lodSettings; }
+
+    // Frees mesh's ranges in the arenas once the frames in flight are
+    // finished, then MeshId can be reused by the next added mesh.
+    void removeMesh(GfxDevice& gfxDevice, MeshId id);
+
+    // Full and packed vertices are stored in different arenas
+    const GPUBuffer& getVertexBuffer(VertexFormat format) const;
+    const GPUBuffer& getIndexBuffer(VkIndexType indexType) const;
+    const GPUBuffer& getSkinningDataBuffer() const { return skinningDataArena.buffer; }
+
 private:
-    void uploadMesh(GfxDevice& gfxDevice, const CPUMesh& cpuMesh, GPUMesh& gpuMesh) const;
+    struct Arena {
+        GPUBuffer buffer;
+        OffsetAllocator allocator;
+        std::size_t elementSize{0};
+        VkBufferUsageFlags usage{0};
+        const char* name{nullptr};
+    };
+
+    void initArena(
+        GfxDevice& gfxDevice,
+        Arena& arena,
+        std::size_t elementSize,
+        std::uint32_t capacity,
+        VkBufferUsageFlags usage,
+        const char* name);
+    OffsetAllocator::Allocation allocateInArena(
+        GfxDevice& gfxDevice,
+        Arena& arena,
+        std::uint32_t numElements);
+    void growArena(GfxDevice& gfxDevice, Arena& arena, std::uint32_t newCapacity);
+
+    void uploadMesh(GfxDevice& gfxDevice, const MeshUploadData& data, GPUMesh& gpuMesh);
 
     std::vector<GPUMesh> meshes;
+    std::vector<MeshId> freeMeshIds;
+
+    Arena& getVertexArena(VertexFormat format);
+    Arena& getIndexArena(VkIndexType indexType);
+
+    Arena vertexArena;
+    Arena packedVertexArena;
+    Arena indexArena;
+    Arena index16Arena;
+    Arena skinningDataArena;
+
+    MeshLodSettings lodSettings;
 };
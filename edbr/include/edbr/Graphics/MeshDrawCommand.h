@@ -12,8 +12,13 @@ struct MeshDrawCommand {
     MeshId meshId;
     glm::mat4 transformMatrix;
     math::Sphere worldBoundingSphere;
+    std::uint32_t lod{0}; // index into GPUMesh::lods
 
-    const SkinnedMesh* skinnedMesh{nullptr};
+    // skinned meshes only
+    SkinnedMesh* skinnedMesh{nullptr};
     std::uint32_t jointMatricesStartIndex;
+    std::uint64_t poseVersion{0}; // see SkeletonAnimator::getPoseVersion
     bool castShadow{true};
+    // hint that the mesh doesn't move (its shadow can be cached)
+    bool isStatic{false};
 };
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+// Range of mesh's indices which is drawn at some level of detail. All LODs
+// of the mesh use the same vertices, only the indices are different.
+struct MeshLod {
+    std::uint32_t firstIndex{0}; // can be directly passed to vkCmdDrawIndexed
+    std::uint32_t numIndices{0};
+    // max distance by which the surface has moved during simplification
+    // (relative to the mesh size - the diagonal of its AABB), 0 for LOD 0
+    float error{0.f};
+};
+
+// How MeshCache builds LOD chains (see graphics::generateMeshLods)
+struct MeshLodSettings {
+    // number of LODs including the full mesh, 1 - LODs are not generated
+    std::uint32_t maxLods{1};
+    // each LOD tries to have this fraction of the previous LOD's triangles
+    float reductionRatio{0.5f};
+    // simplification stops when the error reaches this (relative to the mesh size)
+    float targetError{0.05f};
+};
+
+namespace graphics
+{
+// Returns the coarsest LOD whose error projected on the screen is not bigger
+// than maxPixelError. projectedSize is the size of the mesh on the screen in
+// pixels (e.g. the projected diameter of its bounding sphere). To avoid
+// flickering near thresholds, the LOD which was selected previously is kept
+// until the error changes by more than hysteresis (0.1 - 10%).
+std::uint32_t selectMeshLod(
+    std::span<const MeshLod> lods,
+    float projectedSize,
+    float maxPixelError,
+    std::uint32_t prevLod,
+    float hysteresis);
+}
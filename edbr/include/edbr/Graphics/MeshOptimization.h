@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+struct CPUMesh;
+
+namespace graphics
+{
+// size of FIFO cache used for ACMR calculation
+inline constexpr std::size_t VERTEX_CACHE_SIZE = 16;
+// how much overdraw optimization is allowed to make ACMR worse
+inline constexpr float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+// Average cache miss ratio - the number of transformed vertices per triangle
+// with a FIFO post-transform cache of cacheSize. 0.5 is the best possible
+// value for big regular grids, 3 is the worst.
+float calculateACMR(
+    std::span<const std::uint32_t> indices,
+    std::size_t numVertices,
+    std::size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders triangles for better post-transform vertex cache usage.
+// See Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+void optimizeVertexCache(std::vector<std::uint32_t>& indices, std::size_t numVertices);
+
+// Splits triangles (which should already be vertex cache optimized) into
+// clusters and sorts them so that the outer clusters are drawn first. Cluster
+// boundaries are placed where ACMR is at most acmrThreshold times worse.
+// See Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+void optimizeOverdraw(
+    std::vector<std::uint32_t>& indices,
+    std::span<const glm::vec3> positions,
+    float acmrThreshold = OVERDRAW_ACMR_THRESHOLD);
+
+// Returns remap table for ordering vertices by their first use in indices:
+// remap[oldIndex] is the new index or UNUSED_VERTEX if the vertex is not referenced.
+inline constexpr std::uint32_t UNUSED_VERTEX = ~0u;
+std::vector<std::uint32_t> generateVertexFetchRemap(
+    std::span<const std::uint32_t> indices,
+    std::size_t numVertices);
+
+// Runs all of the above on the mesh (unused vertices are removed) and
+// sets mesh's ACMR stats
+void optimizeMesh(CPUMesh& mesh);
+}
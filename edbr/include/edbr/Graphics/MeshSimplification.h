@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include <edbr/Graphics/MeshLod.h>
+
+namespace graphics
+{
+// Simplifies the mesh with edge collapses ordered by quadric error
+// (see Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics").
+// Vertices are collapsed into their neighbours, so the resulting indices
+// reference the same vertices. Vertices on borders and attribute seams
+// (several vertices with the same position) are never moved.
+// Stops when there are at most targetIndexCount indices or when the next
+// collapse would make the error bigger than targetError (relative to the
+// mesh size - the diagonal of its AABB). Returns the resulting error.
+float simplifyMesh(
+    std::vector<std::uint32_t>& indices,
+    std::span<const glm::vec3> positions,
+    std::size_t targetIndexCount,
+    float targetError);
+
+struct SimplifiedMeshLod {
+    std::vector<std::uint32_t> indices; // vertex cache optimized
+    float error;
+};
+
+// Builds LODs 1..N (LOD 0 is the mesh itself) by simplifying the mesh
+// progressively. Fewer than settings.maxLods - 1 levels are returned if the
+// mesh can't be simplified further within settings.targetError.
+std::vector<SimplifiedMeshLod> generateMeshLods(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    const MeshLodSettings& settings);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <glm/vec3.hpp>
+
+#include <edbr/Math/Sphere.h>
+
+#include <edbr/Graphics/CPUMesh.h>
+#include <edbr/Graphics/MeshLod.h>
+#include <edbr/Graphics/VertexFormat.h>
+
+// Mesh in the format in which MeshCache stores it on GPU: vertices are packed
+// into vertexFormat and indices of all LODs are narrowed to indexType.
+// Cooked scenes (see CookedScene.h) store meshes like this, so they're
+// uploaded without any per-vertex conversion.
+struct MeshUploadData {
+    VertexFormat vertexFormat{VertexFormat::Full};
+    VkIndexType indexType{VK_INDEX_TYPE_UINT32};
+    std::uint32_t numVertices{0};
+
+    std::span<const std::byte> vertices;
+    std::span<const std::byte> indices; // all LODs
+    // lods[0] is the full mesh, firstIndex is relative to the start of indices
+    std::span<const MeshLod> lods;
+    std::span<const CPUMesh::SkinningData> skinningData; // empty if no skeleton
+
+    glm::vec3 minPos;
+    glm::vec3 maxPos;
+    math::Sphere boundingSphere;
+
+    // debug info
+    std::string_view name;
+    float acmrBefore{0.f};
+    float acmrAfter{0.f};
+};
+
+// Owns converted data which MeshUploadData points to
+struct MeshUploadStorage {
+    std::vector<std::byte> vertices;
+    std::vector<std::byte> indices;
+    std::vector<MeshLod> lods;
+};
+
+namespace graphics
+{
+// Converts cpuMesh into GPU format. LODs are generated with lodSettings
+// (skinned meshes don't get LODs). The result points into storage and cpuMesh.
+MeshUploadData prepareMeshUpload(
+    const CPUMesh& cpuMesh,
+    const MeshLodSettings& lodSettings,
+    MeshUploadStorage& storage);
+}
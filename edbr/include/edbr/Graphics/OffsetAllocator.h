@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+
+// OffsetAllocator manages ranges [offset, offset + size) inside [0, capacity).
+// It doesn't own any memory - it's used for sub-allocating big GPU buffers
+// (see MeshCache). Free ranges are coalesced when allocations are freed.
+class OffsetAllocator {
+public:
+    static constexpr std::uint32_t INVALID_OFFSET = std::numeric_limits<std::uint32_t>::max();
+
+    struct Allocation {
+        std::uint32_t offset{INVALID_OFFSET};
+        std::uint32_t size{0};
+
+        bool isValid() const { return offset != INVALID_OFFSET; }
+    };
+
+public:
+    void init(std::uint32_t capacity);
+
+    // Returns invalid allocation if there's no free range big enough
+    Allocation allocate(std::uint32_t size);
+    void free(const Allocation& allocation);
+
+    // Makes [capacity, newCapacity) available for allocation
+    void grow(std::uint32_t newCapacity);
+
+    std::uint32_t getCapacity() const { return capacity; }
+    std::uint32_t getUsedSize() const { return usedSize; }
+    std::size_t getNumFreeRanges() const { return freeRanges.size(); }
+
+private:
+    void addFreeRange(std::uint32_t offset, std::uint32_t size);
+
+    std::uint32_t capacity{0};
+    std::uint32_t usedSize{0};
+    std::map<std::uint32_t, std::uint32_t> freeRanges; // offset -> size
+};
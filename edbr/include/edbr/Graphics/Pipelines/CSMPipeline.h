@@ -1,38 +1,70 @@
 #pragma once
 
 #include <array>
+#include <functional>
 #include <vector>
 
 #include <vulkan/vulkan.h>
 
 #include <edbr/Graphics/Camera.h>
 
+#include <edbr/Graphics/Common.h>
+#include <edbr/Graphics/DrawStats.h>
+#include <edbr/Graphics/FrustumCulling.h>
 #include <edbr/Graphics/IdTypes.h>
+#include <edbr/Graphics/RenderGraph.h>
+#include <edbr/Graphics/Vulkan/GPUBuffer.h>
+#include <edbr/Math/Sphere.h>
 
 class GfxDevice;
 class MeshCache;
+class MeshCullingPipeline;
 struct MeshDrawCommand;
-struct GPUBuffer;
 
 class CSMPipeline {
 public:
     static const int NUM_SHADOW_CASCADES = 3;
 
 public:
+    // Creates the pipeline and buffers - can be done on a worker thread together
+    // with other pipelines. initCSMData should be called after it on the main thread.
     void init(GfxDevice& gfxDevice, const std::array<float, NUM_SHADOW_CASCADES>& percents);
+    // creates shadow maps
+    void initCSMData(GfxDevice& gfxDevice);
     void cleanup(GfxDevice& gfxDevice);
 
-    void draw(
-        VkCommandBuffer cmd,
+    // Calculates cascades for the frame, should be called before addPasses
+    void updateCascades(
         const GfxDevice& gfxDevice,
-        const MeshCache& meshCache,
         const Camera& camera,
         const glm::vec3& sunlightDirection,
+        const std::vector<MeshDrawCommand>& meshDrawCommands,
+        const std::vector<std::size_t>& sortedMeshDrawCommands,
+        bool shadowsEnabled);
+
+    // Adds the passes which draw shadow casters into the shadow map and
+    // returns it - the passes which sample the shadow map should read it.
+    // The passes reference the arguments, so they should be alive until the
+    // graph is executed.
+    RenderGraph::ResourceId addPasses(
+        RenderGraph& graph,
+        GfxDevice& gfxDevice,
+        const MeshCache& meshCache,
         const GPUBuffer& materialsBuffer,
         const std::vector<MeshDrawCommand>& meshDrawCommands,
+        const std::vector<std::size_t>& sortedMeshDrawCommands,
+        const SphereSoA& drawBoundingSpheres, // in sorted order
+        const MeshCullingPipeline& meshCullingPipeline,
+        RenderGraph::ResourceId skinnedVertices,
         bool shadowsEnabled);
 
     ImageId getShadowMap() { return csmShadowMapID; }
+    const std::array<DrawStats, NUM_SHADOW_CASCADES>& getStats() const { return stats; }
+    // shadow casters of each cascade are culled with these (set by updateCascades)
+    const std::array<Frustum, NUM_SHADOW_CASCADES>& getCasterCullingFrustums() const
+    {
+        return casterCullingFrustums;
+    }
 
     std::array<float, NUM_SHADOW_CASCADES> cascadeFarPlaneZs{};
     std::array<glm::mat4, NUM_SHADOW_CASCADES> csmLightSpaceTMs{};
@@ -40,22 +72,101 @@ public:
     // how cascades are distributed
     std::array<float, NUM_SHADOW_CASCADES> percents;
 
+    // If enabled, static casters are rendered into a separate shadow map
+    // which is only redrawn when the sun or the cascade bounds change
+    // too much. Each frame this map is copied into the CSM shadow map and
+    // then dynamic casters are drawn on top of it.
+    bool staticShadowCacheEnabled{true};
+    // how much cached cascades are bigger than the cascades they contain
+    // (so that the camera can move a bit without cache invalidation)
+    float staticShadowCacheMargin{0.25f};
+
+    // Casters are drawn with LOD = main view's LOD + shadowLodBias (clamped
+    // to the last LOD of the mesh): shadows don't need as much detail.
+    // Cached static casters use cascade index + shadowLodBias instead, so
+    // that the cache isn't redrawn when the main view's LODs change.
+    std::uint32_t shadowLodBias{1};
+
+    // if true, cascades are recorded into secondary command buffers in parallel
+    bool parallelRecording{true};
+
+    // number of static cascade redraws since the start (for dev tools)
+    std::uint32_t numStaticCascadeRedraws{0};
+
 private:
-    void initCSMData(GfxDevice& device);
+    enum class CasterType {
+        None, // only clear the shadow map
+        All,
+        Static,
+        Dynamic,
+    };
+
+    void drawCasters(
+        VkCommandBuffer cmd,
+        const GfxDevice& gfxDevice,
+        const MeshCache& meshCache,
+        const GPUBuffer& materialsBuffer,
+        const std::vector<MeshDrawCommand>& meshDrawCommands,
+        const std::vector<std::size_t>& sortedMeshDrawCommands,
+        const MeshCullingPipeline& meshCullingPipeline,
+        std::size_t cascadeIndex,
+        VkImageView depthImageView,
+        bool clearDepth,
+        CasterType casterType);
+
+    // records each cascade either directly into cmd or into secondary command
+    // buffers in parallel (see parallelRecording)
+    void recordCascades(
+        VkCommandBuffer cmd,
+        GfxDevice& gfxDevice,
+        const std::function<void(VkCommandBuffer cmd, std::size_t cascadeIndex)>& recordCascade);
+
+    bool shouldRedrawStaticCascade(
+        std::size_t cascadeIndex,
+        const math::Sphere& cascadeBounds,
+        const glm::vec3& sunlightDirection) const;
 
     ImageId csmShadowMapID{NULL_IMAGE_ID};
     float shadowMapTextureSize{4096.f};
     std::array<Camera, NUM_SHADOW_CASCADES> cascadeCameras;
     std::array<VkImageView, NUM_SHADOW_CASCADES> csmShadowMapViews;
 
+    // static shadow cache
+    ImageId staticShadowMapID{NULL_IMAGE_ID};
+    std::array<VkImageView, NUM_SHADOW_CASCADES> staticShadowMapViews;
+    struct StaticCascade {
+        bool valid{false};
+        math::Sphere bounds; // bounds of the cascade when it was cached (without margin)
+        math::Sphere cachedBounds; // bounds which the cached cascade covers
+        glm::vec3 sunlightDirection;
+        Camera camera;
+        // the cascade is only valid if the frame which redraws it gets submitted
+        bool redrawPending{false};
+        std::uint32_t redrawFrameNumber{0};
+    };
+    std::array<StaticCascade, NUM_SHADOW_CASCADES> staticCascades;
+    std::array<bool, NUM_SHADOW_CASCADES> redrawStaticCascade{};
+    std::size_t staticCastersHash{0};
+
     VkPipelineLayout pipelineLayout;
     VkPipeline pipeline;
 
     struct PushConstants {
-        glm::mat4 mvp;
-        VkDeviceAddress vertexBuffer;
+        glm::mat4 viewProj;
+        VkDeviceAddress drawDataBuffer;
+        VkDeviceAddress instancesBuffer;
         VkDeviceAddress materialsBuffer;
-        std::uint32_t materialId;
-        std::uint32_t padding;
     };
+
+    struct PerFrameData {
+        // indices of visible draws in MeshCullingPipeline's draw data buffer
+        // (each cascade has a range of MeshCullingPipeline::MAX_DRAWS instances)
+        GPUBuffer instancesBuffer;
+        std::array<std::uint32_t, NUM_SHADOW_CASCADES> numCascadeInstances{};
+    };
+    std::array<PerFrameData, graphics::FRAME_OVERLAP> framesData;
+
+    std::array<DrawStats, NUM_SHADOW_CASCADES> stats;
+    std::array<Frustum, NUM_SHADOW_CASCADES> casterCullingFrustums;
+    std::array<VisibilityMask, NUM_SHADOW_CASCADES> cascadeVisibility;
 };
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+#include <edbr/Graphics/IdTypes.h>
+#include <edbr/Graphics/Vulkan/Descriptors.h>
+
+class GfxDevice;
+struct GPUImage;
+
+// HiZPipeline builds a hierarchical depth pyramid from the depth buffer.
+// Each texel of the pyramid stores the farthest depth of the area it covers
+// in the previous level, so that MeshCullingPipeline can check if an object
+// is hidden behind already drawn geometry with a few texel fetches.
+class HiZPipeline {
+public:
+    void init(GfxDevice& gfxDevice);
+    void cleanup(GfxDevice& gfxDevice);
+
+    // Should be called each time the depth image is (re)created. If the size
+    // of the depth image has changed, the pyramid is recreated (with a new
+    // id). The old resources are destroyed once the frames in flight finish.
+    void setDepthImage(GfxDevice& gfxDevice, const GPUImage& depthImage);
+
+    // depth image should be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    void build(VkCommandBuffer cmd, const GfxDevice& gfxDevice, const glm::mat4& viewProj);
+
+    // false until the pyramid is built for the first time
+    bool isPyramidValid() const { return pyramidValid; }
+    ImageId getPyramid() const { return pyramidId; }
+    // view-projection matrix of the camera which the pyramid was built with
+    const glm::mat4& getPyramidViewProj() const { return pyramidViewProj; }
+
+private:
+    void initDescAllocator(VkDevice device);
+    void destroyPyramidViews(VkDevice device);
+    VkDescriptorSet createMipDescSet(
+        VkDevice device,
+        std::uint32_t level,
+        VkImageView depthImageView);
+
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    VkDescriptorSetLayout descSetLayout;
+    DescriptorAllocatorGrowable descAllocator;
+    VkSampler depthSampler;
+
+    struct PushConstants {
+        glm::ivec2 inImageSize;
+        glm::ivec2 outImageSize;
+    };
+
+    ImageId pyramidId{NULL_IMAGE_ID};
+    glm::ivec2 depthImageSize;
+    // one view and one set per mip level: level N is downsampled from level N-1
+    // (and level 0 - from the depth image)
+    std::vector<VkImageView> mipViews;
+    std::vector<VkDescriptorSet> mipDescSets;
+
+    bool pyramidValid{false};
+    glm::mat4 pyramidViewProj;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include <edbr/Graphics/Vulkan/GPUBuffer.h>
+
+class GfxDevice;
+
+// LightClusteringPipeline splits the camera frustum into clusters (screen
+// tiles which are split into depth slices) and finds which point and spot
+// lights affect each cluster. This allows mesh.frag to only go through the
+// lights of the fragment's cluster instead of all lights in the scene.
+class LightClusteringPipeline {
+public:
+    // keep in sync with light_clusters.glsl
+    static constexpr std::uint32_t NUM_CLUSTERS_X = 16;
+    static constexpr std::uint32_t NUM_CLUSTERS_Y = 9;
+    static constexpr std::uint32_t NUM_CLUSTERS_Z = 24;
+    static constexpr std::uint32_t NUM_CLUSTERS = NUM_CLUSTERS_X * NUM_CLUSTERS_Y * NUM_CLUSTERS_Z;
+    static constexpr std::uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+
+public:
+    void init(GfxDevice& gfxDevice);
+    void cleanup(GfxDevice& gfxDevice);
+
+    // sceneDataBuffer should already contain the camera and lights data
+    void buildClusters(VkCommandBuffer cmd, const GPUBuffer& sceneDataBuffer);
+
+    const GPUBuffer& getClustersBuffer() const { return clustersBuffer; }
+
+private:
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    struct PushConstants {
+        VkDeviceAddress sceneDataBuffer;
+        VkDeviceAddress clustersBuffer;
+    };
+
+    // written and read only on GPU, so one buffer is enough for all frames
+    GPUBuffer clustersBuffer;
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <edbr/Graphics/Common.h>
+#include <edbr/Graphics/IdTypes.h>
+#include <edbr/Graphics/Vulkan/AppendableBuffer.h>
+
+struct Frustum;
+struct VisibilityMask;
+struct MeshDrawCommand;
+class MeshCache;
+class GfxDevice;
+class HiZPipeline;
+
+// MeshCullingPipeline uploads all MeshDrawCommands of the frame into a SSBO
+// once and then culls them (on GPU or CPU). Visible draws of each batch are
+// written into the instances buffer, so that each batch can be drawn with
+// a single instanced draw (see mesh.vert).
+//
+// GPU culling can also do two-phase occlusion culling:
+// - Early pass: the draws which are inside the frustum and are not occluded
+//   in the Hi-Z pyramid of the previous frame are drawn first.
+// - The pyramid is then rebuilt from the depth of the early pass and the draws
+//   which were rejected as occluded are tested against it again. The ones which
+//   turn out to be visible are drawn in the late pass, so nothing pops in when
+//   the camera moves quickly.
+class MeshCullingPipeline {
+public:
+    enum class Pass {
+        Early,
+        Late,
+    };
+
+    // keep in sync with mesh_draw_data.glsl
+    struct GPUMeshDrawData {
+        glm::mat4 transform;
+        glm::vec4 boundingSphere; // xyz - center, w - radius (world space)
+        // PackedQuantized positions are decoded as positionMin + q * positionExtent
+        glm::vec3 positionMin;
+        std::uint32_t vertexFormat; // VertexFormat
+        glm::vec3 positionExtent;
+        std::uint32_t materialId;
+        VkDeviceAddress vertexBuffer;
+        std::uint32_t batchIndex;
+        std::uint32_t batchFirstDraw;
+    };
+
+    // Consecutive non-skinned draws which use the same mesh LOD are grouped into
+    // batches (skinned meshes always get their own batch). Each batch gets its
+    // own range in the instances buffer and its own VkDrawIndexedIndirectCommand
+    // in the draw commands buffer.
+    struct DrawBatch {
+        MeshId meshId;
+        std::uint32_t lod;
+        std::uint32_t firstDraw;
+        std::uint32_t numDraws;
+        std::uint32_t numVisibleDraws; // only set by cullOnCPU
+        VkIndexType indexType; // same as mesh's
+        bool skinned;
+    };
+
+    // capacity of the per-frame buffers - uploadDrawData skips the draws
+    // after the first MAX_DRAWS (in sorted order)
+    static constexpr std::size_t MAX_DRAWS = 20000;
+
+public:
+    void init(GfxDevice& gfxDevice);
+    void cleanup(GfxDevice& gfxDevice);
+
+    void uploadDrawData(
+        std::size_t frameIndex,
+        const MeshCache& meshCache,
+        const std::vector<MeshDrawCommand>& drawCommands,
+        const std::vector<std::size_t>& sortedDrawCommands);
+
+    // if hiZPipeline is nullptr, only frustum culling is done and the late pass
+    // doesn't need to be performed
+    void cull(
+        VkCommandBuffer cmd,
+        const GfxDevice& gfxDevice,
+        const Frustum& frustum,
+        const HiZPipeline* hiZPipeline);
+    // hiZPipeline's pyramid should be built from the depth of the early pass
+    void cullLate(VkCommandBuffer cmd, const GfxDevice& gfxDevice, const HiZPipeline& hiZPipeline);
+    // visibility[i] corresponds to i-th draw in sorted order, the visible
+    // instances are copied to GPU with cmd
+    void cullOnCPU(VkCommandBuffer cmd, std::size_t frameIndex, const VisibilityMask& visibility);
+
+    const GPUBuffer& getDrawDataBuffer(std::size_t frameIndex) const;
+    const GPUBuffer& getInstancesBuffer(std::size_t frameIndex, Pass pass = Pass::Early) const;
+    const GPUBuffer& getDrawCommandsBuffer(std::size_t frameIndex, Pass pass = Pass::Early) const;
+    const std::vector<DrawBatch>& getDrawBatches() const { return drawBatches; }
+
+    // When culling on GPU, the number is read back from the culling stats,
+    // so it's FRAME_OVERLAP frames late
+    std::uint32_t getNumVisibleDraws() const { return numVisibleDraws; }
+    // Number of draws which were inside the frustum, but were occluded
+    // in both passes. Also FRAME_OVERLAP frames late.
+    std::uint32_t getNumOccludedDraws() const { return numOccludedDraws; }
+
+private:
+    VkPipelineLayout cullingPipelineLayout;
+    VkPipeline cullingPipeline;
+
+    // keep in sync with mesh_cull.comp
+    struct GPUCullingData {
+        std::array<glm::vec4, 6> frustumPlanes; // xyz - normal, w - distance
+        glm::mat4 viewProj; // camera which the Hi-Z pyramid was built with
+        glm::vec2 pyramidSize;
+        std::uint32_t pyramidId;
+        std::uint32_t pyramidNumLevels;
+        std::uint32_t occlusionCulling;
+    };
+
+    // keep in sync with mesh_cull.comp
+    struct GPUCullingStats {
+        std::uint32_t numVisibleDraws;
+        std::uint32_t numOccludedDraws;
+    };
+
+    struct PushConstants {
+        VkDeviceAddress cullingData;
+        VkDeviceAddress drawDataBuffer;
+        VkDeviceAddress instancesBuffer;
+        VkDeviceAddress drawCommandsBuffer;
+        VkDeviceAddress visibilityBuffer;
+        VkDeviceAddress statsBuffer;
+        std::uint32_t numDraws;
+        std::uint32_t latePass;
+    };
+
+    // Buffers which are written by the culling shader are only accessed by GPU:
+    // CPU writes into the upload buffers which are copied into them, and the
+    // stats are copied into a small readback buffer.
+    struct PerFrameData {
+        AppendableBuffer<GPUMeshDrawData> drawDataBuffer;
+        // indices of visible draws in drawDataBuffer, grouped by batch
+        GPUBuffer instancesBuffer;
+        GPUBuffer lateInstancesBuffer;
+        GPUBuffer instancesUploadBuffer; // written by cullOnCPU
+        // one command per batch (with instanceCount = 0)
+        AppendableBuffer<VkDrawIndexedIndirectCommand> drawCommandsUploadBuffer;
+        GPUBuffer drawCommandsBuffer;
+        // same commands, but instance counts are set by the late pass
+        GPUBuffer lateDrawCommandsBuffer;
+
+        // one GPUCullingData for each pass
+        GPUBuffer cullingDataBuffer;
+        // one uint per draw: 0 if the draw needs to be tested in the late pass
+        GPUBuffer visibilityBuffer;
+        GPUBuffer statsBuffer;
+        GPUBuffer statsReadbackBuffer;
+        bool culledOnGPU{false}; // statsReadbackBuffer is only written by GPU culling
+    };
+
+    void dispatchCulling(
+        VkCommandBuffer cmd,
+        const GfxDevice& gfxDevice,
+        Pass pass,
+        const GPUCullingData& cullingData);
+    std::array<PerFrameData, graphics::FRAME_OVERLAP> framesData;
+
+    std::vector<DrawBatch> drawBatches;
+    std::uint32_t numVisibleDraws{0};
+    std::uint32_t numOccludedDraws{0};
+    bool drawLimitExceeded{false}; // during the last uploadDrawData (only warned once)
+};
@@ -2,16 +2,14 @@
 
 #include <glm/mat4x4.hpp>
 
-#include <vector>
-
 #include <vulkan/vulkan.h>
 
+#include <edbr/Graphics/Pipelines/MeshCullingPipeline.h>
+
 class GfxDevice;
 class MeshCache;
-class Camera;
 struct GPUImage;
 struct GPUBuffer;
-struct MeshDrawCommand;
 
 class MeshPipeline {
 public:
@@ -22,23 +20,26 @@ public:
         VkSampleCountFlagBits samples);
     void cleanup(VkDevice device);
 
-    void draw(
+    // Draws batches [firstBatch, firstBatch + numBatches) of meshCullingPipeline
+    // and returns the number of draw calls. Doesn't modify the pipeline, so
+    // different ranges can be recorded into different command buffers in parallel.
+    std::uint32_t draw(
         VkCommandBuffer cmd,
         VkExtent2D renderExtent,
         const GfxDevice& gfxDevice,
         const MeshCache& meshCache,
-        const Camera& camera,
         const GPUBuffer& sceneDataBuffer,
-        const std::vector<MeshDrawCommand>& drawCommands,
-        const std::vector<std::size_t>& sortedDrawCommands);
+        const MeshCullingPipeline& meshCullingPipeline,
+        bool gpuCulling,
+        MeshCullingPipeline::Pass pass,
+        std::size_t firstBatch,
+        std::size_t numBatches) const;
 
 private:
     struct PushConstants {
-        glm::mat4 transform;
         VkDeviceAddress sceneDataBuffer;
-        VkDeviceAddress vertexBuffer;
-        std::uint32_t materialId;
-        std::uint32_t padding;
+        VkDeviceAddress drawDataBuffer;
+        VkDeviceAddress instancesBuffer;
     };
 
     VkPipelineLayout pipelineLayout;
@@ -5,6 +5,7 @@
 #include <vulkan/vulkan.h>
 
 #include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
 
 #include <edbr/Graphics/Common.h>
 #include <edbr/Graphics/Vulkan/AppendableBuffer.h>
@@ -13,37 +14,59 @@ struct MeshDrawCommand;
 class MeshCache;
 class GfxDevice;
 
+// SkinningPipeline skins all meshes of the frame with a single dispatch.
+// Each skinned mesh gets a job in the jobs buffer, each thread of the
+// dispatch finds its job and skins one vertex.
 class SkinningPipeline {
 public:
     void init(GfxDevice& gfxDevice);
     void cleanup(GfxDevice& gfxDevice);
 
-    void doSkinning(
-        VkCommandBuffer cmd,
-        std::size_t frameIndex,
-        const MeshCache& meshCache,
-        const MeshDrawCommand& dc);
-
     void beginDrawing(std::size_t frameIndex);
     std::size_t appendJointMatrices(
         std::span<const glm::mat4> jointMatrices,
         std::size_t frameIndex);
 
+    // dc's mesh will be skinned into dc.skinnedMesh->skinnedVertexBuffers[frameIndex]
+    void addJob(std::size_t frameIndex, const MeshCache& meshCache, const MeshDrawCommand& dc);
+    bool hasJobs(std::size_t frameIndex) const;
+    std::size_t getNumJobs(std::size_t frameIndex) const;
+
+    void doSkinning(VkCommandBuffer cmd, std::size_t frameIndex);
+
 private:
     VkPipelineLayout skinningPipelineLayout;
     VkPipeline skinningPipeline;
-    struct PushConstants {
-        VkDeviceAddress jointMatricesBuffer;
+
+    // keep in sync with skinning.comp
+    // (the fields are ordered so that std430 layout matches C++ layout)
+    struct GPUSkinningJob {
+        // for decoding of PackedQuantized input positions
+        glm::vec3 positionMin;
+        std::uint32_t inputVertexFormat; // VertexFormat
+        glm::vec3 positionExtent;
         std::uint32_t jointMatricesStartIndex;
-        std::uint32_t numVertices;
         VkDeviceAddress inputBuffer;
         VkDeviceAddress skinningData;
+        // vertices are written in graphics::getSkinnedVertexFormat(inputVertexFormat)
         VkDeviceAddress outputBuffer;
+        std::uint32_t numVertices;
+        std::uint32_t firstThread; // sum of numVertices of all previous jobs
+    };
+
+    struct PushConstants {
+        VkDeviceAddress jointMatricesBuffer;
+        VkDeviceAddress jobsBuffer;
+        std::uint32_t numJobs;
+        std::uint32_t numThreads;
     };
     static constexpr std::size_t MAX_JOINT_MATRICES = 5000;
+    static constexpr std::size_t MAX_SKINNING_JOBS = 1000;
 
     struct PerFrameData {
         AppendableBuffer<glm::mat4> jointMatricesBuffer;
+        AppendableBuffer<GPUSkinningJob> jobsBuffer;
+        std::uint32_t numThreads{0};
     };
 
     std::array<PerFrameData, graphics::FRAME_OVERLAP> framesData;
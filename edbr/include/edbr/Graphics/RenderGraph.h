@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <edbr/Graphics/IdTypes.h>
+#include <edbr/Graphics/Vulkan/Util.h>
+
+class GfxDevice;
+struct GPUImage;
+
+// RenderGraph records the passes of a frame in the order in which they were
+// added. Passes declare how they use images and buffers, and the graph
+// inserts the barriers between them (batched into one vkCmdPipelineBarrier2
+// per pass), so a pass doesn't need to know what was done to its resources
+// before it.
+//
+// Transient images (see createImage) only live during the frame: they're
+// allocated by the graph and the ones which are never used at the same time
+// share memory. Passes whose writes are never read are culled (see addPass).
+//
+// The graph is rebuilt each frame: resources and passes are added, then
+// compile() and execute() are called.
+class RenderGraph {
+public:
+    using ResourceId = std::uint32_t;
+
+    enum class Usage {
+        ColorAttachmentWrite,
+        DepthAttachmentWrite,
+        DepthResolveWrite, // resolve attachment of a multisampled depth attachment
+        VertexShaderRead,
+        FragmentShaderRead, // images are sampled in SHADER_READ_ONLY_OPTIMAL layout
+        ComputeShaderRead,
+        ComputeShaderWrite,
+        TransferRead,
+        TransferWrite,
+    };
+
+    struct Access {
+        ResourceId resource;
+        Usage usage;
+    };
+
+public:
+    RenderGraph(GfxDevice& gfxDevice);
+
+    // The contents of transient images are undefined at their first use in
+    // the frame. Images are matched with the previous frame's images by
+    // name: they're only reallocated when create infos or lifetimes change.
+    // Images with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT are put into lazily
+    // allocated memory if the device has it.
+    ResourceId createImage(const std::string& name, const vkutil::CreateImageInfo& createInfo);
+    // Images which are owned by someone else. The graph remembers their
+    // layouts between frames, so if preserveContents is true, the image
+    // shouldn't be transitioned outside of the graph.
+    ResourceId importImage(const std::string& name, ImageId id, bool preserveContents = true);
+    // Buffers are synced with global memory barriers, so one resource can
+    // stand for many buffers which are used the same way (e.g. all skinned
+    // vertex buffers). Their state is kept between frames by name, so they
+    // shouldn't be used outside of the graph.
+    ResourceId importBuffer(const std::string& name);
+    // The image is used after the graph is executed: passes which write it
+    // are never culled and its memory isn't shared with other images.
+    void markOutput(ResourceId id);
+
+    // A pass is culled if it declares writes and none of them are needed:
+    // read by the kept passes, imported or outputs. Passes without declared
+    // writes are always kept (e.g. compute passes which sync their own buffers).
+    void addPass(
+        std::string name,
+        std::vector<Access> accesses,
+        std::function<void(VkCommandBuffer cmd)> execute);
+
+    // culls passes and allocates transient images
+    void compile();
+    // can be called after compile (on the resources of the kept passes)
+    ImageId getImageId(ResourceId id) const;
+    const GPUImage& getImage(ResourceId id) const;
+
+    // records the kept passes and clears the graph for the next frame
+    void execute(VkCommandBuffer cmd);
+
+    // releases the transient images
+    void cleanup();
+
+    std::size_t getNumCulledPasses() const { return numCulledPasses; }
+    std::size_t getNumTransientImages() const { return transientImages.size(); }
+    std::size_t getNumMemoryBlocks() const { return memoryBlocks.size(); }
+
+private:
+    enum class ResourceType {
+        TransientImage,
+        ImportedImage,
+        Buffer,
+    };
+
+    struct ResourceState {
+        VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+        // stages and accesses which the next write (or layout transition) waits for
+        VkPipelineStageFlags2 writeStages{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 writeAccess{VK_ACCESS_2_NONE};
+        // reads since the last write - next reads in these stages don't need a barrier
+        VkPipelineStageFlags2 readStages{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 readAccess{VK_ACCESS_2_NONE};
+    };
+
+    struct Resource {
+        std::string name;
+        ResourceType type;
+        vkutil::CreateImageInfo createInfo{}; // transient images only
+        ImageId imageId{NULL_IMAGE_ID};
+        bool preserveContents{true};
+        bool isOutput{false};
+
+        // set by compile
+        bool used{false}; // by the kept passes
+        std::size_t firstPass{0};
+        std::size_t lastPass{0};
+        std::size_t memoryBlock{0}; // transient images only
+
+        // set by execute
+        ResourceState state;
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<Access> accesses;
+        std::function<void(VkCommandBuffer cmd)> execute;
+        bool culled{false};
+    };
+
+    struct BlockRequirements {
+        VkMemoryRequirements memory;
+        bool lazilyAllocated; // only transient attachments are put into the block
+    };
+
+    // transient image which was allocated for one of the previous frames
+    struct TransientImage {
+        std::string name;
+        vkutil::CreateImageInfo createInfo;
+        std::size_t memoryBlock;
+        ImageId id;
+    };
+
+    void cullPasses();
+    void calculateLifetimes();
+    // returns the memory block of each used transient image (indexed by ResourceId)
+    std::vector<std::size_t> assignMemoryBlocks(
+        std::vector<BlockRequirements>& blockRequirements) const;
+    void allocateTransientImages();
+    void releaseTransientImages();
+
+    void initResourceStates();
+    void addBarriers(
+        const Pass& pass,
+        std::vector<VkImageMemoryBarrier2>& imageBarriers,
+        VkMemoryBarrier2& memoryBarrier);
+    void saveResourceStates();
+    void applyPendingResourceStates();
+
+    GfxDevice& gfxDevice;
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    bool compiled{false};
+    std::size_t numCulledPasses{0};
+
+    std::vector<TransientImage> transientImages;
+    std::vector<VmaAllocation> memoryBlocks;
+    // image which used each memory block last during execute
+    std::vector<ResourceId> blockOccupants;
+
+    // kept between frames
+    std::unordered_map<ImageId, VkImageLayout> importedImageLayouts;
+    std::unordered_map<std::string, ResourceState> bufferStates;
+    // states after the last execute - only applied if its frame was submitted
+    std::unordered_map<ImageId, VkImageLayout> pendingImageLayouts;
+    std::unordered_map<std::string, ResourceState> pendingBufferStates;
+    std::uint32_t pendingFrameNumber{0};
+    bool hasPendingStates{false};
+};
@@ -42,7 +42,13 @@ struct Scene {
     std::vector<Skeleton> skeletons;
     std::unordered_map<std::string, SkeletalAnimation> animations;
     std::vector<Light> lights;
+    // has an entry for each mesh which the scene added to MeshCache
     std::unordered_map<MeshId, CPUMesh> cpuMeshes;
+
+    // resources which the scene owns, they're released when the scene is
+    // unloaded (see SceneCache::unloadScene)
+    std::vector<MaterialId> materials;
+    std::vector<ImageId> images; // the scene holds a reference to each image
 };
 
 namespace edbr
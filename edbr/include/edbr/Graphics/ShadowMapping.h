@@ -4,9 +4,22 @@
 
 #include <glm/fwd.hpp>
 
+#include <edbr/Math/Sphere.h>
+
 class Camera;
+struct Frustum;
+
+// Bounding sphere of the frustum which is covered by a CSM cascade
+math::Sphere calculateCSMBounds(const std::array<glm::vec3, 8>& frustumCorners);
 
 Camera calculateCSMCamera(
     const std::array<glm::vec3, 8>& frustumCorners,
     const glm::vec3& lightDir,
     float shadowMapSize);
+
+Camera calculateCSMCamera(const math::Sphere& bounds, const glm::vec3& lightDir, float shadowMapSize);
+
+// Frustum for culling shadow casters of a cascade: the plane which faces the light is moved
+// to infinity, because objects between the light and the cascade can still cast shadows into it
+// (they're not clipped thanks to depth clamp)
+Frustum createCSMCasterCullingFrustum(const Camera& csmCamera, const glm::vec3& lightDir);
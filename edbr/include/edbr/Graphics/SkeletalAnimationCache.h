@@ -13,6 +13,8 @@ public:
     using AnimationsMap = std::unordered_map<std::string, SkeletalAnimation>;
     void addAnimations(const std::filesystem::path& gltfPath, AnimationsMap anims);
     const AnimationsMap& getAnimations(const std::filesystem::path& gltfPath) const;
+    // the animations must not be used by any entity after this call
+    void removeAnimations(const std::filesystem::path& gltfPath);
 
 private:
     // gltf path -> animations
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -26,6 +27,9 @@ public:
     float getNormalizedProgress() const;
 
     const std::vector<glm::mat4>& getJointMatrices() const { return jointMatrices; };
+    // Changes each time joint matrices are recalculated. Versions are unique
+    // across all animators, so skinned vertices can be cached by pose version.
+    std::uint64_t getPoseVersion() const { return poseVersion; }
 
     bool hasFrameChanged() const { return frameChanged; }
     int getCurrentFrame() const { return currentFrame; }
@@ -48,4 +52,5 @@ private:
     bool frameChanged{false};
 
     std::vector<glm::mat4> jointMatrices;
+    std::uint64_t poseVersion{0};
 };
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <edbr/Graphics/IdTypes.h>
+#include <edbr/Graphics/KTX2.h>
+#include <edbr/Graphics/Vulkan/GPUImage.h>
+
+class GfxDevice;
+class ImageCache;
+
+// Streams mips of cooked (KTX2) images in and out depending on how big the
+// meshes which use them are on the screen.
+// Images are first loaded with mips not bigger than MIN_RESIDENT_MIP_SIZE.
+// Each frame the renderer requests the resolution needed for the visible
+// meshes (see requestResolution) and update() loads the missing mips of the
+// biggest on-screen images first. When the budget is exceeded, the mips which
+// are not needed anymore are dropped in LRU order, and then the mips of the
+// smallest on-screen images.
+// Changing resident mips creates a new image which replaces the old one under
+// the same ImageId, so materials don't need to be updated. Mips which are
+// streamed in are read from the cooked file on a worker thread, dropped mips
+// are copied out of the current image on GPU. The replacement is done once the
+// new image is uploaded. Bindless descriptors which are used by frames in
+// flight can't be rewritten, so update() waits for these frames before
+// swapping the images - the swaps are batched to not stall every frame.
+class TextureStreamer {
+public:
+    static constexpr std::uint32_t MIN_RESIDENT_MIP_SIZE = 128;
+
+    struct StreamedImage {
+        std::filesystem::path cookedPath;
+        VkImageUsageFlags usage;
+        VkFormat format;
+        std::uint32_t width; // of mip 0
+        std::uint32_t height;
+        std::uint32_t numMips;
+        std::uint32_t minResidentMip; // the biggest mip which is never dropped
+        std::uint32_t residentMip; // the biggest mip which is on GPU
+        std::size_t residentSize; // in bytes
+        std::uint32_t wantedMip;
+
+        // max size of the meshes using the image on the screen, in pixels
+        float requestedScreenSize{0.f};
+        std::uint32_t lastRequestFrame{0};
+
+        bool pendingSwap{false}; // the new image is being loaded or uploaded
+        bool streamingFailed{false}; // the cooked file changed or got removed
+    };
+
+public:
+    TextureStreamer(GfxDevice& gfxDevice, ImageCache& imageCache);
+
+    // data is what was uploaded to the image with the id
+    void addImage(
+        ImageId id,
+        const std::filesystem::path& cookedPath,
+        const CompressedImageData& data,
+        VkImageUsageFlags usage);
+    // Stops streaming the image (called by ImageCache when the image is removed)
+    void removeImage(ImageId id);
+    // Should be called each frame for the images which are visible.
+    // screenSize is the size of the mesh which uses the image on the screen
+    // in pixels (can be infinite if the camera is inside the mesh)
+    void requestResolution(ImageId id, float screenSize);
+
+    // Should be called at the start of the frame, when the frame's fence was waited on
+    void update();
+    // Destroys the images which were not swapped in yet (ImageCache destroys the rest)
+    void cleanup();
+
+    void setBudget(std::size_t budget) { this->budget = budget; }
+    std::size_t getBudget() const { return budget; }
+    // size of the mips which are resident (or will be resident after pending swaps)
+    std::size_t getResidentSize() const { return residentSize; }
+    const std::unordered_map<ImageId, StreamedImage>& getImages() const { return images; }
+
+    // how many texels of mip 0 are needed per pixel of the mesh's on-screen size - a
+    // mesh is usually covered by the texture more than once (e.g. tiling or atlases)
+    float texelsPerPixel{2.f};
+    // limits the size of the mips which start loading from disk each frame
+    // (and which are uploaded once they're loaded)
+    std::size_t maxUploadSizePerFrame{16 * 1024 * 1024};
+    // waiting for frames in flight is only done once in this many frames
+    std::uint32_t swapInterval{8};
+
+private:
+    std::uint32_t calculateWantedMip(const StreamedImage& image) const;
+    std::size_t getSizeWithMips(const StreamedImage& image, std::uint32_t firstMip) const;
+    // returns false if the budget can't be freed by dropping less important mips
+    bool makeRoom(std::size_t size, ImageId requestedId, float requestedScreenSize);
+    // Starts creating the image with the mips starting with firstMip, which will
+    // replace the current one. The accounting is updated right away.
+    void setResidentMip(ImageId id, StreamedImage& image, std::uint32_t firstMip);
+    // creates and uploads the images whose mips were loaded on the worker threads
+    void finishLoads();
+    void addPendingSwap(ImageId id, GPUImage image);
+    void swapImages();
+
+    GfxDevice& gfxDevice;
+    ImageCache& imageCache;
+
+    std::unordered_map<ImageId, StreamedImage> images;
+    std::size_t budget{256 * 1024 * 1024};
+    std::size_t residentSize{0};
+
+    struct PendingLoad {
+        ImageId id;
+        std::uint32_t firstMip;
+        // restored if the file can't be loaded
+        std::uint32_t prevResidentMip;
+        std::size_t prevResidentSize;
+        std::future<std::optional<CompressedImageData>> data;
+    };
+    std::vector<PendingLoad> pendingLoads;
+    // loads of the removed images - destroying a future waits for the load,
+    // so they're kept until they're finished
+    std::vector<std::future<std::optional<CompressedImageData>>> discardedLoads;
+
+    struct PendingSwap {
+        ImageId id;
+        GPUImage image;
+        std::uint64_t uploadBatchId; // see VulkanUploadQueue::isBatchFinished
+    };
+    std::vector<PendingSwap> pendingSwaps;
+    std::uint32_t lastSwapFrame{0};
+    std::size_t frameUploadSize{0};
+};
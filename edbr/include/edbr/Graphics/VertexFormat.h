@@ -0,0 +1,25 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// keep in sync with vertex.glsl
+enum class VertexFormat : std::uint32_t {
+    Full = 0, // CPUMesh::Vertex
+    Packed = 1, // PackedVertex with float positions
+    PackedQuantized = 2, // PackedVertex with positions quantized in mesh's AABB
+};
+
+// Compact vertex - half the size of CPUMesh::Vertex (see VertexPacking.h)
+// keep in sync with vertex.glsl
+struct PackedVertex {
+    // Packed: float x, y, z
+    // PackedQuantized: unorm16 x, y | unorm16 z | unused
+    std::array<std::uint32_t, 3> position;
+    std::uint32_t normal; // octahedral, snorm16 x 2
+    // octahedral, snorm16 x 2 - the lowest bit of the second component is set
+    // if the bitangent is flipped (tangent.w < 0)
+    std::uint32_t tangent;
+    std::uint32_t uv; // half x 2
+};
+static_assert(sizeof(PackedVertex) == 24);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <edbr/Graphics/CPUMesh.h>
+#include <edbr/Graphics/VertexFormat.h>
+
+namespace graphics
+{
+// positions are only quantized if the quantization step (AABB size / 65535)
+// is not bigger than this
+inline constexpr float MAX_POSITION_QUANTIZATION_STEP = 0.0005f;
+
+std::size_t getVertexSize(VertexFormat format);
+// Skinned positions can leave the bind pose AABB, so skinning of packed
+// meshes always outputs float positions
+VertexFormat getSkinnedVertexFormat(VertexFormat format);
+// Chooses the most compact format which keeps enough precision
+VertexFormat choosePackedVertexFormat(const glm::vec3& minPos, const glm::vec3& maxPos);
+
+// octahedral encoding of unit vectors, result is in [-1;1]
+glm::vec2 octEncode(const glm::vec3& n);
+glm::vec3 octDecode(const glm::vec2& e);
+
+// minPos and maxPos are only used by PackedQuantized format
+PackedVertex packVertex(
+    const CPUMesh::Vertex& v,
+    VertexFormat format,
+    const glm::vec3& minPos,
+    const glm::vec3& maxPos);
+// same as decoding in vertex.glsl
+CPUMesh::Vertex unpackVertex(
+    const PackedVertex& v,
+    VertexFormat format,
+    const glm::vec3& minPos,
+    const glm::vec3& maxPos);
+}
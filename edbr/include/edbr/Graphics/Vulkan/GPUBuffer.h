@@ -3,10 +3,30 @@
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
 
+#include <edbr/Graphics/Vulkan/GPUMemoryStats.h>
+
+// Describes how the buffer is accessed - determines which memory it's allocated from.
+// Buffers of all classes except GPUOnly are persistently mapped (GPUBuffer::info.pMappedData)
+// and always HOST_COHERENT, so writes and reads don't need to be flushed/invalidated.
+enum class MemoryClass {
+    // Only accessed by GPU, or filled via transfers (e.g. with VulkanUploadQueue).
+    // Always device local, not mapped.
+    GPUOnly,
+    // Written by CPU (sequentially, e.g. with memcpy) and read by GPU, usually
+    // each frame. Allocated in device local host visible memory if it's big enough
+    // (ReBAR/UMA), host memory otherwise.
+    Streaming,
+    // Written by GPU and read by CPU. Allocated in host cached memory.
+    Readback,
+    // Copy source for transfers. Allocated in host memory.
+    Staging,
+};
+
 struct GPUBuffer {
     VkBuffer buffer{VK_NULL_HANDLE};
     VmaAllocation allocation;
     VmaAllocationInfo info;
+    MemoryCategory memoryCategory{MemoryCategory::Other};
 
     // Only for buffers created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
     // TODO: add check that this is not 0 if requesting address?
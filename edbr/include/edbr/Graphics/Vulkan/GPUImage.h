@@ -10,16 +10,19 @@
 
 #include <glm/vec2.hpp>
 
+#include <edbr/Graphics/Vulkan/GPUMemoryStats.h>
+
 struct GPUImage {
     VkImage image;
     VkImageView imageView;
-    VmaAllocation allocation;
+    VmaAllocation allocation{VK_NULL_HANDLE};
     VkFormat format;
     VkImageUsageFlags usage;
     VkExtent3D extent;
     std::uint32_t mipLevels{1};
     std::uint32_t numLayers{1};
     bool isCubemap{false};
+    MemoryCategory memoryCategory{MemoryCategory::Textures};
     std::string debugName{};
 
     static const auto NULL_BINDLESS_ID = std::numeric_limits<std::uint32_t>::max();
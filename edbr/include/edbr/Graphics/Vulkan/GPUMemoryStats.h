@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+// What the GPU memory is used for - only used for accounting (see GPUMemoryStats)
+enum class MemoryCategory {
+    Meshes, // mesh arenas (vertices, indices, skinning data)
+    SkinnedMeshes, // skinning output
+    Textures,
+    RenderTargets, // draw/depth images and images which are rendered into each frame
+    ShadowMaps,
+    PerFrameBuffers, // buffers which are rewritten each frame (draw data, instances, etc.)
+    Staging, // upload queue staging buffers
+    Other,
+
+    Count,
+};
+
+const char* getMemoryCategoryName(MemoryCategory category);
+
+// Tracks how much memory is allocated for each MemoryCategory and the
+// budgets of memory heaps. Categories are updated by GfxDevice when buffers
+// and images are created/destroyed (possibly from several threads).
+class GPUMemoryStats {
+public:
+    struct CategoryStats {
+        std::size_t size{0}; // in bytes
+        std::size_t count{0}; // number of buffers/images
+    };
+
+    struct HeapStats {
+        VkMemoryHeapFlags flags;
+        VkDeviceSize size;
+        // how much the app can use - with VK_EXT_memory_budget, it's provided by the
+        // OS/driver and can change, otherwise it's estimated as 80% of the heap size
+        VkDeviceSize budget;
+        // how much the app uses (including the memory allocated outside of VMA)
+        VkDeviceSize usage;
+        VkDeviceSize blockBytes; // allocated by VMA
+        VkDeviceSize allocationBytes; // occupied by allocations in VMA's blocks
+    };
+
+public:
+    void onAllocate(MemoryCategory category, std::size_t size);
+    void onFree(MemoryCategory category, std::size_t size);
+
+    // should be called each frame
+    void updateHeapStats(VmaAllocator allocator);
+
+    CategoryStats getCategoryStats(MemoryCategory category) const;
+    std::size_t getTotalSize() const;
+    const std::vector<HeapStats>& getHeapStats() const { return heaps; }
+
+    // returns the categories' stats and heap budgets as JSON
+    std::string toJson() const;
+
+private:
+    struct AtomicCategoryStats {
+        std::atomic<std::size_t> size{0};
+        std::atomic<std::size_t> count{0};
+    };
+    std::array<AtomicCategoryStats, (std::size_t)MemoryCategory::Count> categories;
+
+    std::vector<HeapStats> heaps;
+};
@@ -17,7 +17,8 @@ VkPipelineLayout createPipelineLayout(
 class PipelineBuilder {
 public:
     PipelineBuilder(VkPipelineLayout pipelineLayout);
-    VkPipeline build(VkDevice device);
+    // cache should usually be GfxDevice::getPipelineCache()
+    VkPipeline build(VkDevice device, VkPipelineCache cache = VK_NULL_HANDLE);
 
     PipelineBuilder& setShaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
     PipelineBuilder& setShaders(
@@ -66,7 +67,7 @@ public:
     ComputePipelineBuilder(VkPipelineLayout pipelineLayout);
     ComputePipelineBuilder& setShader(VkShaderModule shaderModule);
 
-    VkPipeline build(VkDevice device);
+    VkPipeline build(VkDevice device, VkPipelineCache cache = VK_NULL_HANDLE);
 
 private:
     VkPipelineLayout pipelineLayout;
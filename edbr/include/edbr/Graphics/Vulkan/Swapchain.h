@@ -2,6 +2,7 @@
 
 #include <array>
 #include <cstdint>
+#include <span>
 #include <vector>
 
 #include <vulkan/vulkan.h>
@@ -33,15 +34,20 @@ public:
 
     void beginFrame(VkDevice device, std::size_t frameIndex) const;
     void resetFences(VkDevice device, std::size_t frameIndex) const;
+    // waits until all submitted frames are finished on GPU
+    void waitForAllFrames(VkDevice device) const;
 
     // returns the image and its index
     std::pair<VkImage, std::uint32_t> acquireImage(VkDevice device, std::size_t frameIndex);
 
+    // extraWaitInfos - semaphores to wait on in addition to the swapchain semaphore
+    // (e.g. async compute work which the frame depends on)
     void submitAndPresent(
         VkCommandBuffer cmd,
         VkQueue graphicsQueue,
         std::size_t frameIndex,
-        std::uint32_t swapchainImageIndex);
+        std::uint32_t swapchainImageIndex,
+        std::span<const VkSemaphoreSubmitInfo> extraWaitInfos = {});
 
     VkImageView getImageView(std::size_t swapchainImageIndex)
     {
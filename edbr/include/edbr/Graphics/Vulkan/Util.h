@@ -8,6 +8,8 @@
 
 #include <glm/vec4.hpp>
 
+#include <edbr/Graphics/Vulkan/GPUMemoryStats.h>
+
 #define VK_CHECK(call)                 \
     do {                               \
         VkResult result_ = call;       \
@@ -30,6 +32,9 @@ struct CreateImageInfo {
     VkSampleCountFlagBits samples{VK_SAMPLE_COUNT_1_BIT};
     bool mipMap{false};
     bool isCubemap{false};
+    // if not 0, the image gets this number of mips instead of the full chain (mipMap is ignored)
+    std::uint32_t mipLevels{0};
+    MemoryCategory memoryCategory{MemoryCategory::Textures};
 };
 
 void transitionImage(
@@ -81,6 +86,12 @@ struct RenderingInfoParams {
     VkImageView depthImageView{VK_NULL_HANDLE};
     std::optional<float> depthImageClearValue;
     VkImageView resolveImageView{VK_NULL_HANDLE};
+    VkImageView depthResolveImageView{VK_NULL_HANDLE};
+    VkResolveModeFlagBits depthResolveMode{VK_RESOLVE_MODE_SAMPLE_ZERO_BIT};
+    // multisampled images whose contents are not needed after the resolve
+    // aren't stored (nothing is written to lazily allocated memory)
+    bool discardColorImage{false};
+    bool discardDepthImage{false};
 };
 
 struct RenderInfo {
@@ -97,6 +108,9 @@ void clearColorImage(
     VkImageView colorImageView,
     const glm::vec4& clearColor);
 
+// all aspects of the format: depth and stencil for combined depth/stencil formats
+VkImageAspectFlags getImageAspect(VkFormat format);
+
 int sampleCountToInt(VkSampleCountFlagBits count);
 const char* sampleCountToString(VkSampleCountFlagBits count);
 
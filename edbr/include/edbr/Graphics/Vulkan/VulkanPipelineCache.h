@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+#include <vulkan/vulkan.h>
+
+// VkPipelineCache which is loaded from a file on startup and written back on
+// exit, so that the driver doesn't compile the same shaders on each run.
+// The file starts with the device's vendor/device ids, driver version and
+// pipeline cache UUID - the data is discarded if any of them changed (drivers
+// should reject incompatible data themselves, but not all of them do it well).
+// The cache is internally synchronized, so pipelines can be created with it
+// from multiple threads.
+class VulkanPipelineCache {
+public:
+    void init(
+        VkDevice device,
+        const VkPhysicalDeviceProperties& deviceProps,
+        const std::filesystem::path& path);
+    // writes the cache to the file
+    void save() const;
+    void cleanup();
+
+    VkPipelineCache getCache() const { return cache; }
+    // size of the data loaded from the file, 0 if there was no (valid) file
+    std::size_t getLoadedDataSize() const { return loadedDataSize; }
+
+private:
+    VkDevice device{VK_NULL_HANDLE};
+    VkPipelineCache cache{VK_NULL_HANDLE};
+    VkPhysicalDeviceProperties deviceProps;
+    std::filesystem::path path;
+    std::size_t loadedDataSize{0};
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <edbr/Graphics/Vulkan/GPUBuffer.h>
+
+class GfxDevice;
+struct GPUImage;
+
+// Batches buffer and image uploads into a few submissions instead of waiting
+// for a fence after each resource.
+// The data is copied into a persistently mapped staging ring buffer right
+// away, so the source memory can be freed after the call. The copies are
+// executed on GPU when the batch is submitted - GfxDevice submits it before
+// each frame and the frame waits for it, so resources can be used for drawing
+// right after they're uploaded. Completion is tracked with a timeline
+// semaphore: each submit returns the value which signals that its uploads
+// are finished.
+// Buffer copies run on a dedicated transfer queue if the device has one.
+// Image uploads always run on the graphics queue (mipmaps are generated
+// with blits and images are not shared between queue families).
+class VulkanUploadQueue {
+public:
+    struct QueueInfo {
+        std::uint32_t family;
+        VkQueue queue{VK_NULL_HANDLE};
+    };
+
+    // transferQueue.queue can be VK_NULL_HANDLE - then all copies go to the graphics queue
+    void init(
+        GfxDevice& gfxDevice,
+        const QueueInfo& graphicsQueue,
+        const QueueInfo& transferQueue,
+        std::size_t stagingBufferSize);
+    void cleanup();
+
+    void uploadBuffer(VkBuffer dst, std::size_t dstOffset, std::span<const std::byte> data);
+    // Uploads mip 0 of the layer and generates the rest of the mips (if the
+    // image has them). The image is in SHADER_READ_ONLY_OPTIMAL layout after
+    // the upload.
+    void uploadImage(const GPUImage& image, std::span<const std::byte> data, std::uint32_t layer);
+    // Uploads all mips of the image (mip 0 first) as is, for images with
+    // pre-built mips (block compressed images can't be mipmapped with blits)
+    void uploadImageMips(const GPUImage& image, std::span<const std::vector<std::uint8_t>> mips);
+    // Copies the mips of src starting with srcFirstMip into all mips of dst.
+    // src should be in SHADER_READ_ONLY_OPTIMAL layout - it can still be
+    // sampled by the frames in flight, as they're submitted before the copy.
+    void copyImageMips(const GPUImage& src, std::uint32_t srcFirstMip, const GPUImage& dst);
+
+    bool hasPendingUploads() const;
+    // Submits uploads recorded since the last submit. Returns the value of
+    // the semaphore which is signaled when they're finished.
+    std::uint64_t submit();
+    bool isFinished(std::uint64_t value) const;
+    void wait(std::uint64_t value) const;
+    // Submits pending uploads and waits until all uploads are finished
+    void flush();
+    // Frees staging memory and command buffers of finished batches (doesn't block)
+    void collectFinishedBatches();
+
+    VkSemaphore getSemaphore() const { return semaphore; }
+    std::uint64_t getLastSubmittedValue() const { return lastSubmittedValue; }
+
+    // Id of the batch which records the uploads now (it's submitted by the
+    // next submit). The semaphore value of a batch is only known after the
+    // submit: it's incremented once per queue which the batch is split into.
+    std::uint64_t getCurrentBatchId() const { return lastSubmittedBatchId + 1; }
+    bool isBatchFinished(std::uint64_t batchId) const;
+
+private:
+    struct Lane {
+        QueueInfo queueInfo;
+        VkCommandPool commandPool{VK_NULL_HANDLE};
+        std::vector<VkCommandBuffer> freeCommandBuffers;
+        VkCommandBuffer cmd{VK_NULL_HANDLE}; // recorded now, null if there's nothing to submit
+    };
+    enum LaneIndex : std::size_t {
+        GRAPHICS_LANE = 0,
+        TRANSFER_LANE = 1,
+    };
+
+    struct Batch {
+        std::uint64_t id;
+        std::uint64_t value;
+        std::uint64_t stagingEnd;
+        std::array<VkCommandBuffer, 2> commandBuffers; // per lane
+        std::vector<GPUBuffer> tempBuffers;
+    };
+
+    struct StagingMemory {
+        VkBuffer buffer;
+        std::size_t offset; // in buffer
+        std::byte* data; // mapped memory at offset
+    };
+
+    VkCommandBuffer getCommandBuffer(LaneIndex laneIndex);
+    // returns staging buffer and offset in it
+    std::pair<VkBuffer, std::size_t> stage(std::span<const std::byte> data);
+    StagingMemory allocateStagingMemory(std::size_t size);
+    std::size_t allocateStaging(std::size_t size);
+
+    GfxDevice* gfxDevice{nullptr};
+    VkDevice device{VK_NULL_HANDLE};
+    bool hasTransferQueue{false};
+    std::array<Lane, 2> lanes;
+
+    VkSemaphore semaphore{VK_NULL_HANDLE}; // timeline semaphore
+    std::uint64_t lastSubmittedValue{0};
+    std::uint64_t lastSubmittedBatchId{0};
+
+    GPUBuffer stagingBuffer;
+    std::size_t stagingBufferSize{0};
+    // positions in the ring grow infinitely - offset in the buffer is
+    // (pos % stagingBufferSize). Everything in [stagingTail, stagingHead)
+    // is used by pending or in-flight uploads.
+    std::uint64_t stagingHead{0};
+    std::uint64_t stagingTail{0};
+    // uploads which don't fit into the ring get their own staging buffers
+    std::vector<GPUBuffer> pendingTempBuffers;
+
+    std::deque<Batch> batches; // submitted and not finished yet
+};
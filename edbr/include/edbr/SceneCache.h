@@ -1,15 +1,20 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include <edbr/Core/ThreadPool.h>
 #include <edbr/Graphics/Scene.h>
 
 class SkeletalAnimationCache;
 class GfxDevice;
 class MeshCache;
 class MaterialCache;
+struct PreparedScene;
 
 class SceneCache {
 public:
@@ -21,13 +26,45 @@ public:
 
     const Scene& addScene(const std::string& scenePath, Scene scene);
     const Scene& getScene(const std::string& scenePath) const;
+    bool hasScene(const std::string& scenePath) const;
+    std::vector<std::string> getScenePaths() const;
 
     [[nodiscard]] const Scene& loadOrGetScene(const std::filesystem::path& path);
 
+    // Removes the scene's meshes, materials and animations and releases its
+    // images. GPU resources are destroyed when the frames in flight are
+    // finished, but the scene's ids must not be used after this call.
+    void unloadScene(const std::string& scenePath);
+
+    // Non-blocking scene loading is done in two steps:
+    // 1. prepareScene loads the scene on CPU. It only reads the cache's
+    //    settings, so it can be called from a worker thread.
+    // 2. uploadPreparedScenePart is called on the main thread until it
+    //    returns true - then the scene is added to the cache.
+    std::unique_ptr<PreparedScene> prepareScene(const std::filesystem::path& path) const;
+    bool uploadPreparedScenePart(PreparedScene& preparedScene);
+
+    // If set, scenes are loaded from cooked files in this directory (see
+    // CookedScene.h). Missing or outdated cooked files are cooked on first load.
+    void setCookedSceneDir(const std::filesystem::path& dir) { cookedSceneDir = dir; }
+
 private:
+    std::unique_ptr<PreparedScene> prepareSceneWithThreadPool(
+        const std::filesystem::path& path,
+        ThreadPool* threadPool) const;
+    const Scene& addLoadedScene(Scene scene);
+
     std::unordered_map<std::string, Scene> sceneCache;
     GfxDevice& gfxDevice;
     MeshCache& meshCache;
     MaterialCache& materialCache;
     SkeletalAnimationCache& animationCache;
+
+    std::filesystem::path cookedSceneDir; // empty - cooking is disabled
+
+    // decodes textures of imported scenes
+    std::unique_ptr<ThreadPool> importThreadPool;
+    // The pool only runs one loop at a time. Scenes prepared while another
+    // thread holds it are decoded on the calling thread.
+    mutable std::mutex importThreadPoolMutex;
 };
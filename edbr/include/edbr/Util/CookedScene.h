@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+#include <edbr/Graphics/MeshLod.h>
+
+struct Scene;
+struct PreparedScene;
+class MeshCache;
+class MaterialCache;
+class GfxDevice;
+class ThreadPool;
+
+// Cooked scene is a binary file with everything which util::loadGltfFile
+// would produce on CPU: meshes are stored in GPU format (see MeshUploadData)
+// and all big arrays are aligned, so that the file is memory-mapped and
+// uploaded without any conversion. Textures are not cooked - materials
+// store their paths.
+
+struct SceneImportSettings {
+    bool packVertices{true};
+    MeshLodSettings lodSettings;
+    // if false, cooked (BC compressed) textures are not used - the device doesn't
+    // support them (textures are not cooked into scenes, so this isn't in the key)
+    bool compressedTextures{true};
+};
+
+namespace util
+{
+// Key changes when the .gltf, its buffers (.bin) or the import settings change
+std::uint64_t calculateCookedSceneKey(
+    const std::filesystem::path& gltfPath,
+    const SceneImportSettings& settings);
+
+// Returns "<cookedDir>/<gltf file name>-<key>.scene"
+std::filesystem::path getCookedScenePath(
+    const std::filesystem::path& cookedDir,
+    const std::filesystem::path& gltfPath,
+    std::uint64_t key);
+
+// Imports gltfPath and writes the cooked scene to cookedPath
+bool cookGltfFile(
+    const std::filesystem::path& gltfPath,
+    const std::filesystem::path& cookedPath,
+    const SceneImportSettings& settings,
+    std::uint64_t key);
+
+// CPU part of loadCookedScene (doesn't touch GPU, can be called from any thread).
+// Returns nullptr if the cooked file doesn't exist, is corrupted or was
+// cooked with a different key. Textures are decoded on threadPool if it's set.
+std::unique_ptr<PreparedScene> prepareCookedScene(
+    const std::filesystem::path& gltfPath,
+    const std::filesystem::path& cookedPath,
+    std::uint64_t key,
+    bool compressedTextures,
+    ThreadPool* threadPool = nullptr);
+
+// Returns std::nullopt if the cooked file doesn't exist, is corrupted or
+// was cooked with a different key. Nothing is uploaded to GPU in this case.
+std::optional<Scene> loadCookedScene(
+    GfxDevice& gfxDevice,
+    MeshCache& meshCache,
+    MaterialCache& materialCache,
+    const std::filesystem::path& gltfPath,
+    const std::filesystem::path& cookedPath,
+    std::uint64_t key,
+    ThreadPool* threadPool = nullptr);
+}
@@ -1,17 +1,53 @@
 #pragma once
 
 #include <filesystem>
+#include <string>
+#include <vector>
+
+#include <edbr/Graphics/CPUMesh.h>
+#include <edbr/Graphics/Material.h>
+#include <edbr/Graphics/Scene.h>
 
-struct Scene;
 class MeshCache;
 class MaterialCache;
 class GfxDevice;
+class ThreadPool;
+
+// Material with texture paths instead of loaded textures
+struct ImportedMaterial {
+    Material material;
+    // relative to .gltf file's dir, empty if the material doesn't have the texture
+    std::string diffuseTexture;
+    std::string normalMapTexture;
+    std::string metallicRoughnessTexture;
+    std::string emissiveTexture;
+};
+
+struct ImportedPrimitive {
+    CPUMesh mesh; // primitives without indices are not loaded
+    int materialIndex{-1}; // index in ImportedScene::materials
+};
+
+// glTF scene loaded on CPU - nothing is uploaded to GPU yet
+struct ImportedScene {
+    std::vector<ImportedMaterial> materials;
+    std::vector<std::vector<ImportedPrimitive>> meshes;
+    // nodes, skeletons, animations and lights (meshes and cpuMeshes are empty)
+    Scene scene;
+};
 
 namespace util
 {
+ImportedScene importGltfFile(const std::filesystem::path& path, bool packVertices = true);
+
+// If packVertices is true, meshes are stored in packed vertex format
+// (see VertexPacking.h) - positions are quantized if it's precise enough.
+// Textures are decoded on threadPool if it's set.
 Scene loadGltfFile(
     GfxDevice& gfxDevice,
     MeshCache& meshCache,
     MaterialCache& materialCache,
-    const std::filesystem::path& path);
+    const std::filesystem::path& path,
+    bool packVertices = true,
+    ThreadPool* threadPool = nullptr);
 }
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// Read-only memory mapped file. Pages are loaded by the OS on access,
+// so nothing is read until the data is used.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // empty files can't be mapped and are not "good"
+    bool isGood() const { return data != nullptr; }
+    std::span<const std::byte> getData() const { return {data, size}; }
+
+private:
+    const std::byte* data{nullptr};
+    std::size_t size{0};
+#ifdef _WIN32
+    void* fileHandle{nullptr};
+    void* mappingHandle{nullptr};
+#endif
+};
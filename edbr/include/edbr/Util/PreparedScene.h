@@ -0,0 +1,101 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <edbr/Graphics/CPUMesh.h>
+#include <edbr/Graphics/IdTypes.h>
+#include <edbr/Graphics/ImageLoader.h>
+#include <edbr/Graphics/KTX2.h>
+#include <edbr/Graphics/MeshUploadData.h>
+#include <edbr/Graphics/Scene.h>
+#include <edbr/Util/CookedScene.h>
+#include <edbr/Util/GltfLoader.h>
+#include <edbr/Util/MappedFile.h>
+
+class GfxDevice;
+class MeshCache;
+class MaterialCache;
+class ThreadPool;
+
+// Texture decoded on CPU (pixels are null if it failed to load or if the
+// cooked image was loaded instead)
+struct PreparedTexture {
+    std::filesystem::path path;
+    VkFormat format;
+    ImageData data;
+    std::optional<CompressedImageData> cookedData;
+};
+
+// Material which references decoded textures - texture ids are set when
+// the textures are uploaded
+struct PreparedMaterial {
+    Material material;
+    // indices in PreparedScene::textures, -1 if the material doesn't have the texture
+    int diffuseTexture{-1};
+    int normalMapTexture{-1};
+    int metallicRoughnessTexture{-1};
+    int emissiveTexture{-1};
+};
+
+struct PreparedPrimitive {
+    bool loaded{false}; // primitives without indices are not loaded
+    int materialIndex{-1}; // index in PreparedScene::materials
+    MeshUploadData data; // points into storage, cpuMesh or PreparedScene::cookedFile
+    MeshUploadStorage storage;
+    CPUMesh cpuMesh; // moved to Scene::cpuMeshes after the upload
+};
+
+// Scene which is fully loaded on CPU: meshes are converted into GPU format
+// and textures are decoded. Preparing the scene doesn't touch GPU or any
+// caches, so it can be done on a worker thread. Then the main thread uploads
+// the scene in small parts (see util::uploadPreparedScenePart), so that
+// loading big scenes doesn't stall the frame.
+struct PreparedScene {
+    // each texture is only decoded once, even if several materials use it
+    std::vector<PreparedTexture> textures;
+    std::vector<PreparedMaterial> materials;
+    std::vector<std::vector<PreparedPrimitive>> meshes;
+    // meshes and cpuMeshes are filled during the upload
+    Scene scene;
+
+    std::unique_ptr<MappedFile> cookedFile; // null if the scene was imported from glTF
+
+    // upload progress: textures go first, then all materials, then meshes
+    std::vector<ImageId> textureIds;
+    std::vector<MaterialId> materialIds;
+};
+
+namespace util
+{
+// Collects unique textures of the materials and decodes them in parallel
+// on threadPool (or on the calling thread if threadPool is nullptr).
+// If compressedTextures is true, cooked versions of the textures are loaded
+// instead if they're present.
+void prepareMaterials(
+    PreparedScene& preparedScene,
+    const std::vector<ImportedMaterial>& importedMaterials,
+    const std::filesystem::path& fileDir,
+    bool compressedTextures,
+    ThreadPool* threadPool);
+
+std::unique_ptr<PreparedScene> prepareGltfScene(
+    const std::filesystem::path& path,
+    const SceneImportSettings& settings,
+    ThreadPool* threadPool = nullptr);
+
+// Uploads the next texture, the materials or the next mesh of the scene to
+// GPU. Returns true when everything is uploaded - preparedScene.scene is
+// complete after that.
+// All uploads go through GfxDevice's upload queue, so the uploads done
+// during one frame are submitted together.
+bool uploadPreparedScenePart(
+    GfxDevice& gfxDevice,
+    MeshCache& meshCache,
+    MaterialCache& materialCache,
+    PreparedScene& preparedScene);
+}
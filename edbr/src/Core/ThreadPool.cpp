@@ -0,0 +1,92 @@
+#include <edbr/Core/ThreadPool.h>
+
+ThreadPool::ThreadPool(std::size_t numWorkers)
+{
+    workers.reserve(numWorkers);
+    for (std::size_t i = 0; i < numWorkers; ++i) {
+        workers.emplace_back([this, i]() { workerLoop(i + 1); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const Task& task)
+{
+    if (count == 0) {
+        return;
+    }
+
+    if (workers.empty() || count == 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            task(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        this->task = &task;
+        taskCount = count;
+        nextIndex = 0;
+        numBusyWorkers = workers.size();
+        ++generation;
+    }
+    startCondition.notify_all();
+
+    runTasks(0);
+
+    // task is owned by the caller, so all workers need to be done with it
+    std::unique_lock lock(mutex);
+    finishCondition.wait(lock, [this]() { return numBusyWorkers == 0; });
+    this->task = nullptr;
+}
+
+void ThreadPool::workerLoop(std::size_t threadIndex)
+{
+    std::uint64_t lastGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            startCondition.wait(lock, [this, lastGeneration]() {
+                return stopping || generation != lastGeneration;
+            });
+            if (stopping) {
+                return;
+            }
+            lastGeneration = generation;
+        }
+
+        runTasks(threadIndex);
+
+        bool lastWorker = false;
+        {
+            std::lock_guard lock(mutex);
+            --numBusyWorkers;
+            lastWorker = (numBusyWorkers == 0);
+        }
+        if (lastWorker) {
+            finishCondition.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runTasks(std::size_t threadIndex)
+{
+    while (true) {
+        const auto index = nextIndex.fetch_add(1);
+        if (index >= taskCount) {
+            break;
+        }
+        (*task)(index, threadIndex);
+    }
+}
@@ -62,7 +62,7 @@ void Im3dState::init(GfxDevice& gfxDevice, VkFormat drawImageFormat, VkFormat de
                              .setDepthFormat(depthImageFormat)
                              .enableDepthTest(false, VK_COMPARE_OP_GREATER_OR_EQUAL)
                              .enableDynamicDepth()
-                             .build(device);
+                             .build(device, gfxDevice.getPipelineCache());
         vkutil::addDebugLabel(device, pointsPipeline, "im3d points pipeline");
 
         vkDestroyShaderModule(device, pointsVertShader, nullptr);
@@ -92,7 +92,7 @@ void Im3dState::init(GfxDevice& gfxDevice, VkFormat drawImageFormat, VkFormat de
                             .enableDepthTest(true, VK_COMPARE_OP_GREATER_OR_EQUAL)
                             .enableDepthBias(-10.f, 0.0f)
                             .enableDynamicDepth()
-                            .build(device);
+                            .build(device, gfxDevice.getPipelineCache());
         vkutil::addDebugLabel(device, linesPipeline, "im3d lines pipeline");
 
         vkDestroyShaderModule(device, linesVertShader, nullptr);
@@ -120,7 +120,7 @@ void Im3dState::init(GfxDevice& gfxDevice, VkFormat drawImageFormat, VkFormat de
                                 .setDepthFormat(depthImageFormat)
                                 .enableDepthTest(true, VK_COMPARE_OP_GREATER_OR_EQUAL)
                                 .enableDynamicDepth()
-                                .build(device);
+                                .build(device, gfxDevice.getPipelineCache());
         vkutil::addDebugLabel(device, trianglesPipeline, "im3d triangles pipeline");
 
         vkDestroyShaderModule(device, trianglesVertShader, nullptr);
@@ -2,9 +2,16 @@
 
 #include <edbr/Graphics/ImageCache.h>
 #include <edbr/Graphics/MaterialCache.h>
+#include <edbr/Graphics/MeshCache.h>
+#include <edbr/Graphics/Vulkan/GPUMemoryStats.h>
 #include <edbr/Util/ImGuiUtil.h>
 
+#include <algorithm>
 #include <array>
+#include <fstream>
+#include <vector>
+
+#include <fmt/format.h>
 #include <imgui.h>
 
 #include <vulkan/vk_enum_string_helper.h>
@@ -25,7 +32,9 @@ void imagePreview(const GPUImage& image, const glm::vec2 maxSize = glm::vec2{512
 void ResourcesInspector::update(
     float dt,
     const ImageCache& imageCache,
-    const MaterialCache& materialCache)
+    const MaterialCache& materialCache,
+    const MeshCache& meshCache,
+    const GPUMemoryStats& memoryStats)
 {
     ImGui::Begin("Resources");
 
@@ -105,6 +114,156 @@ void ResourcesInspector::update(
         ImGui::TreePop();
     }
 
+    if (ImGui::TreeNode("Texture streaming")) {
+        const auto& textureStreamer = imageCache.getTextureStreamer();
+        const auto& streamedImages = textureStreamer.getImages();
+        ImGui::Text(
+            "Resident: %.1f / %.1f MB, %d image(s)",
+            (float)textureStreamer.getResidentSize() / (1024.f * 1024.f),
+            (float)textureStreamer.getBudget() / (1024.f * 1024.f),
+            (int)streamedImages.size());
+
+        static ImGuiTableFlags flags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_Borders |
+                                       ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+        if (ImGui::BeginTable("Texture streaming", 7, flags)) {
+            ImGui::TableSetupColumn("Id", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Name");
+            ImGui::TableSetupColumn("Size");
+            // the biggest mip which is on GPU and its size
+            ImGui::TableSetupColumn("Resident");
+            ImGui::TableSetupColumn("Wanted", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Memory", ImGuiTableColumnFlags_WidthFixed);
+            // size of the meshes using the image on the screen, in pixels
+            ImGui::TableSetupColumn("On screen", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableHeadersRow();
+
+            std::vector<ImageId> ids;
+            ids.reserve(streamedImages.size());
+            for (const auto& [id, image] : streamedImages) {
+                ids.push_back(id);
+            }
+            std::sort(ids.begin(), ids.end());
+
+            for (const auto id : ids) {
+                const auto& image = streamedImages.at(id);
+                ImGui::PushID((int)id);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", id);
+
+                ImGui::TableNextColumn();
+                if (ImGui::Selectable(
+                        imageCache.getImage(id).debugName.c_str(), id == selectedImageId)) {
+                    selectedImageId = id;
+                    showPreviewWindow = true;
+                }
+
+                ImGui::TableNextColumn();
+                ImGui::Text("(%u, %u)", image.width, image.height);
+
+                ImGui::TableNextColumn();
+                ImGui::Text(
+                    "%u (%u, %u)%s",
+                    image.residentMip,
+                    std::max(image.width >> image.residentMip, 1u),
+                    std::max(image.height >> image.residentMip, 1u),
+                    image.pendingSwap ? " *" : "");
+                if (image.pendingSwap && ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Waiting for upload");
+                }
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", image.wantedMip);
+                if (image.streamingFailed) {
+                    ImGui::SameLine();
+                    ImGui::TextUnformatted("(failed)");
+                }
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f KB", (float)image.residentSize / 1024.f);
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%.0f", image.requestedScreenSize);
+
+                ImGui::PopID();
+            }
+            ImGui::EndTable();
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Memory")) {
+        const auto toMB = [](std::size_t size) { return (float)size / (1024.f * 1024.f); };
+
+        ImGui::Text("Tracked: %.1f MB", toMB(memoryStats.getTotalSize()));
+        ImGui::SameLine();
+        static const char* reportPath = "memory_report.json";
+        if (ImGui::Button("Save report")) {
+            std::ofstream file(reportPath);
+            file << memoryStats.toJson();
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Writes the stats as JSON to %s", reportPath);
+        }
+
+        static ImGuiTableFlags flags =
+            ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+        if (ImGui::BeginTable("Memory categories", 3, flags)) {
+            ImGui::TableSetupColumn("Category");
+            ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableHeadersRow();
+
+            for (std::size_t i = 0; i < (std::size_t)MemoryCategory::Count; ++i) {
+                const auto stats = memoryStats.getCategoryStats((MemoryCategory)i);
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(getMemoryCategoryName((MemoryCategory)i));
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f MB", toMB(stats.size));
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", (int)stats.count);
+            }
+            ImGui::EndTable();
+        }
+
+        if (ImGui::BeginTable("Memory heaps", 4, flags)) {
+            ImGui::TableSetupColumn("Heap", ImGuiTableColumnFlags_WidthFixed);
+            // usage of the whole app (including memory not allocated by VMA) / budget
+            ImGui::TableSetupColumn("Usage / budget");
+            // allocated by VMA / occupied by allocations
+            ImGui::TableSetupColumn("VMA blocks", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Allocations", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableHeadersRow();
+
+            const auto& heaps = memoryStats.getHeapStats();
+            for (std::size_t i = 0; i < heaps.size(); ++i) {
+                const auto& heap = heaps[i];
+                ImGui::TableNextColumn();
+                ImGui::Text(
+                    "%d%s",
+                    (int)i,
+                    (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0 ? " (device)" : "");
+
+                ImGui::TableNextColumn();
+                const auto label = fmt::format(
+                    "{:.1f} / {:.1f} MB", toMB(heap.usage), toMB(heap.budget));
+                ImGui::ProgressBar(
+                    heap.budget > 0 ? (float)heap.usage / (float)heap.budget : 0.f,
+                    ImVec2{-1.f, 0.f},
+                    label.c_str());
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f MB", toMB(heap.blockBytes));
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f MB", toMB(heap.allocationBytes));
+            }
+            ImGui::EndTable();
+        }
+        ImGui::TreePop();
+    }
+
     const auto displayColor = [](const LinearColor& color) {
         const auto flags = ImGuiColorEditFlags_Float | ImGuiColorEditFlags_NoInputs;
         std::array<float, 4> arr{color.r, color.g, color.b, color.a};
@@ -189,7 +348,67 @@ void ResourcesInspector::update(
     }
 
     if (ImGui::TreeNode("Meshes")) {
-        ImGui::TextUnformatted("TODO");
+        static ImGuiTableFlags flags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_Borders |
+                                       ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+        if (ImGui::BeginTable("Meshes", 8, flags)) {
+            ImGui::TableSetupColumn("Id", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Name");
+            ImGui::TableSetupColumn("Verts", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Tris", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Index", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Vertex", ImGuiTableColumnFlags_WidthFixed);
+            // average cache miss ratio before and after optimization at import
+            ImGui::TableSetupColumn("ACMR", ImGuiTableColumnFlags_WidthFixed);
+            // triangles of LODs 1..N
+            ImGui::TableSetupColumn("LOD tris");
+            ImGui::TableHeadersRow();
+
+            static const auto vertexFormatNames = std::array{"full", "packed", "quantized"};
+
+            std::uint32_t meshId = 0;
+            for (const auto& mesh : meshCache.meshes) {
+                if (mesh.numIndices == 0) { // removed
+                    ++meshId;
+                    continue;
+                }
+                ImGui::PushID((int)meshId);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", meshId);
+
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(mesh.debugName.c_str());
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", mesh.numVertices);
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", mesh.numIndices / 3);
+
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(mesh.indexType == VK_INDEX_TYPE_UINT16 ? "u16" : "u32");
+
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(vertexFormatNames[(std::size_t)mesh.vertexFormat]);
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f -> %.2f", mesh.acmrBefore, mesh.acmrAfter);
+
+                ImGui::TableNextColumn();
+                for (std::size_t i = 1; i < mesh.lods.size(); ++i) {
+                    if (i > 1) {
+                        ImGui::SameLine();
+                    }
+                    ImGui::Text("%u", mesh.lods[i].numIndices / 3);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("LOD %d error: %.4f", (int)i, mesh.lods[i].error);
+                    }
+                }
+
+                ++meshId;
+                ImGui::PopID();
+            }
+            ImGui::EndTable();
+        }
         ImGui::TreePop();
     }
     ImGui::End();
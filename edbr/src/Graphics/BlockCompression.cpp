@@ -0,0 +1,395 @@
+#include <edbr/Graphics/BlockCompression.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace
+{
+constexpr int BLOCK_PIXELS = 16;
+
+template<int N>
+using Vec = std::array<float, N>;
+
+// Returns the end points of the segment which goes through the first N
+// channels of the block's pixels along their principal axis
+template<int N>
+void fitEndpoints(const std::uint8_t* rgba, Vec<N>& e0, Vec<N>& e1)
+{
+    Vec<N> mean{};
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        for (int c = 0; c < N; ++c) {
+            mean[c] += (float)rgba[i * 4 + c];
+        }
+    }
+    for (int c = 0; c < N; ++c) {
+        mean[c] /= (float)BLOCK_PIXELS;
+    }
+
+    std::array<Vec<N>, N> cov{};
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        Vec<N> d;
+        for (int c = 0; c < N; ++c) {
+            d[c] = (float)rgba[i * 4 + c] - mean[c];
+        }
+        for (int a = 0; a < N; ++a) {
+            for (int b = 0; b < N; ++b) {
+                cov[a][b] += d[a] * d[b];
+            }
+        }
+    }
+
+    // power iteration starting from the row of the channel with the biggest
+    // variance - it's not zero unless all pixels are the same
+    int maxVarianceChannel = 0;
+    for (int c = 1; c < N; ++c) {
+        if (cov[c][c] > cov[maxVarianceChannel][maxVarianceChannel]) {
+            maxVarianceChannel = c;
+        }
+    }
+    if (cov[maxVarianceChannel][maxVarianceChannel] == 0.f) {
+        e0 = mean;
+        e1 = mean;
+        return;
+    }
+
+    auto axis = cov[maxVarianceChannel];
+    for (int iter = 0; iter < 8; ++iter) {
+        Vec<N> next{};
+        float maxComponent = 0.f;
+        for (int a = 0; a < N; ++a) {
+            for (int b = 0; b < N; ++b) {
+                next[a] += cov[a][b] * axis[b];
+            }
+            maxComponent = std::max(maxComponent, std::abs(next[a]));
+        }
+        for (int c = 0; c < N; ++c) {
+            axis[c] = next[c] / maxComponent;
+        }
+    }
+
+    float lengthSq = 0.f;
+    for (int c = 0; c < N; ++c) {
+        lengthSq += axis[c] * axis[c];
+    }
+    const auto invLength = 1.f / std::sqrt(lengthSq);
+    for (int c = 0; c < N; ++c) {
+        axis[c] *= invLength;
+    }
+
+    float minT = 0.f;
+    float maxT = 0.f;
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        float t = 0.f;
+        for (int c = 0; c < N; ++c) {
+            t += ((float)rgba[i * 4 + c] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    for (int c = 0; c < N; ++c) {
+        e0[c] = std::clamp(mean[c] + axis[c] * minT, 0.f, 255.f);
+        e1[c] = std::clamp(mean[c] + axis[c] * maxT, 0.f, 255.f);
+    }
+}
+
+int quantize(float v, int maxValue)
+{
+    return std::clamp((int)std::lround(v * (float)maxValue / 255.f), 0, maxValue);
+}
+
+int unquantize565(int v, int bits)
+{
+    return bits == 5 ? (v << 3) | (v >> 2) : (v << 2) | (v >> 4);
+}
+
+void writeLE(std::uint8_t* out, std::uint64_t value, int numBytes)
+{
+    for (int i = 0; i < numBytes; ++i) {
+        out[i] = (std::uint8_t)(value >> (i * 8));
+    }
+}
+
+void encodeBC1(const std::uint8_t* rgba, std::uint8_t* out)
+{
+    Vec<3> e0, e1;
+    fitEndpoints<3>(rgba, e0, e1);
+
+    const auto toRGB565 = [](const Vec<3>& c) {
+        return (std::uint16_t)(quantize(c[0], 31) << 11 | quantize(c[1], 63) << 5 |
+                               quantize(c[2], 31));
+    };
+    auto c0 = toRGB565(e1);
+    auto c1 = toRGB565(e0);
+    // c0 > c1 selects 4 color mode. If they're equal, the block is in 3 color
+    // mode, but it only uses index 0 then
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+
+    std::uint32_t indices = 0;
+    if (c0 != c1) {
+        std::array<std::array<int, 3>, 4> palette;
+        for (int e = 0; e < 2; ++e) {
+            const auto c = e == 0 ? c0 : c1;
+            palette[e] = {
+                unquantize565(c >> 11, 5),
+                unquantize565((c >> 5) & 0x3f, 6),
+                unquantize565(c & 0x1f, 5),
+            };
+        }
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < BLOCK_PIXELS; ++i) {
+            int bestIndex = 0;
+            int bestError = std::numeric_limits<int>::max();
+            for (int p = 0; p < 4; ++p) {
+                int error = 0;
+                for (int c = 0; c < 3; ++c) {
+                    const auto d = (int)rgba[i * 4 + c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            indices |= (std::uint32_t)bestIndex << (i * 2);
+        }
+    }
+
+    writeLE(out, c0, 2);
+    writeLE(out + 2, c1, 2);
+    writeLE(out + 4, indices, 4);
+}
+
+void encodeBC4(const std::uint8_t* rgba, int channel, std::uint8_t* out)
+{
+    int minValue = 255;
+    int maxValue = 0;
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        minValue = std::min(minValue, (int)rgba[i * 4 + channel]);
+        maxValue = std::max(maxValue, (int)rgba[i * 4 + channel]);
+    }
+
+    // r0 > r1 selects 8 value mode. If they're equal, the block is in 6 value
+    // mode, but it only uses index 0 then
+    std::uint64_t indices = 0;
+    if (maxValue > minValue) {
+        std::array<int, 8> palette;
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int p = 2; p < 8; ++p) {
+            palette[p] = ((8 - p) * maxValue + (p - 1) * minValue) / 7;
+        }
+
+        for (int i = 0; i < BLOCK_PIXELS; ++i) {
+            const auto v = (int)rgba[i * 4 + channel];
+            int bestIndex = 0;
+            for (int p = 1; p < 8; ++p) {
+                if (std::abs(v - palette[p]) < std::abs(v - palette[bestIndex])) {
+                    bestIndex = p;
+                }
+            }
+            indices |= (std::uint64_t)bestIndex << (i * 3);
+        }
+    }
+
+    out[0] = (std::uint8_t)maxValue;
+    out[1] = (std::uint8_t)minValue;
+    writeLE(out + 2, indices, 6);
+}
+
+// Writes bits from LSB to MSB, which is how BC7 blocks are laid out
+class BitWriter {
+public:
+    explicit BitWriter(std::uint8_t* out) : out(out) { std::fill(out, out + 16, 0); }
+
+    void write(std::uint32_t value, int numBits)
+    {
+        for (int i = 0; i < numBits; ++i, ++pos) {
+            out[pos / 8] |= (std::uint8_t)(((value >> i) & 1) << (pos % 8));
+        }
+    }
+
+private:
+    std::uint8_t* out;
+    int pos{0};
+};
+
+constexpr std::array<int, 16> BC7_WEIGHTS_4 =
+    {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Mode 6 endpoints are 7 bits per channel + one shared p-bit (LSB)
+void quantizeBC7Endpoint(const Vec<4>& e, std::array<int, 4>& q, int& pBit)
+{
+    // fully opaque/transparent endpoints have to stay that way, even if the
+    // other p-bit would give a slightly smaller color error
+    const auto minP = e[3] == 255.f ? 1 : 0;
+    const auto maxP = e[3] == 0.f ? 0 : 1;
+
+    float bestError = std::numeric_limits<float>::max();
+    for (int p = minP; p <= maxP; ++p) {
+        std::array<int, 4> candidate;
+        float error = 0.f;
+        for (int c = 0; c < 4; ++c) {
+            candidate[c] = std::clamp((int)std::lround((e[c] - (float)p) / 2.f), 0, 127);
+            const auto d = e[c] - (float)(candidate[c] * 2 + p);
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            q = candidate;
+            pBit = p;
+        }
+    }
+}
+
+void encodeBC7(const std::uint8_t* rgba, std::uint8_t* out)
+{
+    Vec<4> e0, e1;
+    fitEndpoints<4>(rgba, e0, e1);
+
+    std::array<std::array<int, 4>, 2> q;
+    std::array<int, 2> pBits;
+    quantizeBC7Endpoint(e0, q[0], pBits[0]);
+    quantizeBC7Endpoint(e1, q[1], pBits[1]);
+
+    std::array<std::array<int, 4>, 16> palette;
+    for (int p = 0; p < 16; ++p) {
+        const auto w = BC7_WEIGHTS_4[p];
+        for (int c = 0; c < 4; ++c) {
+            const auto v0 = q[0][c] << 1 | pBits[0];
+            const auto v1 = q[1][c] << 1 | pBits[1];
+            palette[p][c] = ((64 - w) * v0 + w * v1 + 32) >> 6;
+        }
+    }
+
+    std::array<int, BLOCK_PIXELS> indices;
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        int bestError = std::numeric_limits<int>::max();
+        for (int p = 0; p < 16; ++p) {
+            int error = 0;
+            for (int c = 0; c < 4; ++c) {
+                const auto d = (int)rgba[i * 4 + c] - palette[p][c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = p;
+            }
+        }
+    }
+
+    // MSB of the first pixel's index is not stored (it's always 0) - the
+    // weights are symmetric, so swapping the endpoints and inverting the
+    // indices gives the same colors
+    if (indices[0] >= 8) {
+        std::swap(q[0], q[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (auto& index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    BitWriter writer(out);
+    writer.write(1 << 6, 7); // mode 6
+    for (int c = 0; c < 4; ++c) {
+        writer.write(q[0][c], 7);
+        writer.write(q[1][c], 7);
+    }
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < BLOCK_PIXELS; ++i) {
+        writer.write(indices[i], 4);
+    }
+}
+
+} // end of anonymous namespace
+
+namespace graphics
+{
+std::size_t getBlockSize(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC4:
+        return 8;
+    case BlockFormat::BC3:
+    case BlockFormat::BC5:
+    case BlockFormat::BC7:
+        return 16;
+    }
+    assert(false);
+    return 0;
+}
+
+std::size_t getCompressedImageSize(BlockFormat format, int width, int height)
+{
+    const auto numBlocksX = (std::size_t)(width + 3) / 4;
+    const auto numBlocksY = (std::size_t)(height + 3) / 4;
+    return numBlocksX * numBlocksY * getBlockSize(format);
+}
+
+void compressBlock(BlockFormat format, const std::uint8_t* rgba, std::uint8_t* out)
+{
+    switch (format) {
+    case BlockFormat::BC1:
+        encodeBC1(rgba, out);
+        break;
+    case BlockFormat::BC3:
+        encodeBC4(rgba, 3, out);
+        encodeBC1(rgba, out + 8);
+        break;
+    case BlockFormat::BC4:
+        encodeBC4(rgba, 0, out);
+        break;
+    case BlockFormat::BC5:
+        encodeBC4(rgba, 0, out);
+        encodeBC4(rgba, 1, out + 8);
+        break;
+    case BlockFormat::BC7:
+        encodeBC7(rgba, out);
+        break;
+    }
+}
+
+std::vector<std::uint8_t> compressImage(
+    BlockFormat format,
+    std::span<const std::uint8_t> rgba,
+    int width,
+    int height)
+{
+    assert(rgba.size() == (std::size_t)width * height * 4);
+
+    std::vector<std::uint8_t> compressed(getCompressedImageSize(format, width, height));
+    const auto blockSize = getBlockSize(format);
+    auto* out = compressed.data();
+
+    std::array<std::uint8_t, BLOCK_PIXELS * 4> block;
+    for (int blockY = 0; blockY < height; blockY += 4) {
+        for (int blockX = 0; blockX < width; blockX += 4) {
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 4; ++x) {
+                    const auto srcX = std::min(blockX + x, width - 1);
+                    const auto srcY = std::min(blockY + y, height - 1);
+                    const auto* src = &rgba[((std::size_t)srcY * width + srcX) * 4];
+                    std::copy(src, src + 4, &block[(y * 4 + x) * 4]);
+                }
+            }
+            compressBlock(format, block.data(), out);
+            out += blockSize;
+        }
+    }
+    return compressed;
+}
+
+} // end of namespace graphics
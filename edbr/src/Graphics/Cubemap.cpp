@@ -7,26 +7,29 @@
 
 namespace graphics
 {
-GPUImage loadCubemap(GfxDevice& gfxDevice, const std::filesystem::path& imagesDir)
+CubemapData loadCubemapData(const std::filesystem::path& imagesDir)
 {
-    VkImageUsageFlags usages{};
-    usages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-    usages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-    usages |= VK_IMAGE_USAGE_STORAGE_BIT;
-    usages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-
-    GPUImage img;
-
     static const auto paths =
         std::array{"right.jpg", "left.jpg", "top.jpg", "bottom.jpg", "front.jpg", "back.jpg"};
 
+    CubemapData data;
+    data.imagesDir = imagesDir;
+    for (std::size_t face = 0; face < paths.size(); ++face) {
+        data.faces[face] = util::loadImage(imagesDir / paths[face]);
+    }
+    return data;
+}
+
+GPUImage createCubemap(GfxDevice& gfxDevice, const CubemapData& data)
+{
+    GPUImage img;
+
     std::uint32_t face = 0;
     bool imageCreated = false;
 
-    for (auto& p : paths) {
-        ImageData data = util::loadImage(imagesDir / p);
-        assert(data.channels == 4);
-        assert(data.pixels != nullptr);
+    for (const auto& faceData : data.faces) {
+        assert(faceData.channels == 4);
+        assert(faceData.pixels != nullptr);
 
         if (!imageCreated) {
             img = gfxDevice.createImageRaw({
@@ -35,8 +38,8 @@ GPUImage loadCubemap(GfxDevice& gfxDevice, const std::filesystem::path& imagesDi
                 .flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
                 .extent =
                     {
-                        .width = (std::uint32_t)data.width,
-                        .height = (std::uint32_t)data.height,
+                        .width = (std::uint32_t)faceData.width,
+                        .height = (std::uint32_t)faceData.height,
                         .depth = 1,
                     },
                 .numLayers = 6,
@@ -45,19 +48,24 @@ GPUImage loadCubemap(GfxDevice& gfxDevice, const std::filesystem::path& imagesDi
             imageCreated = true;
         } else {
             assert(
-                img.extent.width == (std::uint32_t)data.width &&
-                img.extent.height == (std::uint32_t)data.height &&
+                img.extent.width == (std::uint32_t)faceData.width &&
+                img.extent.height == (std::uint32_t)faceData.height &&
                 "All images for cubemap must have the same size");
         }
 
-        gfxDevice.uploadImageData(img, data.pixels, face);
+        gfxDevice.uploadImageData(img, faceData.pixels, face);
         ++face;
     }
 
-    const auto cubemapLabel = "cubemap, dir=" + imagesDir.string();
+    const auto cubemapLabel = "cubemap, dir=" + data.imagesDir.string();
     img.debugName = cubemapLabel;
     vkutil::addDebugLabel(gfxDevice.getDevice(), img.image, cubemapLabel.c_str());
 
     return img;
 }
+
+GPUImage loadCubemap(GfxDevice& gfxDevice, const std::filesystem::path& imagesDir)
+{
+    return createCubemap(gfxDevice, loadCubemapData(imagesDir));
+}
 }
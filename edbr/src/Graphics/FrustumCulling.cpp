@@ -6,6 +6,51 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
+#include <limits>
+
+#if defined(__AVX__)
+#define EDBR_CULLING_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EDBR_CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+void SphereSoA::clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radius.clear();
+    numSpheres = 0;
+}
+
+void SphereSoA::add(const math::Sphere& s)
+{
+    if (numSpheres % 8 == 0) {
+        // add padding: dot(n, c) - d > -r is never true for these spheres
+        static const auto paddingRadius = -std::numeric_limits<float>::max();
+        centerX.resize(numSpheres + 8, 0.f);
+        centerY.resize(numSpheres + 8, 0.f);
+        centerZ.resize(numSpheres + 8, 0.f);
+        radius.resize(numSpheres + 8, paddingRadius);
+    }
+    centerX[numSpheres] = s.center.x;
+    centerY[numSpheres] = s.center.y;
+    centerZ[numSpheres] = s.center.z;
+    radius[numSpheres] = s.radius;
+    ++numSpheres;
+}
+
+std::size_t VisibilityMask::countVisible() const
+{
+    std::size_t count = 0;
+    for (const auto& word : words) {
+        count += std::popcount(word);
+    }
+    return count;
+}
 
 namespace
 {
@@ -175,6 +220,89 @@ bool isInFrustum(const Frustum& frustum, const math::AABB& aabb)
     return ret;
 }
 
+void cullSpheresScalar(const Frustum& frustum, const SphereSoA& spheres, VisibilityMask& mask)
+{
+    mask.words.assign((spheres.size() + 63) / 64, 0);
+    for (std::size_t i = 0; i < spheres.size(); ++i) {
+        const auto s = math::Sphere{
+            .center = glm::vec3{spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]},
+            .radius = spheres.radius[i],
+        };
+        if (isInFrustum(frustum, s)) {
+            mask.words[i / 64] |= std::uint64_t{1} << (i % 64);
+        }
+    }
+}
+
+void cullSpheres(const Frustum& frustum, const SphereSoA& spheres, VisibilityMask& mask)
+{
+#if defined(EDBR_CULLING_AVX)
+    mask.words.assign((spheres.size() + 63) / 64, 0);
+
+    __m256 nx[6], ny[6], nz[6], d[6];
+    for (int p = 0; p < 6; ++p) {
+        const auto& plane = frustum.getPlane(p);
+        nx[p] = _mm256_set1_ps(plane.normal.x);
+        ny[p] = _mm256_set1_ps(plane.normal.y);
+        nz[p] = _mm256_set1_ps(plane.normal.z);
+        d[p] = _mm256_set1_ps(plane.distance);
+    }
+
+    // arrays are padded to a multiple of 8, padding spheres are never visible
+    for (std::size_t i = 0; i < spheres.size(); i += 8) {
+        const auto cx = _mm256_loadu_ps(&spheres.centerX[i]);
+        const auto cy = _mm256_loadu_ps(&spheres.centerY[i]);
+        const auto cz = _mm256_loadu_ps(&spheres.centerZ[i]);
+        const auto negR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+
+        // same as isOnOrForwardPlane: dot(n, c) - d > -r
+        auto visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            auto dist = _mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(nz[p], cz));
+            dist = _mm256_sub_ps(dist, d[p]);
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, negR, _CMP_GT_OQ));
+        }
+
+        const auto bits = (std::uint64_t)_mm256_movemask_ps(visible);
+        mask.words[i / 64] |= bits << (i % 64);
+    }
+#elif defined(EDBR_CULLING_SSE)
+    mask.words.assign((spheres.size() + 63) / 64, 0);
+
+    __m128 nx[6], ny[6], nz[6], d[6];
+    for (int p = 0; p < 6; ++p) {
+        const auto& plane = frustum.getPlane(p);
+        nx[p] = _mm_set1_ps(plane.normal.x);
+        ny[p] = _mm_set1_ps(plane.normal.y);
+        nz[p] = _mm_set1_ps(plane.normal.z);
+        d[p] = _mm_set1_ps(plane.distance);
+    }
+
+    // arrays are padded to a multiple of 8, padding spheres are never visible
+    for (std::size_t i = 0; i < spheres.size(); i += 4) {
+        const auto cx = _mm_loadu_ps(&spheres.centerX[i]);
+        const auto cy = _mm_loadu_ps(&spheres.centerY[i]);
+        const auto cz = _mm_loadu_ps(&spheres.centerZ[i]);
+        const auto negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+        // same as isOnOrForwardPlane: dot(n, c) - d > -r
+        auto visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            auto dist = _mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy));
+            dist = _mm_add_ps(dist, _mm_mul_ps(nz[p], cz));
+            dist = _mm_sub_ps(dist, d[p]);
+            visible = _mm_and_ps(visible, _mm_cmpgt_ps(dist, negR));
+        }
+
+        const auto bits = (std::uint64_t)_mm_movemask_ps(visible);
+        mask.words[i / 64] |= bits << (i % 64);
+    }
+#else
+    cullSpheresScalar(frustum, spheres, mask);
+#endif
+}
+
 math::Sphere calculateBoundingSphereWorld(
     const glm::mat4& transform,
     const math::Sphere& s,
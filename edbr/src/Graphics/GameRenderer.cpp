@@ -1,18 +1,26 @@
 #include <edbr/Graphics/GameRenderer.h>
 
+#include <edbr/Core/ThreadPool.h>
 #include <edbr/Graphics/Font.h>
 #include <edbr/Graphics/FrustumCulling.h>
 #include <edbr/Graphics/GfxDevice.h>
 #include <edbr/Graphics/MaterialCache.h>
 #include <edbr/Graphics/MeshCache.h>
 #include <edbr/Graphics/Scene.h>
-#include <edbr/Graphics/Vulkan/Init.h>
 #include <edbr/Graphics/Vulkan/Pipelines.h>
 #include <edbr/Graphics/Vulkan/Util.h>
 
 #include <imgui.h>
 
+#include <algorithm> // any_of, min
+#include <chrono>
+#include <cmath> // abs, isinf
+#include <functional>
+#include <limits>
 #include <numeric> // iota
+#include <utility> // exchange
+
+#include <fmt/printf.h>
 
 #include <tracy/Tracy.hpp>
 
@@ -20,92 +28,63 @@ GameRenderer::GameRenderer(
     GfxDevice& gfxDevice,
     MeshCache& meshCache,
     MaterialCache& materialCache) :
-    gfxDevice(gfxDevice), meshCache(meshCache), materialCache(materialCache)
+    gfxDevice(gfxDevice),
+    meshCache(meshCache),
+    materialCache(materialCache),
+    renderGraph(gfxDevice)
 {}
 
 void GameRenderer::init(const glm::ivec2& drawImageSize)
 {
     initSceneData();
 
-    samples = gfxDevice.getMaxSupportedSamplingCount(); // needs to be called before
-                                                        // createDrawImage
-    createDrawImage(drawImageSize, true);
-
-    skinningPipeline.init(gfxDevice);
-
-    const auto cascadePercents = std::array{0.138f, 0.35f, 1.f};
-    // const auto cascadePercents = std::array{0.04f, 0.1f, 1.f}; // good for far = 500.f
-    csmPipeline.init(gfxDevice, cascadePercents);
-
-    meshPipeline.init(gfxDevice, drawImageFormat, depthImageFormat, samples);
-    skyboxPipeline.init(gfxDevice, drawImageFormat, depthImageFormat, samples);
-
-    depthResolvePipeline.init(gfxDevice, depthImageFormat);
-
-    postFXPipeline.init(gfxDevice, drawImageFormat);
-}
-
-void GameRenderer::createDrawImage(const glm::ivec2& drawImageSize, bool firstCreate)
-{
-    const auto drawImageExtent = VkExtent3D{
+    samples = gfxDevice.getMaxSupportedSamplingCount();
+    hardwareDepthResolveSupported =
+        gfxDevice.deviceSupportsDepthResolveMode(VK_RESOLVE_MODE_MIN_BIT);
+    hardwareDepthResolve = hardwareDepthResolveSupported;
+    drawImageExtent = VkExtent3D{
         .width = (std::uint32_t)drawImageSize.x,
         .height = (std::uint32_t)drawImageSize.y,
         .depth = 1,
     };
-
-    { // setup draw image
-        VkImageUsageFlags usages{};
-        usages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-        usages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-        usages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-        usages |= VK_IMAGE_USAGE_SAMPLED_BIT;
-
-        auto createImageInfo = vkutil::CreateImageInfo{
-            .format = drawImageFormat,
-            .usage = usages,
-            .extent = drawImageExtent,
-            .samples = samples,
+    // other render targets are transient and allocated by the render graph
+    postFXDrawImageId =
+        gfxDevice.createDrawImage(drawImageFormat, drawImageSize, "post FX draw image");
+
+    { // pipelines don't depend on each other, so they're created in parallel
+        ZoneScopedN("Create pipelines");
+        const auto startTime = std::chrono::steady_clock::now();
+
+        const auto cascadePercents = std::array{0.138f, 0.35f, 1.f};
+        // const auto cascadePercents = std::array{0.04f, 0.1f, 1.f}; // good for far = 500.f
+
+        // these only create pipelines and buffers - images can only be created
+        // on the main thread
+        const auto pipelineInits = std::array<std::function<void()>, 9>{
+            [&] { skinningPipeline.init(gfxDevice); },
+            [&] { csmPipeline.init(gfxDevice, cascadePercents); },
+            [&] { meshCullingPipeline.init(gfxDevice); },
+            [&] { meshPipeline.init(gfxDevice, drawImageFormat, depthImageFormat, samples); },
+            [&] { skyboxPipeline.init(gfxDevice, drawImageFormat, depthImageFormat, samples); },
+            [&] { depthResolvePipeline.init(gfxDevice, depthImageFormat); },
+            [&] { hiZPipeline.init(gfxDevice); },
+            [&] { lightClusteringPipeline.init(gfxDevice); },
+            [&] { postFXPipeline.init(gfxDevice, drawImageFormat); },
         };
-        // reuse the same id if creating again
-        drawImageId = gfxDevice.createImage(createImageInfo, "draw image", nullptr, drawImageId);
-
-        if (firstCreate) {
-            createImageInfo.samples = VK_SAMPLE_COUNT_1_BIT; // no MSAA
-            postFXDrawImageId = gfxDevice.createImage(createImageInfo, "post FX draw image");
-        }
+        gfxDevice.getRecordingThreadPool().parallelFor(
+            pipelineInits.size(),
+            [&pipelineInits](std::size_t index, std::size_t) { pipelineInits[index](); });
+
+        pipelineCreationTime =
+            std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime)
+                .count();
+        fmt::println(
+            "Created renderer pipelines in {:.1f} ms (pipeline cache: {} KB loaded)",
+            pipelineCreationTime,
+            gfxDevice.getLoadedPipelineCacheSize() / 1024);
     }
 
-    if (firstCreate) { // setup resolve image
-        VkImageUsageFlags usages{};
-        usages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-        usages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-        usages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-        usages |= VK_IMAGE_USAGE_SAMPLED_BIT;
-
-        const auto createImageInfo = vkutil::CreateImageInfo{
-            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-            .usage = usages,
-            .extent = drawImageExtent,
-        };
-        resolveImageId = gfxDevice.createImage(createImageInfo, "resolve image");
-    }
-
-    { // setup depth image
-        auto createInfo = vkutil::CreateImageInfo{
-            .format = depthImageFormat,
-            .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            .extent = drawImageExtent,
-            .samples = samples,
-        };
-
-        // reuse the same id if creating again
-        depthImageId = gfxDevice.createImage(createInfo, "depth image", nullptr, depthImageId);
-
-        if (firstCreate) {
-            createInfo.samples = VK_SAMPLE_COUNT_1_BIT; // NO MSAA
-            resolveDepthImageId = gfxDevice.createImage(createInfo, "depth resolve");
-        }
-    }
+    csmPipeline.initCSMData(gfxDevice);
 }
 
 void GameRenderer::initSceneData()
@@ -117,80 +96,85 @@ void GameRenderer::initSceneData()
         graphics::FRAME_OVERLAP,
         "scene data");
 
+    initLightDataBuffer();
+}
+
+void GameRenderer::initLightDataBuffer()
+{
     lightDataBuffer.init(
         gfxDevice,
         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        sizeof(GPULightData) * MAX_LIGHTS,
+        sizeof(GPULightData) * lightDataBufferCapacity,
         graphics::FRAME_OVERLAP,
         "light data");
-    lightDataCPU.resize(MAX_LIGHTS);
+    lightDataCPU.reserve(lightDataBufferCapacity);
 }
 
 void GameRenderer::draw(VkCommandBuffer cmd, const Camera& camera, const SceneData& sceneData)
 {
-    { // skinning
-        { // Sync reading from skinning buffers with new writes
-            const auto memoryBarrier = VkMemoryBarrier2{
-                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
-                .srcStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
-                .srcAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
-                .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-                .dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
-            };
-            const auto dependencyInfo = VkDependencyInfo{
-                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-                .memoryBarrierCount = 1,
-                .pMemoryBarriers = &memoryBarrier,
-            };
-            vkCmdPipelineBarrier2(cmd, &dependencyInfo);
-        }
+    if (textureStreaming) {
+        requestTextureMips(camera);
+    }
 
-        vkutil::cmdBeginLabel(cmd, "Skinning");
-        for (const auto& dc : meshDrawCommands) {
-            if (!dc.skinnedMesh) {
-                continue;
-            }
-            skinningPipeline.doSkinning(cmd, gfxDevice.getCurrentFrameIndex(), meshCache, dc);
-        }
-        vkutil::cmdEndLabel(cmd);
-
-        { // Sync skinning with CSM
-            const auto memoryBarrier = VkMemoryBarrier2{
-                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
-                .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-                .srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT,
-                .dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
-                .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
-            };
-            const auto dependencyInfo = VkDependencyInfo{
-                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-                .memoryBarrierCount = 1,
-                .pMemoryBarriers = &memoryBarrier,
-            };
-            vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+    if (sunlightIndex != -1) {
+        // cascades are needed for skipping skinning of meshes which don't cast visible shadows
+        csmPipeline.updateCascades(
+            gfxDevice,
+            camera,
+            lightDataCPU[sunlightIndex].direction,
+            meshDrawCommands,
+            sortedMeshDrawCommands,
+            shadowsEnabled);
+    }
+
+    // all skinned vertex buffers are synced together
+    const auto skinnedVertices = renderGraph.importBuffer("skinned vertices");
+
+    { // skinning
+        ZoneScopedN("Skinning");
+        addSkinningJobs(camera);
+        const auto frameIndex = gfxDevice.getCurrentFrameIndex();
+        const auto hasSkinningJobs = skinningPipeline.hasJobs(frameIndex);
+        if (hasSkinningJobs && asyncCompute && gfxDevice.hasAsyncCompute()) {
+            // Skinned vertex buffers are per frame, so skinning can start right away
+            // and overlap with the previous frame's graphics work (post FX, UI, etc.)
+            auto computeCmd = gfxDevice.beginAsyncCompute();
+            vkutil::cmdBeginLabel(computeCmd, "Skinning");
+            skinningPipeline.doSkinning(computeCmd, frameIndex);
+            vkutil::cmdEndLabel(computeCmd);
+            // skinned vertices are first read by CSM
+            gfxDevice.submitAsyncCompute(computeCmd, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT);
+        } else if (hasSkinningJobs) {
+            renderGraph.addPass(
+                "Skinning",
+                {{skinnedVertices, RenderGraph::Usage::ComputeShaderWrite}},
+                [this, frameIndex](VkCommandBuffer cmd) {
+                    skinningPipeline.doSkinning(cmd, frameIndex);
+                });
         }
     }
 
-    if (sunlightIndex != -1) { // CSM
-        ZoneScopedN("CSM");
-        TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "CSM", tracy::Color::CornflowerBlue);
-        vkutil::cmdBeginLabel(cmd, "CSM");
+    // draw data is shared by CSM and geometry passes
+    meshCullingPipeline.uploadDrawData(
+        gfxDevice.getCurrentFrameIndex(), meshCache, meshDrawCommands, sortedMeshDrawCommands);
 
-        auto& sunlight = lightDataCPU[sunlightIndex];
-        csmPipeline.draw(
-            cmd,
+    std::optional<RenderGraph::ResourceId> shadowMap;
+    if (sunlightIndex != -1) {
+        shadowMap = csmPipeline.addPasses(
+            renderGraph,
             gfxDevice,
             meshCache,
-            camera,
-            sunlight.direction,
             materialCache.getMaterialDataBuffer(),
             meshDrawCommands,
+            sortedMeshDrawCommands,
+            drawBoundingSpheres,
+            meshCullingPipeline,
+            skinnedVertices,
             shadowsEnabled);
-
-        vkutil::cmdEndLabel(cmd);
     }
 
-    { // upload scene data - can only be done after CSM has finished
+    // scene data can only be uploaded after CSM has finished
+    renderGraph.addPass("Upload scene data", {}, [this, &sceneData](VkCommandBuffer cmd) {
         const auto gpuSceneData = GPUSceneData{
             .view = sceneData.camera.getView(),
             .proj = sceneData.camera.getProjection(),
@@ -213,6 +197,10 @@ void GameRenderer::draw(VkCommandBuffer cmd, const Camera& camera, const SceneDa
             .numLights = (std::uint32_t)lightDataCPU.size(),
             .sunlightIndex = sunlightIndex,
             .materialsBuffer = materialCache.getMaterialDataBufferAddress(),
+            .lightClustersBuffer = lightClusteringPipeline.getClustersBuffer().address,
+            .screenSize = glm::vec2{drawImageExtent.width, drawImageExtent.height},
+            .cameraZNear = sceneData.camera.getZNear(),
+            .cameraZFar = sceneData.camera.getZFar(),
         };
         sceneDataBuffer.uploadNewData(
             cmd, gfxDevice.getCurrentFrameIndex(), (void*)&gpuSceneData, sizeof(GPUSceneData));
@@ -221,173 +209,401 @@ void GameRenderer::draw(VkCommandBuffer cmd, const Camera& camera, const SceneDa
             gfxDevice.getCurrentFrameIndex(),
             (void*)lightDataCPU.data(),
             sizeof(GPULightData) * lightDataCPU.size());
+    });
+
+    // light clustering and mesh culling sync their buffers themselves
+    renderGraph.addPass("Light clustering", {}, [this](VkCommandBuffer cmd) {
+        ZoneScopedN("Light clustering");
+        TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "Light clustering", tracy::Color::Gold);
+        lightClusteringPipeline.buildClusters(cmd, sceneDataBuffer.getBuffer());
+    });
+
+    const auto frustum = edge::createFrustumFromCamera(camera);
+    if (gpuCulling) {
+        renderGraph.addPass("Mesh culling", {}, [this, frustum](VkCommandBuffer cmd) {
+            ZoneScopedN("Mesh culling");
+            TracyVkZoneC(
+                gfxDevice.getTracyVkCtx(), cmd, "Mesh culling", tracy::Color::ForestGreen);
+            meshCullingPipeline.cull(
+                cmd, gfxDevice, frustum, occlusionCulling ? &hiZPipeline : nullptr);
+        });
+    } else {
+        renderGraph.addPass("Mesh culling (CPU)", {}, [this, frustum](VkCommandBuffer cmd) {
+            ZoneScopedN("Mesh culling (CPU)");
+            edge::cullSpheres(frustum, drawBoundingSpheres, cameraVisibility);
+            meshCullingPipeline.cullOnCPU(cmd, gfxDevice.getCurrentFrameIndex(), cameraVisibility);
+        });
+    }
+
+    const bool msaa = isMultisamplingEnabled();
+    // the geometry passes resolve MSAA depth themselves, otherwise it's resolved by a shader
+    const bool hwDepthResolve = msaa && hardwareDepthResolve;
+    // MSAA images which are only resolved can live in lazily allocated memory
+    const auto drawImage = renderGraph.createImage(
+        "draw image",
+        {
+            .format = drawImageFormat,
+            .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                     (msaa ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : VK_IMAGE_USAGE_SAMPLED_BIT),
+            .extent = drawImageExtent,
+            .samples = samples,
+        });
+    const auto depthImage = renderGraph.createImage(
+        "depth image",
+        {
+            .format = depthImageFormat,
+            .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                     (hwDepthResolve ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT :
+                                       VK_IMAGE_USAGE_SAMPLED_BIT),
+            .extent = drawImageExtent,
+            .samples = samples,
+        });
+    // with MSAA, the geometry passes resolve the draw image into it
+    const auto resolveImage = msaa ? renderGraph.createImage(
+                                         "resolve image",
+                                         {
+                                             .format = drawImageFormat,
+                                             .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                                      VK_IMAGE_USAGE_SAMPLED_BIT,
+                                             .extent = drawImageExtent,
+                                         }) :
+                                     drawImage;
+    // Only read when MSAA is enabled (MSAA depth can't be sampled directly),
+    // otherwise the depth resolve passes are culled. With hardware depth
+    // resolve, it's written by the geometry passes instead.
+    const auto resolveDepthImage = renderGraph.createImage(
+        "depth resolve",
+        {
+            .format = depthImageFormat,
+            .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .extent = drawImageExtent,
+        });
+    const auto sampledDepthImage = msaa ? resolveDepthImage : depthImage;
+    // the contents are overwritten by post FX each frame
+    const auto postFXDrawImage =
+        renderGraph.importImage("post FX draw image", postFXDrawImageId, false);
+
+    // with occlusion culling, geometry is drawn in two passes (see MeshCullingPipeline)
+    const bool twoPassGeometry = gpuCulling && occlusionCulling;
+
+    std::vector<RenderGraph::Access> geometryAccesses{
+        {drawImage, RenderGraph::Usage::ColorAttachmentWrite},
+        {depthImage, RenderGraph::Usage::DepthAttachmentWrite},
+        {skinnedVertices, RenderGraph::Usage::VertexShaderRead},
+    };
+    if (msaa) {
+        geometryAccesses.push_back({resolveImage, RenderGraph::Usage::ColorAttachmentWrite});
+    }
+    if (hwDepthResolve) {
+        geometryAccesses.push_back({resolveDepthImage, RenderGraph::Usage::DepthResolveWrite});
     }
+    if (shadowMap) {
+        geometryAccesses.push_back({*shadowMap, RenderGraph::Usage::FragmentShaderRead});
+    }
+    const auto addGeometryPass =
+        [&](const char* name, MeshCullingPipeline::Pass pass, bool lastPass) {
+            renderGraph.addPass(name, geometryAccesses, [=, this, &camera](VkCommandBuffer cmd) {
+                ZoneScopedN("Geometry");
+                TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "Geometry", tracy::Color::ForestGreen);
+                drawGeometry(
+                    cmd,
+                    camera,
+                    pass,
+                    lastPass,
+                    renderGraph.getImage(drawImage),
+                    renderGraph.getImage(depthImage),
+                    msaa ? &renderGraph.getImage(resolveImage) : nullptr,
+                    hwDepthResolve ? &renderGraph.getImage(resolveDepthImage) : nullptr);
+            });
+        };
+    const auto addDepthResolvePass = [&](const char* name) {
+        renderGraph.addPass(
+            name,
+            {
+                {depthImage, RenderGraph::Usage::FragmentShaderRead},
+                {resolveDepthImage, RenderGraph::Usage::DepthAttachmentWrite},
+            },
+            [this, depthImage, resolveDepthImage](VkCommandBuffer cmd) {
+                resolveDepth(
+                    cmd, renderGraph.getImage(depthImage), renderGraph.getImage(resolveDepthImage));
+            });
+    };
 
-    const auto& drawImage = gfxDevice.getImage(drawImageId);
-    const auto& resolveImage = gfxDevice.getImage(resolveImageId);
-    const auto& depthImage = gfxDevice.getImage(depthImageId);
+    addGeometryPass("Geometry", MeshCullingPipeline::Pass::Early, !twoPassGeometry);
 
-    { // Geometry + Sky
+    if (twoPassGeometry) {
+        // the pyramid is built from the resolved depth with MSAA
+        if (!hwDepthResolve) {
+            addDepthResolvePass("Depth resolve (Hi-Z)");
+        }
 
-        ZoneScopedN("Geometry");
-        TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "Geometry", tracy::Color::ForestGreen);
-        vkutil::cmdBeginLabel(cmd, "Geometry");
+        renderGraph.addPass(
+            "Hi-Z",
+            {{sampledDepthImage, RenderGraph::Usage::ComputeShaderRead}},
+            [this, &camera, sampledDepthImage](VkCommandBuffer cmd) {
+                ZoneScopedN("Hi-Z");
+                TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "Hi-Z", tracy::Color::ForestGreen);
+                // transient images are reallocated when MSAA is toggled
+                const auto& depth = renderGraph.getImage(sampledDepthImage);
+                if (depth.imageView != hiZDepthImageView) {
+                    hiZPipeline.setDepthImage(gfxDevice, depth);
+                    hiZDepthImageView = depth.imageView;
+                }
+                // the pyramid is also used for the early pass of the next frame
+                hiZPipeline.build(cmd, gfxDevice, camera.getViewProj());
+            });
+
+        renderGraph.addPass("Mesh culling (late)", {}, [this](VkCommandBuffer cmd) {
+            ZoneScopedN("Mesh culling (late)");
+            TracyVkZoneC(
+                gfxDevice.getTracyVkCtx(), cmd, "Mesh culling (late)", tracy::Color::ForestGreen);
+            meshCullingPipeline.cullLate(cmd, gfxDevice, hiZPipeline);
+        });
 
-        vkutil::transitionImage(
-            cmd,
-            drawImage.image,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        addGeometryPass("Geometry (late)", MeshCullingPipeline::Pass::Late, true);
+    }
 
-        vkutil::transitionImage(
-            cmd,
-            depthImage.image,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+    if (!hwDepthResolve) {
+        addDepthResolvePass("Depth resolve");
+    }
 
-        if (isMultisamplingEnabled()) {
-            vkutil::transitionImage(
+    renderGraph.addPass(
+        "Post FX",
+        {
+            {resolveImage, RenderGraph::Usage::FragmentShaderRead},
+            {sampledDepthImage, RenderGraph::Usage::FragmentShaderRead},
+            {postFXDrawImage, RenderGraph::Usage::ColorAttachmentWrite},
+        },
+        [this, resolveImage, sampledDepthImage, postFXDrawImage](VkCommandBuffer cmd) {
+            ZoneScopedN("Post FX");
+            TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "Post FX", tracy::Color::Purple);
+
+            const auto& postFXImage = renderGraph.getImage(postFXDrawImage);
+            const auto renderInfo = vkutil::createRenderingInfo({
+                .renderExtent = postFXImage.getExtent2D(),
+                .colorImageView = postFXImage.imageView,
+            });
+
+            vkCmdBeginRendering(cmd, &renderInfo.renderingInfo);
+            postFXPipeline.draw(
                 cmd,
-                resolveImage.image,
-                VK_IMAGE_LAYOUT_UNDEFINED,
-                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-        }
-
-        const auto renderInfo = vkutil::createRenderingInfo({
-            .renderExtent = drawImage.getExtent2D(),
-            .colorImageView = drawImage.imageView,
-            .colorImageClearValue = glm::vec4{0.f, 0.f, 0.f, 1.f},
-            .depthImageView = depthImage.imageView,
-            .depthImageClearValue = 0.f,
-            .resolveImageView = isMultisamplingEnabled() ? resolveImage.imageView : VK_NULL_HANDLE,
+                gfxDevice,
+                renderGraph.getImage(resolveImage),
+                renderGraph.getImage(sampledDepthImage),
+                sceneDataBuffer.getBuffer());
+            vkCmdEndRendering(cmd);
         });
 
-        vkCmdBeginRendering(cmd, &renderInfo.renderingInfo);
+    // depth is used for drawing debug shapes after the renderer
+    renderGraph.markOutput(sampledDepthImage);
 
-        meshPipeline.draw(
-            cmd,
+    renderGraph.compile();
+    outputDepthImageId = renderGraph.getImageId(sampledDepthImage);
+    renderGraph.execute(cmd);
+}
+
+void GameRenderer::drawGeometry(
+    VkCommandBuffer cmd,
+    const Camera& camera,
+    MeshCullingPipeline::Pass pass,
+    bool lastPass,
+    const GPUImage& drawImage,
+    const GPUImage& depthImage,
+    const GPUImage* resolveImage,
+    const GPUImage* resolveDepthImage)
+{
+    const bool earlyPass = (pass == MeshCullingPipeline::Pass::Early);
+    auto renderInfoParams = vkutil::RenderingInfoParams{
+        .renderExtent = drawImage.getExtent2D(),
+        .colorImageView = drawImage.imageView,
+        .depthImageView = depthImage.imageView,
+        .resolveImageView = resolveImage ? resolveImage->imageView : VK_NULL_HANDLE,
+        .depthResolveImageView =
+            resolveDepthImage ? resolveDepthImage->imageView : VK_NULL_HANDLE,
+        // same as the depth resolve shader
+        .depthResolveMode = VK_RESOLVE_MODE_MIN_BIT,
+        // after the last pass, only the resolved images are used
+        .discardColorImage = lastPass && resolveImage,
+        .discardDepthImage = lastPass && resolveDepthImage,
+    };
+    if (earlyPass) {
+        renderInfoParams.colorImageClearValue = glm::vec4{0.f, 0.f, 0.f, 1.f};
+        renderInfoParams.depthImageClearValue = 0.f;
+    }
+    auto renderInfo = vkutil::createRenderingInfo(renderInfoParams);
+
+    if (earlyPass) {
+        geometryStats = {};
+        geometryStats.numInstances = meshCullingPipeline.getNumVisibleDraws();
+    }
+
+    const auto& batches = meshCullingPipeline.getDrawBatches();
+    const auto drawBatches = [&](VkCommandBuffer drawCmd, std::size_t first, std::size_t count) {
+        return meshPipeline.draw(
+            drawCmd,
             drawImage.getExtent2D(),
             gfxDevice,
             meshCache,
-            camera,
             sceneDataBuffer.getBuffer(),
-            meshDrawCommands,
-            sortedMeshDrawCommands);
-
-        // sky
-        skyboxPipeline.draw(cmd, gfxDevice, camera);
+            meshCullingPipeline,
+            gpuCulling,
+            pass,
+            first,
+            count);
+    };
 
+    // GPU culled geometry is drawn with one indirect draw - nothing to split
+    const bool recordInParallel =
+        parallelRecording && !gpuCulling && batches.size() >= 2 * MIN_BATCHES_PER_CHUNK;
+    if (!recordInParallel) {
+        vkCmdBeginRendering(cmd, &renderInfo.renderingInfo);
+        geometryStats.numDrawCalls += drawBatches(cmd, 0, batches.size());
+        if (lastPass) {
+            skyboxPipeline.draw(cmd, gfxDevice, camera);
+        }
         vkCmdEndRendering(cmd);
-        vkutil::cmdEndLabel(cmd);
-    }
-
-    { // Sync Geometry/Sky with next pass
-        const auto imageBarrier = VkImageMemoryBarrier2{
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-            .srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-            .dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
-            .oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-            .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            .image = isMultisamplingEnabled() ? resolveImage.image : drawImage.image,
-            .subresourceRange = vkinit::imageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT),
-        };
-        const auto depthBarrier = VkImageMemoryBarrier2{
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-            .srcStageMask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
-            .srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-            .dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
-            .oldLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-            .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            .image = depthImage.image,
-            .subresourceRange = vkinit::imageSubresourceRange(VK_IMAGE_ASPECT_DEPTH_BIT),
-        };
-        const auto barriers = std::array{imageBarrier, depthBarrier};
-        const auto dependencyInfo = VkDependencyInfo{
-            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-            .imageMemoryBarrierCount = barriers.size(),
-            .pImageMemoryBarriers = barriers.data(),
-        };
-        vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+        return;
     }
 
-    if (isMultisamplingEnabled()) {
-        ZoneScopedN("Depth resolve");
-        TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "Depth resolve", tracy::Color::ForestGreen);
-        vkutil::cmdBeginLabel(cmd, "Depth resolve");
-
-        const auto& resolveDepthImage = gfxDevice.getImage(resolveDepthImageId);
-        vkutil::transitionImage(
-            cmd,
-            resolveDepthImage.image,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+    // Split batches into chunks and record each chunk into a secondary
+    // command buffer on its own thread
+    auto& threadPool = gfxDevice.getRecordingThreadPool();
+    const auto numChunks =
+        std::min(threadPool.getNumThreads(), batches.size() / MIN_BATCHES_PER_CHUNK);
+    const auto batchesPerChunk = (batches.size() + numChunks - 1) / numChunks;
+
+    const auto inheritanceInfo = VkCommandBufferInheritanceRenderingInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &drawImageFormat,
+        .depthAttachmentFormat = depthImageFormat,
+        .rasterizationSamples = samples,
+    };
 
-        const auto renderInfo = vkutil::createRenderingInfo({
-            .renderExtent = resolveDepthImage.getExtent2D(),
-            .depthImageView = resolveDepthImage.imageView,
-        });
+    std::vector<VkCommandBuffer> chunkCmds(numChunks);
+    std::vector<std::uint32_t> chunkDrawCalls(numChunks);
+    threadPool.parallelFor(numChunks, [&](std::size_t chunk, std::size_t threadIndex) {
+        ZoneScopedN("Record geometry chunk");
+        const auto chunkCmd = gfxDevice.beginSecondaryCommandBuffer(threadIndex, &inheritanceInfo);
+        const auto first = chunk * batchesPerChunk;
+        const auto count = std::min(batchesPerChunk, batches.size() - first);
+        chunkDrawCalls[chunk] = drawBatches(chunkCmd, first, count);
+        VK_CHECK(vkEndCommandBuffer(chunkCmd));
+        chunkCmds[chunk] = chunkCmd;
+    });
+    for (const auto numDrawCalls : chunkDrawCalls) {
+        geometryStats.numDrawCalls += numDrawCalls;
+    }
 
-        vkCmdBeginRendering(cmd, &renderInfo.renderingInfo);
+    if (lastPass) { // draw sky
+        // the caller's thread has index 0 and parallelFor has already returned
+        const auto skyCmd = gfxDevice.beginSecondaryCommandBuffer(0, &inheritanceInfo);
+        const auto renderExtent = drawImage.getExtent2D();
+        const auto viewport = VkViewport{
+            .x = 0,
+            .y = 0,
+            .width = (float)renderExtent.width,
+            .height = (float)renderExtent.height,
+            .minDepth = 0.f,
+            .maxDepth = 1.f,
+        };
+        vkCmdSetViewport(skyCmd, 0, 1, &viewport);
+        const auto scissor = VkRect2D{
+            .offset = {},
+            .extent = renderExtent,
+        };
+        vkCmdSetScissor(skyCmd, 0, 1, &scissor);
+        skyboxPipeline.draw(skyCmd, gfxDevice, camera);
+        VK_CHECK(vkEndCommandBuffer(skyCmd));
+        chunkCmds.push_back(skyCmd);
+    }
 
-        depthResolvePipeline.draw(cmd, gfxDevice, depthImage, vkutil::sampleCountToInt(samples));
+    renderInfo.renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+    vkCmdBeginRendering(cmd, &renderInfo.renderingInfo);
+    vkCmdExecuteCommands(cmd, (std::uint32_t)chunkCmds.size(), chunkCmds.data());
+    vkCmdEndRendering(cmd);
+}
 
-        vkCmdEndRendering(cmd);
+void GameRenderer::addSkinningJobs(const Camera& camera)
+{
+    const auto frameIndex = gfxDevice.getCurrentFrameIndex();
+    const auto frameNumber = gfxDevice.getFrameNumber();
+    const bool skinOnAsyncCompute = asyncCompute && gfxDevice.hasAsyncCompute();
+    const auto frustum = edge::createFrustumFromCamera(camera);
+    const auto& casterFrustums = csmPipeline.getCasterCullingFrustums();
+    const bool shadowsVisible = shadowsEnabled && sunlightIndex != -1;
+
+    skinningStats = {};
+    for (const auto& dc : meshDrawCommands) {
+        if (!dc.skinnedMesh) {
+            continue;
+        }
+        ++skinningStats.numSkinnedMeshes;
+
+        // skip meshes which are culled from the camera and from all cascades
+        bool visible = edge::isInFrustum(frustum, dc.worldBoundingSphere);
+        if (!visible && shadowsVisible && dc.castShadow) {
+            visible = std::ranges::any_of(casterFrustums, [&dc](const Frustum& f) {
+                return edge::isInFrustum(f, dc.worldBoundingSphere);
+            });
+        }
+        if (!visible) {
+            ++skinningStats.numCulled;
+            continue;
+        }
 
-        // sync with post fx
-        vkutil::transitionImage(
-            cmd,
-            resolveDepthImage.image,
-            VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        // this frame's buffer was already skinned with the same pose (if the
+        // skinning was recorded into a frame which was skipped, it never ran)
+        auto& skinnedMesh = *dc.skinnedMesh;
+        auto& bufferPoseVersion = skinnedMesh.skinnedPoseVersions[frameIndex];
+        const bool skinningLost = skinnedMesh.skinningSubmitPending[frameIndex] &&
+                                  skinnedMesh.skinnedFrameNumbers[frameIndex] == frameNumber;
+        if (dc.poseVersion != 0 && bufferPoseVersion == dc.poseVersion && !skinningLost) {
+            ++skinningStats.numReused;
+            continue;
+        }
 
-        vkutil::cmdEndLabel(cmd);
+        skinningPipeline.addJob(frameIndex, meshCache, dc);
+        bufferPoseVersion = dc.poseVersion;
+        skinnedMesh.skinningSubmitPending[frameIndex] = !skinOnAsyncCompute;
+        skinnedMesh.skinnedFrameNumbers[frameIndex] = frameNumber;
     }
+}
 
-    { // post FX
-        ZoneScopedN("Post FX");
-        TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "Post FX", tracy::Color::Purple);
-        vkutil::cmdBeginLabel(cmd, "Post FX");
-
-        const auto& postFXDrawImage = gfxDevice.getImage(postFXDrawImageId);
-        vkutil::transitionImage(
-            cmd,
-            postFXDrawImage.image,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-        const auto renderInfo = vkutil::createRenderingInfo({
-            .renderExtent = postFXDrawImage.getExtent2D(),
-            .colorImageView = postFXDrawImage.imageView,
-        });
+void GameRenderer::resolveDepth(
+    VkCommandBuffer cmd,
+    const GPUImage& depthImage,
+    const GPUImage& resolveDepthImage)
+{
+    ZoneScopedN("Depth resolve");
+    TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "Depth resolve", tracy::Color::ForestGreen);
 
-        vkCmdBeginRendering(cmd, &renderInfo.renderingInfo);
-        if (isMultisamplingEnabled()) {
-            const auto& resolveDepthImage = gfxDevice.getImage(resolveDepthImageId);
-            postFXPipeline
-                .draw(cmd, gfxDevice, resolveImage, resolveDepthImage, sceneDataBuffer.getBuffer());
-        } else {
-            postFXPipeline.draw(cmd, gfxDevice, drawImage, depthImage, sceneDataBuffer.getBuffer());
-        }
-        vkCmdEndRendering(cmd);
+    const auto renderInfo = vkutil::createRenderingInfo({
+        .renderExtent = resolveDepthImage.getExtent2D(),
+        .depthImageView = resolveDepthImage.imageView,
+    });
 
-        vkutil::cmdEndLabel(cmd);
-    }
+    vkCmdBeginRendering(cmd, &renderInfo.renderingInfo);
+    depthResolvePipeline.draw(cmd, gfxDevice, depthImage, vkutil::sampleCountToInt(samples));
+    vkCmdEndRendering(cmd);
 }
 
 void GameRenderer::cleanup()
 {
     const auto& device = gfxDevice.getDevice();
 
+    renderGraph.cleanup();
+
     lightDataBuffer.cleanup(gfxDevice);
     sceneDataBuffer.cleanup(gfxDevice);
 
     postFXPipeline.cleanup(device);
     depthResolvePipeline.cleanup(device);
+    lightClusteringPipeline.cleanup(gfxDevice);
+    hiZPipeline.cleanup(gfxDevice);
     skyboxPipeline.cleanup(device);
     meshPipeline.cleanup(device);
+    meshCullingPipeline.cleanup(gfxDevice);
     csmPipeline.cleanup(gfxDevice);
     skinningPipeline.cleanup(gfxDevice);
 }
@@ -397,6 +613,32 @@ void GameRenderer::updateDevTools(float dt)
     ImGui::DragFloat3("Cascades", csmPipeline.percents.data(), 0.1f, 0.f, 1.f);
 
     ImGui::Checkbox("Shadows", &shadowsEnabled);
+    ImGui::Checkbox("GPU culling", &gpuCulling);
+    if (gfxDevice.hasAsyncCompute()) {
+        ImGui::Checkbox("Async compute", &asyncCompute);
+    }
+    if (gpuCulling) {
+        ImGui::Checkbox("Occlusion culling", &occlusionCulling);
+    }
+    ImGui::Checkbox("Static shadow cache", &csmPipeline.staticShadowCacheEnabled);
+    ImGui::Checkbox("Mesh LODs", &meshLodsEnabled);
+    ImGui::Checkbox("Texture streaming", &textureStreaming);
+    if (meshLodsEnabled) {
+        ImGui::DragFloat("LOD max pixel error", &lodMaxPixelError, 0.05f, 0.1f, 50.f);
+        ImGui::DragFloat("LOD hysteresis", &lodHysteresis, 0.01f, 0.f, 0.5f);
+    }
+    auto shadowLodBias = (int)csmPipeline.shadowLodBias;
+    if (ImGui::SliderInt("Shadow LOD bias", &shadowLodBias, 0, 4)) {
+        csmPipeline.shadowLodBias = (std::uint32_t)shadowLodBias;
+    }
+    if (ImGui::Checkbox("Parallel recording", &parallelRecording)) {
+        csmPipeline.parallelRecording = parallelRecording;
+    }
+
+    if (hardwareDepthResolveSupported) {
+        // with MSAA, resolve depth in the geometry passes instead of a shader pass
+        ImGui::Checkbox("Hardware depth resolve", &hardwareDepthResolve);
+    }
 
     if (ImGui::BeginCombo("MSAA", vkutil::sampleCountToString(samples))) {
         static const auto counts = std::array{
@@ -420,6 +662,43 @@ void GameRenderer::updateDevTools(float dt)
         }
         ImGui::EndCombo();
     }
+
+    ImGui::Text(
+        "Pipeline creation at startup: %.1f ms (cache: %d KB loaded)",
+        pipelineCreationTime,
+        (int)(gfxDevice.getLoadedPipelineCacheSize() / 1024));
+
+    if (ImGui::TreeNode("Draw stats")) {
+        ImGui::Text("Draws: %d", (int)meshDrawCommands.size());
+        ImGui::Text(
+            "Geometry: %d draw calls, %d instances",
+            (int)geometryStats.numDrawCalls,
+            (int)geometryStats.numInstances);
+        if (gpuCulling && occlusionCulling) {
+            ImGui::Text("Occluded: %d", (int)meshCullingPipeline.getNumOccludedDraws());
+        }
+        const auto& csmStats = csmPipeline.getStats();
+        for (std::size_t i = 0; i < csmStats.size(); ++i) {
+            ImGui::Text(
+                "CSM cascade %d: %d draw calls, %d instances",
+                (int)i,
+                (int)csmStats[i].numDrawCalls,
+                (int)csmStats[i].numInstances);
+        }
+        ImGui::Text("Static cascade redraws: %d", (int)csmPipeline.numStaticCascadeRedraws);
+        ImGui::Text("Lights: %d", (int)lightDataCPU.size());
+        ImGui::Text(
+            "Skinned meshes: %d (%d culled, %d reused)",
+            (int)skinningStats.numSkinnedMeshes,
+            (int)skinningStats.numCulled,
+            (int)skinningStats.numReused);
+        ImGui::Text(
+            "Render graph: %d culled passes, %d transient images in %d memory blocks",
+            (int)renderGraph.getNumCulledPasses(),
+            (int)renderGraph.getNumTransientImages(),
+            (int)renderGraph.getNumMemoryBlocks());
+        ImGui::TreePop();
+    }
 }
 
 bool GameRenderer::isMultisamplingEnabled() const
@@ -431,25 +710,20 @@ void GameRenderer::onMultisamplingStateUpdate()
 {
     gfxDevice.waitIdle();
 
-    { // cleanup old state
-        meshPipeline.cleanup(gfxDevice.getDevice());
-        skyboxPipeline.cleanup(gfxDevice.getDevice());
+    meshPipeline.cleanup(gfxDevice.getDevice());
+    skyboxPipeline.cleanup(gfxDevice.getDevice());
+    // draw and depth images are reallocated by the render graph during the
+    // next frame (their create infos have changed)
 
-        const auto& drawImage = gfxDevice.getImage(drawImageId);
-        const auto& depthImage = gfxDevice.getImage(depthImageId);
-
-        gfxDevice.destroyImage(depthImage);
-        gfxDevice.destroyImage(drawImage);
-    }
-
-    const auto& drawImage = gfxDevice.getImage(drawImageId);
-    const auto prevDrawImageSize =
-        glm::ivec2{drawImage.getExtent2D().width, drawImage.getExtent2D().height};
-    createDrawImage(prevDrawImageSize, false);
-
-    // recreate pipelines
-    meshPipeline.init(gfxDevice, drawImageFormat, depthImageFormat, samples);
-    skyboxPipeline.init(gfxDevice, drawImageFormat, depthImageFormat, samples);
+    // recreate pipelines (they're in the pipeline cache if this sample count
+    // was used before)
+    gfxDevice.getRecordingThreadPool().parallelFor(2, [this](std::size_t index, std::size_t) {
+        if (index == 0) {
+            meshPipeline.init(gfxDevice, drawImageFormat, depthImageFormat, samples);
+        } else {
+            skyboxPipeline.init(gfxDevice, drawImageFormat, depthImageFormat, samples);
+        }
+    });
 }
 
 void GameRenderer::setSkyboxImage(ImageId skyboxImageId)
@@ -457,8 +731,15 @@ void GameRenderer::setSkyboxImage(ImageId skyboxImageId)
     skyboxPipeline.setSkyboxImage(skyboxImageId);
 }
 
-void GameRenderer::beginDrawing()
+void GameRenderer::beginDrawing(const Camera& camera)
 {
+    lodCameraPosition = camera.getPosition();
+    lodCameraOrthographic = camera.isOrthographic();
+    // proj[1][1] is 1 / tan(fovY / 2) for perspective and 1 / halfHeight for
+    // orthographic projection (it's negative if clip space Y points down)
+    const auto drawImageHeight = (float)drawImageExtent.height;
+    lodProjectionScale = std::abs(camera.getProjection()[1][1]) * drawImageHeight * 0.5f;
+
     meshDrawCommands.clear();
     lightDataCPU.clear();
     sunlightIndex = -1;
@@ -468,6 +749,22 @@ void GameRenderer::beginDrawing()
 void GameRenderer::endDrawing()
 {
     sortDrawList();
+
+    drawBoundingSpheres.clear();
+    for (const auto& dcIdx : sortedMeshDrawCommands) {
+        drawBoundingSpheres.add(meshDrawCommands[dcIdx].worldBoundingSphere);
+    }
+
+    if (lightDataCPU.size() > lightDataBufferCapacity) {
+        gfxDevice.deferDestruction(
+            [&gfxDevice = gfxDevice, oldBuffer = std::exchange(lightDataBuffer, {})]() mutable {
+                oldBuffer.cleanup(gfxDevice);
+            });
+        while (lightDataBufferCapacity < lightDataCPU.size()) {
+            lightDataBufferCapacity *= 2;
+        }
+        initLightDataBuffer();
+    }
 }
 
 void GameRenderer::addLight(const Light& light, const Transform& transform)
@@ -503,25 +800,100 @@ void GameRenderer::addLight(const Light& light, const Transform& transform)
     lightDataCPU.push_back(ld);
 }
 
-void GameRenderer::drawMesh(MeshId id, const glm::mat4& transform, bool castShadow)
+void GameRenderer::drawMesh(
+    MeshId id,
+    const glm::mat4& transform,
+    bool castShadow,
+    bool isStatic,
+    std::uint32_t* lod)
 {
     const auto& mesh = meshCache.getMesh(id);
     const auto worldBoundingSphere =
         edge::calculateBoundingSphereWorld(transform, mesh.boundingSphere, false);
 
+    const auto meshLod = selectLod(mesh, worldBoundingSphere, lod ? *lod : 0);
+    if (lod) {
+        *lod = meshLod;
+    }
+
     meshDrawCommands.push_back(MeshDrawCommand{
         .meshId = id,
         .transformMatrix = transform,
         .worldBoundingSphere = worldBoundingSphere,
+        .lod = meshLod,
         .castShadow = castShadow,
+        .isStatic = isStatic,
     });
 }
 
+std::uint32_t GameRenderer::selectLod(
+    const GPUMesh& mesh,
+    const math::Sphere& worldBoundingSphere,
+    std::uint32_t prevLod) const
+{
+    if (!meshLodsEnabled || mesh.lods.size() <= 1) {
+        return 0;
+    }
+
+    const auto projectedSize = getProjectedSize(worldBoundingSphere);
+    if (std::isinf(projectedSize)) {
+        return 0;
+    }
+    return graphics::selectMeshLod(
+        mesh.lods, projectedSize, lodMaxPixelError, prevLod, lodHysteresis);
+}
+
+float GameRenderer::getProjectedSize(const math::Sphere& worldBoundingSphere) const
+{
+    auto projectedSize = worldBoundingSphere.radius * 2.f * lodProjectionScale;
+    if (!lodCameraOrthographic) {
+        const auto distance = glm::length(worldBoundingSphere.center - lodCameraPosition);
+        if (distance <= worldBoundingSphere.radius) {
+            // the camera is inside the mesh's bounds
+            return std::numeric_limits<float>::infinity();
+        }
+        projectedSize /= distance;
+    }
+    return projectedSize;
+}
+
+void GameRenderer::requestTextureMips(const Camera& camera)
+{
+    ZoneScopedN("Request texture mips");
+    const auto frustum = edge::createFrustumFromCamera(camera);
+    edge::cullSpheres(frustum, drawBoundingSpheres, streamingVisibility);
+
+    auto& textureStreamer = gfxDevice.getTextureStreamer();
+    for (std::size_t i = 0; i < sortedMeshDrawCommands.size(); ++i) {
+        if (!streamingVisibility.isVisible(i)) {
+            continue;
+        }
+        const auto& dc = meshDrawCommands[sortedMeshDrawCommands[i]];
+        const auto& mesh = meshCache.getMesh(dc.meshId);
+        if (mesh.materialId == NULL_MATERIAL_ID) {
+            continue;
+        }
+
+        const auto& material = materialCache.getMaterial(mesh.materialId);
+        const auto screenSize = getProjectedSize(dc.worldBoundingSphere);
+        for (const auto textureId :
+             {material.diffuseTexture,
+              material.normalMapTexture,
+              material.metallicRoughnessTexture,
+              material.emissiveTexture}) {
+            if (textureId != NULL_IMAGE_ID) {
+                textureStreamer.requestResolution(textureId, screenSize);
+            }
+        }
+    }
+}
+
 void GameRenderer::drawSkinnedMesh(
     std::span<const MeshId> meshes,
-    std::span<const SkinnedMesh> skinnedMeshes,
+    std::span<SkinnedMesh> skinnedMeshes,
     const glm::mat4& transform,
-    std::span<const glm::mat4> jointMatrices)
+    std::span<const glm::mat4> jointMatrices,
+    std::uint64_t poseVersion)
 {
     const auto startIndex =
         skinningPipeline.appendJointMatrices(jointMatrices, gfxDevice.getCurrentFrameIndex());
@@ -539,6 +911,7 @@ void GameRenderer::drawSkinnedMesh(
             .worldBoundingSphere = worldBoundingSphere,
             .skinnedMesh = &skinnedMeshes[i],
             .jointMatricesStartIndex = (std::uint32_t)startIndex,
+            .poseVersion = poseVersion,
         });
     }
 }
@@ -555,7 +928,20 @@ void GameRenderer::sortDrawList()
         [this](const auto& i1, const auto& i2) {
             const auto& dc1 = meshDrawCommands[i1];
             const auto& dc2 = meshDrawCommands[i2];
-            return dc1.meshId < dc2.meshId;
+            // meshes with the same index type are drawn with one indirect draw
+            const auto indexType1 = meshCache.getMesh(dc1.meshId).indexType;
+            const auto indexType2 = meshCache.getMesh(dc2.meshId).indexType;
+            if (indexType1 != indexType2) {
+                return indexType1 < indexType2;
+            }
+            if (dc1.meshId != dc2.meshId) {
+                return dc1.meshId < dc2.meshId;
+            }
+            if (dc1.lod != dc2.lod) {
+                return dc1.lod < dc2.lod;
+            }
+            // keep non-skinned draws together so that they're instanced
+            return (dc1.skinnedMesh == nullptr) > (dc2.skinnedMesh == nullptr);
         });
 }
 
@@ -572,7 +958,7 @@ VkFormat GameRenderer::getDrawImageFormat() const
 
 const GPUImage& GameRenderer::getDepthImage() const
 {
-    return gfxDevice.getImage(isMultisamplingEnabled() ? resolveDepthImageId : depthImageId);
+    return gfxDevice.getImage(outputDepthImageId);
 }
 
 VkFormat GameRenderer::getDepthImageFormat() const
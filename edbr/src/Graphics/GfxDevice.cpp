@@ -1,7 +1,11 @@
 #include <edbr/Graphics/GfxDevice.h>
 
+#include <algorithm> // clamp
+#include <cassert>
 #include <iostream>
 #include <limits>
+#include <thread> // hardware_concurrency
+#include <unordered_map>
 
 #include <vulkan/vulkan.h>
 
@@ -22,6 +26,7 @@
 #include <edbr/Graphics/Vulkan/Util.h>
 
 #include <edbr/Graphics/ImageLoader.h>
+#include <edbr/Graphics/KTX2.h>
 #include <edbr/Graphics/MipMapGeneration.h>
 
 #include <tracy/Tracy.hpp>
@@ -29,6 +34,79 @@
 namespace
 {
 static constexpr auto NO_TIMEOUT = std::numeric_limits<std::uint64_t>::max();
+// more threads don't help much with recording and only take CPU time from other systems
+static constexpr std::size_t MAX_RECORDING_THREADS = 8;
+// uploads bigger than 1/4 of this get their own staging buffers
+static constexpr std::size_t UPLOAD_STAGING_BUFFER_SIZE = 64 * 1024 * 1024;
+// relative to the working directory (which is the executable's directory)
+static const std::filesystem::path PIPELINE_CACHE_PATH = "cooked/pipeline_cache.bin";
+// device local host visible heaps of this size or smaller are the default 256 MB BAR
+// which is too small to put the streaming buffers there (ReBAR heaps are much bigger)
+static constexpr VkDeviceSize SMALL_BAR_HEAP_SIZE = 256 * 1024 * 1024;
+// usage of the buffer which is used to find the memory types of the pools - in
+// practice, buffers with any usage can be allocated from the same memory types
+static constexpr VkBufferUsageFlags POOL_BUFFER_USAGE =
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+VmaAllocationCreateInfo getAllocationCreateInfo(MemoryClass memoryClass)
+{
+    switch (memoryClass) {
+    case MemoryClass::GPUOnly:
+        return {.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE};
+    case MemoryClass::Streaming:
+        return {
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                     VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+            .requiredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        };
+    case MemoryClass::Readback:
+        return {
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                     VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+            .requiredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        };
+    case MemoryClass::Staging:
+        return {
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                     VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+            .requiredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        };
+    }
+    assert(false);
+    return {};
+}
+
+// Images which are only sampled after their data is uploaded - they're always
+// in SHADER_READ_ONLY_OPTIMAL layout, so defragmentation can copy them
+bool isMovableImage(VkImageUsageFlags usage)
+{
+    constexpr VkImageUsageFlags movableUsage = VK_IMAGE_USAGE_SAMPLED_BIT |
+                                               VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                               VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    return (usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0 && (usage & ~movableUsage) == 0;
+}
+
+const char* getMemoryClassName(MemoryClass memoryClass)
+{
+    switch (memoryClass) {
+    case MemoryClass::GPUOnly:
+        return "GPU only";
+    case MemoryClass::Streaming:
+        return "streaming";
+    case MemoryClass::Readback:
+        return "readback";
+    case MemoryClass::Staging:
+        return "staging";
+    }
+    assert(false);
+    return "";
+}
 }
 
 GfxDevice::GfxDevice() : imageCache(*this)
@@ -37,7 +115,14 @@ GfxDevice::GfxDevice() : imageCache(*this)
 void GfxDevice::init(SDL_Window* window, const char* appName, const Version& version, bool vSync)
 {
     initVulkan(window, appName, version);
+    initMemoryPools();
+    pipelineCache.init(device, physicalDevice.properties, PIPELINE_CACHE_PATH);
     executor = createImmediateExecutor();
+    uploadQueue.init(
+        *this,
+        {.family = graphicsQueueFamily, .queue = graphicsQueue},
+        {.family = transferQueueFamily, .queue = transferQueue},
+        UPLOAD_STAGING_BUFFER_SIZE);
 
     swapchain.initSyncStructures(device);
 
@@ -115,11 +200,14 @@ void GfxDevice::initVulkan(SDL_Window* window, const char* appName, const Versio
 
     const auto deviceFeatures = VkPhysicalDeviceFeatures{
         .geometryShader = VK_TRUE, // for im3d
+        .multiDrawIndirect = VK_TRUE,
+        .drawIndirectFirstInstance = VK_TRUE,
         .depthClamp = VK_TRUE,
         .samplerAnisotropy = VK_TRUE,
     };
 
     const auto features12 = VkPhysicalDeviceVulkan12Features{
+        .drawIndirectCount = true,
         .descriptorIndexing = true,
         .descriptorBindingSampledImageUpdateAfterBind = true,
         .descriptorBindingStorageImageUpdateAfterBind = true,
@@ -127,6 +215,7 @@ void GfxDevice::initVulkan(SDL_Window* window, const char* appName, const Versio
         .descriptorBindingVariableDescriptorCount = true,
         .runtimeDescriptorArray = true,
         .scalarBlockLayout = true,
+        .timelineSemaphore = true,
         .bufferDeviceAddress = true,
     };
     const auto features13 = VkPhysicalDeviceVulkan13Features{
@@ -139,10 +228,16 @@ void GfxDevice::initVulkan(SDL_Window* window, const char* appName, const Versio
                          .set_required_features(deviceFeatures)
                          .set_required_features_12(features12)
                          .set_required_features_13(features13)
+                         // for GPUMemoryStats (VMA estimates the budget without it)
+                         .add_desired_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)
                          .set_surface(surface)
                          .select()
                          .value();
 
+    // cooked textures are BC compressed - without it, the source images are loaded
+    textureCompressionBCSupported = physicalDevice.enable_features_if_present(
+        VkPhysicalDeviceFeatures{.textureCompressionBC = VK_TRUE});
+
     checkDeviceCapabilities();
 
     device = vkb::DeviceBuilder{physicalDevice}.build().value();
@@ -150,14 +245,41 @@ void GfxDevice::initVulkan(SDL_Window* window, const char* appName, const Versio
     graphicsQueueFamily = device.get_queue_index(vkb::QueueType::graphics).value();
     graphicsQueue = device.get_queue(vkb::QueueType::graphics).value();
 
+    // vk-bootstrap only returns a compute queue from a family without graphics support
+    if (const auto computeQueueIndex = device.get_queue_index(vkb::QueueType::compute);
+        computeQueueIndex.has_value()) {
+        asyncComputeSupported = true;
+        computeQueueFamily = computeQueueIndex.value();
+        computeQueue = device.get_queue(vkb::QueueType::compute).value();
+    }
+
+    // uploads use a transfer-only queue (usually a separate DMA engine) if there's one
+    if (const auto transferQueueIndex = device.get_dedicated_queue_index(vkb::QueueType::transfer);
+        transferQueueIndex.has_value()) {
+        transferQueueFamily = transferQueueIndex.value();
+        transferQueue = device.get_dedicated_queue(vkb::QueueType::transfer).value();
+    }
+
+    bufferQueueFamilies.push_back(graphicsQueueFamily);
+    if (asyncComputeSupported) {
+        bufferQueueFamilies.push_back(computeQueueFamily);
+    }
+    if (transferQueue != VK_NULL_HANDLE) {
+        bufferQueueFamilies.push_back(transferQueueFamily);
+    }
+
     { // Init VMA
         const auto vulkanFunctions = VmaVulkanFunctions{
             .vkGetInstanceProcAddr = vkGetInstanceProcAddr,
             .vkGetDeviceProcAddr = vkGetDeviceProcAddr,
         };
 
+        VmaAllocatorCreateFlags flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+        if (physicalDevice.is_extension_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+            flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        }
         const auto allocatorInfo = VmaAllocatorCreateInfo{
-            .flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+            .flags = flags,
             .physicalDevice = physicalDevice,
             .device = device,
             .pVulkanFunctions = &vulkanFunctions,
@@ -170,10 +292,30 @@ void GfxDevice::initVulkan(SDL_Window* window, const char* appName, const Versio
 void GfxDevice::checkDeviceCapabilities()
 {
     // check limits
-    VkPhysicalDeviceProperties props{};
-    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    auto depthStencilResolveProps = VkPhysicalDeviceDepthStencilResolveProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEPTH_STENCIL_RESOLVE_PROPERTIES,
+    };
+    auto props2 = VkPhysicalDeviceProperties2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &depthStencilResolveProps,
+    };
+    vkGetPhysicalDeviceProperties2(physicalDevice, &props2);
+    const auto& props = props2.properties;
 
     maxSamplerAnisotropy = props.limits.maxSamplerAnisotropy;
+    supportedDepthResolveModes = depthStencilResolveProps.supportedDepthResolveModes;
+
+    { // lazily allocated memory is usually only present on tile-based GPUs
+        VkPhysicalDeviceMemoryProperties memoryProps{};
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProps);
+        lazilyAllocatedMemoryTypeBits = 0;
+        for (std::uint32_t i = 0; i < memoryProps.memoryTypeCount; ++i) {
+            if (memoryProps.memoryTypes[i].propertyFlags &
+                VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+                lazilyAllocatedMemoryTypeBits |= (1u << i);
+            }
+        }
+    }
 
     { // store which sampling counts HW supports
         const auto counts = std::array{
@@ -211,6 +353,47 @@ void GfxDevice::createCommandBuffers()
         auto& mainCommandBuffer = frames[i].mainCommandBuffer;
         VK_CHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &mainCommandBuffer));
     }
+
+    { // secondary command buffers - each recording thread has its own pool per frame
+        const auto numHardwareThreads = (std::size_t)std::thread::hardware_concurrency();
+        const auto numThreads =
+            std::clamp(numHardwareThreads, (std::size_t)1, MAX_RECORDING_THREADS);
+        recordingThreadPool = std::make_unique<ThreadPool>(numThreads - 1);
+
+        const auto threadPoolCreateInfo = vkinit::commandPoolCreateInfo(0, graphicsQueueFamily);
+        for (auto& frame : frames) {
+            frame.threadCommandPools.resize(numThreads);
+            for (auto& threadPool : frame.threadCommandPools) {
+                VK_CHECK(
+                    vkCreateCommandPool(device, &threadPoolCreateInfo, nullptr, &threadPool.pool));
+            }
+        }
+    }
+
+    if (!asyncComputeSupported) {
+        return;
+    }
+
+    const auto computePoolCreateInfo = vkinit::
+        commandPoolCreateInfo(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, computeQueueFamily);
+    for (std::uint32_t i = 0; i < graphics::FRAME_OVERLAP; ++i) {
+        auto& commandPool = frames[i].computeCommandPool;
+        VK_CHECK(vkCreateCommandPool(device, &computePoolCreateInfo, nullptr, &commandPool));
+
+        const auto cmdAllocInfo = vkinit::commandBufferAllocateInfo(commandPool, 1);
+        VK_CHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &frames[i].computeCommandBuffer));
+    }
+
+    const auto semaphoreTypeInfo = VkSemaphoreTypeCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    const auto semaphoreInfo = VkSemaphoreCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &semaphoreTypeInfo,
+    };
+    VK_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &computeSemaphore));
 }
 
 void GfxDevice::recreateSwapchain(std::uint32_t swapchainWidth, std::uint32_t swapchainHeight)
@@ -229,6 +412,21 @@ VkCommandBuffer GfxDevice::beginFrame()
 {
     swapchain.beginFrame(device, getCurrentFrameIndex());
 
+    uploadQueue.collectFinishedBatches();
+    runDeferredDestructions(false);
+
+    vmaSetCurrentFrameIndex(allocator, frameNumber);
+    memoryStats.updateHeapStats(allocator);
+
+    // streams in the mips requested in the previous frame
+    imageCache.getTextureStreamer().update();
+
+    // GPU is done with the frame, so its secondary command buffers can be reused
+    for (auto& threadPool : getCurrentFrame().threadCommandPools) {
+        VK_CHECK(vkResetCommandPool(device, threadPool.pool, 0));
+        threadPool.numUsed = 0;
+    }
+
     const auto& frame = getCurrentFrame();
     const auto& cmd = frame.mainCommandBuffer;
     const auto cmdBeginInfo = VkCommandBufferBeginInfo{
@@ -246,6 +444,8 @@ void GfxDevice::endFrame(VkCommandBuffer cmd, const GPUImage& drawImage, const E
     const auto [swapchainImage, swapchainImageIndex] =
         swapchain.acquireImage(device, getCurrentFrameIndex());
     if (swapchainImage == VK_NULL_HANDLE) {
+        // the frame is skipped, so nothing will wait for its async compute work
+        getCurrentFrame().computeSubmitted = false;
         return;
     }
 
@@ -329,19 +529,58 @@ void GfxDevice::endFrame(VkCommandBuffer cmd, const GPUImage& drawImage, const E
 
     VK_CHECK(vkEndCommandBuffer(cmd));
 
-    swapchain.submitAndPresent(cmd, graphicsQueue, getCurrentFrameIndex(), swapchainImageIndex);
+    auto& frame = getCurrentFrame();
+    std::array<VkSemaphoreSubmitInfo, 2> waitInfos;
+    std::size_t numWaitInfos = 0;
+    if (frame.computeSubmitted) {
+        auto& waitInfo = waitInfos[numWaitInfos++];
+        waitInfo = vkinit::semaphoreSubmitInfo(frame.computeWaitStage, computeSemaphore);
+        waitInfo.value = frame.computeSemaphoreValue;
+        frame.computeSubmitted = false;
+    }
+    if (const auto uploadValue = uploadQueue.submit(); uploadValue > 0) {
+        auto& waitInfo = waitInfos[numWaitInfos++];
+        waitInfo = vkinit::semaphoreSubmitInfo(
+            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, uploadQueue.getSemaphore());
+        waitInfo.value = uploadValue;
+    }
+    swapchain.submitAndPresent(
+        cmd,
+        graphicsQueue,
+        getCurrentFrameIndex(),
+        swapchainImageIndex,
+        {waitInfos.data(), numWaitInfos});
 
     frameNumber++;
 }
 
 void GfxDevice::cleanup()
 {
+    // images destroyed by deferred functions can have pending uploads
+    uploadQueue.flush();
+    runDeferredDestructions(true);
+
+    // streamed images which are not swapped in yet can have pending uploads
+    imageCache.getTextureStreamer().cleanup();
+    uploadQueue.cleanup();
+
     imageCache.destroyImages();
     imageCache.bindlessSetManager.cleanup(device);
 
     for (auto& frame : frames) {
         vkDestroyCommandPool(device, frame.commandPool, 0);
         TracyVkDestroy(frame.tracyVkCtx);
+        for (auto& threadPool : frame.threadCommandPools) {
+            vkDestroyCommandPool(device, threadPool.pool, 0);
+        }
+    }
+    recordingThreadPool.reset();
+
+    if (asyncComputeSupported) {
+        for (auto& frame : frames) {
+            vkDestroyCommandPool(device, frame.computeCommandPool, 0);
+        }
+        vkDestroySemaphore(device, computeSemaphore, nullptr);
     }
 
     // cleanup Dear ImGui
@@ -353,33 +592,104 @@ void GfxDevice::cleanup()
 
     executor.cleanup(device);
 
+    pipelineCache.save();
+    pipelineCache.cleanup();
+
     vkb::destroy_surface(instance, surface);
+    for (const auto pool : memoryPools) {
+        vmaDestroyPool(allocator, pool);
+    }
     vmaDestroyAllocator(allocator);
     vkb::destroy_device(device);
     vkb::destroy_instance(instance);
 }
 
+void GfxDevice::initMemoryPools()
+{
+    const VkPhysicalDeviceMemoryProperties* memoryProps{nullptr};
+    vmaGetMemoryProperties(allocator, &memoryProps);
+
+    auto bufferInfo = VkBufferCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = 1024,
+        .usage = POOL_BUFFER_USAGE,
+    };
+    setBufferSharingMode(bufferInfo);
+
+    for (std::size_t i = 0; i < memoryPools.size(); ++i) {
+        const auto memoryClass = (MemoryClass)i;
+        auto allocInfo = getAllocationCreateInfo(memoryClass);
+        std::uint32_t memoryTypeIndex{0};
+        VK_CHECK(vmaFindMemoryTypeIndexForBufferInfo(
+            allocator, &bufferInfo, &allocInfo, &memoryTypeIndex));
+
+        if (memoryClass == MemoryClass::Streaming) {
+            const auto& memoryType = memoryProps->memoryTypes[memoryTypeIndex];
+            const auto heapSize = memoryProps->memoryHeaps[memoryType.heapIndex].size;
+            streamingMemoryDeviceLocal =
+                (memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+            if (streamingMemoryDeviceLocal && heapSize <= SMALL_BAR_HEAP_SIZE) {
+                // no ReBAR - the small BAR is better left for the driver
+                streamingMemoryDeviceLocal = false;
+                allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+                VK_CHECK(vmaFindMemoryTypeIndexForBufferInfo(
+                    allocator, &bufferInfo, &allocInfo, &memoryTypeIndex));
+            }
+            fmt::println(
+                "Streaming buffers use {} memory",
+                streamingMemoryDeviceLocal ? "device local" : "host");
+        }
+
+        const auto poolInfo = VmaPoolCreateInfo{
+            .memoryTypeIndex = memoryTypeIndex,
+        };
+        VK_CHECK(vmaCreatePool(allocator, &poolInfo, &memoryPools[i]));
+        vmaSetPoolName(allocator, memoryPools[i], getMemoryClassName(memoryClass));
+    }
+}
+
+void GfxDevice::setBufferSharingMode(VkBufferCreateInfo& bufferInfo) const
+{
+    // buffers can be accessed from all queues without queue family ownership transfers
+    if (bufferQueueFamilies.size() > 1) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = (std::uint32_t)bufferQueueFamilies.size();
+        bufferInfo.pQueueFamilyIndices = bufferQueueFamilies.data();
+    }
+}
+
 GPUBuffer GfxDevice::createBuffer(
     std::size_t allocSize,
     VkBufferUsageFlags usage,
-    VmaMemoryUsage memoryUsage) const
+    MemoryClass memoryClass,
+    MemoryCategory memoryCategory) const
 {
-    const auto bufferInfo = VkBufferCreateInfo{
+    auto bufferInfo = VkBufferCreateInfo{
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .size = allocSize,
         .usage = usage,
     };
+    setBufferSharingMode(bufferInfo);
 
-    const auto allocInfo = VmaAllocationCreateInfo{
-        .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
-                 // TODO: allow to set VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT when needed
-                 VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-        .usage = memoryUsage,
-    };
+    auto allocInfo = getAllocationCreateInfo(memoryClass);
+    allocInfo.pool = memoryPools[(std::size_t)memoryClass];
 
     GPUBuffer buffer{};
-    VK_CHECK(vmaCreateBuffer(
-        allocator, &bufferInfo, &allocInfo, &buffer.buffer, &buffer.allocation, &buffer.info));
+    const auto res = vmaCreateBuffer(
+        allocator, &bufferInfo, &allocInfo, &buffer.buffer, &buffer.allocation, &buffer.info);
+    if (res != VK_SUCCESS) {
+        // the pool's memory type might not be supported by the buffer with this usage -
+        // let VMA choose the memory type itself
+        allocInfo.pool = VK_NULL_HANDLE;
+        if (memoryClass == MemoryClass::Streaming && !streamingMemoryDeviceLocal) {
+            allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+        }
+        VK_CHECK(vmaCreateBuffer(
+            allocator, &bufferInfo, &allocInfo, &buffer.buffer, &buffer.allocation, &buffer.info));
+    }
+    buffer.memoryCategory = memoryCategory;
+    memoryStats.onAllocate(memoryCategory, buffer.info.size);
+
     if ((usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0) {
         const auto deviceAdressInfo = VkBufferDeviceAddressInfo{
             .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
@@ -402,6 +712,9 @@ VkDeviceAddress GfxDevice::getBufferAddress(const GPUBuffer& buffer) const
 
 void GfxDevice::destroyBuffer(const GPUBuffer& buffer) const
 {
+    if (buffer.buffer != VK_NULL_HANDLE) {
+        memoryStats.onFree(buffer.memoryCategory, buffer.info.size);
+    }
     vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
 }
 
@@ -420,6 +733,11 @@ std::uint32_t GfxDevice::getCurrentFrameIndex() const
     return frameNumber % graphics::FRAME_OVERLAP;
 }
 
+void GfxDevice::waitForFramesInFlight() const
+{
+    swapchain.waitForAllFrames(device);
+}
+
 bool GfxDevice::deviceSupportsSamplingCount(VkSampleCountFlagBits sample) const
 {
     return (supportedSampleCounts & sample) != 0;
@@ -430,6 +748,11 @@ VkSampleCountFlagBits GfxDevice::getMaxSupportedSamplingCount() const
     return highestSupportedSamples;
 }
 
+bool GfxDevice::deviceSupportsDepthResolveMode(VkResolveModeFlagBits mode) const
+{
+    return (supportedDepthResolveModes & mode) != 0;
+}
+
 VulkanImmediateExecutor GfxDevice::createImmediateExecutor() const
 {
     VulkanImmediateExecutor executor;
@@ -437,16 +760,271 @@ VulkanImmediateExecutor GfxDevice::createImmediateExecutor() const
     return executor;
 }
 
-void GfxDevice::immediateSubmit(std::function<void(VkCommandBuffer)>&& f) const
+void GfxDevice::immediateSubmit(std::function<void(VkCommandBuffer)>&& f)
 {
+    // the submitted commands can use resources which are still being uploaded
+    uploadQueue.flush();
     executor.immediateSubmit(std::move(f));
 }
 
+void GfxDevice::deferDestruction(std::function<void()>&& f)
+{
+    deferredDestructions.push_back(DeferredDestruction{
+        .frameNumber = frameNumber,
+        .f = std::move(f),
+    });
+}
+
+void GfxDevice::runDeferredDestructions(bool all)
+{
+    // beginFrame waited for the fence of frame (frameNumber - FRAME_OVERLAP), so
+    // the frames before it are finished too
+    while (!deferredDestructions.empty()) {
+        auto& deferred = deferredDestructions.front();
+        if (!all && frameNumber < deferred.frameNumber + graphics::FRAME_OVERLAP) {
+            break; // the rest were deferred later
+        }
+        auto f = std::move(deferred.f);
+        deferredDestructions.pop_front();
+        f(); // can defer more functions
+    }
+}
+
+VkCommandBuffer GfxDevice::beginSecondaryCommandBuffer(
+    std::size_t threadIndex,
+    const VkCommandBufferInheritanceRenderingInfo* renderingInfo)
+{
+    auto& threadPool = getCurrentFrame().threadCommandPools[threadIndex];
+    if (threadPool.numUsed == threadPool.commandBuffers.size()) {
+        const auto allocInfo = VkCommandBufferAllocateInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = threadPool.pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+            .commandBufferCount = 1,
+        };
+        VkCommandBuffer cmd;
+        VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &cmd));
+        threadPool.commandBuffers.push_back(cmd);
+    }
+    const auto cmd = threadPool.commandBuffers[threadPool.numUsed];
+    ++threadPool.numUsed;
+
+    const auto inheritanceInfo = VkCommandBufferInheritanceInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = renderingInfo,
+    };
+    auto flags = VkCommandBufferUsageFlags{VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    if (renderingInfo) {
+        flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+    const auto cmdBeginInfo = VkCommandBufferBeginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = flags,
+        .pInheritanceInfo = &inheritanceInfo,
+    };
+    VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+    return cmd;
+}
+
+VmaDefragmentationStats GfxDevice::defragmentMemory()
+{
+    // the images can be used by pending uploads and frames in flight
+    uploadQueue.flush();
+    waitIdle();
+    // nothing is in flight now, so the memory of the removed resources can be freed
+    // before the defragmentation
+    runDeferredDestructions(true);
+
+    // only the images from the cache are moved - they're the only resources which are
+    // referenced by their ids everywhere. Buffers are referenced by device addresses
+    // and handles copied into many places, and they're allocated from custom pools
+    // which are not defragmented anyway.
+    std::unordered_map<VmaAllocation, ImageId> movableImages;
+    for (ImageId id = 0; id < imageCache.getNumImages(); ++id) {
+        const auto& image = imageCache.getImage(id);
+        if (image.isInitialized() && isMovableImage(image.usage)) {
+            movableImages.emplace(image.allocation, id);
+        }
+    }
+
+    const auto defragInfo = VmaDefragmentationInfo{
+        .flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FULL_BIT,
+    };
+    VmaDefragmentationContext context;
+    VK_CHECK(vmaBeginDefragmentation(allocator, &defragInfo, &context));
+
+    while (true) {
+        VmaDefragmentationPassMoveInfo pass{};
+        if (vmaBeginDefragmentationPass(allocator, context, &pass) == VK_SUCCESS) {
+            break; // nothing to move
+        }
+
+        // new images are bound to the new place of the allocations, VMA
+        // moves the allocations there when the pass ends
+        std::vector<std::pair<ImageId, GPUImage>> movedImages;
+        for (std::uint32_t i = 0; i < pass.moveCount; ++i) {
+            auto& move = pass.pMoves[i];
+            const auto it = movableImages.find(move.srcAllocation);
+            if (it == movableImages.end()) {
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                continue;
+            }
+
+            auto image = imageCache.getImage(it->second);
+            const auto imgInfo = VkImageCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                .flags = image.isCubemap ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0u,
+                .imageType = VK_IMAGE_TYPE_2D,
+                .format = image.format,
+                .extent = image.extent,
+                .mipLevels = image.mipLevels,
+                .arrayLayers = image.numLayers,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .tiling = VK_IMAGE_TILING_OPTIMAL,
+                .usage = image.usage | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // same as in createImageRaw
+            };
+            VK_CHECK(vkCreateImage(device, &imgInfo, nullptr, &image.image));
+            VK_CHECK(vmaBindImageMemory(allocator, move.dstTmpAllocation, image.image));
+            image.imageView = createImageView(image);
+            vkutil::addDebugLabel(device, image.image, image.debugName.c_str());
+            movedImages.emplace_back(it->second, std::move(image));
+        }
+
+        if (!movedImages.empty()) {
+            executor.immediateSubmit([&](VkCommandBuffer cmd) {
+                for (const auto& [id, newImage] : movedImages) {
+                    const auto& oldImage = imageCache.getImage(id);
+                    vkutil::transitionImage(
+                        cmd,
+                        oldImage.image,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+                    vkutil::transitionImage(
+                        cmd,
+                        newImage.image,
+                        VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+                    std::vector<VkImageCopy> regions(newImage.mipLevels);
+                    for (std::uint32_t mip = 0; mip < newImage.mipLevels; ++mip) {
+                        const auto subresource = VkImageSubresourceLayers{
+                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                            .mipLevel = mip,
+                            .baseArrayLayer = 0,
+                            .layerCount = newImage.numLayers,
+                        };
+                        regions[mip] = VkImageCopy{
+                            .srcSubresource = subresource,
+                            .dstSubresource = subresource,
+                            .extent =
+                                {
+                                    .width = std::max(newImage.extent.width >> mip, 1u),
+                                    .height = std::max(newImage.extent.height >> mip, 1u),
+                                    .depth = 1,
+                                },
+                        };
+                    }
+                    vkCmdCopyImage(
+                        cmd,
+                        oldImage.image,
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        newImage.image,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        (std::uint32_t)regions.size(),
+                        regions.data());
+
+                    vkutil::transitionImage(
+                        cmd,
+                        newImage.image,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                }
+            });
+        }
+
+        // the allocation stays the same, only the old image and its view are destroyed
+        for (auto& [id, newImage] : movedImages) {
+            const auto oldImage = imageCache.replaceImage(id, std::move(newImage));
+            vkDestroyImageView(device, oldImage.imageView, nullptr);
+            vkDestroyImage(device, oldImage.image, nullptr);
+        }
+
+        if (vmaEndDefragmentationPass(allocator, context, &pass) == VK_SUCCESS) {
+            break;
+        }
+    }
+
+    VmaDefragmentationStats stats{};
+    vmaEndDefragmentation(allocator, context, &stats);
+    fmt::println(
+        "Defragmentation: moved {} allocation(s) ({:.1f} MB), freed {} block(s) ({:.1f} MB)",
+        stats.allocationsMoved,
+        (float)stats.bytesMoved / (1024.f * 1024.f),
+        stats.deviceMemoryBlocksFreed,
+        (float)stats.bytesFreed / (1024.f * 1024.f));
+    return stats;
+}
+
 void GfxDevice::waitIdle() const
 {
     VK_CHECK(vkDeviceWaitIdle(device));
 }
 
+VkCommandBuffer GfxDevice::beginAsyncCompute()
+{
+    assert(asyncComputeSupported);
+    auto& frame = getCurrentFrame();
+    assert(!frame.computeSubmitted && "async compute was already submitted in this frame");
+
+    // Normally, the frame's previous compute work is finished by now, because
+    // the graphics work which waited for it has finished. But if the frame was
+    // skipped (e.g. the swapchain was out of date), nothing waited for it.
+    const auto waitInfo = VkSemaphoreWaitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &computeSemaphore,
+        .pValues = &frame.computeSemaphoreValue,
+    };
+    VK_CHECK(vkWaitSemaphores(device, &waitInfo, NO_TIMEOUT));
+
+    const auto& cmd = frame.computeCommandBuffer;
+    const auto cmdBeginInfo = VkCommandBufferBeginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+    return cmd;
+}
+
+void GfxDevice::submitAsyncCompute(VkCommandBuffer cmd, VkPipelineStageFlags2 waitStage)
+{
+    assert(asyncComputeSupported);
+    VK_CHECK(vkEndCommandBuffer(cmd));
+
+    auto& frame = getCurrentFrame();
+    ++computeSemaphoreValue;
+    frame.computeSemaphoreValue = computeSemaphoreValue;
+    frame.computeWaitStage = waitStage;
+    frame.computeSubmitted = true;
+
+    const auto cmdInfo = vkinit::commandBufferSubmitInfo(cmd);
+    auto signalInfo = vkinit::
+        semaphoreSubmitInfo(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, computeSemaphore);
+    signalInfo.value = computeSemaphoreValue;
+
+    // compute work can read buffers uploaded in this frame (e.g. skinning data)
+    const auto uploadValue = uploadQueue.submit();
+    auto uploadWaitInfo = vkinit::
+        semaphoreSubmitInfo(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, uploadQueue.getSemaphore());
+    uploadWaitInfo.value = uploadValue;
+
+    const auto submit =
+        vkinit::submitInfo(&cmdInfo, uploadValue > 0 ? &uploadWaitInfo : nullptr, &signalInfo);
+    VK_CHECK(vkQueueSubmit2(computeQueue, 1, &submit, VK_NULL_HANDLE));
+}
+
 BindlessSetManager& GfxDevice::getBindlessSetManager()
 {
     return imageCache.bindlessSetManager;
@@ -462,11 +1040,14 @@ const VkDescriptorSet& GfxDevice::getBindlessDescSet() const
     return imageCache.bindlessSetManager.getDescSet();
 }
 
-void GfxDevice::bindBindlessDescSet(VkCommandBuffer cmd, VkPipelineLayout layout) const
+void GfxDevice::bindBindlessDescSet(
+    VkCommandBuffer cmd,
+    VkPipelineLayout layout,
+    VkPipelineBindPoint bindPoint) const
 {
     vkCmdBindDescriptorSets(
         cmd,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        bindPoint,
         layout,
         0,
         1,
@@ -513,6 +1094,7 @@ ImageId GfxDevice::createDrawImage(VkFormat format, glm::ivec2 size, const char*
         .format = format,
         .usage = usages,
         .extent = extent,
+        .memoryCategory = MemoryCategory::RenderTargets,
     };
     return createImage(createImageInfo, debugName);
 }
@@ -526,6 +1108,25 @@ ImageId GfxDevice::loadImageFromFile(
     return imageCache.loadImageFromFile(path, format, usage, mipMap);
 }
 
+ImageId GfxDevice::loadImageFromData(
+    const std::filesystem::path& path,
+    const ImageData& data,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    bool mipMap)
+{
+    return imageCache.loadImageFromData(path, data, format, usage, mipMap);
+}
+
+ImageId GfxDevice::loadImageFromData(
+    const std::filesystem::path& path,
+    const CompressedImageData& data,
+    VkFormat format,
+    VkImageUsageFlags usage)
+{
+    return imageCache.loadImageFromData(path, data, format, usage);
+}
+
 const GPUImage& GfxDevice::getImage(ImageId id) const
 {
     return imageCache.getImage(id);
@@ -536,10 +1137,17 @@ ImageId GfxDevice::addImageToCache(GPUImage img)
     return imageCache.addImage(std::move(img));
 }
 
-GPUImage GfxDevice::createImageRaw(const vkutil::CreateImageInfo& createInfo) const
+void GfxDevice::releaseImage(ImageId id)
+{
+    imageCache.releaseImage(id);
+}
+
+VkImageCreateInfo GfxDevice::getImageCreateInfo(const vkutil::CreateImageInfo& createInfo) const
 {
     std::uint32_t mipLevels = 1;
-    if (createInfo.mipMap) {
+    if (createInfo.mipLevels != 0) {
+        mipLevels = createInfo.mipLevels;
+    } else if (createInfo.mipMap) {
         const auto maxExtent = std::max(createInfo.extent.width, createInfo.extent.height);
         mipLevels = (std::uint32_t)std::floor(std::log2(maxExtent)) + 1;
     }
@@ -550,7 +1158,11 @@ GPUImage GfxDevice::createImageRaw(const vkutil::CreateImageInfo& createInfo) co
         assert((createInfo.flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT) != 0);
     }
 
-    const auto imgInfo = VkImageCreateInfo{
+    auto usage = createInfo.usage;
+    if (isMovableImage(usage)) {
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; // for copying it during defragmentation
+    }
+    return VkImageCreateInfo{
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .flags = createInfo.flags,
         .imageType = VK_IMAGE_TYPE_2D,
@@ -560,13 +1172,13 @@ GPUImage GfxDevice::createImageRaw(const vkutil::CreateImageInfo& createInfo) co
         .arrayLayers = createInfo.numLayers,
         .samples = createInfo.samples,
         .tiling = VK_IMAGE_TILING_OPTIMAL,
-        .usage = createInfo.usage,
-    };
-    const auto allocInfo = VmaAllocationCreateInfo{
-        .usage = VMA_MEMORY_USAGE_AUTO,
-        .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .usage = usage,
     };
+}
 
+GPUImage GfxDevice::initImage(const vkutil::CreateImageInfo& createInfo, std::uint32_t mipLevels)
+    const
+{
     GPUImage image{};
     image.format = createInfo.format;
     image.usage = createInfo.usage;
@@ -574,18 +1186,101 @@ GPUImage GfxDevice::createImageRaw(const vkutil::CreateImageInfo& createInfo) co
     image.mipLevels = mipLevels;
     image.numLayers = createInfo.numLayers;
     image.isCubemap = createInfo.isCubemap;
+    image.memoryCategory = createInfo.memoryCategory;
+    return image;
+}
 
-    VK_CHECK(
-        vmaCreateImage(allocator, &imgInfo, &allocInfo, &image.image, &image.allocation, nullptr));
+GPUImage GfxDevice::createImageRaw(const vkutil::CreateImageInfo& createInfo) const
+{
+    const auto imgInfo = getImageCreateInfo(createInfo);
+    const auto allocInfo = VmaAllocationCreateInfo{
+        .usage = VMA_MEMORY_USAGE_AUTO,
+        .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    };
+
+    auto image = initImage(createInfo, imgInfo.mipLevels);
 
-    // create view
-    VkImageAspectFlags aspectFlag = VK_IMAGE_ASPECT_COLOR_BIT;
-    if (createInfo.format == VK_FORMAT_D32_SFLOAT) { // TODO: support other depth formats
+    VmaAllocationInfo allocationInfo{};
+    VK_CHECK(vmaCreateImage(
+        allocator, &imgInfo, &allocInfo, &image.image, &image.allocation, &allocationInfo));
+    memoryStats.onAllocate(image.memoryCategory, allocationInfo.size);
+
+    image.imageView = createImageView(image);
+
+    return image;
+}
+
+VkMemoryRequirements GfxDevice::getImageMemoryRequirements(
+    const vkutil::CreateImageInfo& createInfo) const
+{
+    const auto imgInfo = getImageCreateInfo(createInfo);
+    const auto requirementsInfo = VkDeviceImageMemoryRequirements{
+        .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+        .pCreateInfo = &imgInfo,
+    };
+    auto requirements = VkMemoryRequirements2{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+    };
+    vkGetDeviceImageMemoryRequirements(device, &requirementsInfo, &requirements);
+    return requirements.memoryRequirements;
+}
+
+VmaAllocation GfxDevice::allocateImageMemory(
+    const VkMemoryRequirements& requirements,
+    MemoryCategory category,
+    bool lazilyAllocated) const
+{
+    auto allocInfo = VmaAllocationCreateInfo{
+        .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    };
+    if (lazilyAllocated && (requirements.memoryTypeBits & lazilyAllocatedMemoryTypeBits) != 0) {
+        // the size is still counted in the stats, though the memory might never be committed
+        allocInfo.requiredFlags |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        allocInfo.memoryTypeBits = lazilyAllocatedMemoryTypeBits;
+    }
+    VmaAllocation memory;
+    VmaAllocationInfo allocationInfo{};
+    VK_CHECK(vmaAllocateMemory(allocator, &requirements, &allocInfo, &memory, &allocationInfo));
+    memoryStats.onAllocate(category, allocationInfo.size);
+    return memory;
+}
+
+void GfxDevice::freeImageMemory(VmaAllocation memory, MemoryCategory category) const
+{
+    VmaAllocationInfo allocationInfo{};
+    vmaGetAllocationInfo(allocator, memory, &allocationInfo);
+    memoryStats.onFree(category, allocationInfo.size);
+    vmaFreeMemory(allocator, memory);
+}
+
+ImageId GfxDevice::createAliasedImage(
+    const vkutil::CreateImageInfo& createInfo,
+    VmaAllocation memory,
+    const char* debugName)
+{
+    const auto imgInfo = getImageCreateInfo(createInfo);
+    // the image doesn't own the memory, so its allocation stays null
+    auto image = initImage(createInfo, imgInfo.mipLevels);
+    VK_CHECK(vkCreateImage(device, &imgInfo, nullptr, &image.image));
+    VK_CHECK(vmaBindImageMemory(allocator, memory, image.image));
+    image.imageView = createImageView(image);
+    if (debugName) {
+        vkutil::addDebugLabel(device, image.image, debugName);
+        image.debugName = debugName;
+    }
+    return addImageToCache(std::move(image));
+}
+
+VkImageView GfxDevice::createImageView(const GPUImage& image) const
+{
+    // a sampled view can only have one aspect, so depth/stencil images are viewed as depth
+    auto aspectFlag = vkutil::getImageAspect(image.format);
+    if (aspectFlag & VK_IMAGE_ASPECT_DEPTH_BIT) {
         aspectFlag = VK_IMAGE_ASPECT_DEPTH_BIT;
     }
 
-    auto viewType = createInfo.numLayers == 1 ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_2D_ARRAY;
-    if (createInfo.isCubemap) {
+    auto viewType = image.numLayers == 1 ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    if (image.isCubemap) {
         viewType = VK_IMAGE_VIEW_TYPE_CUBE;
     }
 
@@ -593,23 +1288,23 @@ GPUImage GfxDevice::createImageRaw(const vkutil::CreateImageInfo& createInfo) co
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
         .image = image.image,
         .viewType = viewType,
-        .format = createInfo.format,
+        .format = image.format,
         .subresourceRange =
             VkImageSubresourceRange{
                 .aspectMask = aspectFlag,
                 .baseMipLevel = 0,
-                .levelCount = mipLevels,
+                .levelCount = image.mipLevels,
                 .baseArrayLayer = 0,
-                .layerCount = createInfo.numLayers,
+                .layerCount = image.numLayers,
             },
     };
 
-    VK_CHECK(vkCreateImageView(device, &viewCreateInfo, nullptr, &image.imageView));
-
-    return image;
+    VkImageView imageView;
+    VK_CHECK(vkCreateImageView(device, &viewCreateInfo, nullptr, &imageView));
+    return imageView;
 }
 
-void GfxDevice::uploadImageData(const GPUImage& image, void* pixelData, std::uint32_t layer) const
+void GfxDevice::uploadImageData(const GPUImage& image, void* pixelData, std::uint32_t layer)
 {
     int numChannels = 4;
     if (image.format == VK_FORMAT_R8_UNORM) {
@@ -619,72 +1314,31 @@ void GfxDevice::uploadImageData(const GPUImage& image, void* pixelData, std::uin
     const auto dataSize =
         image.extent.depth * image.extent.width * image.extent.height * numChannels;
 
-    const auto uploadBuffer = createBuffer(dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    memcpy(uploadBuffer.info.pMappedData, pixelData, dataSize);
-
-    executor.immediateSubmit([&](VkCommandBuffer cmd) {
-        assert(
-            (image.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0 &&
-            "Image needs to have VK_IMAGE_USAGE_TRANSFER_DST_BIT to upload data to it");
-        vkutil::transitionImage(
-            cmd, image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-        const auto copyRegion = VkBufferImageCopy{
-            .bufferOffset = 0,
-            .bufferRowLength = 0,
-            .bufferImageHeight = 0,
-            .imageSubresource =
-                {
-                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                    .mipLevel = 0,
-                    .baseArrayLayer = layer,
-                    .layerCount = 1,
-                },
-            .imageExtent = image.extent,
-        };
-
-        vkCmdCopyBufferToImage(
-            cmd,
-            uploadBuffer.buffer,
-            image.image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &copyRegion);
-
-        if (image.mipLevels > 1) {
-            assert(
-                (image.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0 &&
-                (image.usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0 &&
-                "Image needs to have VK_IMAGE_USAGE_TRANSFER_{DST,SRC}_BIT to generate mip maps");
-            graphics::generateMipmaps(
-                cmd,
-                image.image,
-                VkExtent2D{image.extent.width, image.extent.height},
-                image.mipLevels);
-        } else {
-            vkutil::transitionImage(
-                cmd,
-                image.image,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        }
-    });
-
-    destroyBuffer(uploadBuffer);
+    uploadQueue.uploadImage(image, {(const std::byte*)pixelData, dataSize}, layer);
 }
 
 GPUImage GfxDevice::loadImageFromFileRaw(
     const std::filesystem::path& path,
     VkFormat format,
     VkImageUsageFlags usage,
-    bool mipMap) const
+    bool mipMap)
 {
-    auto data = util::loadImage(path);
+    const auto data = util::loadImage(path);
     if (!data.pixels) {
         fmt::println("[error] failed to load image from '{}'", path.string());
         return getImage(errorImageId);
     }
+    return createImageFromDataRaw(data, format, usage, mipMap, path.string());
+}
 
+GPUImage GfxDevice::createImageFromDataRaw(
+    const ImageData& data,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    bool mipMap,
+    const std::string& debugName)
+{
+    assert(data.pixels);
     auto image = createImageRaw({
         .format = format,
         .usage = usage | //
@@ -700,14 +1354,46 @@ GPUImage GfxDevice::loadImageFromFileRaw(
     });
     uploadImageData(image, data.pixels);
 
-    image.debugName = path.string();
-    vkutil::addDebugLabel(device, image.image, path.string().c_str());
+    image.debugName = debugName;
+    vkutil::addDebugLabel(device, image.image, debugName.c_str());
+
+    return image;
+}
+
+GPUImage GfxDevice::createCompressedImageRaw(
+    const CompressedImageData& data,
+    VkImageUsageFlags usage,
+    const std::string& debugName)
+{
+    assert(!data.mips.empty());
+    auto image = createImageRaw({
+        .format = data.format,
+        // for uploading pixel data to image (and copying mips out of it when
+        // TextureStreamer drops the biggest ones)
+        .usage = usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        .extent =
+            VkExtent3D{
+                .width = std::max(data.width >> data.firstMip, 1u),
+                .height = std::max(data.height >> data.firstMip, 1u),
+                .depth = 1,
+            },
+        .mipLevels = (std::uint32_t)data.mips.size(),
+    });
+    uploadQueue.uploadImageMips(image, data.mips);
+
+    image.debugName = debugName;
+    vkutil::addDebugLabel(device, image.image, debugName.c_str());
 
     return image;
 }
 
 void GfxDevice::destroyImage(const GPUImage& image) const
 {
+    if (image.allocation != VK_NULL_HANDLE) {
+        VmaAllocationInfo allocationInfo{};
+        vmaGetAllocationInfo(allocator, image.allocation, &allocationInfo);
+        memoryStats.onFree(image.memoryCategory, allocationInfo.size);
+    }
     vkDestroyImageView(device, image.imageView, nullptr);
     vmaDestroyImage(allocator, image.image, image.allocation);
     // TODO: if image has bindless id, update the set
@@ -1,8 +1,25 @@
 #include <edbr/Graphics/ImageCache.h>
 
+#include <cassert>
+
+#include <fmt/printf.h>
+
 #include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/ImageLoader.h>
+#include <edbr/Graphics/KTX2.h>
 
-ImageCache::ImageCache(GfxDevice& gfxDevice) : gfxDevice(gfxDevice)
+namespace
+{
+// Cooked images always have all mips and block compressed formats can
+// only be sampled
+bool canUseCookedImage(VkImageUsageFlags usage, bool mipMap)
+{
+    return mipMap && (usage & ~VK_IMAGE_USAGE_SAMPLED_BIT) == 0;
+}
+}
+
+ImageCache::ImageCache(GfxDevice& gfxDevice) :
+    gfxDevice(gfxDevice), textureStreamer(gfxDevice, *this)
 {}
 
 ImageId ImageCache::loadImageFromFile(
@@ -11,16 +28,86 @@ ImageId ImageCache::loadImageFromFile(
     VkImageUsageFlags usage,
     bool mipMap)
 {
-    for (const auto& [id, info] : loadedImagesInfo) {
+    if (const auto id = acquireLoadedImage(path, format, usage, mipMap); id != NULL_IMAGE_ID) {
+        return id;
+    }
+
+    if (gfxDevice.hasTextureCompressionBC() && canUseCookedImage(usage, mipMap)) {
+        const auto cooked =
+            util::loadCookedImage(path, format, TextureStreamer::MIN_RESIDENT_MIP_SIZE);
+        if (cooked) {
+            return loadImageFromData(path, *cooked, format, usage);
+        }
+    }
+
+    auto image = gfxDevice.loadImageFromFileRaw(path, format, usage, mipMap);
+    return addLoadedImage(std::move(image), path, format, usage, mipMap);
+}
+
+ImageId ImageCache::loadImageFromData(
+    const std::filesystem::path& path,
+    const ImageData& data,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    bool mipMap)
+{
+    if (const auto id = acquireLoadedImage(path, format, usage, mipMap); id != NULL_IMAGE_ID) {
+        return id;
+    }
+
+    if (!data.pixels) {
+        fmt::println("[error] failed to load image from '{}'", path.string());
+        return errorImageId;
+    }
+
+    auto image = gfxDevice.createImageFromDataRaw(data, format, usage, mipMap, path.string());
+    return addLoadedImage(std::move(image), path, format, usage, mipMap);
+}
+
+ImageId ImageCache::loadImageFromData(
+    const std::filesystem::path& path,
+    const CompressedImageData& data,
+    VkFormat format,
+    VkImageUsageFlags usage)
+{
+    constexpr auto mipMap = true;
+    if (const auto id = acquireLoadedImage(path, format, usage, mipMap); id != NULL_IMAGE_ID) {
+        return id;
+    }
+
+    auto image = gfxDevice.createCompressedImageRaw(data, usage, path.string());
+    const auto id = addLoadedImage(std::move(image), path, format, usage, mipMap);
+    if (id != errorImageId) {
+        textureStreamer.addImage(id, util::getCookedImagePath(path), data, usage);
+    }
+    return id;
+}
+
+ImageId ImageCache::acquireLoadedImage(
+    const std::filesystem::path& path,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    bool mipMap)
+{
+    for (auto& [id, info] : loadedImagesInfo) {
         // TODO: calculate some hash to not have to linear search every time?
         if (info.path == path && info.format == format && info.usage == usage &&
             info.mipMap == mipMap) {
             // std::cout << "Already loaded: " << path << std::endl;
+            ++info.refCount;
             return id;
         }
     }
+    return NULL_IMAGE_ID;
+}
 
-    auto image = gfxDevice.loadImageFromFileRaw(path, format, usage, mipMap);
+ImageId ImageCache::addLoadedImage(
+    GPUImage image,
+    const std::filesystem::path& path,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    bool mipMap)
+{
     if (image.isInitialized() && image.getBindlessId() == errorImageId) {
         return errorImageId;
     }
@@ -48,30 +135,80 @@ ImageId ImageCache::addImage(ImageId id, GPUImage image)
 {
     image.setBindlessId(static_cast<std::uint32_t>(id));
     if (id != images.size()) {
-        images[id] = std::move(image); // replacing existing image
+        // replacing existing image or reusing the id of the removed one
+        std::erase(freeImageIds, id);
+        images[id] = std::move(image);
     } else {
         images.push_back(std::move(image));
     }
-    bindlessSetManager.addImage(gfxDevice.getDevice(), id, image.imageView);
+    // only sampled images can be put into the bindless set (e.g. transient
+    // MSAA attachments can't be)
+    if (images[id].usage & VK_IMAGE_USAGE_SAMPLED_BIT) {
+        bindlessSetManager.addImage(gfxDevice.getDevice(), id, images[id].imageView);
+    }
 
     return id;
 }
 
+GPUImage ImageCache::replaceImage(ImageId id, GPUImage image)
+{
+    assert(id < images.size());
+    auto oldImage = std::move(images[id]);
+    addImage(id, std::move(image));
+    return oldImage;
+}
+
 const GPUImage& ImageCache::getImage(ImageId id) const
 {
     return images.at(id);
 }
 
+void ImageCache::releaseImage(ImageId id)
+{
+    if (id == errorImageId) {
+        return; // returned when images fail to load, never removed
+    }
+
+    if (const auto it = loadedImagesInfo.find(id); it != loadedImagesInfo.end()) {
+        assert(it->second.refCount > 0);
+        if (--it->second.refCount > 0) {
+            return;
+        }
+        // loading the same path again creates a new image
+        loadedImagesInfo.erase(it);
+    }
+    removeImage(id);
+}
+
+void ImageCache::removeImage(ImageId id)
+{
+    assert(id < images.size() && images[id].isInitialized());
+    textureStreamer.removeImage(id);
+
+    auto image = std::move(images[id]);
+    images[id] = GPUImage{};
+    gfxDevice.deferDestruction([this, id, image = std::move(image)]() {
+        gfxDevice.destroyImage(image);
+        // the slot can still be sampled by mistake (e.g. by a material which was not
+        // removed), so it shouldn't point to the destroyed view
+        const auto& errorImage = images.at(errorImageId);
+        bindlessSetManager.addImage(gfxDevice.getDevice(), id, errorImage.imageView);
+        freeImageIds.push_back(id);
+    });
+}
+
 ImageId ImageCache::getFreeImageId() const
 {
-    return images.size();
+    return freeImageIds.empty() ? images.size() : freeImageIds.back();
 }
 
 void ImageCache::destroyImages()
 {
+    textureStreamer.cleanup();
     for (const auto& image : images) {
         gfxDevice.destroyImage(image);
     }
     images.clear();
+    freeImageIds.clear();
     loadedImagesInfo.clear();
 }
@@ -1,5 +1,7 @@
 #include <edbr/Graphics/ImageLoader.h>
 
+#include <utility>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -11,6 +13,35 @@ ImageData::~ImageData()
     }
 }
 
+ImageData::ImageData(ImageData&& o)
+{
+    *this = std::move(o);
+}
+
+ImageData& ImageData::operator=(ImageData&& o)
+{
+    if (this == &o) {
+        return *this;
+    }
+
+    if (shouldSTBFree) {
+        stbi_image_free(pixels);
+        stbi_image_free(hdrPixels);
+    }
+
+    // moved-from data doesn't own the pixels anymore
+    pixels = std::exchange(o.pixels, nullptr);
+    width = o.width;
+    height = o.height;
+    channels = o.channels;
+    hdrPixels = std::exchange(o.hdrPixels, nullptr);
+    hdr = o.hdr;
+    comp = o.comp;
+    shouldSTBFree = std::exchange(o.shouldSTBFree, false);
+
+    return *this;
+}
+
 namespace util
 {
 ImageData loadImage(const std::filesystem::path& p)
@@ -0,0 +1,359 @@
+#include <edbr/Graphics/KTX2.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstring> // memcpy
+#include <fstream>
+#include <span>
+
+#include <fmt/printf.h>
+
+#include <edbr/Util/MappedFile.h>
+
+namespace
+{
+constexpr std::array<std::uint8_t, 12> KTX2_IDENTIFIER =
+    {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+// level data has to be aligned to lcm(texel block size, 4)
+constexpr std::size_t LEVEL_ALIGNMENT = 16;
+
+struct Header {
+    std::array<std::uint8_t, 12> identifier;
+    std::uint32_t vkFormat;
+    std::uint32_t typeSize;
+    std::uint32_t pixelWidth;
+    std::uint32_t pixelHeight;
+    std::uint32_t pixelDepth;
+    std::uint32_t layerCount;
+    std::uint32_t faceCount;
+    std::uint32_t levelCount;
+    std::uint32_t supercompressionScheme;
+    // index
+    std::uint32_t dfdByteOffset;
+    std::uint32_t dfdByteLength;
+    std::uint32_t kvdByteOffset;
+    std::uint32_t kvdByteLength;
+    std::uint64_t sgdByteOffset;
+    std::uint64_t sgdByteLength;
+};
+static_assert(sizeof(Header) == 80);
+
+struct LevelIndex {
+    std::uint64_t byteOffset;
+    std::uint64_t byteLength;
+    std::uint64_t uncompressedByteLength;
+};
+
+// Data Format Descriptor values (see Khronos Data Format Specification)
+enum DFDColorModel : std::uint32_t {
+    DFD_MODEL_BC1A = 128,
+    DFD_MODEL_BC3 = 130,
+    DFD_MODEL_BC4 = 131,
+    DFD_MODEL_BC5 = 132,
+    DFD_MODEL_BC7 = 134,
+};
+constexpr std::uint32_t DFD_PRIMARIES_BT709 = 1;
+constexpr std::uint32_t DFD_TRANSFER_LINEAR = 1;
+constexpr std::uint32_t DFD_TRANSFER_SRGB = 2;
+
+struct DFDSample {
+    std::uint32_t channel;
+    std::uint32_t bitOffset;
+    std::uint32_t bitLength;
+};
+
+struct FormatInfo {
+    VkFormat format;
+    std::uint32_t blockSize;
+    bool srgb;
+    DFDColorModel colorModel;
+    std::vector<DFDSample> samples;
+};
+
+const std::vector<FormatInfo>& getSupportedFormats()
+{
+    static const std::vector<FormatInfo> formats{
+        {VK_FORMAT_BC1_RGB_UNORM_BLOCK, 8, false, DFD_MODEL_BC1A, {{0, 0, 64}}},
+        {VK_FORMAT_BC1_RGB_SRGB_BLOCK, 8, true, DFD_MODEL_BC1A, {{0, 0, 64}}},
+        {VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 8, false, DFD_MODEL_BC1A, {{1, 0, 64}}},
+        {VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 8, true, DFD_MODEL_BC1A, {{1, 0, 64}}},
+        {VK_FORMAT_BC3_UNORM_BLOCK, 16, false, DFD_MODEL_BC3, {{15, 0, 64}, {0, 64, 64}}},
+        {VK_FORMAT_BC3_SRGB_BLOCK, 16, true, DFD_MODEL_BC3, {{15, 0, 64}, {0, 64, 64}}},
+        {VK_FORMAT_BC4_UNORM_BLOCK, 8, false, DFD_MODEL_BC4, {{0, 0, 64}}},
+        {VK_FORMAT_BC5_UNORM_BLOCK, 16, false, DFD_MODEL_BC5, {{0, 0, 64}, {1, 64, 64}}},
+        {VK_FORMAT_BC7_UNORM_BLOCK, 16, false, DFD_MODEL_BC7, {{0, 0, 128}}},
+        {VK_FORMAT_BC7_SRGB_BLOCK, 16, true, DFD_MODEL_BC7, {{0, 0, 128}}},
+    };
+    return formats;
+}
+
+const FormatInfo* findFormatInfo(VkFormat format)
+{
+    const auto& formats = getSupportedFormats();
+    const auto it = std::ranges::find(formats, format, &FormatInfo::format);
+    return it != formats.end() ? &*it : nullptr;
+}
+
+bool isSRGBFormat(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::size_t getMipSize(const FormatInfo& info, std::uint32_t width, std::uint32_t height)
+{
+    return (std::size_t)((width + 3) / 4) * ((height + 3) / 4) * info.blockSize;
+}
+
+std::vector<std::uint32_t> makeDFD(const FormatInfo& info)
+{
+    const auto blockSize = 24 + 16 * (std::uint32_t)info.samples.size();
+    const auto transfer = info.srgb ? DFD_TRANSFER_SRGB : DFD_TRANSFER_LINEAR;
+
+    std::vector<std::uint32_t> dfd{
+        4 + blockSize, // dfdTotalSize
+        0, // vendorId = KHRONOS, descriptorType = BASICFORMAT
+        2 | blockSize << 16, // versionNumber = 2
+        info.colorModel | DFD_PRIMARIES_BT709 << 8 | transfer << 16, // flags = 0
+        3 | 3 << 8, // texelBlockDimension: 4x4x1x1 (stored as dimension - 1)
+        info.blockSize, // bytesPlane0
+        0, // bytesPlane4-7
+    };
+    for (const auto& sample : info.samples) {
+        dfd.push_back(sample.bitOffset | (sample.bitLength - 1) << 16 | sample.channel << 24);
+        dfd.push_back(0); // samplePosition
+        dfd.push_back(0); // sampleLower
+        dfd.push_back(0xFFFFFFFF); // sampleUpper
+    }
+    return dfd;
+}
+
+std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // end of anonymous namespace
+
+namespace util
+{
+std::optional<CompressedImageData> loadKTX2Image(
+    const std::filesystem::path& path,
+    std::uint32_t maxSize)
+{
+    const MappedFile file(path);
+    if (!file.isGood()) {
+        return std::nullopt;
+    }
+
+    const auto data = file.getData();
+    const auto fail = [&path](const char* reason) {
+        fmt::println("[error] failed to load '{}': {}", path.string(), reason);
+        return std::nullopt;
+    };
+
+    Header header;
+    if (data.size() < sizeof(Header)) {
+        return fail("file is too small");
+    }
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (header.identifier != KTX2_IDENTIFIER) {
+        return fail("not a KTX2 file");
+    }
+
+    const auto* info = findFormatInfo((VkFormat)header.vkFormat);
+    if (!info) {
+        return fail("unsupported format");
+    }
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 ||
+        header.layerCount > 1 || header.faceCount != 1) {
+        return fail("only 2D images are supported");
+    }
+    if (header.supercompressionScheme != 0) {
+        return fail("supercompression is not supported");
+    }
+    const auto maxMips = std::bit_width(std::max(header.pixelWidth, header.pixelHeight));
+    if (header.levelCount == 0 || header.levelCount > maxMips) {
+        return fail("invalid number of mip levels");
+    }
+
+    const auto levelIndexEnd = sizeof(Header) + header.levelCount * sizeof(LevelIndex);
+    if (data.size() < levelIndexEnd) {
+        return fail("file is too small");
+    }
+
+    CompressedImageData image{
+        .format = info->format,
+        .width = header.pixelWidth,
+        .height = header.pixelHeight,
+        .numMips = header.levelCount,
+    };
+    if (maxSize != 0) {
+        while (image.firstMip + 1 < header.levelCount &&
+               std::max(header.pixelWidth, header.pixelHeight) >> image.firstMip > maxSize) {
+            ++image.firstMip;
+        }
+    }
+
+    // the file is memory mapped, so skipped mips are not even read
+    image.mips.resize(header.levelCount - image.firstMip);
+    for (std::uint32_t level = image.firstMip; level < header.levelCount; ++level) {
+        LevelIndex levelIndex;
+        std::memcpy(
+            &levelIndex,
+            data.data() + sizeof(Header) + level * sizeof(LevelIndex),
+            sizeof(LevelIndex));
+
+        const auto mipWidth = std::max(header.pixelWidth >> level, 1u);
+        const auto mipHeight = std::max(header.pixelHeight >> level, 1u);
+        if (levelIndex.byteLength != getMipSize(*info, mipWidth, mipHeight)) {
+            return fail("invalid mip size");
+        }
+        if (levelIndex.byteOffset > data.size() ||
+            data.size() - levelIndex.byteOffset < levelIndex.byteLength) {
+            return fail("mip data is out of bounds");
+        }
+
+        const auto* mipData = data.data() + levelIndex.byteOffset;
+        auto& mip = image.mips[level - image.firstMip];
+        mip.resize(levelIndex.byteLength);
+        std::memcpy(mip.data(), mipData, levelIndex.byteLength);
+    }
+
+    return image;
+}
+
+bool writeKTX2Image(const std::filesystem::path& path, const CompressedImageData& image)
+{
+    const auto* info = findFormatInfo(image.format);
+    assert(info && "unsupported format");
+    assert(!image.mips.empty() && image.firstMip == 0);
+
+    const auto dfd = makeDFD(*info);
+    const auto numLevels = (std::uint32_t)image.mips.size();
+
+    Header header{
+        .identifier = KTX2_IDENTIFIER,
+        .vkFormat = (std::uint32_t)image.format,
+        .typeSize = 1, // block compressed
+        .pixelWidth = image.width,
+        .pixelHeight = image.height,
+        .pixelDepth = 0,
+        .layerCount = 0,
+        .faceCount = 1,
+        .levelCount = numLevels,
+        .supercompressionScheme = 0,
+        .dfdByteOffset = (std::uint32_t)(sizeof(Header) + numLevels * sizeof(LevelIndex)),
+        .dfdByteLength = (std::uint32_t)(dfd.size() * sizeof(std::uint32_t)),
+        .kvdByteOffset = 0,
+        .kvdByteLength = 0,
+        .sgdByteOffset = 0,
+        .sgdByteLength = 0,
+    };
+
+    // mips are stored from the smallest to the biggest one, so that
+    // streaming loaders can show something before the whole file is read
+    std::vector<LevelIndex> levelIndices(numLevels);
+    std::uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+    for (std::uint32_t level = numLevels; level-- > 0;) {
+        offset = alignUp(offset, LEVEL_ALIGNMENT);
+        const auto size = image.mips[level].size();
+        levelIndices[level] = LevelIndex{
+            .byteOffset = offset,
+            .byteLength = size,
+            .uncompressedByteLength = size,
+        };
+        offset += size;
+    }
+
+    // write to a temporary file first, so that the game never sees partially
+    // written files (e.g. if the cooker is run while the game is running)
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.good()) {
+            fmt::println("[error] failed to open '{}' for writing", tempPath.string());
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(
+            reinterpret_cast<const char*>(levelIndices.data()),
+            levelIndices.size() * sizeof(LevelIndex));
+        file.write(reinterpret_cast<const char*>(dfd.data()), header.dfdByteLength);
+
+        std::uint64_t pos = header.dfdByteOffset + header.dfdByteLength;
+        const std::array<char, LEVEL_ALIGNMENT> padding{};
+        for (std::uint32_t level = numLevels; level-- > 0;) {
+            file.write(padding.data(), (std::streamsize)(levelIndices[level].byteOffset - pos));
+            const auto& mip = image.mips[level];
+            file.write(reinterpret_cast<const char*>(mip.data()), mip.size());
+            pos = levelIndices[level].byteOffset + mip.size();
+        }
+        if (!file.good()) {
+            fmt::println("[error] failed to write '{}'", tempPath.string());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        fmt::println("[error] failed to write '{}': {}", path.string(), ec.message());
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+std::size_t getCompressedMipSize(VkFormat format, std::uint32_t width, std::uint32_t height)
+{
+    const auto* info = findFormatInfo(format);
+    assert(info && "unsupported format");
+    return getMipSize(*info, width, height);
+}
+
+std::filesystem::path getCookedImagePath(const std::filesystem::path& imagePath)
+{
+    auto path = imagePath;
+    path.replace_extension(".ktx2");
+    return path;
+}
+
+std::optional<CompressedImageData> loadCookedImage(
+    const std::filesystem::path& imagePath,
+    VkFormat format,
+    std::uint32_t maxSize)
+{
+    const auto cookedPath = getCookedImagePath(imagePath);
+    std::error_code ec;
+    const auto cookedTime = std::filesystem::last_write_time(cookedPath, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    // a missing source image is fine - only cooked images can be shipped
+    const auto imageTime = std::filesystem::last_write_time(imagePath, ec);
+    if (!ec && imageTime > cookedTime) {
+        fmt::println("'{}' is outdated, cook the image again", cookedPath.string());
+        return std::nullopt;
+    }
+
+    auto image = loadKTX2Image(cookedPath, maxSize);
+    if (image && findFormatInfo(image->format)->srgb != isSRGBFormat(format)) {
+        fmt::println(
+            "'{}' can't be used instead of '{}': color spaces don't match",
+            cookedPath.string(),
+            imagePath.string());
+        return std::nullopt;
+    }
+    return image;
+}
+
+} // end of namespace util
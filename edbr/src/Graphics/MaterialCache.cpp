@@ -7,7 +7,9 @@ void MaterialCache::init(GfxDevice& gfxDevice)
 {
     materialDataBuffer = gfxDevice.createBuffer(
         MAX_MATERIALS * sizeof(MaterialData),
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::Streaming,
+            MemoryCategory::Other);
     vkutil::addDebugLabel(gfxDevice.getDevice(), materialDataBuffer.buffer, "material data");
 
     { // create default normal map texture
@@ -50,11 +52,23 @@ MaterialId MaterialCache::addMaterial(GfxDevice& gfxDevice, Material material)
     };
 
     // store on CPU
-    materials.push_back(std::move(material));
+    if (id < materials.size()) {
+        freeMaterialIds.pop_back();
+        materials[id] = std::move(material);
+    } else {
+        materials.push_back(std::move(material));
+    }
 
     return id;
 }
 
+void MaterialCache::removeMaterial(GfxDevice& gfxDevice, MaterialId id)
+{
+    assert(id < materials.size());
+    materials[id] = Material{};
+    gfxDevice.deferDestruction([this, id]() { freeMaterialIds.push_back(id); });
+}
+
 const Material& MaterialCache::getMaterial(MaterialId id) const
 {
     return materials.at(id);
@@ -62,5 +76,5 @@ const Material& MaterialCache::getMaterial(MaterialId id) const
 
 MaterialId MaterialCache::getFreeMaterialId() const
 {
-    return materials.size();
+    return freeMaterialIds.empty() ? materials.size() : freeMaterialIds.back();
 }
@@ -1,105 +1,189 @@
 #include <edbr/Graphics/MeshCache.h>
 
+#include <algorithm> // max
+#include <cassert>
+
 #include <edbr/Graphics/CPUMesh.h>
 #include <edbr/Graphics/GfxDevice.h>
 #include <edbr/Graphics/Vulkan/Util.h>
-#include <edbr/Math/Util.h>
+
+// initial arena sizes (in elements), arenas grow when they run out of space
+static constexpr std::uint32_t INITIAL_NUM_VERTICES = 256 * 1024;
+static constexpr std::uint32_t INITIAL_NUM_PACKED_VERTICES = 256 * 1024;
+static constexpr std::uint32_t INITIAL_NUM_INDICES = 1024 * 1024;
+static constexpr std::uint32_t INITIAL_NUM_INDICES_16 = 1024 * 1024;
+static constexpr std::uint32_t INITIAL_NUM_SKINNING_DATA = 64 * 1024;
 
 MeshId MeshCache::addMesh(GfxDevice& gfxDevice, const CPUMesh& cpuMesh, MaterialId materialId)
 {
+    MeshUploadStorage storage;
+    const auto data = graphics::prepareMeshUpload(cpuMesh, lodSettings, storage);
+    return addMesh(gfxDevice, data, materialId);
+}
+
+MeshId MeshCache::addMesh(GfxDevice& gfxDevice, const MeshUploadData& data, MaterialId materialId)
+{
+    assert(!data.lods.empty());
     auto gpuMesh = GPUMesh{
-        .numVertices = (std::uint32_t)cpuMesh.vertices.size(),
-        .numIndices = (std::uint32_t)cpuMesh.indices.size(),
+        .numVertices = data.numVertices,
+        .numIndices = data.lods[0].numIndices,
+        .indexType = data.indexType,
+        .lods = {data.lods.begin(), data.lods.end()},
         .materialId = materialId,
-        .minPos = cpuMesh.minPos,
-        .maxPos = cpuMesh.maxPos,
-        .hasSkeleton = cpuMesh.hasSkeleton,
+        .vertexFormat = data.vertexFormat,
+        .minPos = data.minPos,
+        .maxPos = data.maxPos,
+        .boundingSphere = data.boundingSphere,
+        .hasSkeleton = !data.skinningData.empty(),
+        .debugName = std::string{data.name},
+        .acmrBefore = data.acmrBefore,
+        .acmrAfter = data.acmrAfter,
     };
 
-    std::vector<glm::vec3> positions(cpuMesh.vertices.size());
-    for (std::size_t i = 0; i < cpuMesh.vertices.size(); ++i) {
-        positions[i] = cpuMesh.vertices[i].position;
+    uploadMesh(gfxDevice, data, gpuMesh);
+    if (!freeMeshIds.empty()) {
+        const auto id = freeMeshIds.back();
+        freeMeshIds.pop_back();
+        meshes[id] = std::move(gpuMesh);
+        return id;
     }
-    gpuMesh.boundingSphere = util::calculateBoundingSphere(positions);
-
-    uploadMesh(gfxDevice, cpuMesh, gpuMesh);
     const auto id = meshes.size();
     meshes.push_back(std::move(gpuMesh));
     return id;
 }
 
-void MeshCache::uploadMesh(GfxDevice& gfxDevice, const CPUMesh& cpuMesh, GPUMesh& gpuMesh) const
+void MeshCache::initArena(
+    GfxDevice& gfxDevice,
+    Arena& arena,
+    std::size_t elementSize,
+    std::uint32_t capacity,
+    VkBufferUsageFlags usage,
+    const char* name)
 {
-    // create index buffer
-    const auto indexBufferSize = cpuMesh.indices.size() * sizeof(std::uint32_t);
-    gpuMesh.indexBuffer = gfxDevice.createBuffer(
-        indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-
-    // create vertex buffer
-    const auto vertexBufferSize = cpuMesh.vertices.size() * sizeof(CPUMesh::Vertex);
-    gpuMesh.vertexBuffer = gfxDevice.createBuffer(
-        vertexBufferSize,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-
-    const auto staging =
-        gfxDevice
-            .createBuffer(vertexBufferSize + indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-
-    // copy data
-    void* data = staging.info.pMappedData;
-    memcpy(data, cpuMesh.vertices.data(), vertexBufferSize);
-    memcpy((char*)data + vertexBufferSize, cpuMesh.indices.data(), indexBufferSize);
+    arena.elementSize = elementSize;
+    arena.usage = usage;
+    arena.name = name;
+    arena.allocator.init(capacity);
+    arena.buffer = gfxDevice.createBuffer(
+        capacity * elementSize, usage, MemoryClass::GPUOnly, MemoryCategory::Meshes);
+    vkutil::addDebugLabel(gfxDevice.getDevice(), arena.buffer.buffer, name);
+}
+
+OffsetAllocator::Allocation MeshCache::allocateInArena(
+    GfxDevice& gfxDevice,
+    Arena& arena,
+    std::uint32_t numElements)
+{
+    auto allocation = arena.allocator.allocate(numElements);
+    if (!allocation.isValid()) {
+        const auto capacity = arena.allocator.getCapacity();
+        growArena(gfxDevice, arena, std::max(capacity * 2, capacity + numElements));
+        allocation = arena.allocator.allocate(numElements);
+    }
+    assert(allocation.isValid());
+    return allocation;
+}
 
+void MeshCache::growArena(GfxDevice& gfxDevice, Arena& arena, std::uint32_t newCapacity)
+{
+    const auto oldBuffer = arena.buffer;
+    const auto oldSize = arena.allocator.getCapacity() * arena.elementSize;
+
+    arena.buffer = gfxDevice.createBuffer(
+        newCapacity * arena.elementSize,
+        arena.usage,
+        MemoryClass::GPUOnly,
+        MemoryCategory::Meshes);
+    vkutil::addDebugLabel(gfxDevice.getDevice(), arena.buffer.buffer, arena.name);
+
+    // pending uploads into the old buffer are finished before this copy (see immediateSubmit)
     gfxDevice.immediateSubmit([&](VkCommandBuffer cmd) {
-        const auto vertexCopy = VkBufferCopy{
+        const auto copy = VkBufferCopy{
             .srcOffset = 0,
             .dstOffset = 0,
-            .size = vertexBufferSize,
-        };
-        vkCmdCopyBuffer(cmd, staging.buffer, gpuMesh.vertexBuffer.buffer, 1, &vertexCopy);
-
-        const auto indexCopy = VkBufferCopy{
-            .srcOffset = vertexBufferSize,
-            .dstOffset = 0,
-            .size = indexBufferSize,
+            .size = oldSize,
         };
-        vkCmdCopyBuffer(cmd, staging.buffer, gpuMesh.indexBuffer.buffer, 1, &indexCopy);
+        vkCmdCopyBuffer(cmd, oldBuffer.buffer, arena.buffer.buffer, 1, &copy);
     });
 
-    gfxDevice.destroyBuffer(staging);
+    gfxDevice.deferDestruction([&gfxDevice, oldBuffer]() { gfxDevice.destroyBuffer(oldBuffer); });
 
-    const auto vtxBufferName = cpuMesh.name + " (vtx)";
-    const auto idxBufferName = cpuMesh.name + " (idx)";
-    vkutil::
-        addDebugLabel(gfxDevice.getDevice(), gpuMesh.vertexBuffer.buffer, vtxBufferName.c_str());
-    vkutil::addDebugLabel(gfxDevice.getDevice(), gpuMesh.indexBuffer.buffer, idxBufferName.c_str());
+    arena.allocator.grow(newCapacity);
+}
+
+void MeshCache::uploadMesh(GfxDevice& gfxDevice, const MeshUploadData& data, GPUMesh& gpuMesh)
+{
+    if (vertexArena.buffer.buffer == VK_NULL_HANDLE) {
+        static const auto usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        initArena(
+            gfxDevice,
+            vertexArena,
+            sizeof(CPUMesh::Vertex),
+            INITIAL_NUM_VERTICES,
+            usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            "mesh vertices");
+        initArena(
+            gfxDevice,
+            packedVertexArena,
+            sizeof(PackedVertex),
+            INITIAL_NUM_PACKED_VERTICES,
+            usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            "mesh packed vertices");
+        initArena(
+            gfxDevice,
+            indexArena,
+            sizeof(std::uint32_t),
+            INITIAL_NUM_INDICES,
+            usage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            "mesh indices");
+        initArena(
+            gfxDevice,
+            index16Arena,
+            sizeof(std::uint16_t),
+            INITIAL_NUM_INDICES_16,
+            usage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            "mesh indices (16 bit)");
+        initArena(
+            gfxDevice,
+            skinningDataArena,
+            sizeof(CPUMesh::SkinningData),
+            INITIAL_NUM_SKINNING_DATA,
+            usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            "mesh skinning data");
+    }
+
+    auto& meshVertexArena = getVertexArena(gpuMesh.vertexFormat);
+    gpuMesh.vertices = allocateInArena(gfxDevice, meshVertexArena, gpuMesh.numVertices);
+    auto& meshIndexArena = getIndexArena(gpuMesh.indexType);
+    const auto numIndices = (std::uint32_t)(data.indices.size() / meshIndexArena.elementSize);
+    gpuMesh.indices = allocateInArena(gfxDevice, meshIndexArena, numIndices);
+    gpuMesh.vertexOffset = (std::int32_t)gpuMesh.vertices.offset;
+    gpuMesh.firstIndex = gpuMesh.indices.offset;
+    for (auto& lod : gpuMesh.lods) {
+        lod.firstIndex += gpuMesh.indices.offset;
+    }
 
     if (gpuMesh.hasSkeleton) {
-        // create skinning data buffer
-        const auto skinningDataSize = cpuMesh.vertices.size() * sizeof(CPUMesh::SkinningData);
-        gpuMesh.skinningDataBuffer = gfxDevice.createBuffer(
-            skinningDataSize,
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-
-        const auto staging =
-            gfxDevice.createBuffer(skinningDataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-
-        // copy data
-        void* data = staging.info.pMappedData;
-        memcpy(data, cpuMesh.skinningData.data(), skinningDataSize);
-
-        gfxDevice.immediateSubmit([&](VkCommandBuffer cmd) {
-            const auto vertexCopy = VkBufferCopy{
-                .srcOffset = 0,
-                .dstOffset = 0,
-                .size = skinningDataSize,
-            };
-            vkCmdCopyBuffer(cmd, staging.buffer, gpuMesh.skinningDataBuffer.buffer, 1, &vertexCopy);
-        });
-
-        gfxDevice.destroyBuffer(staging);
+        gpuMesh.skinningData =
+            allocateInArena(gfxDevice, skinningDataArena, gpuMesh.numVertices);
+    }
+
+    // the data is already in GPU format, copies are batched with other uploads
+    auto& uploadQueue = gfxDevice.getUploadQueue();
+    uploadQueue.uploadBuffer(
+        meshVertexArena.buffer.buffer,
+        gpuMesh.vertices.offset * meshVertexArena.elementSize,
+        data.vertices);
+    uploadQueue.uploadBuffer(
+        meshIndexArena.buffer.buffer,
+        gpuMesh.indices.offset * meshIndexArena.elementSize,
+        data.indices);
+    if (gpuMesh.hasSkeleton) {
+        uploadQueue.uploadBuffer(
+            skinningDataArena.buffer.buffer,
+            gpuMesh.skinningData.offset * skinningDataArena.elementSize,
+            std::as_bytes(data.skinningData));
     }
 }
 
@@ -108,13 +192,49 @@ const GPUMesh& MeshCache::getMesh(MeshId id) const
     return meshes.at(id);
 }
 
-void MeshCache::cleanup(const GfxDevice& gfxDevice)
+const GPUBuffer& MeshCache::getVertexBuffer(VertexFormat format) const
+{
+    return format == VertexFormat::Full ? vertexArena.buffer : packedVertexArena.buffer;
+}
+
+MeshCache::Arena& MeshCache::getVertexArena(VertexFormat format)
+{
+    return format == VertexFormat::Full ? vertexArena : packedVertexArena;
+}
+
+const GPUBuffer& MeshCache::getIndexBuffer(VkIndexType indexType) const
+{
+    return indexType == VK_INDEX_TYPE_UINT16 ? index16Arena.buffer : indexArena.buffer;
+}
+
+MeshCache::Arena& MeshCache::getIndexArena(VkIndexType indexType)
+{
+    return indexType == VK_INDEX_TYPE_UINT16 ? index16Arena : indexArena;
+}
+
+void MeshCache::removeMesh(GfxDevice& gfxDevice, MeshId id)
 {
-    for (const auto& mesh : meshes) {
-        gfxDevice.destroyBuffer(mesh.indexBuffer);
-        gfxDevice.destroyBuffer(mesh.vertexBuffer);
+    assert(meshes.at(id).numIndices != 0 && "Mesh was removed before");
+    // the mesh can still be drawn by frames in flight, so its ranges can't be
+    // overwritten by new meshes until then
+    gfxDevice.deferDestruction([this, id]() {
+        auto& mesh = meshes.at(id);
+        getVertexArena(mesh.vertexFormat).allocator.free(mesh.vertices);
+        getIndexArena(mesh.indexType).allocator.free(mesh.indices);
         if (mesh.hasSkeleton) {
-            gfxDevice.destroyBuffer(mesh.skinningDataBuffer);
+            skinningDataArena.allocator.free(mesh.skinningData);
+        }
+        mesh = GPUMesh{};
+        freeMeshIds.push_back(id);
+    });
+}
+
+void MeshCache::cleanup(const GfxDevice& gfxDevice)
+{
+    for (const auto* arena :
+         {&vertexArena, &packedVertexArena, &indexArena, &index16Arena, &skinningDataArena}) {
+        if (arena->buffer.buffer != VK_NULL_HANDLE) {
+            gfxDevice.destroyBuffer(arena->buffer);
         }
     }
 }
@@ -0,0 +1,32 @@
+#include <edbr/Graphics/MeshLod.h>
+
+namespace graphics
+{
+std::uint32_t selectMeshLod(
+    std::span<const MeshLod> lods,
+    float projectedSize,
+    float maxPixelError,
+    std::uint32_t prevLod,
+    float hysteresis)
+{
+    if (lods.size() <= 1) {
+        return 0;
+    }
+
+    // LOD errors grow with each level, so the first one which fits is the coarsest
+    for (auto lod = (std::uint32_t)lods.size() - 1; lod > 0; --lod) {
+        // switching to a coarser LOD needs some margin and the current LOD is
+        // kept until its error exceeds the threshold by the same margin
+        auto threshold = maxPixelError;
+        if (lod > prevLod) {
+            threshold *= 1.f - hysteresis;
+        } else if (lod == prevLod) {
+            threshold *= 1.f + hysteresis;
+        }
+        if (lods[lod].error * projectedSize <= threshold) {
+            return lod;
+        }
+    }
+    return 0;
+}
+}
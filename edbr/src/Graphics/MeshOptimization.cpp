@@ -0,0 +1,384 @@
+#include <edbr/Graphics/MeshOptimization.h>
+
+#include <algorithm> // count_if, find, min, stable_sort
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <numeric> // iota
+
+#include <edbr/Graphics/CPUMesh.h>
+
+namespace
+{
+// Forsyth's algorithm works best with a LRU cache bigger than the hardware one
+constexpr std::size_t OPTIMIZER_CACHE_SIZE = 32;
+
+float calculateVertexScore(int cachePosition, std::uint32_t numLiveTriangles)
+{
+    if (numLiveTriangles == 0) {
+        return -1.f; // no triangles left to draw
+    }
+
+    auto score = 0.f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // the vertices of the last triangle get a fixed score, otherwise
+            // the next triangle would be in the same strip direction
+            score = 0.75f;
+        } else {
+            const auto scaler = 1.f / (OPTIMIZER_CACHE_SIZE - 3);
+            score = std::pow(1.f - (cachePosition - 3) * scaler, 1.5f);
+        }
+    }
+
+    // bonus for vertices with few triangles left, so that they're removed
+    // from the mesh quickly and don't leave lone triangles
+    score += 2.f / std::sqrt((float)numLiveTriangles);
+    return score;
+}
+
+// Simulates FIFO cache with timestamps: the vertex is in the cache if it was
+// inserted less than cacheSize insertions ago. Returns the number of misses.
+struct FIFOCache {
+    FIFOCache(std::size_t numVertices, std::size_t cacheSize) :
+        timestamps(numVertices, 0), cacheSize((std::uint32_t)cacheSize),
+        time((std::uint32_t)cacheSize + 1)
+    {}
+
+    std::uint32_t access(std::uint32_t v)
+    {
+        if (time - timestamps[v] > cacheSize) {
+            timestamps[v] = time++;
+            return 1;
+        }
+        return 0;
+    }
+
+    void flush() { time += cacheSize + 1; }
+
+    std::vector<std::uint32_t> timestamps;
+    std::uint32_t cacheSize;
+    std::uint32_t time;
+};
+
+glm::vec3 getTriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+    // not normalized - length is proportional to area
+    const auto e1 = p1 - p0;
+    const auto e2 = p2 - p0;
+    return glm::vec3{
+        e1.y * e2.z - e1.z * e2.y,
+        e1.z * e2.x - e1.x * e2.z,
+        e1.x * e2.y - e1.y * e2.x,
+    };
+}
+
+template<typename T>
+void remapVertices(
+    std::vector<T>& vertices,
+    const std::vector<std::uint32_t>& remap,
+    std::size_t numUsedVertices)
+{
+    std::vector<T> result(numUsedVertices);
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        if (remap[i] != graphics::UNUSED_VERTEX) {
+            result[remap[i]] = vertices[i];
+        }
+    }
+    vertices = std::move(result);
+}
+
+} // end of anonymous namespace
+
+namespace graphics
+{
+float calculateACMR(
+    std::span<const std::uint32_t> indices,
+    std::size_t numVertices,
+    std::size_t cacheSize)
+{
+    if (indices.empty()) {
+        return 0.f;
+    }
+
+    FIFOCache cache(numVertices, cacheSize);
+    std::size_t numMisses = 0;
+    for (const auto v : indices) {
+        numMisses += cache.access(v);
+    }
+    return (float)numMisses / (float)(indices.size() / 3);
+}
+
+void optimizeVertexCache(std::vector<std::uint32_t>& indices, std::size_t numVertices)
+{
+    assert(indices.size() % 3 == 0);
+    const auto numTriangles = indices.size() / 3;
+    if (numTriangles == 0) {
+        return;
+    }
+
+    // triangles which use each vertex: vertex v's triangles are stored in
+    // adjacentTriangles[firstAdjacent[v], firstAdjacent[v] + numLiveTriangles[v]),
+    // already emitted triangles are moved out of the live range
+    std::vector<std::uint32_t> numLiveTriangles(numVertices, 0);
+    for (const auto v : indices) {
+        ++numLiveTriangles[v];
+    }
+    std::vector<std::uint32_t> firstAdjacent(numVertices, 0);
+    for (std::size_t v = 1; v < numVertices; ++v) {
+        firstAdjacent[v] = firstAdjacent[v - 1] + numLiveTriangles[v - 1];
+    }
+    std::vector<std::uint32_t> adjacentTriangles(indices.size());
+    {
+        std::vector<std::uint32_t> fillOffsets = firstAdjacent;
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            adjacentTriangles[fillOffsets[indices[i]]++] = (std::uint32_t)(i / 3);
+        }
+    }
+
+    std::vector<float> vertexScores(numVertices);
+    for (std::size_t v = 0; v < numVertices; ++v) {
+        vertexScores[v] = calculateVertexScore(-1, numLiveTriangles[v]);
+    }
+
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<std::uint32_t> result;
+    result.reserve(indices.size());
+
+    // +3 - the vertices of the emitted triangle are pushed before the old ones are evicted
+    std::array<std::uint32_t, OPTIMIZER_CACHE_SIZE + 3> cache{};
+    std::array<std::uint32_t, OPTIMIZER_CACHE_SIZE + 3> newCache{};
+    std::size_t cacheSize = 0;
+
+    std::size_t nextUnemittedTriangle = 0;
+    auto bestTriangle = std::size_t{0};
+    while (result.size() < indices.size()) {
+        const auto* tri = &indices[bestTriangle * 3];
+        result.insert(result.end(), tri, tri + 3);
+        emitted[bestTriangle] = true;
+
+        // remove the triangle from its vertices' live ranges
+        for (int k = 0; k < 3; ++k) {
+            const auto v = tri[k];
+            auto* begin = &adjacentTriangles[firstAdjacent[v]];
+            auto* end = begin + numLiveTriangles[v];
+            auto* it = std::find(begin, end, (std::uint32_t)bestTriangle);
+            assert(it != end);
+            std::swap(*it, *(end - 1));
+            --numLiveTriangles[v];
+        }
+
+        // LRU: the triangle's vertices go to the front of the cache
+        std::size_t newCacheSize = 0;
+        for (int k = 0; k < 3; ++k) {
+            newCache[newCacheSize++] = tri[k];
+        }
+        for (std::size_t i = 0; i < cacheSize; ++i) {
+            const auto v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                newCache[newCacheSize++] = v;
+            }
+        }
+
+        // update scores of the vertices which were touched (including the evicted ones)
+        for (std::size_t i = 0; i < newCacheSize; ++i) {
+            const auto v = newCache[i];
+            const auto cachePosition = (i < OPTIMIZER_CACHE_SIZE) ? (int)i : -1;
+            vertexScores[v] = calculateVertexScore(cachePosition, numLiveTriangles[v]);
+        }
+
+        // the next triangle is the best one which uses the touched vertices
+        auto bestScore = -1.f;
+        bool found = false;
+        for (std::size_t i = 0; i < newCacheSize; ++i) {
+            const auto v = newCache[i];
+            const auto first = firstAdjacent[v];
+            for (auto j = first; j < first + numLiveTriangles[v]; ++j) {
+                const auto t = adjacentTriangles[j];
+                const auto score = vertexScores[indices[t * 3 + 0]] +
+                                   vertexScores[indices[t * 3 + 1]] +
+                                   vertexScores[indices[t * 3 + 2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = t;
+                    found = true;
+                }
+            }
+        }
+
+        cacheSize = std::min(newCacheSize, OPTIMIZER_CACHE_SIZE);
+        std::copy(newCache.begin(), newCache.begin() + cacheSize, cache.begin());
+
+        if (!found) {
+            // nothing in the cache can be drawn - continue from any remaining triangle
+            while (nextUnemittedTriangle < numTriangles && emitted[nextUnemittedTriangle]) {
+                ++nextUnemittedTriangle;
+            }
+            bestTriangle = nextUnemittedTriangle;
+        }
+    }
+
+    indices = std::move(result);
+}
+
+void optimizeOverdraw(
+    std::vector<std::uint32_t>& indices,
+    std::span<const glm::vec3> positions,
+    float acmrThreshold)
+{
+    assert(indices.size() % 3 == 0);
+    const auto numTriangles = indices.size() / 3;
+    if (numTriangles == 0) {
+        return;
+    }
+
+    // Hard boundaries: triangles which miss the cache completely - the
+    // cache doesn't carry over between such clusters, so they can be
+    // reordered freely
+    std::vector<std::size_t> hardBoundaries;
+    {
+        FIFOCache cache(positions.size(), VERTEX_CACHE_SIZE);
+        for (std::size_t t = 0; t < numTriangles; ++t) {
+            const auto misses = cache.access(indices[t * 3 + 0]) +
+                                cache.access(indices[t * 3 + 1]) +
+                                cache.access(indices[t * 3 + 2]);
+            if (t == 0 || misses == 3) {
+                hardBoundaries.push_back(t);
+            }
+        }
+        hardBoundaries.push_back(numTriangles);
+    }
+
+    // Soft boundaries: hard clusters are split further, the cluster ends
+    // as soon as its ACMR (with the cache flushed at its start) gets within
+    // the threshold of the hard cluster's ACMR
+    std::vector<std::size_t> clusters; // first triangle of each cluster
+    for (std::size_t c = 0; c + 1 < hardBoundaries.size(); ++c) {
+        const auto start = hardBoundaries[c];
+        const auto end = hardBoundaries[c + 1];
+
+        FIFOCache cache(positions.size(), VERTEX_CACHE_SIZE);
+        std::uint32_t hardClusterMisses = 0;
+        for (auto t = start; t < end; ++t) {
+            hardClusterMisses += cache.access(indices[t * 3 + 0]) +
+                                 cache.access(indices[t * 3 + 1]) +
+                                 cache.access(indices[t * 3 + 2]);
+        }
+        const auto threshold = acmrThreshold * (float)hardClusterMisses / (float)(end - start);
+
+        cache.flush();
+        clusters.push_back(start);
+        std::uint32_t clusterMisses = 0;
+        std::size_t clusterSize = 0;
+        for (auto t = start; t < end; ++t) {
+            clusterMisses += cache.access(indices[t * 3 + 0]) +
+                             cache.access(indices[t * 3 + 1]) +
+                             cache.access(indices[t * 3 + 2]);
+            ++clusterSize;
+            if (t + 1 < end && (float)clusterMisses / (float)clusterSize <= threshold) {
+                clusters.push_back(t + 1);
+                cache.flush();
+                clusterMisses = 0;
+                clusterSize = 0;
+            }
+        }
+    }
+    clusters.push_back(numTriangles);
+
+    // sort clusters by how much they face away from the mesh center
+    auto meshCentroid = glm::vec3{0.f};
+    for (const auto v : indices) {
+        meshCentroid += positions[v];
+    }
+    meshCentroid /= (float)indices.size();
+
+    const auto numClusters = clusters.size() - 1;
+    std::vector<float> sortKeys(numClusters);
+    for (std::size_t c = 0; c < numClusters; ++c) {
+        auto centroid = glm::vec3{0.f};
+        auto normal = glm::vec3{0.f};
+        auto area = 0.f;
+        for (auto t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const auto& p0 = positions[indices[t * 3 + 0]];
+            const auto& p1 = positions[indices[t * 3 + 1]];
+            const auto& p2 = positions[indices[t * 3 + 2]];
+            const auto n = getTriangleNormal(p0, p1, p2);
+            const auto triArea = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+            centroid += (p0 + p1 + p2) * (triArea / 3.f);
+            normal += n;
+            area += triArea;
+        }
+        if (area > 0.f) {
+            centroid /= area;
+        }
+        const auto normalLength =
+            std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        if (normalLength > 0.f) {
+            normal /= normalLength;
+        }
+        const auto d = centroid - meshCentroid;
+        sortKeys[c] = d.x * normal.x + d.y * normal.y + d.z * normal.z;
+    }
+
+    std::vector<std::size_t> order(numClusters);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](std::size_t a, std::size_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<std::uint32_t> result;
+    result.reserve(indices.size());
+    for (const auto c : order) {
+        result.insert(
+            result.end(),
+            indices.begin() + clusters[c] * 3,
+            indices.begin() + clusters[c + 1] * 3);
+    }
+    indices = std::move(result);
+}
+
+std::vector<std::uint32_t> generateVertexFetchRemap(
+    std::span<const std::uint32_t> indices,
+    std::size_t numVertices)
+{
+    std::vector<std::uint32_t> remap(numVertices, UNUSED_VERTEX);
+    std::uint32_t nextVertex = 0;
+    for (const auto v : indices) {
+        if (remap[v] == UNUSED_VERTEX) {
+            remap[v] = nextVertex++;
+        }
+    }
+    return remap;
+}
+
+void optimizeMesh(CPUMesh& mesh)
+{
+    if (mesh.indices.empty()) {
+        return;
+    }
+
+    const auto numVertices = mesh.vertices.size();
+    mesh.acmrBefore = calculateACMR(mesh.indices, numVertices);
+
+    optimizeVertexCache(mesh.indices, numVertices);
+
+    std::vector<glm::vec3> positions(numVertices);
+    for (std::size_t i = 0; i < numVertices; ++i) {
+        positions[i] = mesh.vertices[i].position;
+    }
+    optimizeOverdraw(mesh.indices, positions);
+
+    const auto remap = generateVertexFetchRemap(mesh.indices, numVertices);
+    const auto numUsedVertices = (std::size_t)std::count_if(
+        remap.begin(), remap.end(), [](std::uint32_t v) { return v != UNUSED_VERTEX; });
+    for (auto& index : mesh.indices) {
+        index = remap[index];
+    }
+    remapVertices(mesh.vertices, remap, numUsedVertices);
+    if (mesh.hasSkeleton) {
+        remapVertices(mesh.skinningData, remap, numUsedVertices);
+    }
+
+    mesh.acmrAfter = calculateACMR(mesh.indices, mesh.vertices.size());
+}
+}
@@ -0,0 +1,432 @@
+#include <edbr/Graphics/MeshSimplification.h>
+
+#include <algorithm> // max, min, sort
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <numeric> // iota
+
+#include <glm/geometric.hpp>
+
+#include <edbr/Graphics/MeshOptimization.h>
+
+namespace
+{
+// LODs which remove fewer triangles than this are not worth keeping
+constexpr float MIN_LOD_REDUCTION = 0.1f;
+
+// Symmetric 4x4 matrix which gives the sum of squared distances to a set
+// of planes. Planes are weighted by the area of their triangles and the
+// error is divided by the total weight, so it's an average squared distance.
+struct Quadric {
+    double a2{0.0}, ab{0.0}, ac{0.0}, ad{0.0};
+    double b2{0.0}, bc{0.0}, bd{0.0};
+    double c2{0.0}, cd{0.0};
+    double d2{0.0};
+    double weight{0.0};
+
+    // plane: dot(n, p) + d = 0, n is normalized
+    void addPlane(const glm::vec3& n, float d, float w)
+    {
+        a2 += w * n.x * n.x;
+        ab += w * n.x * n.y;
+        ac += w * n.x * n.z;
+        ad += w * n.x * d;
+        b2 += w * n.y * n.y;
+        bc += w * n.y * n.z;
+        bd += w * n.y * d;
+        c2 += w * n.z * n.z;
+        cd += w * n.z * d;
+        d2 += w * d * d;
+        weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& o)
+    {
+        a2 += o.a2;
+        ab += o.ab;
+        ac += o.ac;
+        ad += o.ad;
+        b2 += o.b2;
+        bc += o.bc;
+        bd += o.bd;
+        c2 += o.c2;
+        cd += o.cd;
+        d2 += o.d2;
+        weight += o.weight;
+        return *this;
+    }
+
+    double evaluate(const glm::vec3& p) const
+    {
+        if (weight == 0.0) {
+            return 0.0;
+        }
+        const double x = p.x, y = p.y, z = p.z;
+        const auto e = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x +
+                       b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y + c2 * z * z +
+                       2.0 * cd * z + d2;
+        return std::max(e, 0.0) / weight;
+    }
+};
+
+// Simplification state which is kept between calls to simplify, so that
+// LODs can be built progressively with errors accumulated in the quadrics.
+// Topology is tracked per position: all vertices with the same position
+// map to one "position vertex" (the first of them).
+class Simplifier {
+public:
+    Simplifier(std::span<const std::uint32_t> indices, std::span<const glm::vec3> positions);
+
+    void simplify(std::size_t targetIndexCount, float targetError);
+
+    std::vector<std::uint32_t> getIndices() const;
+    std::size_t getNumIndices() const { return numAliveTriangles * 3; }
+    // relative to the mesh size
+    float getError() const { return (float)std::sqrt(maxCollapseError) / meshSize; }
+
+private:
+    struct Collapse {
+        std::uint32_t from; // position vertices
+        std::uint32_t to;
+        double error; // squared
+    };
+
+    void buildPositionRemap();
+    void lockBordersAndSeams();
+    void computeQuadrics();
+
+    bool collapseFlipsTriangles(std::uint32_t from, std::uint32_t to) const;
+    void collapse(std::uint32_t from, std::uint32_t to);
+
+    std::span<const glm::vec3> positions;
+    float meshSize{1.f};
+
+    std::vector<std::array<std::uint32_t, 3>> triangles;
+    std::vector<bool> triangleAlive;
+    std::size_t numAliveTriangles{0};
+
+    std::vector<std::uint32_t> remap; // vertex -> position vertex
+    std::vector<std::uint32_t> numWedges; // vertices with the same position
+    std::vector<bool> locked;
+    std::vector<Quadric> quadrics;
+    // triangles which reference the position vertex (may contain dead ones)
+    std::vector<std::vector<std::uint32_t>> vertexTriangles;
+
+    double maxCollapseError{0.0};
+    bool errorLimitReached{false};
+};
+
+Simplifier::Simplifier(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions) :
+    positions(positions)
+{
+    assert(indices.size() % 3 == 0);
+    triangles.resize(indices.size() / 3);
+    for (std::size_t i = 0; i < triangles.size(); ++i) {
+        triangles[i] = {indices[i * 3 + 0], indices[i * 3 + 1], indices[i * 3 + 2]};
+    }
+    triangleAlive.assign(triangles.size(), true);
+    numAliveTriangles = triangles.size();
+
+    if (!positions.empty()) {
+        auto minPos = positions[0];
+        auto maxPos = positions[0];
+        for (const auto& p : positions) {
+            minPos = glm::min(minPos, p);
+            maxPos = glm::max(maxPos, p);
+        }
+        const auto diagonal = glm::length(maxPos - minPos);
+        meshSize = diagonal > 0.f ? diagonal : 1.f;
+    }
+
+    buildPositionRemap();
+    lockBordersAndSeams();
+    computeQuadrics();
+}
+
+void Simplifier::buildPositionRemap()
+{
+    std::vector<std::uint32_t> sorted(positions.size());
+    std::iota(sorted.begin(), sorted.end(), 0);
+    const auto less = [this](std::uint32_t a, std::uint32_t b) {
+        const auto& pa = positions[a];
+        const auto& pb = positions[b];
+        if (pa.x != pb.x) {
+            return pa.x < pb.x;
+        }
+        if (pa.y != pb.y) {
+            return pa.y < pb.y;
+        }
+        if (pa.z != pb.z) {
+            return pa.z < pb.z;
+        }
+        return a < b;
+    };
+    std::sort(sorted.begin(), sorted.end(), less);
+
+    remap.resize(positions.size());
+    numWedges.assign(positions.size(), 0);
+    for (std::size_t i = 0; i < sorted.size();) {
+        // sorted by index within the group, so the first vertex is the smallest one
+        const auto first = sorted[i];
+        std::size_t j = i;
+        while (j < sorted.size() && positions[sorted[j]].x == positions[first].x &&
+               positions[sorted[j]].y == positions[first].y &&
+               positions[sorted[j]].z == positions[first].z) {
+            remap[sorted[j]] = first;
+            ++j;
+        }
+        numWedges[first] = (std::uint32_t)(j - i);
+        i = j;
+    }
+}
+
+void Simplifier::lockBordersAndSeams()
+{
+    locked.assign(positions.size(), false);
+    for (std::size_t v = 0; v < positions.size(); ++v) {
+        // moving a seam vertex would move only one side of the seam
+        if (numWedges[remap[v]] > 1) {
+            locked[remap[v]] = true;
+        }
+    }
+
+    // border (and non-manifold) edges don't have exactly one opposite edge
+    std::vector<std::uint64_t> edges;
+    edges.reserve(triangles.size() * 3);
+    for (const auto& t : triangles) {
+        for (int k = 0; k < 3; ++k) {
+            const auto a = remap[t[k]];
+            const auto b = remap[t[(k + 1) % 3]];
+            edges.push_back(((std::uint64_t)a << 32) | b);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    const auto countEdges = [&edges](std::uint64_t edge) {
+        const auto [first, last] = std::equal_range(edges.begin(), edges.end(), edge);
+        return last - first;
+    };
+    for (const auto edge : edges) {
+        const auto a = (std::uint32_t)(edge >> 32);
+        const auto b = (std::uint32_t)(edge & 0xFFFFFFFF);
+        const auto reversed = ((std::uint64_t)b << 32) | a;
+        if (countEdges(edge) != 1 || countEdges(reversed) != 1) {
+            locked[a] = true;
+            locked[b] = true;
+        }
+    }
+}
+
+void Simplifier::computeQuadrics()
+{
+    quadrics.assign(positions.size(), Quadric{});
+    vertexTriangles.assign(positions.size(), {});
+    for (std::uint32_t i = 0; i < triangles.size(); ++i) {
+        const auto& t = triangles[i];
+        for (int k = 0; k < 3; ++k) {
+            vertexTriangles[remap[t[k]]].push_back(i);
+        }
+
+        const auto& p0 = positions[t[0]];
+        const auto& p1 = positions[t[1]];
+        const auto& p2 = positions[t[2]];
+        const auto n = glm::cross(p1 - p0, p2 - p0);
+        const auto len = glm::length(n);
+        if (len == 0.f) {
+            continue; // degenerate triangle
+        }
+        const auto normal = n / len;
+        const auto area = len * 0.5f;
+        for (int k = 0; k < 3; ++k) {
+            quadrics[remap[t[k]]].addPlane(normal, -glm::dot(normal, p0), area);
+        }
+    }
+}
+
+bool Simplifier::collapseFlipsTriangles(std::uint32_t from, std::uint32_t to) const
+{
+    const auto& newPos = positions[to];
+    for (const auto ti : vertexTriangles[from]) {
+        if (!triangleAlive[ti]) {
+            continue;
+        }
+        const auto& t = triangles[ti];
+        std::array<glm::vec3, 3> ps;
+        bool containsTo = false;
+        for (int k = 0; k < 3; ++k) {
+            const auto v = remap[t[k]];
+            containsTo = containsTo || v == to;
+            ps[k] = (v == from) ? newPos : positions[t[k]];
+        }
+        if (containsTo) {
+            continue; // removed by the collapse
+        }
+
+        const auto oldNormal = glm::cross(
+            positions[t[1]] - positions[t[0]], positions[t[2]] - positions[t[0]]);
+        const auto newNormal = glm::cross(ps[1] - ps[0], ps[2] - ps[0]);
+        if (glm::dot(oldNormal, newNormal) <= 0.f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Simplifier::collapse(std::uint32_t from, std::uint32_t to)
+{
+    // vertex of "to" which is used by the triangles on the collapsed edge -
+    // "from" is not a seam vertex, so its triangles can all use it
+    auto toVertex = to;
+    for (const auto ti : vertexTriangles[from]) {
+        if (!triangleAlive[ti]) {
+            continue;
+        }
+        for (const auto v : triangles[ti]) {
+            if (remap[v] == to) {
+                toVertex = v;
+            }
+        }
+    }
+
+    for (const auto ti : vertexTriangles[from]) {
+        if (!triangleAlive[ti]) {
+            continue;
+        }
+        auto& t = triangles[ti];
+        for (auto& v : t) {
+            if (remap[v] == from) {
+                v = toVertex;
+            }
+        }
+        if (remap[t[0]] == remap[t[1]] || remap[t[1]] == remap[t[2]] ||
+            remap[t[0]] == remap[t[2]]) {
+            triangleAlive[ti] = false;
+            --numAliveTriangles;
+        } else {
+            vertexTriangles[to].push_back(ti);
+        }
+    }
+    vertexTriangles[from].clear();
+    quadrics[to] += quadrics[from];
+}
+
+void Simplifier::simplify(std::size_t targetIndexCount, float targetError)
+{
+    const auto maxError = (double)targetError * meshSize;
+    const auto maxErrorSq = maxError * maxError;
+
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(positions.size());
+    while (getNumIndices() > targetIndexCount && !errorLimitReached) {
+        // each pass collapses the cheapest edges which don't share vertices
+        collapses.clear();
+        for (std::size_t ti = 0; ti < triangles.size(); ++ti) {
+            if (!triangleAlive[ti]) {
+                continue;
+            }
+            const auto& t = triangles[ti];
+            for (int k = 0; k < 3; ++k) {
+                const auto a = remap[t[k]];
+                const auto b = remap[t[(k + 1) % 3]];
+                auto quadric = quadrics[a];
+                quadric += quadrics[b];
+                if (!locked[a]) {
+                    collapses.push_back({a, b, quadric.evaluate(positions[b])});
+                }
+                if (!locked[b]) {
+                    collapses.push_back({b, a, quadric.evaluate(positions[a])});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const auto& c1, const auto& c2) {
+            return c1.error < c2.error;
+        });
+
+        std::fill(touched.begin(), touched.end(), false);
+        std::size_t numCollapses = 0;
+        for (const auto& c : collapses) {
+            if (getNumIndices() <= targetIndexCount) {
+                break;
+            }
+            if (c.error > maxErrorSq) {
+                errorLimitReached = true;
+                break;
+            }
+            if (touched[c.from] || touched[c.to] || collapseFlipsTriangles(c.from, c.to)) {
+                continue;
+            }
+            collapse(c.from, c.to);
+            touched[c.from] = true;
+            touched[c.to] = true;
+            maxCollapseError = std::max(maxCollapseError, c.error);
+            ++numCollapses;
+        }
+
+        if (numCollapses == 0) {
+            break;
+        }
+    }
+}
+
+std::vector<std::uint32_t> Simplifier::getIndices() const
+{
+    std::vector<std::uint32_t> indices;
+    indices.reserve(getNumIndices());
+    for (std::size_t ti = 0; ti < triangles.size(); ++ti) {
+        if (triangleAlive[ti]) {
+            indices.insert(indices.end(), triangles[ti].begin(), triangles[ti].end());
+        }
+    }
+    return indices;
+}
+
+} // end of anonymous namespace
+
+namespace graphics
+{
+float simplifyMesh(
+    std::vector<std::uint32_t>& indices,
+    std::span<const glm::vec3> positions,
+    std::size_t targetIndexCount,
+    float targetError)
+{
+    Simplifier simplifier(indices, positions);
+    simplifier.simplify(targetIndexCount, targetError);
+    indices = simplifier.getIndices();
+    return simplifier.getError();
+}
+
+std::vector<SimplifiedMeshLod> generateMeshLods(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    const MeshLodSettings& settings)
+{
+    std::vector<SimplifiedMeshLod> lods;
+    if (settings.maxLods <= 1 || indices.empty()) {
+        return lods;
+    }
+
+    Simplifier simplifier(indices, positions);
+    auto prevNumIndices = indices.size();
+    for (std::uint32_t i = 1; i < settings.maxLods; ++i) {
+        const auto targetNumTriangles =
+            (std::size_t)((prevNumIndices / 3) * settings.reductionRatio);
+        simplifier.simplify(targetNumTriangles * 3, settings.targetError);
+
+        const auto numIndices = simplifier.getNumIndices();
+        if (numIndices == 0 || numIndices > prevNumIndices * (1.f - MIN_LOD_REDUCTION)) {
+            break;
+        }
+
+        auto& lod = lods.emplace_back();
+        lod.indices = simplifier.getIndices();
+        lod.error = simplifier.getError();
+        optimizeVertexCache(lod.indices, positions.size());
+        prevNumIndices = numIndices;
+    }
+    return lods;
+}
+}
@@ -0,0 +1,85 @@
+#include <edbr/Graphics/MeshUploadData.h>
+
+#include <cstring> // memcpy
+#include <limits>
+
+#include <edbr/Graphics/MeshSimplification.h>
+#include <edbr/Graphics/VertexPacking.h>
+#include <edbr/Math/Util.h>
+
+namespace graphics
+{
+MeshUploadData prepareMeshUpload(
+    const CPUMesh& cpuMesh,
+    const MeshLodSettings& lodSettings,
+    MeshUploadStorage& storage)
+{
+    const auto numVertices = cpuMesh.vertices.size();
+    std::vector<glm::vec3> positions(numVertices);
+    for (std::size_t i = 0; i < numVertices; ++i) {
+        positions[i] = cpuMesh.vertices[i].position;
+    }
+
+    auto data = MeshUploadData{
+        .vertexFormat = cpuMesh.vertexFormat,
+        // all indices fit into 16 bits (primitive restart is not used, so 0xFFFF is fine)
+        .indexType = numVertices <= std::numeric_limits<std::uint16_t>::max() + 1 ?
+                         VK_INDEX_TYPE_UINT16 :
+                         VK_INDEX_TYPE_UINT32,
+        .numVertices = (std::uint32_t)numVertices,
+        .minPos = cpuMesh.minPos,
+        .maxPos = cpuMesh.maxPos,
+        .boundingSphere = util::calculateBoundingSphere(positions),
+        .name = cpuMesh.name,
+        .acmrBefore = cpuMesh.acmrBefore,
+        .acmrAfter = cpuMesh.acmrAfter,
+    };
+
+    if (cpuMesh.vertexFormat == VertexFormat::Full) {
+        data.vertices = std::as_bytes(std::span{cpuMesh.vertices});
+    } else {
+        storage.vertices.resize(numVertices * sizeof(PackedVertex));
+        auto* packedVertices = (PackedVertex*)storage.vertices.data();
+        for (std::size_t i = 0; i < numVertices; ++i) {
+            packedVertices[i] = packVertex(
+                cpuMesh.vertices[i], cpuMesh.vertexFormat, cpuMesh.minPos, cpuMesh.maxPos);
+        }
+        data.vertices = storage.vertices;
+    }
+
+    // all LODs use the same vertices, their indices are stored after LOD 0's
+    storage.lods.clear();
+    storage.lods.push_back(MeshLod{.numIndices = (std::uint32_t)cpuMesh.indices.size()});
+    std::vector<std::uint32_t> indices = cpuMesh.indices;
+    if (!cpuMesh.hasSkeleton) {
+        const auto lods = generateMeshLods(cpuMesh.indices, positions, lodSettings);
+        for (const auto& lod : lods) {
+            storage.lods.push_back(MeshLod{
+                .firstIndex = (std::uint32_t)indices.size(),
+                .numIndices = (std::uint32_t)lod.indices.size(),
+                .error = lod.error,
+            });
+            indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+        }
+    }
+    data.lods = storage.lods;
+
+    if (data.indexType == VK_INDEX_TYPE_UINT32) {
+        storage.indices.resize(indices.size() * sizeof(std::uint32_t));
+        std::memcpy(storage.indices.data(), indices.data(), storage.indices.size());
+    } else {
+        storage.indices.resize(indices.size() * sizeof(std::uint16_t));
+        auto* indices16 = (std::uint16_t*)storage.indices.data();
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            indices16[i] = (std::uint16_t)indices[i];
+        }
+    }
+    data.indices = storage.indices;
+
+    if (cpuMesh.hasSkeleton) {
+        data.skinningData = cpuMesh.skinningData;
+    }
+
+    return data;
+}
+}
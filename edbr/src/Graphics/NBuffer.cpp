@@ -23,12 +23,18 @@ void NBuffer::init(
     gpuBufferSize = dataSize;
 
     gpuBuffer = gfxDevice.createBuffer(
-        dataSize, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+        dataSize,
+        usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        MemoryClass::GPUOnly,
+        MemoryCategory::PerFrameBuffers);
     vkutil::addDebugLabel(gfxDevice.getDevice(), gpuBuffer.buffer, label);
 
     for (std::size_t i = 0; i < numFramesInFlight; ++i) {
         stagingBuffers.push_back(gfxDevice.createBuffer(
-            dataSize, usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST));
+            dataSize,
+            usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            MemoryClass::Staging,
+            MemoryCategory::PerFrameBuffers));
     }
 
     initialized = true;
@@ -0,0 +1,97 @@
+#include <edbr/Graphics/OffsetAllocator.h>
+
+#include <cassert>
+
+void OffsetAllocator::init(std::uint32_t capacity)
+{
+    this->capacity = capacity;
+    usedSize = 0;
+    freeRanges.clear();
+    if (capacity > 0) {
+        freeRanges.emplace(0, capacity);
+    }
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(std::uint32_t size)
+{
+    if (size == 0) {
+        return {};
+    }
+
+    // best fit - the number of free ranges is usually small
+    auto bestIt = freeRanges.end();
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second < size) {
+            continue;
+        }
+        if (bestIt == freeRanges.end() || it->second < bestIt->second) {
+            bestIt = it;
+            if (it->second == size) {
+                break;
+            }
+        }
+    }
+
+    if (bestIt == freeRanges.end()) {
+        return {};
+    }
+
+    const auto [offset, rangeSize] = *bestIt;
+    freeRanges.erase(bestIt);
+    if (rangeSize > size) {
+        freeRanges.emplace(offset + size, rangeSize - size);
+    }
+    usedSize += size;
+
+    return Allocation{
+        .offset = offset,
+        .size = size,
+    };
+}
+
+void OffsetAllocator::free(const Allocation& allocation)
+{
+    if (!allocation.isValid()) {
+        return;
+    }
+    assert(allocation.offset + allocation.size <= capacity);
+    assert(usedSize >= allocation.size);
+    usedSize -= allocation.size;
+    addFreeRange(allocation.offset, allocation.size);
+}
+
+void OffsetAllocator::grow(std::uint32_t newCapacity)
+{
+    assert(newCapacity >= capacity);
+    if (newCapacity == capacity) {
+        return;
+    }
+    const auto oldCapacity = capacity;
+    capacity = newCapacity;
+    addFreeRange(oldCapacity, newCapacity - oldCapacity);
+}
+
+void OffsetAllocator::addFreeRange(std::uint32_t offset, std::uint32_t size)
+{
+    auto next = freeRanges.lower_bound(offset);
+    assert(next == freeRanges.end() || next->first >= offset + size); // double free?
+
+    // merge with the previous range
+    if (next != freeRanges.begin()) {
+        auto prev = std::prev(next);
+        assert(prev->first + prev->second <= offset); // double free?
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            freeRanges.erase(prev);
+        }
+    }
+
+    // merge with the next range
+    if (next != freeRanges.end() && next->first == offset + size) {
+        size += next->second;
+        freeRanges.erase(next);
+    }
+
+    freeRanges.emplace(offset, size);
+}
@@ -4,10 +4,18 @@
 #include <edbr/Graphics/GfxDevice.h>
 #include <edbr/Graphics/MeshCache.h>
 #include <edbr/Graphics/MeshDrawCommand.h>
+#include <edbr/Graphics/Pipelines/MeshCullingPipeline.h>
 #include <edbr/Graphics/ShadowMapping.h>
-#include <edbr/Graphics/Vulkan/Init.h>
 #include <edbr/Graphics/Vulkan/Pipelines.h>
 #include <edbr/Graphics/Vulkan/Util.h>
+#include <edbr/Math/HashCombine.h>
+
+#include <algorithm>
+#include <functional>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <tracy/Tracy.hpp>
 
 void CSMPipeline::init(GfxDevice& gfxDevice, const std::array<float, NUM_SHADOW_CASCADES>& percents)
 {
@@ -39,80 +47,139 @@ void CSMPipeline::init(GfxDevice& gfxDevice, const std::array<float, NUM_SHADOW_
                    .setDepthFormat(VK_FORMAT_D32_SFLOAT)
                    .enableDepthClamp()
                    .enableDepthTest(true, VK_COMPARE_OP_GREATER_OR_EQUAL)
-                   .build(device);
+                   .build(device, gfxDevice.getPipelineCache());
     vkutil::addDebugLabel(device, pipeline, "mesh depth only pipeline");
 
     vkDestroyShaderModule(device, vertexShader, nullptr);
     vkDestroyShaderModule(device, fragShader, nullptr);
 
-    initCSMData(gfxDevice);
+    for (std::size_t i = 0; i < graphics::FRAME_OVERLAP; ++i) {
+        // each cascade has its own range of MAX_DRAWS instances, so that
+        // cascades can be recorded in parallel
+        auto& instancesBuffer = framesData[i].instancesBuffer;
+        instancesBuffer = gfxDevice.createBuffer(
+            MeshCullingPipeline::MAX_DRAWS * NUM_SHADOW_CASCADES * sizeof(std::uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::Streaming,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(device, instancesBuffer.buffer, "CSM mesh instances");
+    }
 }
 
 void CSMPipeline::initCSMData(GfxDevice& gfxDevice)
 {
-    csmShadowMapID = gfxDevice.createImage(
-        {
-            .format = VK_FORMAT_D32_SFLOAT,
-            .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            .extent =
-                VkExtent3D{
-                    (std::uint32_t)shadowMapTextureSize, (std::uint32_t)shadowMapTextureSize, 1},
-            .numLayers = NUM_SHADOW_CASCADES,
-        },
-        "CSM shadow map");
-    const auto& csmShadowMap = gfxDevice.getImage(csmShadowMapID);
+    const auto createShadowMap = [&](VkImageUsageFlags usage, const char* debugName) {
+        return gfxDevice.createImage(
+            {
+                .format = VK_FORMAT_D32_SFLOAT,
+                .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | usage,
+                .extent =
+                    VkExtent3D{
+                        (std::uint32_t)shadowMapTextureSize,
+                        (std::uint32_t)shadowMapTextureSize,
+                        1},
+                .numLayers = NUM_SHADOW_CASCADES,
+                .memoryCategory = MemoryCategory::ShadowMaps,
+            },
+            debugName);
+    };
 
-    for (int i = 0; i < NUM_SHADOW_CASCADES; ++i) {
-        const auto createInfo = VkImageViewCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-            .image = csmShadowMap.image,
-            .viewType = VK_IMAGE_VIEW_TYPE_2D,
-            .format = csmShadowMap.format,
-            .subresourceRange =
-                VkImageSubresourceRange{
-                    .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
-                    .baseMipLevel = 0,
-                    .levelCount = 1,
-                    .baseArrayLayer = (std::uint32_t)i,
-                    .layerCount = 1,
-                },
-        };
-        VK_CHECK(
-            vkCreateImageView(gfxDevice.getDevice(), &createInfo, nullptr, &csmShadowMapViews[i]));
-        vkutil::addDebugLabel(gfxDevice.getDevice(), csmShadowMapViews[i], "CSM shadow map view");
-    }
+    const auto createCascadeViews = [&](ImageId imageId,
+                                        std::array<VkImageView, NUM_SHADOW_CASCADES>& views,
+                                        const char* debugName) {
+        const auto& shadowMap = gfxDevice.getImage(imageId);
+        for (int i = 0; i < NUM_SHADOW_CASCADES; ++i) {
+            const auto createInfo = VkImageViewCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .image = shadowMap.image,
+                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .format = shadowMap.format,
+                .subresourceRange =
+                    VkImageSubresourceRange{
+                        .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                        .baseMipLevel = 0,
+                        .levelCount = 1,
+                        .baseArrayLayer = (std::uint32_t)i,
+                        .layerCount = 1,
+                    },
+            };
+            VK_CHECK(vkCreateImageView(gfxDevice.getDevice(), &createInfo, nullptr, &views[i]));
+            vkutil::addDebugLabel(gfxDevice.getDevice(), views[i], debugName);
+        }
+    };
+
+    csmShadowMapID = createShadowMap(
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, "CSM shadow map");
+    createCascadeViews(csmShadowMapID, csmShadowMapViews, "CSM shadow map view");
+
+    staticShadowMapID =
+        createShadowMap(VK_IMAGE_USAGE_TRANSFER_SRC_BIT, "CSM static shadow map");
+    createCascadeViews(staticShadowMapID, staticShadowMapViews, "CSM static shadow map view");
 }
 
 void CSMPipeline::cleanup(GfxDevice& gfxDevice)
 {
+    for (std::size_t i = 0; i < graphics::FRAME_OVERLAP; ++i) {
+        gfxDevice.destroyBuffer(framesData[i].instancesBuffer);
+    }
     vkDestroyPipelineLayout(gfxDevice.getDevice(), pipelineLayout, nullptr);
     vkDestroyPipeline(gfxDevice.getDevice(), pipeline, nullptr);
     for (int i = 0; i < NUM_SHADOW_CASCADES; ++i) {
         vkDestroyImageView(gfxDevice.getDevice(), csmShadowMapViews[i], nullptr);
+        vkDestroyImageView(gfxDevice.getDevice(), staticShadowMapViews[i], nullptr);
     }
 }
 
-void CSMPipeline::draw(
-    VkCommandBuffer cmd,
+void CSMPipeline::updateCascades(
     const GfxDevice& gfxDevice,
-    const MeshCache& meshCache,
     const Camera& camera,
     const glm::vec3& sunlightDirection,
-    const GPUBuffer& materialsBuffer,
     const std::vector<MeshDrawCommand>& meshDrawCommands,
+    const std::vector<std::size_t>& sortedMeshDrawCommands,
     bool shadowsEnabled)
 {
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-    gfxDevice.bindBindlessDescSet(cmd, pipelineLayout);
+    const bool useStaticCache = shadowsEnabled && staticShadowCacheEnabled;
 
-    const auto& csmShadowMap = gfxDevice.getImage(csmShadowMapID);
+    // GfxDevice::endFrame only advances the frame number after a submit - if
+    // the frame which redrew a cascade was skipped, the cascade was never drawn
+    const auto frameNumber = gfxDevice.getFrameNumber();
+    for (auto& sc : staticCascades) {
+        if (sc.redrawPending && sc.redrawFrameNumber == frameNumber) {
+            sc.valid = false;
+        }
+        sc.redrawPending = false;
+    }
 
-    vkutil::transitionImage(
-        cmd,
-        csmShadowMap.image,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+    // static casters changed (e.g. new level was loaded or something has moved)?
+    std::size_t newStaticCastersHash = 0;
+    if (useStaticCache) {
+        // static casters' LODs only depend on the bias (see drawCasters)
+        hash_combine(newStaticCastersHash, shadowLodBias);
+        for (const auto& dcIdx : sortedMeshDrawCommands) {
+            const auto& dc = meshDrawCommands[dcIdx];
+            if (!dc.isStatic || !dc.castShadow || dc.skinnedMesh) {
+                continue;
+            }
+            hash_combine(newStaticCastersHash, dc.meshId);
+            const auto* m = glm::value_ptr(dc.transformMatrix);
+            for (int i = 0; i < 16; ++i) {
+                hash_combine(newStaticCastersHash, m[i]);
+            }
+        }
+        if (newStaticCastersHash != staticCastersHash) {
+            for (auto& sc : staticCascades) {
+                sc.valid = false;
+            }
+            staticCastersHash = newStaticCastersHash;
+        }
+    } else {
+        for (auto& sc : staticCascades) {
+            sc.valid = false;
+        }
+    }
 
+    // calculate cascades
+    redrawStaticCascade = {};
     for (std::size_t i = 0; i < NUM_SHADOW_CASCADES; ++i) {
         float zNear = i == 0 ? camera.getZNear() : camera.getZNear() * percents[i - 1];
         float zFar = camera.getZFar() * percents[i];
@@ -126,82 +193,358 @@ void CSMPipeline::draw(
         subFrustumCamera.init(camera.getFOVX(), zNear, zFar, 1.f);
 
         const auto corners = edge::calculateFrustumCornersWorldSpace(subFrustumCamera);
-        const auto csmCamera = calculateCSMCamera(corners, sunlightDirection, shadowMapTextureSize);
-        csmLightSpaceTMs[i] = csmCamera.getViewProj();
-
-        const auto renderInfo = vkutil::createRenderingInfo({
-            .renderExtent =
-                {(std::uint32_t)shadowMapTextureSize, (std::uint32_t)shadowMapTextureSize},
-            .depthImageView = csmShadowMapViews[i],
-            .depthImageClearValue = 0.f,
-        });
-        vkCmdBeginRendering(cmd, &renderInfo.renderingInfo);
-
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-        const auto viewport = VkViewport{
-            .x = 0,
-            .y = 0,
-            .width = shadowMapTextureSize,
-            .height = shadowMapTextureSize,
-            .minDepth = 0.f,
-            .maxDepth = 1.f,
-        };
-        vkCmdSetViewport(cmd, 0, 1, &viewport);
-
-        const auto scissor = VkRect2D{
-            .offset = {},
-            .extent = {(std::uint32_t)shadowMapTextureSize, (std::uint32_t)shadowMapTextureSize},
-        };
-        vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-        const auto frustum = edge::createFrustumFromCamera(csmCamera);
-        auto prevMeshId = NULL_MESH_ID;
-
-        for (const auto& dc : meshDrawCommands) {
-            if (!shadowsEnabled || !dc.castShadow) {
-                continue;
-            }
+        const auto bounds = calculateCSMBounds(corners);
 
-            if (!edge::isInFrustum(frustum, dc.worldBoundingSphere)) {
-                // hack: don't cull big objects, because shadows from them might disappear
-                if (dc.worldBoundingSphere.radius < 2.f) {
-                    continue;
-                }
+        if (useStaticCache) {
+            auto& sc = staticCascades[i];
+            if (shouldRedrawStaticCascade(i, bounds, sunlightDirection)) {
+                // cache a bigger cascade, so that it can be reused while the camera moves
+                sc.valid = true;
+                sc.redrawPending = true;
+                sc.redrawFrameNumber = frameNumber;
+                sc.bounds = bounds;
+                sc.cachedBounds = math::Sphere{
+                    .center = bounds.center,
+                    .radius = std::round(bounds.radius * (1.f + staticShadowCacheMargin)),
+                };
+                sc.sunlightDirection = sunlightDirection;
+                sc.camera =
+                    calculateCSMCamera(sc.cachedBounds, sunlightDirection, shadowMapTextureSize);
+                redrawStaticCascade[i] = true;
+                ++numStaticCascadeRedraws;
             }
+            cascadeCameras[i] = sc.camera;
+        } else {
+            cascadeCameras[i] = calculateCSMCamera(bounds, sunlightDirection, shadowMapTextureSize);
+        }
 
-            const auto& mesh = meshCache.getMesh(dc.meshId);
+        csmLightSpaceTMs[i] = cascadeCameras[i].getViewProj();
+        casterCullingFrustums[i] =
+            createCSMCasterCullingFrustum(cascadeCameras[i], sunlightDirection);
+    }
+}
 
-            if (dc.meshId != prevMeshId) {
-                prevMeshId = dc.meshId;
-                vkCmdBindIndexBuffer(cmd, mesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-            }
+RenderGraph::ResourceId CSMPipeline::addPasses(
+    RenderGraph& graph,
+    GfxDevice& gfxDevice,
+    const MeshCache& meshCache,
+    const GPUBuffer& materialsBuffer,
+    const std::vector<MeshDrawCommand>& meshDrawCommands,
+    const std::vector<std::size_t>& sortedMeshDrawCommands,
+    const SphereSoA& drawBoundingSpheres,
+    const MeshCullingPipeline& meshCullingPipeline,
+    RenderGraph::ResourceId skinnedVertices,
+    bool shadowsEnabled)
+{
+    const auto frameIndex = gfxDevice.getCurrentFrameIndex();
+    framesData[frameIndex].numCascadeInstances = {};
+    stats = {};
+
+    // all cascades are cleared or overwritten by the static shadow map
+    const auto shadowMap = graph.importImage("CSM shadow map", csmShadowMapID, false);
+
+    const bool useStaticCache = shadowsEnabled && staticShadowCacheEnabled;
+    if (!useStaticCache) {
+        graph.addPass(
+            "CSM",
+            {
+                {shadowMap, RenderGraph::Usage::DepthAttachmentWrite},
+                {skinnedVertices, RenderGraph::Usage::VertexShaderRead},
+            },
+            [&, shadowsEnabled](VkCommandBuffer cmd) {
+                ZoneScopedN("CSM");
+                TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "CSM", tracy::Color::CornflowerBlue);
+                recordCascades(cmd, gfxDevice, [&](VkCommandBuffer cascadeCmd, std::size_t i) {
+                    if (shadowsEnabled) {
+                        edge::cullSpheres(
+                            casterCullingFrustums[i], drawBoundingSpheres, cascadeVisibility[i]);
+                    }
+                    drawCasters(
+                        cascadeCmd,
+                        gfxDevice,
+                        meshCache,
+                        materialsBuffer,
+                        meshDrawCommands,
+                        sortedMeshDrawCommands,
+                        meshCullingPipeline,
+                        i,
+                        csmShadowMapViews[i],
+                        true,
+                        shadowsEnabled ? CasterType::All : CasterType::None);
+                });
+            });
+        return shadowMap;
+    }
+
+    // cascades which are not redrawn keep their static casters
+    const auto staticShadowMap = graph.importImage("CSM static shadow map", staticShadowMapID);
+
+    if (std::ranges::any_of(redrawStaticCascade, [](bool b) { return b; })) {
+        graph.addPass(
+            "CSM static casters",
+            {{staticShadowMap, RenderGraph::Usage::DepthAttachmentWrite}},
+            [&](VkCommandBuffer cmd) {
+                ZoneScopedN("CSM static casters");
+                for (std::size_t i = 0; i < NUM_SHADOW_CASCADES; ++i) {
+                    if (redrawStaticCascade[i]) {
+                        edge::cullSpheres(
+                            casterCullingFrustums[i], drawBoundingSpheres, cascadeVisibility[i]);
+                        drawCasters(
+                            cmd,
+                            gfxDevice,
+                            meshCache,
+                            materialsBuffer,
+                            meshDrawCommands,
+                            sortedMeshDrawCommands,
+                            meshCullingPipeline,
+                            i,
+                            staticShadowMapViews[i],
+                            true,
+                            CasterType::Static);
+                    }
+                }
+            });
+    }
 
-            const auto pushConstants = PushConstants{
-                .mvp = csmLightSpaceTMs[i] * dc.transformMatrix,
-                .vertexBuffer = dc.skinnedMesh ? dc.skinnedMesh->skinnedVertexBuffer.address :
-                                                 mesh.vertexBuffer.address,
-                .materialsBuffer = materialsBuffer.address,
-                .materialId = (std::uint32_t)mesh.materialId,
+    graph.addPass(
+        "CSM static copy",
+        {
+            {staticShadowMap, RenderGraph::Usage::TransferRead},
+            {shadowMap, RenderGraph::Usage::TransferWrite},
+        },
+        [this, &graph, &gfxDevice, staticShadowMap, shadowMap](VkCommandBuffer cmd) {
+            const auto& staticImage = graph.getImage(staticShadowMap);
+            const auto layers = VkImageSubresourceLayers{
+                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = NUM_SHADOW_CASCADES,
+            };
+            const auto copyRegion = VkImageCopy{
+                .srcSubresource = layers,
+                .dstSubresource = layers,
+                .extent = staticImage.extent,
             };
-            vkCmdPushConstants(
+            vkCmdCopyImage(
                 cmd,
-                pipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(PushConstants),
-                &pushConstants);
+                staticImage.image,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                graph.getImage(shadowMap).image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1,
+                &copyRegion);
+        });
 
-            vkCmdDrawIndexed(cmd, mesh.numIndices, 1, 0, 0, 0);
+    graph.addPass(
+        "CSM dynamic casters",
+        {
+            {shadowMap, RenderGraph::Usage::DepthAttachmentWrite},
+            {skinnedVertices, RenderGraph::Usage::VertexShaderRead},
+        },
+        [&](VkCommandBuffer cmd) {
+            ZoneScopedN("CSM");
+            TracyVkZoneC(gfxDevice.getTracyVkCtx(), cmd, "CSM", tracy::Color::CornflowerBlue);
+            recordCascades(cmd, gfxDevice, [&](VkCommandBuffer cascadeCmd, std::size_t i) {
+                edge::cullSpheres(
+                    casterCullingFrustums[i], drawBoundingSpheres, cascadeVisibility[i]);
+                drawCasters(
+                    cascadeCmd,
+                    gfxDevice,
+                    meshCache,
+                    materialsBuffer,
+                    meshDrawCommands,
+                    sortedMeshDrawCommands,
+                    meshCullingPipeline,
+                    i,
+                    csmShadowMapViews[i],
+                    false,
+                    CasterType::Dynamic);
+            });
+        });
+
+    return shadowMap;
+}
+
+void CSMPipeline::recordCascades(
+    VkCommandBuffer cmd,
+    GfxDevice& gfxDevice,
+    const std::function<void(VkCommandBuffer, std::size_t)>& recordCascade)
+{
+    if (!parallelRecording) {
+        for (std::size_t i = 0; i < NUM_SHADOW_CASCADES; ++i) {
+            recordCascade(cmd, i);
         }
+        return;
+    }
+
+    std::array<VkCommandBuffer, NUM_SHADOW_CASCADES> cascadeCmds{};
+    gfxDevice.getRecordingThreadPool().parallelFor(
+        NUM_SHADOW_CASCADES, [&](std::size_t i, std::size_t threadIndex) {
+            ZoneScopedN("Record CSM cascade");
+            const auto cascadeCmd = gfxDevice.beginSecondaryCommandBuffer(threadIndex);
+            recordCascade(cascadeCmd, i);
+            VK_CHECK(vkEndCommandBuffer(cascadeCmd));
+            cascadeCmds[i] = cascadeCmd;
+        });
+    vkCmdExecuteCommands(cmd, (std::uint32_t)cascadeCmds.size(), cascadeCmds.data());
+}
+
+bool CSMPipeline::shouldRedrawStaticCascade(
+    std::size_t cascadeIndex,
+    const math::Sphere& cascadeBounds,
+    const glm::vec3& sunlightDirection) const
+{
+    const auto& sc = staticCascades[cascadeIndex];
+    if (!sc.valid) {
+        return true;
+    }
+
+    // cascade size has changed (e.g. cascade percents were changed)
+    if (cascadeBounds.radius != sc.bounds.radius) {
+        return true;
+    }
+
+    // cascade is not inside the cached cascade anymore
+    const auto dist = glm::length(cascadeBounds.center - sc.cachedBounds.center);
+    if (dist + cascadeBounds.radius > sc.cachedBounds.radius) {
+        return true;
+    }
 
-        vkCmdEndRendering(cmd);
+    // sun has moved
+    static const float sunDirectionThreshold = std::cos(glm::radians(0.5f));
+    if (glm::dot(sunlightDirection, sc.sunlightDirection) < sunDirectionThreshold) {
+        return true;
     }
 
-    // this also gives us sync with future passes that will read from CSM shadow map
-    vkutil::transitionImage(
+    return false;
+}
+
+void CSMPipeline::drawCasters(
+    VkCommandBuffer cmd,
+    const GfxDevice& gfxDevice,
+    const MeshCache& meshCache,
+    const GPUBuffer& materialsBuffer,
+    const std::vector<MeshDrawCommand>& meshDrawCommands,
+    const std::vector<std::size_t>& sortedMeshDrawCommands,
+    const MeshCullingPipeline& meshCullingPipeline,
+    std::size_t cascadeIndex,
+    VkImageView depthImageView,
+    bool clearDepth,
+    CasterType casterType)
+{
+    const auto frameIndex = gfxDevice.getCurrentFrameIndex();
+    auto& frame = framesData[frameIndex];
+    const auto& visibility = cascadeVisibility[cascadeIndex];
+
+    // cascade's range in the instances buffer
+    const auto cascadeFirstInstance =
+        (std::uint32_t)(cascadeIndex * MeshCullingPipeline::MAX_DRAWS);
+    auto& numInstancesInCascade = frame.numCascadeInstances[cascadeIndex];
+    auto* instances = (std::uint32_t*)frame.instancesBuffer.info.pMappedData;
+
+    const auto renderInfo = vkutil::createRenderingInfo({
+        .renderExtent = {(std::uint32_t)shadowMapTextureSize, (std::uint32_t)shadowMapTextureSize},
+        .depthImageView = depthImageView,
+        .depthImageClearValue = clearDepth ? std::optional<float>{0.f} : std::nullopt,
+    });
+    vkCmdBeginRendering(cmd, &renderInfo.renderingInfo);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    gfxDevice.bindBindlessDescSet(cmd, pipelineLayout);
+
+    const auto viewport = VkViewport{
+        .x = 0,
+        .y = 0,
+        .width = shadowMapTextureSize,
+        .height = shadowMapTextureSize,
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    const auto scissor = VkRect2D{
+        .offset = {},
+        .extent = {(std::uint32_t)shadowMapTextureSize, (std::uint32_t)shadowMapTextureSize},
+    };
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    const auto pushConstants = PushConstants{
+        .viewProj = csmLightSpaceTMs[cascadeIndex],
+        .drawDataBuffer = meshCullingPipeline.getDrawDataBuffer(frameIndex).address,
+        .instancesBuffer = frame.instancesBuffer.address,
+        .materialsBuffer = materialsBuffer.address,
+    };
+    vkCmdPushConstants(
         cmd,
-        csmShadowMap.image,
-        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+        pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        0,
+        sizeof(PushConstants),
+        &pushConstants);
+
+    // index buffer is rebound when index type changes between batches
+    auto boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+    auto& cascadeStats = stats[cascadeIndex];
+
+    // draws are batched by MeshCullingPipeline - each batch is drawn
+    // with a single instanced draw call
+    for (const auto& batch : meshCullingPipeline.getDrawBatches()) {
+        if (casterType == CasterType::None) {
+            break;
+        }
+
+        const auto firstInstance = cascadeFirstInstance + numInstancesInCascade;
+        for (auto drawIndex = batch.firstDraw; drawIndex < batch.firstDraw + batch.numDraws;
+             ++drawIndex) {
+            // draw data is uploaded in sorted order
+            const auto& dc = meshDrawCommands[sortedMeshDrawCommands[drawIndex]];
+            if (!dc.castShadow || !visibility.isVisible(drawIndex)) {
+                continue;
+            }
+
+            const bool isStatic = dc.isStatic && !dc.skinnedMesh;
+            if ((casterType == CasterType::Static && !isStatic) ||
+                (casterType == CasterType::Dynamic && isStatic)) {
+                continue;
+            }
+
+            assert(numInstancesInCascade < MeshCullingPipeline::MAX_DRAWS);
+            instances[cascadeFirstInstance + numInstancesInCascade] = (std::uint32_t)drawIndex;
+            ++numInstancesInCascade;
+        }
+
+        const auto numInstances = cascadeFirstInstance + numInstancesInCascade - firstInstance;
+        if (numInstances == 0) {
+            continue;
+        }
+
+        if (batch.indexType != boundIndexType) {
+            boundIndexType = batch.indexType;
+            vkCmdBindIndexBuffer(
+                cmd, meshCache.getIndexBuffer(boundIndexType).buffer, 0, boundIndexType);
+        }
+
+        // shadows can use coarser LODs than the main view. Static casters are
+        // cached, so their LOD can't depend on the distance to the camera:
+        // each cascade gets a coarser LOD than the previous one instead.
+        const auto& mesh = meshCache.getMesh(batch.meshId);
+        const auto baseLod =
+            casterType == CasterType::Static ? (std::uint32_t)cascadeIndex : batch.lod;
+        const auto lodIndex =
+            std::min(baseLod + shadowLodBias, (std::uint32_t)mesh.lods.size() - 1);
+        const auto& lod = mesh.lods[lodIndex];
+        vkCmdDrawIndexed(
+            cmd,
+            lod.numIndices,
+            numInstances,
+            lod.firstIndex,
+            batch.skinned ? 0 : mesh.vertexOffset,
+            firstInstance);
+
+        ++cascadeStats.numDrawCalls;
+        cascadeStats.numInstances += numInstances;
+    }
+
+    vkCmdEndRendering(cmd);
 }
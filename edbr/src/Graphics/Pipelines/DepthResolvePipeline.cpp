@@ -32,7 +32,7 @@ void DepthResolvePipeline::init(GfxDevice& gfxDevice, VkFormat depthImageFormat)
                    .setMultisamplingNone()
                    .setDepthFormat(depthImageFormat)
                    .enableDepthTest(true, VK_COMPARE_OP_ALWAYS)
-                   .build(device);
+                   .build(device, gfxDevice.getPipelineCache());
     vkutil::addDebugLabel(device, pipeline, "depth resolve pipeline");
 
     vkDestroyShaderModule(device, vertexShader, nullptr);
@@ -0,0 +1,264 @@
+#include <edbr/Graphics/Pipelines/HiZPipeline.h>
+
+#include <array>
+#include <bit> // bit_floor
+#include <cmath>
+#include <utility> // exchange
+
+#include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/Vulkan/Pipelines.h>
+#include <edbr/Graphics/Vulkan/Util.h>
+
+#include <glm/common.hpp> // max
+
+void HiZPipeline::init(GfxDevice& gfxDevice)
+{
+    const auto& device = gfxDevice.getDevice();
+
+    const auto bindings = std::array<DescriptorLayoutBinding, 2>{{
+        {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE},
+    }};
+    descSetLayout =
+        vkutil::buildDescriptorSetLayout(device, VK_SHADER_STAGE_COMPUTE_BIT, bindings);
+
+    initDescAllocator(device);
+
+    const auto pushConstant = VkPushConstantRange{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+
+    const auto layouts = std::array{descSetLayout};
+    const auto pushConstants = std::array{pushConstant};
+    pipelineLayout = vkutil::createPipelineLayout(device, layouts, pushConstants);
+
+    const auto shader = vkutil::loadShaderModule("shaders/hiz_downsample.comp.spv", device);
+    vkutil::addDebugLabel(device, shader, "hiz_downsample");
+
+    pipeline = ComputePipelineBuilder{pipelineLayout}
+                   .setShader(shader)
+                   .build(device, gfxDevice.getPipelineCache());
+    vkutil::addDebugLabel(device, pipeline, "Hi-Z downsample pipeline");
+
+    vkDestroyShaderModule(device, shader, nullptr);
+
+    const auto samplerCreateInfo = VkSamplerCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+    };
+    VK_CHECK(vkCreateSampler(device, &samplerCreateInfo, nullptr, &depthSampler));
+    vkutil::addDebugLabel(device, depthSampler, "Hi-Z depth");
+}
+
+void HiZPipeline::initDescAllocator(VkDevice device)
+{
+    const auto poolRatios = std::array<DescriptorAllocatorGrowable::PoolSizeRatio, 2>{{
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f},
+    }};
+    descAllocator.init(device, 16, poolRatios);
+}
+
+void HiZPipeline::cleanup(GfxDevice& gfxDevice)
+{
+    const auto& device = gfxDevice.getDevice();
+    destroyPyramidViews(device);
+    vkDestroySampler(device, depthSampler, nullptr);
+    descAllocator.destroyPools(device);
+    vkDestroyDescriptorSetLayout(device, descSetLayout, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyPipeline(device, pipeline, nullptr);
+}
+
+void HiZPipeline::destroyPyramidViews(VkDevice device)
+{
+    for (const auto& view : mipViews) {
+        vkDestroyImageView(device, view, nullptr);
+    }
+    mipViews.clear();
+    mipDescSets.clear();
+}
+
+void HiZPipeline::setDepthImage(GfxDevice& gfxDevice, const GPUImage& depthImage)
+{
+    const auto& device = gfxDevice.getDevice();
+
+    // The old sets (and the old pyramid) can still be used by the frames in
+    // flight, so they're destroyed later. All sets are allocated again from
+    // new pools, so that the old pools can be destroyed as a whole.
+    gfxDevice.deferDestruction(
+        [device, oldAllocator = std::exchange(descAllocator, {})]() mutable {
+            oldAllocator.destroyPools(device);
+        });
+    initDescAllocator(device);
+
+    if (pyramidId != NULL_IMAGE_ID && depthImage.getSize2D() == depthImageSize) {
+        // the pyramid is kept, only level 0 reads from the new depth image
+        for (std::uint32_t i = 0; i < mipDescSets.size(); ++i) {
+            mipDescSets[i] = createMipDescSet(device, i, depthImage.imageView);
+        }
+        return;
+    }
+
+    if (pyramidId != NULL_IMAGE_ID) {
+        gfxDevice.deferDestruction([device, oldViews = std::move(mipViews)]() {
+            for (const auto& view : oldViews) {
+                vkDestroyImageView(device, view, nullptr);
+            }
+        });
+        mipViews.clear();
+        mipDescSets.clear();
+        gfxDevice.releaseImage(pyramidId);
+    }
+
+    depthImageSize = depthImage.getSize2D();
+
+    // level 0 is the biggest power of two which fits into the depth image,
+    // so that all further levels are exactly halved
+    const auto pyramidExtent = VkExtent3D{
+        .width = std::bit_floor(depthImage.extent.width),
+        .height = std::bit_floor(depthImage.extent.height),
+        .depth = 1,
+    };
+    pyramidId = gfxDevice.createImage(
+        {
+            .format = VK_FORMAT_R32_SFLOAT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            .extent = pyramidExtent,
+            .mipMap = true,
+            .memoryCategory = MemoryCategory::RenderTargets,
+        },
+        "Hi-Z pyramid");
+    const auto& pyramid = gfxDevice.getImage(pyramidId);
+
+    mipViews.resize(pyramid.mipLevels);
+    mipDescSets.resize(pyramid.mipLevels);
+    for (std::uint32_t i = 0; i < pyramid.mipLevels; ++i) {
+        const auto createInfo = VkImageViewCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = pyramid.image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = pyramid.format,
+            .subresourceRange =
+                VkImageSubresourceRange{
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .baseMipLevel = i,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+        };
+        VK_CHECK(vkCreateImageView(device, &createInfo, nullptr, &mipViews[i]));
+        vkutil::addDebugLabel(device, mipViews[i], "Hi-Z pyramid mip view");
+    }
+
+    for (std::uint32_t i = 0; i < pyramid.mipLevels; ++i) {
+        mipDescSets[i] = createMipDescSet(device, i, depthImage.imageView);
+    }
+
+    pyramidValid = false;
+}
+
+VkDescriptorSet HiZPipeline::createMipDescSet(
+    VkDevice device,
+    std::uint32_t level,
+    VkImageView depthImageView)
+{
+    const auto set = descAllocator.allocate(device, descSetLayout);
+
+    DescriptorWriter writer;
+    if (level == 0) {
+        writer.writeImage(
+            0,
+            depthImageView,
+            depthSampler,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    } else {
+        writer.writeImage(
+            0,
+            mipViews[level - 1],
+            depthSampler,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    }
+    writer.writeImage(
+        1,
+        mipViews[level],
+        VK_NULL_HANDLE,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    writer.updateSet(device, set);
+    return set;
+}
+
+void HiZPipeline::build(VkCommandBuffer cmd, const GfxDevice& gfxDevice, const glm::mat4& viewProj)
+{
+    const auto& pyramid = gfxDevice.getImage(pyramidId);
+
+    vkutil::transitionImage(
+        cmd, pyramid.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+    auto inImageSize = depthImageSize;
+    for (std::uint32_t i = 0; i < pyramid.mipLevels; ++i) {
+        const auto outImageSize = glm::max(pyramid.getSize2D() >> (int)i, glm::ivec2{1});
+
+        vkCmdBindDescriptorSets(
+            cmd,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            pipelineLayout,
+            0,
+            1,
+            &mipDescSets[i],
+            0,
+            nullptr);
+
+        const auto pcs = PushConstants{
+            .inImageSize = inImageSize,
+            .outImageSize = outImageSize,
+        };
+        vkCmdPushConstants(
+            cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pcs);
+
+        static const auto workgroupSize = 8;
+        vkCmdDispatch(
+            cmd,
+            (std::uint32_t)std::ceil(outImageSize.x / (float)workgroupSize),
+            (std::uint32_t)std::ceil(outImageSize.y / (float)workgroupSize),
+            1);
+
+        if (i + 1 < pyramid.mipLevels) { // next level reads from this one
+            const auto memoryBarrier = VkMemoryBarrier2{
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
+            };
+            const auto dependencyInfo = VkDependencyInfo{
+                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                .memoryBarrierCount = 1,
+                .pMemoryBarriers = &memoryBarrier,
+            };
+            vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+        }
+
+        inImageSize = outImageSize;
+    }
+
+    // this also gives us sync with culling which reads from the pyramid
+    vkutil::transitionImage(
+        cmd, pyramid.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    pyramidValid = true;
+    pyramidViewProj = viewProj;
+}
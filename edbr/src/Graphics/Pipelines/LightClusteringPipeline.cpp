@@ -0,0 +1,102 @@
+#include <edbr/Graphics/Pipelines/LightClusteringPipeline.h>
+
+#include <array>
+#include <cmath>
+
+#include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/Vulkan/Pipelines.h>
+#include <edbr/Graphics/Vulkan/Util.h>
+
+namespace
+{
+// keep in sync with LightCluster in light_clusters.glsl
+struct GPULightCluster {
+    std::uint32_t numLights;
+    std::array<std::uint32_t, LightClusteringPipeline::MAX_LIGHTS_PER_CLUSTER> lightIndices;
+};
+}
+
+void LightClusteringPipeline::init(GfxDevice& gfxDevice)
+{
+    const auto& device = gfxDevice.getDevice();
+
+    const auto pushConstant = VkPushConstantRange{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+
+    const auto pushConstants = std::array{pushConstant};
+    pipelineLayout = vkutil::createPipelineLayout(device, {}, pushConstants);
+
+    const auto shader = vkutil::loadShaderModule("shaders/light_cluster.comp.spv", device);
+    vkutil::addDebugLabel(device, shader, "light_cluster");
+
+    pipeline = ComputePipelineBuilder{pipelineLayout}
+                   .setShader(shader)
+                   .build(device, gfxDevice.getPipelineCache());
+    vkutil::addDebugLabel(device, pipeline, "light clustering pipeline");
+
+    vkDestroyShaderModule(device, shader, nullptr);
+
+    clustersBuffer = gfxDevice.createBuffer(
+        NUM_CLUSTERS * sizeof(GPULightCluster),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        MemoryClass::GPUOnly,
+        MemoryCategory::PerFrameBuffers);
+    vkutil::addDebugLabel(device, clustersBuffer.buffer, "light clusters");
+}
+
+void LightClusteringPipeline::cleanup(GfxDevice& gfxDevice)
+{
+    gfxDevice.destroyBuffer(clustersBuffer);
+    vkDestroyPipelineLayout(gfxDevice.getDevice(), pipelineLayout, nullptr);
+    vkDestroyPipeline(gfxDevice.getDevice(), pipeline, nullptr);
+}
+
+void LightClusteringPipeline::buildClusters(VkCommandBuffer cmd, const GPUBuffer& sceneDataBuffer)
+{
+    { // Sync reading from clusters in the previous frame with new writes
+        const auto memoryBarrier = VkMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        };
+        const auto dependencyInfo = VkDependencyInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &memoryBarrier,
+        };
+        vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+    const auto pcs = PushConstants{
+        .sceneDataBuffer = sceneDataBuffer.address,
+        .clustersBuffer = clustersBuffer.address,
+    };
+    vkCmdPushConstants(
+        cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pcs);
+
+    static const auto workgroupSize = 64;
+    vkCmdDispatch(cmd, (std::uint32_t)std::ceil(NUM_CLUSTERS / (float)workgroupSize), 1, 1);
+
+    { // Sync clusters with geometry pass
+        const auto memoryBarrier = VkMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+        };
+        const auto dependencyInfo = VkDependencyInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &memoryBarrier,
+        };
+        vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+    }
+}
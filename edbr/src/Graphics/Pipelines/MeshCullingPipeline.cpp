@@ -0,0 +1,471 @@
+#include <edbr/Graphics/Pipelines/MeshCullingPipeline.h>
+
+#include <edbr/Graphics/FrustumCulling.h>
+#include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/MeshCache.h>
+#include <edbr/Graphics/MeshDrawCommand.h>
+#include <edbr/Graphics/Pipelines/HiZPipeline.h>
+#include <edbr/Graphics/VertexPacking.h>
+#include <edbr/Graphics/Vulkan/Pipelines.h>
+#include <edbr/Graphics/Vulkan/Util.h>
+
+#include <algorithm> // min
+#include <cassert>
+#include <cstring> // memcpy
+
+#include <fmt/printf.h>
+
+void MeshCullingPipeline::init(GfxDevice& gfxDevice)
+{
+    const auto& device = gfxDevice.getDevice();
+
+    const auto pushConstant = VkPushConstantRange{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+
+    // bindless set is needed for reading from Hi-Z pyramid
+    const auto layouts = std::array{gfxDevice.getBindlessDescSetLayout()};
+    const auto pushConstants = std::array{pushConstant};
+    cullingPipelineLayout = vkutil::createPipelineLayout(device, layouts, pushConstants);
+
+    const auto shader = vkutil::loadShaderModule("shaders/mesh_cull.comp.spv", device);
+    vkutil::addDebugLabel(device, shader, "mesh_cull");
+
+    cullingPipeline = ComputePipelineBuilder{cullingPipelineLayout}
+                          .setShader(shader)
+                          .build(device, gfxDevice.getPipelineCache());
+    vkutil::addDebugLabel(device, cullingPipeline, "mesh culling pipeline");
+
+    vkDestroyShaderModule(device, shader, nullptr);
+
+    for (std::size_t i = 0; i < graphics::FRAME_OVERLAP; ++i) {
+        auto& drawDataBuffer = framesData[i].drawDataBuffer;
+        drawDataBuffer.capacity = MAX_DRAWS;
+        drawDataBuffer.buffer = gfxDevice.createBuffer(
+            MAX_DRAWS * sizeof(GPUMeshDrawData),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::Streaming,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(device, drawDataBuffer.buffer.buffer, "mesh draw data");
+
+        // written by culling shader or copied from instancesUploadBuffer when culling on CPU
+        framesData[i].instancesBuffer = gfxDevice.createBuffer(
+            MAX_DRAWS * sizeof(std::uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::GPUOnly,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(device, framesData[i].instancesBuffer.buffer, "mesh instances");
+
+        framesData[i].lateInstancesBuffer = gfxDevice.createBuffer(
+            MAX_DRAWS * sizeof(std::uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::GPUOnly,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(
+            device, framesData[i].lateInstancesBuffer.buffer, "mesh instances (late)");
+
+        framesData[i].instancesUploadBuffer = gfxDevice.createBuffer(
+            MAX_DRAWS * sizeof(std::uint32_t),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            MemoryClass::Staging,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(
+            device, framesData[i].instancesUploadBuffer.buffer, "mesh instances (upload)");
+
+        // CPU writes the commands into the upload buffer and they're copied into
+        // both commands buffers, then culling shader only increments instanceCount
+        // there can't be more batches than draws
+        auto& drawCommandsUploadBuffer = framesData[i].drawCommandsUploadBuffer;
+        drawCommandsUploadBuffer.capacity = MAX_DRAWS;
+        drawCommandsUploadBuffer.buffer = gfxDevice.createBuffer(
+            MAX_DRAWS * sizeof(VkDrawIndexedIndirectCommand),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            MemoryClass::Staging,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(
+            device, drawCommandsUploadBuffer.buffer.buffer, "mesh draw commands (upload)");
+
+        framesData[i].drawCommandsBuffer = gfxDevice.createBuffer(
+            MAX_DRAWS * sizeof(VkDrawIndexedIndirectCommand),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::GPUOnly,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(
+            device, framesData[i].drawCommandsBuffer.buffer, "mesh draw commands");
+
+        framesData[i].lateDrawCommandsBuffer = gfxDevice.createBuffer(
+            MAX_DRAWS * sizeof(VkDrawIndexedIndirectCommand),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::GPUOnly,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(
+            device, framesData[i].lateDrawCommandsBuffer.buffer, "mesh draw commands (late)");
+
+        framesData[i].cullingDataBuffer = gfxDevice.createBuffer(
+            2 * sizeof(GPUCullingData),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::Streaming,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(device, framesData[i].cullingDataBuffer.buffer, "culling data");
+
+        framesData[i].visibilityBuffer = gfxDevice.createBuffer(
+            MAX_DRAWS * sizeof(std::uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::GPUOnly,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(device, framesData[i].visibilityBuffer.buffer, "draw visibility");
+
+        framesData[i].statsBuffer = gfxDevice.createBuffer(
+            sizeof(GPUCullingStats),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::GPUOnly,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(device, framesData[i].statsBuffer.buffer, "culling stats");
+
+        framesData[i].statsReadbackBuffer = gfxDevice.createBuffer(
+            sizeof(GPUCullingStats),
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            MemoryClass::Readback,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(
+            device, framesData[i].statsReadbackBuffer.buffer, "culling stats (readback)");
+    }
+}
+
+void MeshCullingPipeline::cleanup(GfxDevice& gfxDevice)
+{
+    for (std::size_t i = 0; i < graphics::FRAME_OVERLAP; ++i) {
+        gfxDevice.destroyBuffer(framesData[i].statsReadbackBuffer);
+        gfxDevice.destroyBuffer(framesData[i].statsBuffer);
+        gfxDevice.destroyBuffer(framesData[i].visibilityBuffer);
+        gfxDevice.destroyBuffer(framesData[i].cullingDataBuffer);
+        gfxDevice.destroyBuffer(framesData[i].lateDrawCommandsBuffer);
+        gfxDevice.destroyBuffer(framesData[i].drawCommandsBuffer);
+        gfxDevice.destroyBuffer(framesData[i].drawCommandsUploadBuffer.buffer);
+        gfxDevice.destroyBuffer(framesData[i].instancesUploadBuffer);
+        gfxDevice.destroyBuffer(framesData[i].lateInstancesBuffer);
+        gfxDevice.destroyBuffer(framesData[i].instancesBuffer);
+        gfxDevice.destroyBuffer(framesData[i].drawDataBuffer.buffer);
+    }
+    vkDestroyPipelineLayout(gfxDevice.getDevice(), cullingPipelineLayout, nullptr);
+    vkDestroyPipeline(gfxDevice.getDevice(), cullingPipeline, nullptr);
+}
+
+void MeshCullingPipeline::uploadDrawData(
+    std::size_t frameIndex,
+    const MeshCache& meshCache,
+    const std::vector<MeshDrawCommand>& drawCommands,
+    const std::vector<std::size_t>& sortedDrawCommands)
+{
+    auto& frame = framesData[frameIndex];
+
+    if (frame.culledOnGPU) {
+        // the frame has finished on GPU - read back the results of its culling
+        const auto stats = (const GPUCullingStats*)frame.statsReadbackBuffer.info.pMappedData;
+        numVisibleDraws = stats->numVisibleDraws;
+        numOccludedDraws = stats->numOccludedDraws;
+        frame.culledOnGPU = false;
+    }
+
+    frame.drawDataBuffer.clear();
+    frame.drawCommandsUploadBuffer.clear();
+    drawBatches.clear();
+
+    // per-frame buffers only have room for MAX_DRAWS draws - the rest are not drawn
+    const auto numDraws = std::min(sortedDrawCommands.size(), MAX_DRAWS);
+    if (numDraws < sortedDrawCommands.size() && !drawLimitExceeded) {
+        fmt::println(
+            "[warning] {} meshes are drawn, only the first {} will be visible",
+            sortedDrawCommands.size(),
+            MAX_DRAWS);
+    }
+    drawLimitExceeded = numDraws < sortedDrawCommands.size();
+
+    auto prevMeshId = NULL_MESH_ID;
+    auto prevLod = std::uint32_t{0};
+    bool prevSkinned = false;
+    for (std::size_t i = 0; i < numDraws; ++i) {
+        const auto& dc = drawCommands[sortedDrawCommands[i]];
+        const auto& mesh = meshCache.getMesh(dc.meshId);
+
+        const auto drawIndex = (std::uint32_t)frame.drawDataBuffer.size;
+        const bool skinned = dc.skinnedMesh != nullptr;
+        // skinned meshes have their own vertex buffers, so they're not instanced
+        if (dc.meshId != prevMeshId || dc.lod != prevLod || skinned || prevSkinned) {
+            prevMeshId = dc.meshId;
+            prevLod = dc.lod;
+            drawBatches.push_back(DrawBatch{
+                .meshId = dc.meshId,
+                .lod = dc.lod,
+                .firstDraw = drawIndex,
+                .numDraws = 0,
+                .numVisibleDraws = 0,
+                .indexType = mesh.indexType,
+                .skinned = skinned,
+            });
+            const auto& lod = mesh.lods[dc.lod];
+            const auto drawCommand = VkDrawIndexedIndirectCommand{
+                .indexCount = lod.numIndices,
+                .instanceCount = 0, // incremented by culling shader
+                .firstIndex = lod.firstIndex,
+                // skinned meshes are drawn from their own vertex buffer
+                .vertexOffset = skinned ? 0 : mesh.vertexOffset,
+                .firstInstance = drawIndex,
+            };
+            frame.drawCommandsUploadBuffer.append(drawCommand);
+        }
+        prevSkinned = skinned;
+
+        auto& batch = drawBatches.back();
+        ++batch.numDraws;
+
+        // skinned vertices are in model space, so they're never quantized
+        const auto vertexFormat =
+            skinned ? graphics::getSkinnedVertexFormat(mesh.vertexFormat) : mesh.vertexFormat;
+        frame.drawDataBuffer.append(GPUMeshDrawData{
+            .transform = dc.transformMatrix,
+            .boundingSphere =
+                glm::vec4{dc.worldBoundingSphere.center, dc.worldBoundingSphere.radius},
+            .positionMin = mesh.minPos,
+            .vertexFormat = (std::uint32_t)vertexFormat,
+            .positionExtent = mesh.maxPos - mesh.minPos,
+            .materialId = (std::uint32_t)mesh.materialId,
+            .vertexBuffer = skinned ?
+                                dc.skinnedMesh->skinnedVertexBuffers[frameIndex].address :
+                                meshCache.getVertexBuffer(mesh.vertexFormat).address,
+            .batchIndex = (std::uint32_t)(drawBatches.size() - 1),
+            .batchFirstDraw = batch.firstDraw,
+        });
+    }
+}
+
+void MeshCullingPipeline::cull(
+    VkCommandBuffer cmd,
+    const GfxDevice& gfxDevice,
+    const Frustum& frustum,
+    const HiZPipeline* hiZPipeline)
+{
+    auto cullingData = GPUCullingData{};
+    for (int i = 0; i < 6; ++i) {
+        const auto& plane = frustum.getPlane(i);
+        cullingData.frustumPlanes[i] = glm::vec4{plane.normal, plane.distance};
+    }
+
+    // test against the pyramid of the previous frame
+    if (hiZPipeline && hiZPipeline->isPyramidValid()) {
+        const auto& pyramid = gfxDevice.getImage(hiZPipeline->getPyramid());
+        cullingData.viewProj = hiZPipeline->getPyramidViewProj();
+        cullingData.pyramidSize = glm::vec2{pyramid.getSize2D()};
+        cullingData.pyramidId = pyramid.getBindlessId();
+        cullingData.pyramidNumLevels = pyramid.mipLevels;
+        cullingData.occlusionCulling = 1;
+    }
+
+    auto& frame = framesData[gfxDevice.getCurrentFrameIndex()];
+    if (frame.drawDataBuffer.size == 0) {
+        numVisibleDraws = 0;
+        numOccludedDraws = 0;
+        return;
+    }
+
+    { // reset the instance counts and the stats which the culling shader increments
+        const auto copy = VkBufferCopy{
+            .srcOffset = 0,
+            .dstOffset = 0,
+            .size = frame.drawCommandsUploadBuffer.size * sizeof(VkDrawIndexedIndirectCommand),
+        };
+        vkCmdCopyBuffer(
+            cmd,
+            frame.drawCommandsUploadBuffer.getVkBuffer(),
+            frame.drawCommandsBuffer.buffer,
+            1,
+            &copy);
+        vkCmdCopyBuffer(
+            cmd,
+            frame.drawCommandsUploadBuffer.getVkBuffer(),
+            frame.lateDrawCommandsBuffer.buffer,
+            1,
+            &copy);
+        vkCmdFillBuffer(cmd, frame.statsBuffer.buffer, 0, sizeof(GPUCullingStats), 0);
+
+        const auto memoryBarrier = VkMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+                             VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        };
+        const auto dependencyInfo = VkDependencyInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &memoryBarrier,
+        };
+        vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+    }
+    frame.culledOnGPU = true;
+
+    dispatchCulling(cmd, gfxDevice, Pass::Early, cullingData);
+}
+
+void MeshCullingPipeline::cullLate(
+    VkCommandBuffer cmd,
+    const GfxDevice& gfxDevice,
+    const HiZPipeline& hiZPipeline)
+{
+    assert(hiZPipeline.isPyramidValid());
+    const auto& pyramid = gfxDevice.getImage(hiZPipeline.getPyramid());
+    const auto cullingData = GPUCullingData{
+        .viewProj = hiZPipeline.getPyramidViewProj(),
+        .pyramidSize = glm::vec2{pyramid.getSize2D()},
+        .pyramidId = pyramid.getBindlessId(),
+        .pyramidNumLevels = pyramid.mipLevels,
+        .occlusionCulling = 1,
+    };
+    dispatchCulling(cmd, gfxDevice, Pass::Late, cullingData);
+}
+
+void MeshCullingPipeline::dispatchCulling(
+    VkCommandBuffer cmd,
+    const GfxDevice& gfxDevice,
+    Pass pass,
+    const GPUCullingData& cullingData)
+{
+    const auto& frame = framesData[gfxDevice.getCurrentFrameIndex()];
+    if (frame.drawDataBuffer.size == 0) {
+        return;
+    }
+
+    const bool latePass = (pass == Pass::Late);
+
+    // the frame has finished on GPU, so the data can be written directly
+    const auto cullingDataOffset = latePass ? sizeof(GPUCullingData) : 0;
+    std::memcpy(
+        (char*)frame.cullingDataBuffer.info.pMappedData + cullingDataOffset,
+        &cullingData,
+        sizeof(GPUCullingData));
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullingPipeline);
+    gfxDevice.bindBindlessDescSet(cmd, cullingPipelineLayout, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+    const auto cs = PushConstants{
+        .cullingData = frame.cullingDataBuffer.address + cullingDataOffset,
+        .drawDataBuffer = frame.drawDataBuffer.buffer.address,
+        .instancesBuffer =
+            latePass ? frame.lateInstancesBuffer.address : frame.instancesBuffer.address,
+        .drawCommandsBuffer = latePass ? frame.lateDrawCommandsBuffer.address :
+                                         frame.drawCommandsBuffer.address,
+        .visibilityBuffer = frame.visibilityBuffer.address,
+        .statsBuffer = frame.statsBuffer.address,
+        .numDraws = (std::uint32_t)frame.drawDataBuffer.size,
+        .latePass = latePass ? 1u : 0u,
+    };
+    vkCmdPushConstants(
+        cmd, cullingPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &cs);
+
+    static const auto workgroupSize = 64;
+    const auto groupSizeX = (std::uint32_t)std::ceil(cs.numDraws / (float)workgroupSize);
+    vkCmdDispatch(cmd, groupSizeX, 1, 1);
+
+    { // sync culling with indirect draws, the late pass and the stats readback
+        const auto memoryBarrier = VkMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT |
+                            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+            .dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT |
+                             VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT,
+        };
+        const auto dependencyInfo = VkDependencyInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &memoryBarrier,
+        };
+        vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+    }
+
+    // the stats of the last pass include the ones of the previous pass
+    const auto copy = VkBufferCopy{
+        .srcOffset = 0,
+        .dstOffset = 0,
+        .size = sizeof(GPUCullingStats),
+    };
+    vkCmdCopyBuffer(cmd, frame.statsBuffer.buffer, frame.statsReadbackBuffer.buffer, 1, &copy);
+}
+
+void MeshCullingPipeline::cullOnCPU(
+    VkCommandBuffer cmd,
+    std::size_t frameIndex,
+    const VisibilityMask& visibility)
+{
+    auto& frame = framesData[frameIndex];
+    auto instances = (std::uint32_t*)frame.instancesUploadBuffer.info.pMappedData;
+
+    numVisibleDraws = 0;
+    for (std::size_t batchIdx = 0; batchIdx < drawBatches.size(); ++batchIdx) {
+        auto& batch = drawBatches[batchIdx];
+        batch.numVisibleDraws = 0;
+        for (auto drawIndex = batch.firstDraw; drawIndex < batch.firstDraw + batch.numDraws;
+             ++drawIndex) {
+            if (!visibility.isVisible(drawIndex)) {
+                continue;
+            }
+            instances[batch.firstDraw + batch.numVisibleDraws] = drawIndex;
+            ++batch.numVisibleDraws;
+        }
+        numVisibleDraws += batch.numVisibleDraws;
+    }
+
+    if (frame.drawDataBuffer.size == 0) {
+        return;
+    }
+
+    // batches are drawn with vkCmdDrawIndexed, so only the instances are needed on GPU
+    const auto copy = VkBufferCopy{
+        .srcOffset = 0,
+        .dstOffset = 0,
+        .size = frame.drawDataBuffer.size * sizeof(std::uint32_t),
+    };
+    vkCmdCopyBuffer(
+        cmd, frame.instancesUploadBuffer.buffer, frame.instancesBuffer.buffer, 1, &copy);
+
+    const auto memoryBarrier = VkMemoryBarrier2{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+        .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+    };
+    const auto dependencyInfo = VkDependencyInfo{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &memoryBarrier,
+    };
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+}
+
+const GPUBuffer& MeshCullingPipeline::getDrawDataBuffer(std::size_t frameIndex) const
+{
+    return framesData[frameIndex].drawDataBuffer.buffer;
+}
+
+const GPUBuffer& MeshCullingPipeline::getInstancesBuffer(std::size_t frameIndex, Pass pass) const
+{
+    const auto& frame = framesData[frameIndex];
+    return pass == Pass::Early ? frame.instancesBuffer : frame.lateInstancesBuffer;
+}
+
+const GPUBuffer& MeshCullingPipeline::getDrawCommandsBuffer(std::size_t frameIndex, Pass pass)
+    const
+{
+    const auto& frame = framesData[frameIndex];
+    return pass == Pass::Early ? frame.drawCommandsBuffer : frame.lateDrawCommandsBuffer;
+}
@@ -1,9 +1,8 @@
 #include <edbr/Graphics/Pipelines/MeshPipeline.h>
 
-#include <edbr/Graphics/FrustumCulling.h>
 #include <edbr/Graphics/GfxDevice.h>
 #include <edbr/Graphics/MeshCache.h>
-#include <edbr/Graphics/MeshDrawCommand.h>
+#include <edbr/Graphics/Pipelines/MeshCullingPipeline.h>
 #include <edbr/Graphics/Vulkan/Init.h>
 #include <edbr/Graphics/Vulkan/Pipelines.h>
 #include <edbr/Graphics/Vulkan/Util.h>
@@ -43,23 +42,29 @@ void MeshPipeline::init(
                    .setColorAttachmentFormat(drawImageFormat)
                    .setDepthFormat(depthImageFormat)
                    .enableDepthTest(true, VK_COMPARE_OP_GREATER_OR_EQUAL)
-                   .build(device);
+                   .build(device, gfxDevice.getPipelineCache());
     vkutil::addDebugLabel(device, pipeline, "mesh pipeline");
 
     vkDestroyShaderModule(device, vertexShader, nullptr);
     vkDestroyShaderModule(device, fragShader, nullptr);
 }
 
-void MeshPipeline::draw(
+std::uint32_t MeshPipeline::draw(
     VkCommandBuffer cmd,
     VkExtent2D renderExtent,
     const GfxDevice& gfxDevice,
     const MeshCache& meshCache,
-    const Camera& camera,
     const GPUBuffer& sceneDataBuffer,
-    const std::vector<MeshDrawCommand>& drawCommands,
-    const std::vector<std::size_t>& sortedDrawCommands)
+    const MeshCullingPipeline& meshCullingPipeline,
+    bool gpuCulling,
+    MeshCullingPipeline::Pass pass,
+    std::size_t firstBatch,
+    std::size_t numBatches) const
 {
+    if (numBatches == 0) {
+        return 0;
+    }
+
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
     gfxDevice.bindBindlessDescSet(cmd, pipelineLayout);
 
@@ -79,44 +84,70 @@ void MeshPipeline::draw(
     };
     vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-    auto prevMaterialIdx = NULL_MATERIAL_ID;
-    auto prevMeshId = NULL_MESH_ID;
-
-    const auto frustum = edge::createFrustumFromCamera(camera);
-
-    for (const auto& dcIdx : sortedDrawCommands) {
-        const auto& dc = drawCommands[dcIdx];
-        if (!edge::isInFrustum(frustum, dc.worldBoundingSphere)) {
-            continue;
+    const auto frameIndex = gfxDevice.getCurrentFrameIndex();
+    const auto pushConstants = PushConstants{
+        .sceneDataBuffer = sceneDataBuffer.address,
+        .drawDataBuffer = meshCullingPipeline.getDrawDataBuffer(frameIndex).address,
+        .instancesBuffer = meshCullingPipeline.getInstancesBuffer(frameIndex, pass).address,
+    };
+    vkCmdPushConstants(
+        cmd,
+        pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        0,
+        sizeof(PushConstants),
+        &pushConstants);
+
+    // Meshes with 16 and 32 bit indices are stored in different index buffers,
+    // so the batches are drawn in runs which use the same index type. Batches
+    // are sorted by index type (see GameRenderer::sortDrawList), so there are
+    // usually only two runs.
+    std::uint32_t numDrawCalls = 0;
+    const auto& batches = meshCullingPipeline.getDrawBatches();
+    const auto endBatch = firstBatch + numBatches;
+    for (auto runStart = firstBatch; runStart < endBatch;) {
+        const auto indexType = batches[runStart].indexType;
+        auto runEnd = runStart + 1;
+        while (runEnd < endBatch && batches[runEnd].indexType == indexType) {
+            ++runEnd;
         }
 
-        const auto& mesh = meshCache.getMesh(dc.meshId);
-        if (mesh.materialId != prevMaterialIdx) {
-            prevMaterialIdx = mesh.materialId;
+        vkCmdBindIndexBuffer(cmd, meshCache.getIndexBuffer(indexType).buffer, 0, indexType);
+
+        if (gpuCulling) {
+            // instance counts were written by MeshCullingPipeline
+            vkCmdDrawIndexedIndirect(
+                cmd,
+                meshCullingPipeline.getDrawCommandsBuffer(frameIndex, pass).buffer,
+                runStart * sizeof(VkDrawIndexedIndirectCommand),
+                (std::uint32_t)(runEnd - runStart),
+                sizeof(VkDrawIndexedIndirectCommand));
+            numDrawCalls += (std::uint32_t)(runEnd - runStart);
+            runStart = runEnd;
+            continue;
         }
 
-        if (dc.meshId != prevMeshId) {
-            prevMeshId = dc.meshId;
-            vkCmdBindIndexBuffer(cmd, mesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        // each batch is drawn with a single instanced draw
+        for (auto i = runStart; i < runEnd; ++i) {
+            const auto& batch = batches[i];
+            if (batch.numVisibleDraws == 0) {
+                continue;
+            }
+
+            const auto& mesh = meshCache.getMesh(batch.meshId);
+            const auto& lod = mesh.lods[batch.lod];
+            vkCmdDrawIndexed(
+                cmd,
+                lod.numIndices,
+                batch.numVisibleDraws,
+                lod.firstIndex,
+                batch.skinned ? 0 : mesh.vertexOffset,
+                batch.firstDraw);
+            ++numDrawCalls;
         }
-
-        const auto pushConstants = PushConstants{
-            .transform = dc.transformMatrix,
-            .sceneDataBuffer = sceneDataBuffer.address,
-            .vertexBuffer = dc.skinnedMesh ? dc.skinnedMesh->skinnedVertexBuffer.address :
-                                             mesh.vertexBuffer.address,
-            .materialId = (std::uint32_t)mesh.materialId,
-        };
-        vkCmdPushConstants(
-            cmd,
-            pipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            0,
-            sizeof(PushConstants),
-            &pushConstants);
-
-        vkCmdDrawIndexed(cmd, mesh.numIndices, 1, 0, 0, 0);
+        runStart = runEnd;
     }
+    return numDrawCalls;
 }
 
 void MeshPipeline::cleanup(VkDevice device)
@@ -34,7 +34,7 @@ void PostFXPipeline::init(GfxDevice& gfxDevice, VkFormat drawImageFormat)
                    .disableBlending()
                    .setColorAttachmentFormat(drawImageFormat)
                    .disableDepthTest()
-                   .build(device);
+                   .build(device, gfxDevice.getPipelineCache());
     vkutil::addDebugLabel(device, pipeline, "postFX pipeline");
 
     vkDestroyShaderModule(device, vertexShader, nullptr);
@@ -1,8 +1,10 @@
 #include <edbr/Graphics/Pipelines/SkinningPipeline.h>
 
+#include <edbr/Graphics/CPUMesh.h>
 #include <edbr/Graphics/GfxDevice.h>
 #include <edbr/Graphics/MeshCache.h>
 #include <edbr/Graphics/MeshDrawCommand.h>
+#include <edbr/Graphics/VertexPacking.h>
 #include <edbr/Graphics/Vulkan/Pipelines.h>
 #include <edbr/Graphics/Vulkan/Util.h>
 
@@ -22,8 +24,9 @@ void SkinningPipeline::init(GfxDevice& gfxDevice)
     const auto shader = vkutil::loadShaderModule("shaders/skinning.comp.spv", device);
     vkutil::addDebugLabel(device, shader, "skinning");
 
-    skinningPipeline =
-        ComputePipelineBuilder{skinningPipelineLayout}.setShader(shader).build(device);
+    skinningPipeline = ComputePipelineBuilder{skinningPipelineLayout}
+                           .setShader(shader)
+                           .build(device, gfxDevice.getPipelineCache());
 
     vkDestroyShaderModule(device, shader, nullptr);
 
@@ -32,7 +35,18 @@ void SkinningPipeline::init(GfxDevice& gfxDevice)
         jointMatricesBuffer.capacity = MAX_JOINT_MATRICES;
         jointMatricesBuffer.buffer = gfxDevice.createBuffer(
             MAX_JOINT_MATRICES * sizeof(glm::mat4),
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::Streaming,
+            MemoryCategory::PerFrameBuffers);
+
+        auto& jobsBuffer = framesData[i].jobsBuffer;
+        jobsBuffer.capacity = MAX_SKINNING_JOBS;
+        jobsBuffer.buffer = gfxDevice.createBuffer(
+            MAX_SKINNING_JOBS * sizeof(GPUSkinningJob),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::Streaming,
+            MemoryCategory::PerFrameBuffers);
+        vkutil::addDebugLabel(device, jobsBuffer.buffer.buffer, "skinning jobs");
     }
 }
 
@@ -40,6 +54,7 @@ void SkinningPipeline::cleanup(GfxDevice& gfxDevice)
 {
     for (std::size_t i = 0; i < graphics::FRAME_OVERLAP; ++i) {
         gfxDevice.destroyBuffer(framesData[i].jointMatricesBuffer.buffer);
+        gfxDevice.destroyBuffer(framesData[i].jobsBuffer.buffer);
     }
     vkDestroyPipelineLayout(gfxDevice.getDevice(), skinningPipelineLayout, nullptr);
     vkDestroyPipeline(gfxDevice.getDevice(), skinningPipeline, nullptr);
@@ -47,7 +62,10 @@ void SkinningPipeline::cleanup(GfxDevice& gfxDevice)
 
 void SkinningPipeline::beginDrawing(std::size_t frameIndex)
 {
-    getCurrentFrameData(frameIndex).jointMatricesBuffer.clear();
+    auto& frame = getCurrentFrameData(frameIndex);
+    frame.jointMatricesBuffer.clear();
+    frame.jobsBuffer.clear();
+    frame.numThreads = 0;
 }
 
 SkinningPipeline::PerFrameData& SkinningPipeline::getCurrentFrameData(std::size_t frameIndex)
@@ -65,30 +83,61 @@ std::size_t SkinningPipeline::appendJointMatrices(
     return startIndex;
 }
 
-void SkinningPipeline::doSkinning(
-    VkCommandBuffer cmd,
+void SkinningPipeline::addJob(
     std::size_t frameIndex,
     const MeshCache& meshCache,
     const MeshDrawCommand& dc)
 {
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, skinningPipeline);
-
     const auto& mesh = meshCache.getMesh(dc.meshId);
     assert(mesh.hasSkeleton);
     assert(dc.skinnedMesh);
 
-    const auto cs = PushConstants{
-        .jointMatricesBuffer = getCurrentFrameData(frameIndex).jointMatricesBuffer.buffer.address,
+    auto& frame = getCurrentFrameData(frameIndex);
+    frame.jobsBuffer.append(GPUSkinningJob{
+        .positionMin = mesh.minPos,
+        .inputVertexFormat = (std::uint32_t)mesh.vertexFormat,
+        .positionExtent = mesh.maxPos - mesh.minPos,
         .jointMatricesStartIndex = dc.jointMatricesStartIndex,
+        .inputBuffer = meshCache.getVertexBuffer(mesh.vertexFormat).address +
+                       mesh.vertices.offset * graphics::getVertexSize(mesh.vertexFormat),
+        .skinningData = meshCache.getSkinningDataBuffer().address +
+                        mesh.skinningData.offset * sizeof(CPUMesh::SkinningData),
+        .outputBuffer = dc.skinnedMesh->skinnedVertexBuffers[frameIndex].address,
         .numVertices = mesh.numVertices,
-        .inputBuffer = mesh.vertexBuffer.address,
-        .skinningData = mesh.skinningDataBuffer.address,
-        .outputBuffer = dc.skinnedMesh->skinnedVertexBuffer.address,
+        .firstThread = frame.numThreads,
+    });
+    frame.numThreads += mesh.numVertices;
+}
+
+bool SkinningPipeline::hasJobs(std::size_t frameIndex) const
+{
+    return framesData[frameIndex].jobsBuffer.size != 0;
+}
+
+std::size_t SkinningPipeline::getNumJobs(std::size_t frameIndex) const
+{
+    return framesData[frameIndex].jobsBuffer.size;
+}
+
+void SkinningPipeline::doSkinning(VkCommandBuffer cmd, std::size_t frameIndex)
+{
+    const auto& frame = getCurrentFrameData(frameIndex);
+    if (frame.numThreads == 0) {
+        return;
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, skinningPipeline);
+
+    const auto cs = PushConstants{
+        .jointMatricesBuffer = frame.jointMatricesBuffer.buffer.address,
+        .jobsBuffer = frame.jobsBuffer.buffer.address,
+        .numJobs = (std::uint32_t)frame.jobsBuffer.size,
+        .numThreads = frame.numThreads,
     };
     vkCmdPushConstants(
         cmd, skinningPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &cs);
 
     static const auto workgroupSize = 256;
-    const auto groupSizeX = (std::uint32_t)std::ceil(mesh.numVertices / (float)workgroupSize);
+    const auto groupSizeX = (std::uint32_t)std::ceil(frame.numThreads / (float)workgroupSize);
     vkCmdDispatch(cmd, groupSizeX, 1, 1);
 }
@@ -41,7 +41,7 @@ void SkyboxPipeline::init(
                    .setDepthFormat(depthImageFormat)
                    // only draw to fragments with depth == 0.0 only
                    .enableDepthTest(false, VK_COMPARE_OP_EQUAL)
-                   .build(device);
+                   .build(device, gfxDevice.getPipelineCache());
     vkutil::addDebugLabel(device, pipeline, "skybox pipeline");
 
     vkDestroyShaderModule(device, vertexShader, nullptr);
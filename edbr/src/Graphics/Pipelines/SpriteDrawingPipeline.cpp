@@ -39,7 +39,7 @@ void SpriteDrawingPipeline::init(
                    .enableBlending()
                    .setColorAttachmentFormat(drawImageFormat)
                    .disableDepthTest()
-                   .build(device);
+                   .build(device, gfxDevice.getPipelineCache());
     vkutil::addDebugLabel(device, pipeline, "UI pipeline");
 
     vkDestroyShaderModule(device, vertexShader, nullptr);
@@ -49,7 +49,9 @@ void SpriteDrawingPipeline::init(
         auto& buffer = framesData[i].spriteDrawCommandBuffer;
         buffer = gfxDevice.createBuffer(
             maxSprites * sizeof(SpriteDrawCommand),
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            MemoryClass::Streaming,
+            MemoryCategory::PerFrameBuffers);
         vkutil::addDebugLabel(gfxDevice.getDevice(), buffer.buffer, "sprite draw commands");
     }
 }
@@ -0,0 +1,613 @@
+#include <edbr/Graphics/RenderGraph.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include <fmt/printf.h>
+
+#include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/Vulkan/Init.h>
+
+namespace
+{
+struct UsageInfo {
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout; // ignored for buffers
+    bool isWrite;
+};
+
+UsageInfo getUsageInfo(RenderGraph::Usage usage)
+{
+    switch (usage) {
+    case RenderGraph::Usage::ColorAttachmentWrite:
+        return {
+            .stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+                      VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            .isWrite = true,
+        };
+    case RenderGraph::Usage::DepthAttachmentWrite:
+        return {
+            .stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                      VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            .access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                      VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+            .isWrite = true,
+        };
+    case RenderGraph::Usage::DepthResolveWrite:
+        // multisample resolves (including depth) are done in the color attachment output stage
+        return {
+            .stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+            .isWrite = true,
+        };
+    case RenderGraph::Usage::VertexShaderRead:
+        return {
+            .stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+            .access = VK_ACCESS_2_SHADER_READ_BIT,
+            .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .isWrite = false,
+        };
+    case RenderGraph::Usage::FragmentShaderRead:
+        return {
+            .stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+            .access = VK_ACCESS_2_SHADER_READ_BIT,
+            .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .isWrite = false,
+        };
+    case RenderGraph::Usage::ComputeShaderRead:
+        return {
+            .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .access = VK_ACCESS_2_SHADER_READ_BIT,
+            .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .isWrite = false,
+        };
+    case RenderGraph::Usage::ComputeShaderWrite:
+        return {
+            .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .access = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+            .layout = VK_IMAGE_LAYOUT_GENERAL,
+            .isWrite = true,
+        };
+    case RenderGraph::Usage::TransferRead:
+        return {
+            .stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .access = VK_ACCESS_2_TRANSFER_READ_BIT,
+            .layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .isWrite = false,
+        };
+    case RenderGraph::Usage::TransferWrite:
+        return {
+            .stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .access = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .isWrite = true,
+        };
+    default:
+        assert(false);
+        return {};
+    }
+}
+
+// only writes need to be made available, so reads are never put into srcAccessMask
+constexpr VkAccessFlags2 WRITE_ACCESS_MASK =
+    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+bool isSameImage(const vkutil::CreateImageInfo& a, const vkutil::CreateImageInfo& b)
+{
+    return a.format == b.format && a.usage == b.usage && a.flags == b.flags &&
+           a.extent.width == b.extent.width && a.extent.height == b.extent.height &&
+           a.extent.depth == b.extent.depth && a.numLayers == b.numLayers &&
+           a.samples == b.samples && a.mipMap == b.mipMap && a.mipLevels == b.mipLevels;
+}
+
+// Transient attachments (e.g. MSAA images which are only resolved) can be
+// placed in lazily allocated memory, which other images can't use
+bool isTransientAttachment(const vkutil::CreateImageInfo& createInfo)
+{
+    return (createInfo.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+}
+
+static constexpr auto NO_RESOURCE = std::numeric_limits<RenderGraph::ResourceId>::max();
+
+} // end of anonymous namespace
+
+RenderGraph::RenderGraph(GfxDevice& gfxDevice) : gfxDevice(gfxDevice)
+{}
+
+RenderGraph::ResourceId RenderGraph::createImage(
+    const std::string& name,
+    const vkutil::CreateImageInfo& createInfo)
+{
+    assert(!compiled);
+    auto resource = Resource{
+        .name = name,
+        .type = ResourceType::TransientImage,
+        .createInfo = createInfo,
+        .preserveContents = false,
+    };
+    resource.createInfo.memoryCategory = MemoryCategory::RenderTargets;
+    resources.push_back(std::move(resource));
+    return (ResourceId)(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::importImage(
+    const std::string& name,
+    ImageId id,
+    bool preserveContents)
+{
+    assert(!compiled);
+    assert(id != NULL_IMAGE_ID);
+    resources.push_back(Resource{
+        .name = name,
+        .type = ResourceType::ImportedImage,
+        .imageId = id,
+        .preserveContents = preserveContents,
+    });
+    return (ResourceId)(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::importBuffer(const std::string& name)
+{
+    assert(!compiled);
+    resources.push_back(Resource{
+        .name = name,
+        .type = ResourceType::Buffer,
+    });
+    return (ResourceId)(resources.size() - 1);
+}
+
+void RenderGraph::markOutput(ResourceId id)
+{
+    assert(!compiled);
+    resources.at(id).isOutput = true;
+}
+
+void RenderGraph::addPass(
+    std::string name,
+    std::vector<Access> accesses,
+    std::function<void(VkCommandBuffer cmd)> execute)
+{
+    assert(!compiled);
+    for (const auto& access : accesses) {
+        assert(access.resource < resources.size());
+        // a pass can't use one resource in two ways (e.g. in two layouts)
+        assert(std::ranges::count_if(accesses, [&access](const Access& other) {
+                   return other.resource == access.resource;
+               }) == 1);
+    }
+    passes.push_back(Pass{
+        .name = std::move(name),
+        .accesses = std::move(accesses),
+        .execute = std::move(execute),
+    });
+}
+
+void RenderGraph::compile()
+{
+    assert(!compiled);
+    cullPasses();
+    calculateLifetimes();
+    allocateTransientImages();
+    compiled = true;
+}
+
+ImageId RenderGraph::getImageId(ResourceId id) const
+{
+    assert(compiled);
+    const auto& resource = resources.at(id);
+    assert(resource.type != ResourceType::Buffer);
+    assert(resource.type == ResourceType::ImportedImage || resource.used);
+    return resource.imageId;
+}
+
+const GPUImage& RenderGraph::getImage(ResourceId id) const
+{
+    return gfxDevice.getImage(getImageId(id));
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd)
+{
+    assert(compiled);
+    applyPendingResourceStates();
+    initResourceStates();
+
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    for (const auto& pass : passes) {
+        if (pass.culled) {
+            continue;
+        }
+
+        imageBarriers.clear();
+        auto memoryBarrier = VkMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        };
+        addBarriers(pass, imageBarriers, memoryBarrier);
+
+        vkutil::cmdBeginLabel(cmd, pass.name.c_str());
+        const bool hasMemoryBarrier = memoryBarrier.srcStageMask != VK_PIPELINE_STAGE_2_NONE;
+        if (hasMemoryBarrier || !imageBarriers.empty()) {
+            const auto dependencyInfo = VkDependencyInfo{
+                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                .memoryBarrierCount = hasMemoryBarrier ? 1u : 0u,
+                .pMemoryBarriers = &memoryBarrier,
+                .imageMemoryBarrierCount = (std::uint32_t)imageBarriers.size(),
+                .pImageMemoryBarriers = imageBarriers.data(),
+            };
+            vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+        }
+        pass.execute(cmd);
+        vkutil::cmdEndLabel(cmd);
+    }
+
+    saveResourceStates();
+
+    resources.clear();
+    passes.clear();
+    compiled = false;
+}
+
+void RenderGraph::cleanup()
+{
+    releaseTransientImages();
+    importedImageLayouts.clear();
+    bufferStates.clear();
+    pendingImageLayouts.clear();
+    pendingBufferStates.clear();
+    hasPendingStates = false;
+}
+
+void RenderGraph::cullPasses()
+{
+    // imported resources and outputs are read after the graph
+    std::vector<bool> needed(resources.size());
+    for (std::size_t i = 0; i < resources.size(); ++i) {
+        needed[i] = resources[i].type != ResourceType::TransientImage || resources[i].isOutput;
+    }
+
+    // resources are only read by the passes after the ones which write them
+    numCulledPasses = 0;
+    for (auto i = passes.size(); i-- > 0;) {
+        auto& pass = passes[i];
+        bool hasWrites = false;
+        bool hasNeededWrites = false;
+        for (const auto& access : pass.accesses) {
+            if (getUsageInfo(access.usage).isWrite) {
+                hasWrites = true;
+                hasNeededWrites |= needed[access.resource];
+            }
+        }
+
+        pass.culled = hasWrites && !hasNeededWrites;
+        if (pass.culled) {
+            ++numCulledPasses;
+            continue;
+        }
+        for (const auto& access : pass.accesses) {
+            if (!getUsageInfo(access.usage).isWrite) {
+                needed[access.resource] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::calculateLifetimes()
+{
+    for (std::size_t i = 0; i < passes.size(); ++i) {
+        if (passes[i].culled) {
+            continue;
+        }
+        for (const auto& access : passes[i].accesses) {
+            auto& resource = resources[access.resource];
+            if (!resource.used) {
+                resource.used = true;
+                resource.firstPass = i;
+            }
+            resource.lastPass = i;
+        }
+    }
+
+    for (auto& resource : resources) {
+        if (resource.isOutput) {
+            resource.lastPass = passes.size(); // alive until the end of the frame
+        }
+    }
+}
+
+std::vector<std::size_t> RenderGraph::assignMemoryBlocks(
+    std::vector<BlockRequirements>& blockRequirements) const
+{
+    std::vector<ResourceId> images;
+    for (ResourceId id = 0; id < resources.size(); ++id) {
+        if (resources[id].type == ResourceType::TransientImage && resources[id].used) {
+            images.push_back(id);
+        }
+    }
+    std::ranges::stable_sort(images, [this](ResourceId a, ResourceId b) {
+        return resources[a].firstPass < resources[b].firstPass;
+    });
+
+    // Greedily put each image into the first block which isn't used by other
+    // images during the image's lifetime
+    std::vector<std::size_t> blockLastPasses;
+    std::vector<std::size_t> imageBlocks(resources.size());
+    for (const auto id : images) {
+        const auto& resource = resources[id];
+        const auto requirements = gfxDevice.getImageMemoryRequirements(resource.createInfo);
+        const auto lazilyAllocated = isTransientAttachment(resource.createInfo);
+
+        std::size_t block = 0;
+        for (; block < blockRequirements.size(); ++block) {
+            const auto& blockReqs = blockRequirements[block];
+            if (blockLastPasses[block] < resource.firstPass &&
+                blockReqs.lazilyAllocated == lazilyAllocated &&
+                (blockReqs.memory.memoryTypeBits & requirements.memoryTypeBits) != 0) {
+                break;
+            }
+        }
+        if (block == blockRequirements.size()) {
+            blockRequirements.push_back(BlockRequirements{
+                .memory = requirements,
+                .lazilyAllocated = lazilyAllocated,
+            });
+            blockLastPasses.push_back(resource.lastPass);
+        } else {
+            auto& blockReqs = blockRequirements[block].memory;
+            blockReqs.size = std::max(blockReqs.size, requirements.size);
+            blockReqs.alignment = std::max(blockReqs.alignment, requirements.alignment);
+            blockReqs.memoryTypeBits &= requirements.memoryTypeBits;
+            blockLastPasses[block] = resource.lastPass;
+        }
+        imageBlocks[id] = block;
+    }
+    return imageBlocks;
+}
+
+void RenderGraph::allocateTransientImages()
+{
+    std::vector<BlockRequirements> blockRequirements;
+    const auto imageBlocks = assignMemoryBlocks(blockRequirements);
+
+    // the images of the previous frames are reused if nothing has changed
+    bool canReuse = true;
+    std::size_t numImages = 0;
+    for (ResourceId id = 0; id < resources.size(); ++id) {
+        const auto& resource = resources[id];
+        if (resource.type != ResourceType::TransientImage || !resource.used) {
+            continue;
+        }
+        if (numImages >= transientImages.size()) {
+            canReuse = false;
+            break;
+        }
+        const auto& image = transientImages[numImages];
+        canReuse &= image.name == resource.name &&
+                    isSameImage(image.createInfo, resource.createInfo) &&
+                    image.memoryBlock == imageBlocks[id];
+        ++numImages;
+    }
+    canReuse &= numImages == transientImages.size();
+
+    if (!canReuse) {
+        releaseTransientImages();
+
+        VkDeviceSize totalSize = 0;
+        for (const auto& requirements : blockRequirements) {
+            memoryBlocks.push_back(gfxDevice.allocateImageMemory(
+                requirements.memory,
+                MemoryCategory::RenderTargets,
+                requirements.lazilyAllocated));
+            totalSize += requirements.memory.size;
+        }
+        for (ResourceId id = 0; id < resources.size(); ++id) {
+            const auto& resource = resources[id];
+            if (resource.type != ResourceType::TransientImage || !resource.used) {
+                continue;
+            }
+            const auto block = imageBlocks[id];
+            transientImages.push_back(TransientImage{
+                .name = resource.name,
+                .createInfo = resource.createInfo,
+                .memoryBlock = block,
+                .id = gfxDevice.createAliasedImage(
+                    resource.createInfo, memoryBlocks[block], resource.name.c_str()),
+            });
+        }
+        fmt::println(
+            "Render graph: allocated {} transient images in {} memory blocks ({:.1f} MB)",
+            transientImages.size(),
+            memoryBlocks.size(),
+            (float)totalSize / (1024.f * 1024.f));
+    }
+
+    std::size_t imageIndex = 0;
+    for (auto& resource : resources) {
+        if (resource.type == ResourceType::TransientImage && resource.used) {
+            const auto& image = transientImages[imageIndex++];
+            resource.imageId = image.id;
+            resource.memoryBlock = image.memoryBlock;
+        }
+    }
+}
+
+void RenderGraph::releaseTransientImages()
+{
+    // the frames in flight can still use the images, so they're released with
+    // a delay and the memory is freed after they're destroyed
+    for (const auto& image : transientImages) {
+        gfxDevice.releaseImage(image.id);
+    }
+    for (const auto memory : memoryBlocks) {
+        gfxDevice.deferDestruction([&gfxDevice = gfxDevice, memory]() {
+            gfxDevice.freeImageMemory(memory, MemoryCategory::RenderTargets);
+        });
+    }
+    transientImages.clear();
+    memoryBlocks.clear();
+}
+
+void RenderGraph::initResourceStates()
+{
+    for (auto& resource : resources) {
+        switch (resource.type) {
+        case ResourceType::TransientImage:
+        case ResourceType::ImportedImage: {
+            // images can be used before the graph (by the previous frame or
+            // outside of the graph), so their first use waits for everything
+            resource.state = ResourceState{
+                .layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .writeStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                .writeAccess = VK_ACCESS_2_MEMORY_WRITE_BIT,
+            };
+            if (resource.preserveContents) {
+                if (const auto it = importedImageLayouts.find(resource.imageId);
+                    it != importedImageLayouts.end()) {
+                    resource.state.layout = it->second;
+                }
+            }
+            break;
+        }
+        case ResourceType::Buffer:
+            if (const auto it = bufferStates.find(resource.name); it != bufferStates.end()) {
+                resource.state = it->second;
+            } else {
+                resource.state = {};
+            }
+            break;
+        }
+    }
+    blockOccupants.assign(memoryBlocks.size(), NO_RESOURCE);
+}
+
+void RenderGraph::addBarriers(
+    const Pass& pass,
+    std::vector<VkImageMemoryBarrier2>& imageBarriers,
+    VkMemoryBarrier2& memoryBarrier)
+{
+    for (const auto& access : pass.accesses) {
+        auto& resource = resources[access.resource];
+        auto& state = resource.state;
+
+        if (resource.type == ResourceType::TransientImage &&
+            blockOccupants[resource.memoryBlock] != access.resource) {
+            // first use of the image: the previous image in its memory must be done with it
+            const auto prevId = blockOccupants[resource.memoryBlock];
+            if (prevId != NO_RESOURCE) {
+                const auto& prevState = resources[prevId].state;
+                state.writeStages = prevState.writeStages | prevState.readStages;
+                state.writeAccess = prevState.writeAccess;
+            }
+            blockOccupants[resource.memoryBlock] = access.resource;
+        }
+
+        const auto usage = getUsageInfo(access.usage);
+        const bool isImage = resource.type != ResourceType::Buffer;
+        const bool needsTransition = isImage && state.layout != usage.layout;
+        const auto oldLayout = state.layout;
+
+        VkPipelineStageFlags2 srcStages{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 srcAccess{VK_ACCESS_2_NONE};
+        if (usage.isWrite || needsTransition) {
+            // wait for the previous writes and reads
+            srcStages = state.writeStages | state.readStages;
+            srcAccess = state.writeAccess;
+            if (usage.isWrite) {
+                state = ResourceState{
+                    .layout = usage.layout,
+                    .writeStages = usage.stages,
+                    .writeAccess = usage.access & WRITE_ACCESS_MASK,
+                };
+            } else {
+                // reads in other stages need to wait for the layout transition
+                state = ResourceState{
+                    .layout = usage.layout,
+                    .writeStages = usage.stages,
+                    .readStages = usage.stages,
+                    .readAccess = usage.access,
+                };
+            }
+        } else {
+            const bool alreadyVisible = (state.readStages & usage.stages) == usage.stages &&
+                                        (state.readAccess & usage.access) == usage.access;
+            if (!alreadyVisible) {
+                srcStages = state.writeStages;
+                srcAccess = state.writeAccess;
+            }
+            state.readStages |= usage.stages;
+            state.readAccess |= usage.access;
+        }
+
+        if (srcStages == VK_PIPELINE_STAGE_2_NONE && !needsTransition) {
+            continue; // nothing to wait for
+        }
+
+        if (!isImage) {
+            memoryBarrier.srcStageMask |= srcStages;
+            memoryBarrier.srcAccessMask |= srcAccess;
+            memoryBarrier.dstStageMask |= usage.stages;
+            memoryBarrier.dstAccessMask |= usage.access;
+            continue;
+        }
+
+        const auto& image = gfxDevice.getImage(resource.imageId);
+        const auto aspect = vkutil::getImageAspect(image.format);
+        imageBarriers.push_back(VkImageMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = srcStages,
+            .srcAccessMask = srcAccess,
+            .dstStageMask = usage.stages,
+            .dstAccessMask = usage.access,
+            .oldLayout = oldLayout,
+            .newLayout = usage.layout,
+            .image = image.image,
+            .subresourceRange = vkinit::imageSubresourceRange(aspect),
+        });
+    }
+}
+
+void RenderGraph::saveResourceStates()
+{
+    // the recorded commands only change the states if the frame gets submitted,
+    // which is checked by the next execute (see applyPendingResourceStates)
+    pendingImageLayouts.clear();
+    pendingBufferStates.clear();
+    for (const auto& resource : resources) {
+        if (!resource.used) {
+            continue;
+        }
+        if (resource.type == ResourceType::ImportedImage) {
+            pendingImageLayouts[resource.imageId] = resource.state.layout;
+        } else if (resource.type == ResourceType::Buffer) {
+            pendingBufferStates[resource.name] = resource.state;
+        }
+    }
+    pendingFrameNumber = gfxDevice.getFrameNumber();
+    hasPendingStates = true;
+}
+
+void RenderGraph::applyPendingResourceStates()
+{
+    if (!hasPendingStates) {
+        return;
+    }
+    hasPendingStates = false;
+
+    // GfxDevice::endFrame only advances the frame number after a submit - if
+    // the frame was skipped (e.g. no swapchain image), its commands never ran
+    // and the resources are still in the states saved before it
+    if (gfxDevice.getFrameNumber() == pendingFrameNumber) {
+        return;
+    }
+    for (const auto& [imageId, layout] : pendingImageLayouts) {
+        importedImageLayouts[imageId] = layout;
+    }
+    for (const auto& [name, state] : pendingBufferStates) {
+        bufferStates[name] = state;
+    }
+}
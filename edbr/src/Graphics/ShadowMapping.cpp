@@ -2,16 +2,15 @@
 
 #include <array>
 #include <cmath>
+#include <limits>
 
 #include <edbr/Graphics/Camera.h>
+#include <edbr/Graphics/FrustumCulling.h>
 #include <edbr/Math/GlobalAxes.h>
 
 #include <glm/gtc/quaternion.hpp>
 
-Camera calculateCSMCamera(
-    const std::array<glm::vec3, 8>& frustumCorners,
-    const glm::vec3& lightDir,
-    float shadowMapSize)
+math::Sphere calculateCSMBounds(const std::array<glm::vec3, 8>& frustumCorners)
 {
     // Refer to https://alextardif.com/shadowmapping.html and
     // https://github.com/wessles/vkmerc/blob/master/base/util/CascadedShadowmap.hpp
@@ -49,9 +48,27 @@ Camera calculateCSMCamera(
     // center of AABB
     auto center = glm::mix(glm::vec3{minX, minY, minZ}, glm::vec3{maxX, maxY, maxZ}, 0.5);
 
+    return math::Sphere{
+        .center = center,
+        .radius = radius,
+    };
+}
+
+Camera calculateCSMCamera(
+    const std::array<glm::vec3, 8>& frustumCorners,
+    const glm::vec3& lightDir,
+    float shadowMapSize)
+{
+    return calculateCSMCamera(calculateCSMBounds(frustumCorners), lightDir, shadowMapSize);
+}
+
+Camera calculateCSMCamera(const math::Sphere& bounds, const glm::vec3& lightDir, float shadowMapSize)
+{
+    const auto radius = bounds.radius;
+
     // go to light space and snap to texels
     const auto view = glm::lookAt({}, lightDir, math::GlobalUpAxis);
-    auto frustumCenter = glm::vec3{view * glm::vec4{center, 1.f}};
+    auto frustumCenter = glm::vec3{view * glm::vec4{bounds.center, 1.f}};
     // round to texel for stabilization
     float texelsPerUnit = (radius * 2.f) / shadowMapSize;
     frustumCenter.x -= std::fmod(frustumCenter.x, texelsPerUnit);
@@ -69,3 +86,25 @@ Camera calculateCSMCamera(
 
     return camera;
 }
+
+Frustum createCSMCasterCullingFrustum(const Camera& csmCamera, const glm::vec3& lightDir)
+{
+    auto frustum = edge::createFrustumFromCamera(csmCamera);
+
+    // find the plane which faces the light: its normal (which points inside
+    // the frustum) is the closest to the light direction
+    int lightPlaneIdx = 0;
+    float maxDot = std::numeric_limits<float>::lowest();
+    for (int i = 0; i < 6; ++i) {
+        const auto d = glm::dot(frustum.getPlane(i).normal, lightDir);
+        if (d > maxDot) {
+            maxDot = d;
+            lightPlaneIdx = i;
+        }
+    }
+
+    // dot(n, c) - d > -r is now true for every sphere
+    frustum.getPlane(lightPlaneIdx).distance = std::numeric_limits<float>::lowest();
+
+    return frustum;
+}
@@ -56,3 +56,8 @@ const SkeletalAnimationCache::AnimationsMap& SkeletalAnimationCache::getAnimatio
 {
     return animations.at(gltfPath.string());
 }
+
+void SkeletalAnimationCache::removeAnimations(const std::filesystem::path& gltfPath)
+{
+    animations.erase(gltfPath.string());
+}
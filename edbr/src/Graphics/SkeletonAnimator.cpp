@@ -3,6 +3,7 @@
 #include <edbr/Graphics/SkeletalAnimation.h>
 #include <edbr/Graphics/Skeleton.h>
 
+#include <atomic>
 #include <tuple>
 
 #include <glm/gtx/compatibility.hpp> // lerp for vec3
@@ -11,6 +12,7 @@ namespace
 {
 static const int ANIMATION_FPS = 30;
 static const glm::mat4 I{1.f};
+std::atomic<std::uint64_t> lastPoseVersion{0};
 }
 
 void SkeletonAnimator::setAnimation(const Skeleton& skeleton, const SkeletalAnimation& animation)
@@ -122,6 +124,7 @@ void SkeletonAnimator::calculateJointMatrices(const Skeleton& skeleton)
 {
     static const glm::mat4 I{1.f};
     calculateJointMatrix(skeleton, ROOT_JOINT_ID, *animation, time, I);
+    poseVersion = ++lastPoseVersion;
 }
 
 void SkeletonAnimator::calculateJointMatrix(
@@ -0,0 +1,346 @@
+#include <edbr/Graphics/TextureStreamer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+#include <fmt/printf.h>
+
+#include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/ImageCache.h>
+#include <edbr/Graphics/Vulkan/Util.h>
+
+using namespace std::chrono_literals;
+
+TextureStreamer::TextureStreamer(GfxDevice& gfxDevice, ImageCache& imageCache) :
+    gfxDevice(gfxDevice), imageCache(imageCache)
+{}
+
+void TextureStreamer::addImage(
+    ImageId id,
+    const std::filesystem::path& cookedPath,
+    const CompressedImageData& data,
+    VkImageUsageFlags usage)
+{
+    auto image = StreamedImage{
+        .cookedPath = cookedPath,
+        .usage = usage,
+        .format = data.format,
+        .width = data.width,
+        .height = data.height,
+        .numMips = data.numMips,
+        .minResidentMip = data.firstMip,
+        .residentMip = data.firstMip,
+        .residentSize = 0,
+        .wantedMip = data.firstMip,
+    };
+    for (const auto& mip : data.mips) {
+        image.residentSize += mip.size();
+    }
+
+    residentSize += image.residentSize;
+    if (const auto it = images.find(id); it != images.end()) {
+        residentSize -= it->second.residentSize;
+    }
+    images.insert_or_assign(id, std::move(image));
+}
+
+void TextureStreamer::removeImage(ImageId id)
+{
+    const auto it = images.find(id);
+    if (it == images.end()) {
+        return;
+    }
+    residentSize -= it->second.residentSize;
+    images.erase(it);
+
+    const auto loadIt =
+        std::find_if(pendingLoads.begin(), pendingLoads.end(), [id](const PendingLoad& load) {
+            return load.id == id;
+        });
+    if (loadIt != pendingLoads.end()) {
+        discardedLoads.push_back(std::move(loadIt->data));
+        pendingLoads.erase(loadIt);
+    }
+
+    const auto swapIt =
+        std::find_if(pendingSwaps.begin(), pendingSwaps.end(), [id](const PendingSwap& swap) {
+            return swap.id == id;
+        });
+    if (swapIt != pendingSwaps.end()) {
+        // the new image might still be uploaded
+        gfxDevice.deferDestruction(
+            [this, image = std::move(swapIt->image)]() { gfxDevice.destroyImage(image); });
+        pendingSwaps.erase(swapIt);
+    }
+}
+
+void TextureStreamer::requestResolution(ImageId id, float screenSize)
+{
+    const auto it = images.find(id);
+    if (it == images.end()) {
+        return; // not a cooked image
+    }
+
+    auto& image = it->second;
+    const auto frame = gfxDevice.getFrameNumber();
+    if (image.lastRequestFrame != frame) {
+        image.lastRequestFrame = frame;
+        image.requestedScreenSize = screenSize;
+    } else {
+        image.requestedScreenSize = std::max(image.requestedScreenSize, screenSize);
+    }
+}
+
+void TextureStreamer::update()
+{
+    frameUploadSize = 0;
+
+    std::erase_if(discardedLoads, [](const auto& data) {
+        return data.wait_for(0s) == std::future_status::ready;
+    });
+    finishLoads();
+
+    std::vector<ImageId> streamInIds;
+    for (auto& [id, image] : images) {
+        image.wantedMip = calculateWantedMip(image);
+        if (image.wantedMip < image.residentMip && !image.pendingSwap &&
+            !image.streamingFailed) {
+            streamInIds.push_back(id);
+        }
+    }
+
+    // the biggest images on the screen are streamed in first
+    std::sort(streamInIds.begin(), streamInIds.end(), [this](ImageId a, ImageId b) {
+        return images.at(a).requestedScreenSize > images.at(b).requestedScreenSize;
+    });
+    for (const auto id : streamInIds) {
+        if (frameUploadSize >= maxUploadSizePerFrame) {
+            break;
+        }
+        auto& image = images.at(id);
+        if (image.pendingSwap) {
+            continue; // mips were dropped by makeRoom
+        }
+        // if the wanted mip doesn't fit, load as many mips as possible
+        for (auto mip = image.wantedMip; mip < image.residentMip; ++mip) {
+            const auto extraSize = getSizeWithMips(image, mip) - image.residentSize;
+            if (residentSize + extraSize <= budget ||
+                makeRoom(extraSize, id, image.requestedScreenSize)) {
+                setResidentMip(id, image, mip);
+                break;
+            }
+        }
+    }
+
+    swapImages();
+}
+
+void TextureStreamer::cleanup()
+{
+    if (!pendingSwaps.empty()) {
+        // the images might still be used by the pending uploads
+        gfxDevice.getUploadQueue().flush();
+    }
+    for (const auto& swap : pendingSwaps) {
+        gfxDevice.destroyImage(swap.image);
+    }
+    pendingSwaps.clear();
+    // waits for the loads which are still running
+    pendingLoads.clear();
+    discardedLoads.clear();
+    images.clear();
+    residentSize = 0;
+}
+
+std::uint32_t TextureStreamer::calculateWantedMip(const StreamedImage& image) const
+{
+    // requests are done during the previous frame (update() is called
+    // before the renderer draws anything)
+    const auto isVisible = image.lastRequestFrame + 1 >= gfxDevice.getFrameNumber();
+    if (!isVisible) {
+        return image.minResidentMip;
+    }
+    if (std::isinf(image.requestedScreenSize)) {
+        return 0;
+    }
+
+    const auto neededSize = image.requestedScreenSize * texelsPerPixel;
+    if (neededSize <= 0.f) {
+        return image.minResidentMip;
+    }
+    const auto mip = std::floor(std::log2((float)std::max(image.width, image.height) / neededSize));
+    return (std::uint32_t)std::clamp(mip, 0.f, (float)image.minResidentMip);
+}
+
+std::size_t TextureStreamer::getSizeWithMips(const StreamedImage& image, std::uint32_t firstMip)
+    const
+{
+    std::size_t size = 0;
+    for (auto level = firstMip; level < image.numMips; ++level) {
+        size += util::getCompressedMipSize(
+            image.format, std::max(image.width >> level, 1u), std::max(image.height >> level, 1u));
+    }
+    return size;
+}
+
+bool TextureStreamer::makeRoom(std::size_t size, ImageId requestedId, float requestedScreenSize)
+{
+    const auto fits = [this, size] { return residentSize + size <= budget; };
+
+    // first drop the mips which are not needed anymore, least recently used first
+    std::vector<ImageId> ids;
+    for (const auto& [id, image] : images) {
+        if (id != requestedId && !image.pendingSwap && image.residentMip < image.wantedMip) {
+            ids.push_back(id);
+        }
+    }
+    std::sort(ids.begin(), ids.end(), [this](ImageId a, ImageId b) {
+        return images.at(a).lastRequestFrame < images.at(b).lastRequestFrame;
+    });
+    for (const auto id : ids) {
+        if (fits()) {
+            return true;
+        }
+        auto& image = images.at(id);
+        setResidentMip(id, image, image.wantedMip);
+    }
+
+    // then drop one mip of the images which are smaller on the screen than the
+    // requested one - they'll get it back when there's room again
+    ids.clear();
+    for (const auto& [id, image] : images) {
+        if (id != requestedId && !image.pendingSwap && image.residentMip < image.minResidentMip &&
+            image.requestedScreenSize < requestedScreenSize) {
+            ids.push_back(id);
+        }
+    }
+    std::sort(ids.begin(), ids.end(), [this](ImageId a, ImageId b) {
+        return images.at(a).requestedScreenSize < images.at(b).requestedScreenSize;
+    });
+    for (const auto id : ids) {
+        if (fits()) {
+            return true;
+        }
+        auto& image = images.at(id);
+        setResidentMip(id, image, image.residentMip + 1);
+    }
+
+    return fits();
+}
+
+void TextureStreamer::setResidentMip(ImageId id, StreamedImage& image, std::uint32_t firstMip)
+{
+    assert(!image.pendingSwap);
+    const auto newSize = getSizeWithMips(image, firstMip);
+
+    if (firstMip > image.residentMip) {
+        // the remaining mips are already on GPU, so the file is not read again
+        const auto& currentImage = imageCache.getImage(id);
+        auto newImage = gfxDevice.createImageRaw({
+            .format = image.format,
+            .usage = image.usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .extent =
+                VkExtent3D{
+                    .width = std::max(image.width >> firstMip, 1u),
+                    .height = std::max(image.height >> firstMip, 1u),
+                    .depth = 1,
+                },
+            .mipLevels = image.numMips - firstMip,
+        });
+        gfxDevice.getUploadQueue().copyImageMips(
+            currentImage, firstMip - image.residentMip, newImage);
+        newImage.debugName = currentImage.debugName;
+        vkutil::addDebugLabel(gfxDevice.getDevice(), newImage.image, newImage.debugName.c_str());
+        addPendingSwap(id, std::move(newImage));
+    } else {
+        const auto maxSize = std::max(image.width, image.height) >> firstMip;
+        pendingLoads.push_back(PendingLoad{
+            .id = id,
+            .firstMip = firstMip,
+            .prevResidentMip = image.residentMip,
+            .prevResidentSize = image.residentSize,
+            .data = std::async(
+                std::launch::async,
+                [path = image.cookedPath, maxSize]() {
+                    return util::loadKTX2Image(path, maxSize);
+                }),
+        });
+        frameUploadSize += newSize;
+    }
+
+    residentSize = residentSize - image.residentSize + newSize;
+    image.residentMip = firstMip;
+    image.residentSize = newSize;
+    image.pendingSwap = true;
+}
+
+void TextureStreamer::finishLoads()
+{
+    for (auto it = pendingLoads.begin(); it != pendingLoads.end();) {
+        if (it->data.wait_for(0s) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+
+        const auto data = it->data.get();
+        auto& image = images.at(it->id);
+        if (!data || data->format != image.format || data->width != image.width ||
+            data->height != image.height || data->numMips != image.numMips ||
+            data->firstMip != it->firstMip) {
+            fmt::println(
+                "[error] failed to stream mips of '{}' - the file was changed or removed",
+                image.cookedPath.string());
+            residentSize = residentSize - image.residentSize + it->prevResidentSize;
+            image.residentMip = it->prevResidentMip;
+            image.residentSize = it->prevResidentSize;
+            image.pendingSwap = false;
+            image.streamingFailed = true;
+        } else {
+            const auto& debugName = imageCache.getImage(it->id).debugName;
+            addPendingSwap(
+                it->id, gfxDevice.createCompressedImageRaw(*data, image.usage, debugName));
+        }
+        it = pendingLoads.erase(it);
+    }
+}
+
+void TextureStreamer::addPendingSwap(ImageId id, GPUImage image)
+{
+    pendingSwaps.push_back(PendingSwap{
+        .id = id,
+        .image = std::move(image),
+        // the upload was recorded into the batch which is not submitted yet
+        .uploadBatchId = gfxDevice.getUploadQueue().getCurrentBatchId(),
+    });
+}
+
+void TextureStreamer::swapImages()
+{
+    const auto frame = gfxDevice.getFrameNumber();
+    if (pendingSwaps.empty() || frame < lastSwapFrame + swapInterval) {
+        return;
+    }
+
+    const auto& uploadQueue = gfxDevice.getUploadQueue();
+    const auto readyEnd =
+        std::partition(pendingSwaps.begin(), pendingSwaps.end(), [&](const PendingSwap& swap) {
+            return uploadQueue.isBatchFinished(swap.uploadBatchId);
+        });
+    if (readyEnd == pendingSwaps.begin()) {
+        return;
+    }
+
+    // the old images (and their descriptors) can still be used by the frames in
+    // flight - after this, nothing uses them and they can be destroyed right away
+    gfxDevice.waitForFramesInFlight();
+    for (auto it = pendingSwaps.begin(); it != readyEnd; ++it) {
+        const auto oldImage = imageCache.replaceImage(it->id, std::move(it->image));
+        gfxDevice.destroyImage(oldImage);
+        images.at(it->id).pendingSwap = false;
+    }
+    pendingSwaps.erase(pendingSwaps.begin(), readyEnd);
+    lastSwapFrame = frame;
+}
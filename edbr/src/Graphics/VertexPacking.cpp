@@ -0,0 +1,142 @@
+#include <edbr/Graphics/VertexPacking.h>
+
+#include <algorithm> // max
+#include <bit> // bit_cast
+#include <cassert>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+#include <glm/packing.hpp>
+
+namespace
+{
+// bit 16 is the lowest bit of the second snorm16 component
+constexpr std::uint32_t TANGENT_SIGN_BIT = 1u << 16;
+
+float signNotZero(float v)
+{
+    return v >= 0.f ? 1.f : -1.f;
+}
+}
+
+namespace graphics
+{
+std::size_t getVertexSize(VertexFormat format)
+{
+    switch (format) {
+    case VertexFormat::Full:
+        return sizeof(CPUMesh::Vertex);
+    case VertexFormat::Packed:
+    case VertexFormat::PackedQuantized:
+        return sizeof(PackedVertex);
+    }
+    assert(false);
+    return 0;
+}
+
+VertexFormat getSkinnedVertexFormat(VertexFormat format)
+{
+    return format == VertexFormat::Full ? VertexFormat::Full : VertexFormat::Packed;
+}
+
+VertexFormat choosePackedVertexFormat(const glm::vec3& minPos, const glm::vec3& maxPos)
+{
+    const auto size = maxPos - minPos;
+    const auto maxSize = std::max({size.x, size.y, size.z});
+    if (maxSize / 65535.f <= MAX_POSITION_QUANTIZATION_STEP) {
+        return VertexFormat::PackedQuantized;
+    }
+    return VertexFormat::Packed;
+}
+
+glm::vec2 octEncode(const glm::vec3& n)
+{
+    const auto l1Norm = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1Norm == 0.f) { // missing normal/tangent
+        return glm::vec2{0.f};
+    }
+    auto e = glm::vec2{n.x, n.y} / l1Norm;
+    if (n.z < 0.f) { // fold the lower hemisphere over the diagonals
+        e = glm::vec2{
+            (1.f - std::abs(e.y)) * signNotZero(e.x),
+            (1.f - std::abs(e.x)) * signNotZero(e.y),
+        };
+    }
+    return e;
+}
+
+glm::vec3 octDecode(const glm::vec2& e)
+{
+    auto n = glm::vec3{e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y)};
+    const auto t = std::max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return glm::normalize(n);
+}
+
+PackedVertex packVertex(
+    const CPUMesh::Vertex& v,
+    VertexFormat format,
+    const glm::vec3& minPos,
+    const glm::vec3& maxPos)
+{
+    assert(format != VertexFormat::Full);
+
+    PackedVertex pv{};
+    if (format == VertexFormat::PackedQuantized) {
+        const auto size = maxPos - minPos;
+        auto q = glm::vec3{0.f};
+        for (int i = 0; i < 3; ++i) {
+            if (size[i] > 0.f) {
+                q[i] = (v.position[i] - minPos[i]) / size[i];
+            }
+        }
+        pv.position[0] = glm::packUnorm2x16(glm::vec2{q.x, q.y});
+        pv.position[1] = glm::packUnorm2x16(glm::vec2{q.z, 0.f});
+    } else {
+        pv.position[0] = std::bit_cast<std::uint32_t>(v.position.x);
+        pv.position[1] = std::bit_cast<std::uint32_t>(v.position.y);
+        pv.position[2] = std::bit_cast<std::uint32_t>(v.position.z);
+    }
+
+    pv.normal = glm::packSnorm2x16(octEncode(v.normal));
+    pv.tangent = glm::packSnorm2x16(octEncode(glm::vec3{v.tangent}));
+    if (v.tangent.w < 0.f) {
+        pv.tangent |= TANGENT_SIGN_BIT;
+    } else {
+        pv.tangent &= ~TANGENT_SIGN_BIT;
+    }
+    pv.uv = glm::packHalf2x16(glm::vec2{v.uv_x, v.uv_y});
+    return pv;
+}
+
+CPUMesh::Vertex unpackVertex(
+    const PackedVertex& pv,
+    VertexFormat format,
+    const glm::vec3& minPos,
+    const glm::vec3& maxPos)
+{
+    assert(format != VertexFormat::Full);
+
+    CPUMesh::Vertex v{};
+    if (format == VertexFormat::PackedQuantized) {
+        const auto xy = glm::unpackUnorm2x16(pv.position[0]);
+        const auto z = glm::unpackUnorm2x16(pv.position[1]).x;
+        v.position = minPos + glm::vec3{xy.x, xy.y, z} * (maxPos - minPos);
+    } else {
+        v.position = glm::vec3{
+            std::bit_cast<float>(pv.position[0]),
+            std::bit_cast<float>(pv.position[1]),
+            std::bit_cast<float>(pv.position[2]),
+        };
+    }
+
+    v.normal = octDecode(glm::unpackSnorm2x16(pv.normal));
+    const auto tangentSign = (pv.tangent & TANGENT_SIGN_BIT) ? -1.f : 1.f;
+    v.tangent = glm::vec4{octDecode(glm::unpackSnorm2x16(pv.tangent)), tangentSign};
+    const auto uv = glm::unpackHalf2x16(pv.uv);
+    v.uv_x = uv.x;
+    v.uv_y = uv.y;
+    return v;
+}
+}
@@ -0,0 +1,113 @@
+#include <edbr/Graphics/Vulkan/GPUMemoryStats.h>
+
+#include <cassert>
+
+#include <nlohmann/json.hpp>
+
+const char* getMemoryCategoryName(MemoryCategory category)
+{
+    switch (category) {
+    case MemoryCategory::Meshes:
+        return "meshes";
+    case MemoryCategory::SkinnedMeshes:
+        return "skinned meshes";
+    case MemoryCategory::Textures:
+        return "textures";
+    case MemoryCategory::RenderTargets:
+        return "render targets";
+    case MemoryCategory::ShadowMaps:
+        return "shadow maps";
+    case MemoryCategory::PerFrameBuffers:
+        return "per-frame buffers";
+    case MemoryCategory::Staging:
+        return "staging";
+    case MemoryCategory::Other:
+        return "other";
+    default:
+        assert(false);
+        return "";
+    }
+}
+
+void GPUMemoryStats::onAllocate(MemoryCategory category, std::size_t size)
+{
+    auto& stats = categories[(std::size_t)category];
+    stats.size += size;
+    ++stats.count;
+}
+
+void GPUMemoryStats::onFree(MemoryCategory category, std::size_t size)
+{
+    auto& stats = categories[(std::size_t)category];
+    assert(stats.size >= size && stats.count > 0);
+    stats.size -= size;
+    --stats.count;
+}
+
+void GPUMemoryStats::updateHeapStats(VmaAllocator allocator)
+{
+    const VkPhysicalDeviceMemoryProperties* memoryProps{nullptr};
+    vmaGetMemoryProperties(allocator, &memoryProps);
+
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+    vmaGetHeapBudgets(allocator, budgets.data());
+
+    heaps.resize(memoryProps->memoryHeapCount);
+    for (std::uint32_t i = 0; i < memoryProps->memoryHeapCount; ++i) {
+        const auto& budget = budgets[i];
+        heaps[i] = HeapStats{
+            .flags = memoryProps->memoryHeaps[i].flags,
+            .size = memoryProps->memoryHeaps[i].size,
+            .budget = budget.budget,
+            .usage = budget.usage,
+            .blockBytes = budget.statistics.blockBytes,
+            .allocationBytes = budget.statistics.allocationBytes,
+        };
+    }
+}
+
+GPUMemoryStats::CategoryStats GPUMemoryStats::getCategoryStats(MemoryCategory category) const
+{
+    const auto& stats = categories[(std::size_t)category];
+    return {.size = stats.size, .count = stats.count};
+}
+
+std::size_t GPUMemoryStats::getTotalSize() const
+{
+    std::size_t size = 0;
+    for (const auto& stats : categories) {
+        size += stats.size;
+    }
+    return size;
+}
+
+std::string GPUMemoryStats::toJson() const
+{
+    auto categoriesJson = nlohmann::json::object();
+    for (std::size_t i = 0; i < categories.size(); ++i) {
+        const auto stats = getCategoryStats((MemoryCategory)i);
+        categoriesJson[getMemoryCategoryName((MemoryCategory)i)] = {
+            {"size", stats.size},
+            {"count", stats.count},
+        };
+    }
+
+    auto heapsJson = nlohmann::json::array();
+    for (const auto& heap : heaps) {
+        heapsJson.push_back({
+            {"deviceLocal", (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0},
+            {"size", heap.size},
+            {"budget", heap.budget},
+            {"usage", heap.usage},
+            {"blockBytes", heap.blockBytes},
+            {"allocationBytes", heap.allocationBytes},
+        });
+    }
+
+    const auto json = nlohmann::json{
+        {"totalSize", getTotalSize()},
+        {"categories", std::move(categoriesJson)},
+        {"heaps", std::move(heapsJson)},
+    };
+    return json.dump(4);
+}
@@ -78,7 +78,7 @@ void PipelineBuilder::clear()
     renderInfo = {.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
 }
 
-VkPipeline PipelineBuilder::build(VkDevice device)
+VkPipeline PipelineBuilder::build(VkDevice device, VkPipelineCache cache)
 {
     const auto viewportState = VkPipelineViewportStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
@@ -127,7 +127,7 @@ VkPipeline PipelineBuilder::build(VkDevice device)
 
     VkPipeline pipeline;
     const auto res =
-        vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+        vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
     if (res != VK_SUCCESS) {
         std::cout << "Failed to create pipeline\n";
         return VK_NULL_HANDLE;
@@ -342,7 +342,7 @@ ComputePipelineBuilder& ComputePipelineBuilder::setShader(VkShaderModule shaderM
     return *this;
 }
 
-VkPipeline ComputePipelineBuilder::build(VkDevice device)
+VkPipeline ComputePipelineBuilder::build(VkDevice device, VkPipelineCache cache)
 {
     const auto pipelineCreateInfo = VkComputePipelineCreateInfo{
         .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
@@ -357,7 +357,6 @@ VkPipeline ComputePipelineBuilder::build(VkDevice device)
     };
 
     VkPipeline pipeline;
-    VK_CHECK(
-        vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, 0, &pipeline));
+    VK_CHECK(vkCreateComputePipelines(device, cache, 1, &pipelineCreateInfo, 0, &pipeline));
     return pipeline;
 }
@@ -136,6 +136,16 @@ void Swapchain::resetFences(VkDevice device, std::size_t frameIndex) const
     VK_CHECK(vkResetFences(device, 1, &frame.renderFence));
 }
 
+void Swapchain::waitForAllFrames(VkDevice device) const
+{
+    std::array<VkFence, graphics::FRAME_OVERLAP> fences;
+    for (std::size_t i = 0; i < graphics::FRAME_OVERLAP; ++i) {
+        fences[i] = frames[i].renderFence;
+    }
+    VK_CHECK(
+        vkWaitForFences(device, (std::uint32_t)fences.size(), fences.data(), true, NO_TIMEOUT));
+}
+
 std::pair<VkImage, std::uint32_t> Swapchain::acquireImage(VkDevice device, std::size_t frameIndex)
 {
     std::uint32_t swapchainImageIndex{};
@@ -160,7 +170,8 @@ void Swapchain::submitAndPresent(
     VkCommandBuffer cmd,
     VkQueue graphicsQueue,
     std::size_t frameIndex,
-    std::uint32_t swapchainImageIndex)
+    std::uint32_t swapchainImageIndex,
+    std::span<const VkSemaphoreSubmitInfo> extraWaitInfos)
 {
     const auto& frame = frames[frameIndex];
 
@@ -169,12 +180,16 @@ void Swapchain::submitAndPresent(
             .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
             .commandBuffer = cmd,
         };
-        const auto waitInfo = vkinit::semaphoreSubmitInfo(
-            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, frame.swapchainSemaphore);
+        std::vector<VkSemaphoreSubmitInfo> waitInfos;
+        waitInfos.reserve(1 + extraWaitInfos.size());
+        waitInfos.push_back(vkinit::semaphoreSubmitInfo(
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, frame.swapchainSemaphore));
+        waitInfos.insert(waitInfos.end(), extraWaitInfos.begin(), extraWaitInfos.end());
         const auto signalInfo = vkinit::
             semaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, frame.renderSemaphore);
 
-        const auto submit = vkinit::submitInfo(&submitInfo, &waitInfo, &signalInfo);
+        auto submit = vkinit::submitInfo(&submitInfo, waitInfos.data(), &signalInfo);
+        submit.waitSemaphoreInfoCount = (std::uint32_t)waitInfos.size();
         VK_CHECK(vkQueueSubmit2(graphicsQueue, 1, &submit, frame.renderFence));
     }
 
@@ -226,7 +226,8 @@ RenderInfo createRenderingInfo(const RenderingInfoParams& params)
             .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
             .loadOp = params.colorImageClearValue ? VK_ATTACHMENT_LOAD_OP_CLEAR :
                                                     VK_ATTACHMENT_LOAD_OP_LOAD,
-            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .storeOp = params.discardColorImage ? VK_ATTACHMENT_STORE_OP_DONT_CARE :
+                                                  VK_ATTACHMENT_STORE_OP_STORE,
         };
         if (params.colorImageClearValue) {
             const auto col = params.colorImageClearValue.value();
@@ -241,7 +242,8 @@ RenderInfo createRenderingInfo(const RenderingInfoParams& params)
             .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
             .loadOp = params.depthImageClearValue ? VK_ATTACHMENT_LOAD_OP_CLEAR :
                                                     VK_ATTACHMENT_LOAD_OP_LOAD,
-            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .storeOp = params.discardDepthImage ? VK_ATTACHMENT_STORE_OP_DONT_CARE :
+                                                  VK_ATTACHMENT_STORE_OP_STORE,
         };
         if (params.depthImageClearValue) {
             ri.depthAttachment.clearValue.depthStencil.depth = params.depthImageClearValue.value();
@@ -254,6 +256,12 @@ RenderInfo createRenderingInfo(const RenderingInfoParams& params)
         ri.colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
     }
 
+    if (params.depthResolveImageView) {
+        ri.depthAttachment.resolveImageView = params.depthResolveImageView;
+        ri.depthAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+        ri.depthAttachment.resolveMode = params.depthResolveMode;
+    }
+
     ri.renderingInfo = VkRenderingInfo{
         .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
         .renderArea =
@@ -284,6 +292,22 @@ void clearColorImage(
     vkCmdEndRendering(cmd);
 }
 
+VkImageAspectFlags getImageAspect(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
 int sampleCountToInt(VkSampleCountFlagBits count)
 {
     switch (count) {
@@ -98,7 +98,7 @@ void VulkanImGuiBackend::init(GfxDevice& gfxDevice, VkFormat swapchainFormat)
                        VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA)
                    .setColorAttachmentFormat(swapchainFormat)
                    .disableDepthTest()
-                   .build(device);
+                   .build(device, gfxDevice.getPipelineCache());
     vkutil::addDebugLabel(device, pipeline, "ImGui pipeline");
 
     vkDestroyShaderModule(device, vertexShader, nullptr);
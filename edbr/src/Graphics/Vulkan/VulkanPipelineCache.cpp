@@ -0,0 +1,138 @@
+#include <edbr/Graphics/Vulkan/VulkanPipelineCache.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring> // memcmp
+#include <fstream>
+#include <vector>
+
+#include <volk.h>
+
+#include <fmt/printf.h>
+
+#include <edbr/Graphics/Vulkan/Util.h>
+
+namespace
+{
+static constexpr std::uint32_t PIPELINE_CACHE_MAGIC = 0x48435045; // "EPCH"
+// should be incremented when Header changes
+static constexpr std::uint32_t PIPELINE_CACHE_VERSION = 1;
+
+struct Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t vendorID;
+    std::uint32_t deviceID;
+    std::uint32_t driverVersion;
+    std::array<std::uint8_t, VK_UUID_SIZE> pipelineCacheUUID;
+    std::uint32_t padding{0}; // headers are compared with memcmp
+    std::uint64_t dataSize;
+};
+static_assert(sizeof(Header) == 48);
+
+Header makeHeader(const VkPhysicalDeviceProperties& props, std::size_t dataSize)
+{
+    auto header = Header{
+        .magic = PIPELINE_CACHE_MAGIC,
+        .version = PIPELINE_CACHE_VERSION,
+        .vendorID = props.vendorID,
+        .deviceID = props.deviceID,
+        .driverVersion = props.driverVersion,
+        .pipelineCacheUUID = {},
+        .dataSize = dataSize,
+    };
+    std::copy(
+        std::begin(props.pipelineCacheUUID),
+        std::end(props.pipelineCacheUUID),
+        header.pipelineCacheUUID.begin());
+    return header;
+}
+
+// returns an empty vector if the file doesn't exist or was written for another device/driver
+std::vector<std::uint8_t> loadCacheData(
+    const std::filesystem::path& path,
+    const VkPhysicalDeviceProperties& props)
+{
+    std::error_code ec;
+    const auto fileSize = std::filesystem::file_size(path, ec);
+    std::ifstream file(path, std::ios::binary);
+    if (ec || !file.good() || fileSize < sizeof(Header)) {
+        return {};
+    }
+
+    Header header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+    const auto expected = makeHeader(props, fileSize - sizeof(Header));
+    if (!file.good() || std::memcmp(&header, &expected, sizeof(Header)) != 0) {
+        fmt::println("Pipeline cache '{}' is outdated, discarding it", path.string());
+        return {};
+    }
+
+    std::vector<std::uint8_t> data(header.dataSize);
+    file.read(reinterpret_cast<char*>(data.data()), (std::streamsize)data.size());
+    if (!file.good()) {
+        fmt::println("[error] failed to read pipeline cache from '{}'", path.string());
+        return {};
+    }
+    return data;
+}
+
+} // end of anonymous namespace
+
+void VulkanPipelineCache::init(
+    VkDevice device,
+    const VkPhysicalDeviceProperties& deviceProps,
+    const std::filesystem::path& path)
+{
+    assert(cache == VK_NULL_HANDLE);
+    this->device = device;
+    this->deviceProps = deviceProps;
+    this->path = path;
+
+    const auto data = loadCacheData(path, deviceProps);
+    const auto createInfo = VkPipelineCacheCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.data(),
+    };
+    VK_CHECK(vkCreatePipelineCache(device, &createInfo, nullptr, &cache));
+    loadedDataSize = data.size();
+}
+
+void VulkanPipelineCache::save() const
+{
+    std::size_t dataSize{0};
+    VK_CHECK(vkGetPipelineCacheData(device, cache, &dataSize, nullptr));
+    std::vector<std::uint8_t> data(dataSize);
+    VK_CHECK(vkGetPipelineCacheData(device, cache, &dataSize, data.data()));
+    data.resize(dataSize);
+
+    // write to a temporary file first, so that a crash while writing doesn't
+    // leave a corrupted cache
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        const auto header = makeHeader(deviceProps, data.size());
+        std::ofstream file(tempPath, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+        if (!file.good()) {
+            fmt::println("[error] failed to write pipeline cache to '{}'", tempPath.string());
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        fmt::println("[error] failed to write pipeline cache to '{}'", path.string());
+    }
+}
+
+void VulkanPipelineCache::cleanup()
+{
+    vkDestroyPipelineCache(device, cache, nullptr);
+    cache = VK_NULL_HANDLE;
+}
@@ -0,0 +1,506 @@
+#include <edbr/Graphics/Vulkan/VulkanUploadQueue.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring> // memcpy
+#include <limits>
+
+#include <volk.h>
+
+#include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/MipMapGeneration.h>
+#include <edbr/Graphics/Vulkan/GPUImage.h>
+#include <edbr/Graphics/Vulkan/Init.h>
+#include <edbr/Graphics/Vulkan/Util.h>
+
+namespace
+{
+static constexpr auto NO_TIMEOUT = std::numeric_limits<std::uint64_t>::max();
+// enough for any texel block and vertex/index data
+static constexpr std::size_t STAGING_ALIGNMENT = 16;
+
+std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void transitionImageLayer(
+    VkCommandBuffer cmd,
+    const GPUImage& image,
+    std::uint32_t layer,
+    VkImageLayout currentLayout,
+    VkImageLayout newLayout)
+{
+    auto range = vkinit::imageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+    range.baseArrayLayer = layer;
+    range.layerCount = 1;
+    const auto imageBarrier = VkImageMemoryBarrier2{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT,
+        .oldLayout = currentLayout,
+        .newLayout = newLayout,
+        .image = image.image,
+        .subresourceRange = range,
+    };
+    const auto depInfo = VkDependencyInfo{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &imageBarrier,
+    };
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+}
+
+void VulkanUploadQueue::init(
+    GfxDevice& gfxDevice,
+    const QueueInfo& graphicsQueue,
+    const QueueInfo& transferQueue,
+    std::size_t stagingBufferSize)
+{
+    this->gfxDevice = &gfxDevice;
+    device = gfxDevice.getDevice();
+
+    lanes[GRAPHICS_LANE].queueInfo = graphicsQueue;
+    lanes[TRANSFER_LANE].queueInfo = transferQueue;
+    hasTransferQueue = transferQueue.queue != VK_NULL_HANDLE;
+
+    for (auto& lane : lanes) {
+        if (lane.queueInfo.queue == VK_NULL_HANDLE) {
+            continue;
+        }
+        const auto poolCreateInfo = vkinit::commandPoolCreateInfo(
+            VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, lane.queueInfo.family);
+        VK_CHECK(vkCreateCommandPool(device, &poolCreateInfo, nullptr, &lane.commandPool));
+    }
+
+    const auto semaphoreTypeInfo = VkSemaphoreTypeCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    const auto semaphoreInfo = VkSemaphoreCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &semaphoreTypeInfo,
+    };
+    VK_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore));
+
+    this->stagingBufferSize = stagingBufferSize;
+    stagingBuffer = gfxDevice.createBuffer(
+        stagingBufferSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        MemoryClass::Staging,
+        MemoryCategory::Staging);
+    vkutil::addDebugLabel(device, stagingBuffer.buffer, "upload staging buffer");
+}
+
+void VulkanUploadQueue::cleanup()
+{
+    flush();
+    collectFinishedBatches();
+    assert(batches.empty());
+
+    for (auto& lane : lanes) {
+        if (lane.commandPool != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(device, lane.commandPool, nullptr);
+        }
+    }
+    vkDestroySemaphore(device, semaphore, nullptr);
+    gfxDevice->destroyBuffer(stagingBuffer);
+}
+
+void VulkanUploadQueue::uploadBuffer(
+    VkBuffer dst,
+    std::size_t dstOffset,
+    std::span<const std::byte> data)
+{
+    if (data.empty()) {
+        return;
+    }
+
+    // staging can submit the current batch, so it's done before getting the command buffer
+    const auto [srcBuffer, srcOffset] = stage(data);
+    const auto cmd = getCommandBuffer(hasTransferQueue ? TRANSFER_LANE : GRAPHICS_LANE);
+
+    const auto copy = VkBufferCopy{
+        .srcOffset = srcOffset,
+        .dstOffset = dstOffset,
+        .size = data.size(),
+    };
+    vkCmdCopyBuffer(cmd, srcBuffer, dst, 1, &copy);
+}
+
+void VulkanUploadQueue::uploadImage(
+    const GPUImage& image,
+    std::span<const std::byte> data,
+    std::uint32_t layer)
+{
+    assert(
+        (image.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0 &&
+        "Image needs to have VK_IMAGE_USAGE_TRANSFER_DST_BIT to upload data to it");
+
+    const auto [srcBuffer, srcOffset] = stage(data);
+    const auto cmd = getCommandBuffer(GRAPHICS_LANE);
+
+    // only the uploaded layer is transitioned, so that previously uploaded
+    // layers of the same image are not discarded
+    transitionImageLayer(
+        cmd, image, layer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    const auto copyRegion = VkBufferImageCopy{
+        .bufferOffset = srcOffset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = layer,
+                .layerCount = 1,
+            },
+        .imageExtent = image.extent,
+    };
+    vkCmdCopyBufferToImage(
+        cmd, srcBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+    if (image.mipLevels > 1) {
+        assert(
+            (image.usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0 &&
+            "Image needs to have VK_IMAGE_USAGE_TRANSFER_{DST,SRC}_BIT to generate mip maps");
+        graphics::generateMipmaps(
+            cmd,
+            image.image,
+            VkExtent2D{image.extent.width, image.extent.height},
+            image.mipLevels);
+    } else {
+        transitionImageLayer(
+            cmd,
+            image,
+            layer,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+}
+
+void VulkanUploadQueue::uploadImageMips(
+    const GPUImage& image,
+    std::span<const std::vector<std::uint8_t>> mips)
+{
+    assert(
+        (image.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0 &&
+        "Image needs to have VK_IMAGE_USAGE_TRANSFER_DST_BIT to upload data to it");
+    assert(mips.size() == image.mipLevels);
+
+    // all mips are staged at once: staging can submit the current batch
+    // (if the ring is full), which must not happen between the copies
+    std::size_t totalSize = 0;
+    for (const auto& mip : mips) {
+        totalSize += mip.size();
+    }
+    const auto staging = allocateStagingMemory(totalSize);
+
+    const auto cmd = getCommandBuffer(GRAPHICS_LANE);
+    transitionImageLayer(
+        cmd, image, 0, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    // mip sizes are multiples of the texel block size, so all offsets are aligned
+    std::size_t offset = 0;
+    for (std::uint32_t mipLevel = 0; mipLevel < mips.size(); ++mipLevel) {
+        const auto& mip = mips[mipLevel];
+        std::memcpy(staging.data + offset, mip.data(), mip.size());
+
+        const auto copyRegion = VkBufferImageCopy{
+            .bufferOffset = staging.offset + offset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource =
+                {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = mipLevel,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+            .imageExtent =
+                {
+                    .width = std::max(image.extent.width >> mipLevel, 1u),
+                    .height = std::max(image.extent.height >> mipLevel, 1u),
+                    .depth = 1,
+                },
+        };
+        vkCmdCopyBufferToImage(
+            cmd, staging.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+        offset += mip.size();
+    }
+
+    transitionImageLayer(
+        cmd,
+        image,
+        0,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void VulkanUploadQueue::copyImageMips(
+    const GPUImage& src,
+    std::uint32_t srcFirstMip,
+    const GPUImage& dst)
+{
+    assert(
+        (src.usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0 &&
+        (dst.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0);
+    assert(src.format == dst.format && srcFirstMip + dst.mipLevels <= src.mipLevels);
+
+    // the graphics queue runs the copy after the frames which were submitted
+    // before it, so they can still sample src
+    const auto cmd = getCommandBuffer(GRAPHICS_LANE);
+    transitionImageLayer(
+        cmd,
+        src,
+        0,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    transitionImageLayer(
+        cmd, dst, 0, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    std::vector<VkImageCopy> regions(dst.mipLevels);
+    for (std::uint32_t mipLevel = 0; mipLevel < dst.mipLevels; ++mipLevel) {
+        regions[mipLevel] = VkImageCopy{
+            .srcSubresource =
+                {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = srcFirstMip + mipLevel,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+            .dstSubresource =
+                {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = mipLevel,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+            .extent =
+                {
+                    .width = std::max(dst.extent.width >> mipLevel, 1u),
+                    .height = std::max(dst.extent.height >> mipLevel, 1u),
+                    .depth = 1,
+                },
+        };
+    }
+    vkCmdCopyImage(
+        cmd,
+        src.image,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        dst.image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        (std::uint32_t)regions.size(),
+        regions.data());
+
+    transitionImageLayer(
+        cmd,
+        src,
+        0,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    transitionImageLayer(
+        cmd,
+        dst,
+        0,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+bool VulkanUploadQueue::hasPendingUploads() const
+{
+    for (const auto& lane : lanes) {
+        if (lane.cmd != VK_NULL_HANDLE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint64_t VulkanUploadQueue::submit()
+{
+    if (!hasPendingUploads()) {
+        return lastSubmittedValue;
+    }
+
+    auto batch = Batch{
+        .stagingEnd = stagingHead,
+        .commandBuffers = {VK_NULL_HANDLE, VK_NULL_HANDLE},
+        .tempBuffers = std::move(pendingTempBuffers),
+    };
+    pendingTempBuffers.clear();
+
+    // Each submission waits for the previous one, so that the semaphore is
+    // always signaled in increasing order, even when the batches are split
+    // between two queues. Buffer copies go first, as they're usually bigger.
+    for (const auto laneIndex : {TRANSFER_LANE, GRAPHICS_LANE}) {
+        auto& lane = lanes[laneIndex];
+        if (lane.cmd == VK_NULL_HANDLE) {
+            continue;
+        }
+        VK_CHECK(vkEndCommandBuffer(lane.cmd));
+
+        const auto cmdInfo = vkinit::commandBufferSubmitInfo(lane.cmd);
+        auto waitInfo =
+            vkinit::semaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, semaphore);
+        waitInfo.value = lastSubmittedValue;
+        auto signalInfo =
+            vkinit::semaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, semaphore);
+        signalInfo.value = lastSubmittedValue + 1;
+
+        const auto submit =
+            vkinit::submitInfo(&cmdInfo, lastSubmittedValue > 0 ? &waitInfo : nullptr, &signalInfo);
+        VK_CHECK(vkQueueSubmit2(lane.queueInfo.queue, 1, &submit, VK_NULL_HANDLE));
+
+        ++lastSubmittedValue;
+        batch.commandBuffers[laneIndex] = lane.cmd;
+        lane.cmd = VK_NULL_HANDLE;
+    }
+
+    batch.id = ++lastSubmittedBatchId;
+    batch.value = lastSubmittedValue;
+    batches.push_back(std::move(batch));
+    return lastSubmittedValue;
+}
+
+bool VulkanUploadQueue::isFinished(std::uint64_t value) const
+{
+    std::uint64_t currentValue{0};
+    VK_CHECK(vkGetSemaphoreCounterValue(device, semaphore, &currentValue));
+    return currentValue >= value;
+}
+
+bool VulkanUploadQueue::isBatchFinished(std::uint64_t batchId) const
+{
+    if (batchId > lastSubmittedBatchId) {
+        return false;
+    }
+    for (const auto& batch : batches) {
+        if (batch.id == batchId) {
+            return isFinished(batch.value);
+        }
+    }
+    return true; // finished batches are removed by collectFinishedBatches
+}
+
+void VulkanUploadQueue::wait(std::uint64_t value) const
+{
+    const auto waitInfo = VkSemaphoreWaitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &semaphore,
+        .pValues = &value,
+    };
+    VK_CHECK(vkWaitSemaphores(device, &waitInfo, NO_TIMEOUT));
+}
+
+void VulkanUploadQueue::flush()
+{
+    wait(submit());
+}
+
+void VulkanUploadQueue::collectFinishedBatches()
+{
+    while (!batches.empty() && isFinished(batches.front().value)) {
+        auto& batch = batches.front();
+        stagingTail = batch.stagingEnd;
+        for (const auto& buffer : batch.tempBuffers) {
+            gfxDevice->destroyBuffer(buffer);
+        }
+        for (std::size_t i = 0; i < lanes.size(); ++i) {
+            if (batch.commandBuffers[i] != VK_NULL_HANDLE) {
+                lanes[i].freeCommandBuffers.push_back(batch.commandBuffers[i]);
+            }
+        }
+        batches.pop_front();
+    }
+}
+
+VkCommandBuffer VulkanUploadQueue::getCommandBuffer(LaneIndex laneIndex)
+{
+    auto& lane = lanes[laneIndex];
+    if (lane.cmd != VK_NULL_HANDLE) {
+        return lane.cmd;
+    }
+
+    if (lane.freeCommandBuffers.empty()) {
+        const auto cmdAllocInfo = vkinit::commandBufferAllocateInfo(lane.commandPool, 1);
+        VK_CHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &lane.cmd));
+    } else {
+        lane.cmd = lane.freeCommandBuffers.back();
+        lane.freeCommandBuffers.pop_back();
+        VK_CHECK(vkResetCommandBuffer(lane.cmd, 0));
+    }
+
+    const auto cmdBeginInfo = VkCommandBufferBeginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    VK_CHECK(vkBeginCommandBuffer(lane.cmd, &cmdBeginInfo));
+    return lane.cmd;
+}
+
+std::pair<VkBuffer, std::size_t> VulkanUploadQueue::stage(std::span<const std::byte> data)
+{
+    const auto staging = allocateStagingMemory(data.size());
+    std::memcpy(staging.data, data.data(), data.size());
+    return {staging.buffer, staging.offset};
+}
+
+VulkanUploadQueue::StagingMemory VulkanUploadQueue::allocateStagingMemory(std::size_t size)
+{
+    // big uploads would make the ring wait for everything else too often
+    if (size > stagingBufferSize / 4) {
+        const auto buffer = gfxDevice->createBuffer(
+            size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryClass::Staging, MemoryCategory::Staging);
+        pendingTempBuffers.push_back(buffer);
+        return {
+            .buffer = buffer.buffer,
+            .offset = 0,
+            .data = (std::byte*)buffer.info.pMappedData,
+        };
+    }
+
+    const auto offset = allocateStaging(size);
+    return {
+        .buffer = stagingBuffer.buffer,
+        .offset = offset,
+        .data = (std::byte*)stagingBuffer.info.pMappedData + offset,
+    };
+}
+
+std::size_t VulkanUploadQueue::allocateStaging(std::size_t size)
+{
+    assert(size <= stagingBufferSize);
+    collectFinishedBatches();
+
+    while (true) {
+        if (stagingTail == stagingHead) {
+            // nothing is in use - start from the beginning of the buffer
+            stagingHead = alignUp(stagingHead, stagingBufferSize);
+            stagingTail = stagingHead;
+        }
+
+        auto pos = alignUp(stagingHead, STAGING_ALIGNMENT);
+        if (pos % stagingBufferSize + size > stagingBufferSize) {
+            pos = alignUp(pos, stagingBufferSize); // doesn't fit at the end - wrap around
+        }
+        if (pos + size - stagingTail <= stagingBufferSize) {
+            stagingHead = pos + size;
+            return (std::size_t)(pos % stagingBufferSize);
+        }
+
+        // the ring is full - wait for the oldest batch to finish
+        if (batches.empty()) {
+            submit(); // only the current batch uses the ring
+            assert(!batches.empty());
+        }
+        wait(batches.front().value);
+        collectFinishedBatches();
+    }
+}
@@ -1,9 +1,17 @@
 #include <edbr/SceneCache.h>
 
+#include <algorithm> // max
+#include <chrono>
+#include <thread> // hardware_concurrency
+
 #include <fmt/printf.h>
 
+#include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/MaterialCache.h>
+#include <edbr/Graphics/MeshCache.h>
 #include <edbr/Graphics/SkeletalAnimationCache.h>
-#include <edbr/Util/GltfLoader.h>
+#include <edbr/Util/CookedScene.h>
+#include <edbr/Util/PreparedScene.h>
 
 SceneCache::SceneCache(
     GfxDevice& gfxDevice,
@@ -14,7 +22,13 @@ SceneCache::SceneCache(
     meshCache(meshCache),
     materialCache(materialCache),
     animationCache(animationCache)
-{}
+{
+    // the thread which prepares the scene takes part in decoding and one
+    // core is left for the main thread (scenes can be prepared in background)
+    const auto numHardwareThreads = (std::size_t)std::thread::hardware_concurrency();
+    const auto numWorkers = std::max(numHardwareThreads, (std::size_t)2) - 2;
+    importThreadPool = std::make_unique<ThreadPool>(numWorkers);
+}
 
 const Scene& SceneCache::addScene(const std::string& scenePath, Scene scene)
 {
@@ -33,6 +47,21 @@ const Scene& SceneCache::getScene(const std::string& scenePath) const
     return it->second;
 }
 
+bool SceneCache::hasScene(const std::string& scenePath) const
+{
+    return sceneCache.contains(scenePath);
+}
+
+std::vector<std::string> SceneCache::getScenePaths() const
+{
+    std::vector<std::string> paths;
+    paths.reserve(sceneCache.size());
+    for (const auto& [path, scene] : sceneCache) {
+        paths.push_back(path);
+    }
+    return paths;
+}
+
 const Scene& SceneCache::loadOrGetScene(const std::filesystem::path& path)
 {
     const auto it = sceneCache.find(path.string());
@@ -41,15 +70,104 @@ const Scene& SceneCache::loadOrGetScene(const std::filesystem::path& path)
         return it->second;
     }
 
+    auto preparedScene = prepareScene(path);
+    while (!util::uploadPreparedScenePart(gfxDevice, meshCache, materialCache, *preparedScene)) {}
+    return addLoadedScene(std::move(preparedScene->scene));
+}
+
+void SceneCache::unloadScene(const std::string& scenePath)
+{
+    const auto it = sceneCache.find(scenePath);
+    assert(it != sceneCache.end() && "Scene was not loaded");
+    const auto& scene = it->second;
+
+    for (const auto& [meshId, cpuMesh] : scene.cpuMeshes) {
+        meshCache.removeMesh(gfxDevice, meshId);
+    }
+    for (const auto materialId : scene.materials) {
+        materialCache.removeMaterial(gfxDevice, materialId);
+    }
+    for (const auto imageId : scene.images) {
+        gfxDevice.releaseImage(imageId);
+    }
+    if (!scene.animations.empty()) {
+        animationCache.removeAnimations(scene.path);
+    }
+
+    sceneCache.erase(it);
+}
+
+std::unique_ptr<PreparedScene> SceneCache::prepareScene(const std::filesystem::path& path) const
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    std::unique_lock threadPoolLock(importThreadPoolMutex, std::try_to_lock);
+    auto* threadPool = threadPoolLock.owns_lock() ? importThreadPool.get() : nullptr;
+
+    auto preparedScene = prepareSceneWithThreadPool(path, threadPool);
+
+    const auto loadTime = std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - startTime);
+    fmt::print(
+        "Prepared scene '{}' ({} textures) in {:.1f} ms\n",
+        path.string(),
+        preparedScene->textures.size(),
+        loadTime.count());
+
+    return preparedScene;
+}
+
+std::unique_ptr<PreparedScene> SceneCache::prepareSceneWithThreadPool(
+    const std::filesystem::path& path,
+    ThreadPool* threadPool) const
+{
+    // same settings as MeshCache uses for meshes loaded from glTF
+    const auto settings = SceneImportSettings{
+        .packVertices = true,
+        .lodSettings = meshCache.getLodSettings(),
+        .compressedTextures = gfxDevice.hasTextureCompressionBC(),
+    };
+
+    if (cookedSceneDir.empty()) {
+        fmt::print("Loading gltf scene '{}'\n", path.string());
+        return util::prepareGltfScene(path, settings, threadPool);
+    }
+
+    const auto key = util::calculateCookedSceneKey(path, settings);
+    const auto cookedPath = util::getCookedScenePath(cookedSceneDir, path, key);
+    if (!std::filesystem::exists(cookedPath)) {
+        fmt::print("Cooking gltf scene '{}' to '{}'\n", path.string(), cookedPath.string());
+        util::cookGltfFile(path, cookedPath, settings, key);
+    }
+
+    fmt::print("Loading cooked scene '{}'\n", cookedPath.string());
+    if (auto preparedScene = util::prepareCookedScene(
+            path, cookedPath, key, settings.compressedTextures, threadPool)) {
+        return preparedScene;
+    }
+
     fmt::print("Loading gltf scene '{}'\n", path.string());
+    return util::prepareGltfScene(path, settings, threadPool);
+}
 
-    auto scene = util::loadGltfFile(gfxDevice, meshCache, materialCache, path);
+bool SceneCache::uploadPreparedScenePart(PreparedScene& preparedScene)
+{
+    if (!util::uploadPreparedScenePart(gfxDevice, meshCache, materialCache, preparedScene)) {
+        return false;
+    }
+    addLoadedScene(std::move(preparedScene.scene));
+    return true;
+}
+
+const Scene& SceneCache::addLoadedScene(Scene scene)
+{
+    const auto path = scene.path.string();
     if (!scene.animations.empty()) {
         // NOTE: we don't move here so that the returned/cached scene still
         // has animations inspectable in it
-        animationCache.addAnimations(path, scene.animations);
+        animationCache.addAnimations(scene.path, scene.animations);
     }
-    const auto [it2, inserted] = sceneCache.emplace(path.string(), std::move(scene));
+    const auto [it, inserted] = sceneCache.emplace(path, std::move(scene));
     assert(inserted);
-    return it2->second;
+    return it->second;
 }
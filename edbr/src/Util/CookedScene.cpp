@@ -0,0 +1,804 @@
+#include <edbr/Util/CookedScene.h>
+
+#include <array>
+#include <cstring> // memcpy
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <nlohmann/json.hpp>
+
+#include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/MaterialCache.h>
+#include <edbr/Graphics/MeshCache.h>
+#include <edbr/Graphics/MeshUploadData.h>
+#include <edbr/Graphics/Scene.h>
+#include <edbr/Graphics/VertexPacking.h>
+#include <edbr/Util/GltfLoader.h>
+#include <edbr/Util/MappedFile.h>
+#include <edbr/Util/PreparedScene.h>
+
+namespace
+{
+constexpr std::uint32_t COOKED_SCENE_MAGIC = 0x43534445; // "EDSC"
+// bump when the format or the importer output changes - this invalidates
+// all cooked files, because the version is a part of the key
+constexpr std::uint32_t COOKED_SCENE_VERSION = 1;
+// all arrays in the data section are aligned to this
+constexpr std::size_t DATA_ALIGNMENT = 16;
+
+// File layout: Header, then small sections with per-object records (names,
+// counts, transforms and references to arrays) and then the data section
+// with all the arrays (vertices, indices, keyframes etc.)
+enum class Section : std::uint32_t {
+    Materials,
+    Meshes,
+    Skeletons,
+    Animations,
+    Lights,
+    Nodes,
+    Data,
+    Count,
+};
+constexpr auto NUM_SECTIONS = (std::size_t)Section::Count;
+
+struct FileRange {
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+struct Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t key;
+    std::array<FileRange, NUM_SECTIONS> sections;
+};
+
+// array in the data section (offset is relative to the section start)
+struct ArrayRef {
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+std::size_t alignUp(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// FNV-1a
+class Hasher {
+public:
+    void add(std::span<const std::byte> data)
+    {
+        for (const auto b : data) {
+            hash ^= (std::uint64_t)b;
+            hash *= 0x100000001b3;
+        }
+    }
+
+    template<typename T>
+    void add(const T& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        add(std::as_bytes(std::span{&v, 1}));
+    }
+
+    std::uint64_t getHash() const { return hash; }
+
+private:
+    std::uint64_t hash{0xcbf29ce484222325};
+};
+
+class DataWriter {
+public:
+    template<typename T>
+    ArrayRef addArray(std::span<const T> arr)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto offset = alignUp(data.size(), DATA_ALIGNMENT);
+        data.resize(offset + arr.size_bytes());
+        if (!arr.empty()) {
+            std::memcpy(data.data() + offset, arr.data(), arr.size_bytes());
+        }
+        return ArrayRef{.offset = offset, .count = arr.size()};
+    }
+
+    std::vector<std::byte> data;
+};
+
+class SectionWriter {
+public:
+    SectionWriter(DataWriter& dataWriter) : dataWriter(dataWriter) {}
+
+    template<typename T>
+    void write(const T& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto offset = bytes.size();
+        bytes.resize(offset + sizeof(T));
+        std::memcpy(bytes.data() + offset, &v, sizeof(T));
+    }
+
+    void writeCount(std::size_t count) { write((std::uint32_t)count); }
+
+    template<typename T>
+    void writeArray(std::span<const T> arr)
+    {
+        write(dataWriter.addArray(arr));
+    }
+
+    void writeString(std::string_view str) { writeArray(std::span{str.data(), str.size()}); }
+
+    void writeTransform(const Transform& transform)
+    {
+        write(transform.getPosition());
+        write(transform.getHeading());
+        write(transform.getScale());
+    }
+
+    std::vector<std::byte> bytes;
+
+private:
+    DataWriter& dataWriter;
+};
+
+// Throws std::runtime_error if the data is out of bounds
+class SectionReader {
+public:
+    SectionReader(std::span<const std::byte> section, std::span<const std::byte> data) :
+        section(section), data(data)
+    {}
+
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (sizeof(T) > section.size() - pos) {
+            throw std::runtime_error("unexpected end of section");
+        }
+        T v;
+        std::memcpy(&v, section.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return v;
+    }
+
+    std::size_t readCount()
+    {
+        // each element takes at least one byte, so bigger counts are invalid
+        // (this prevents huge allocations when reading corrupted files)
+        const auto count = read<std::uint32_t>();
+        if (count > section.size() - pos) {
+            throw std::runtime_error("invalid count");
+        }
+        return count;
+    }
+
+    template<typename T>
+    std::span<const T> readArray()
+    {
+        const auto ref = read<ArrayRef>();
+        if (ref.offset > data.size() || ref.count > (data.size() - ref.offset) / sizeof(T)) {
+            throw std::runtime_error("array is out of bounds");
+        }
+        const auto* ptr = data.data() + ref.offset;
+        if ((std::uintptr_t)ptr % alignof(T) != 0) {
+            throw std::runtime_error("array is not aligned");
+        }
+        return {reinterpret_cast<const T*>(ptr), (std::size_t)ref.count};
+    }
+
+    template<typename T>
+    std::vector<T> readVector()
+    {
+        const auto arr = readArray<T>();
+        return {arr.begin(), arr.end()};
+    }
+
+    std::string_view readString()
+    {
+        const auto chars = readArray<char>();
+        return {chars.data(), chars.size()};
+    }
+
+    Transform readTransform()
+    {
+        Transform transform;
+        transform.setPosition(read<glm::vec3>());
+        transform.setHeading(read<glm::quat>());
+        transform.setScale(read<glm::vec3>());
+        return transform;
+    }
+
+private:
+    std::span<const std::byte> section;
+    std::span<const std::byte> data;
+    std::size_t pos{0};
+};
+
+void writeMaterials(SectionWriter& w, const std::vector<ImportedMaterial>& materials)
+{
+    w.writeCount(materials.size());
+    for (const auto& importedMaterial : materials) {
+        const auto& material = importedMaterial.material;
+        w.writeString(material.name);
+        w.write(material.baseColor);
+        w.write(material.metallicFactor);
+        w.write(material.roughnessFactor);
+        w.write(material.emissiveFactor);
+        w.writeString(importedMaterial.diffuseTexture);
+        w.writeString(importedMaterial.normalMapTexture);
+        w.writeString(importedMaterial.metallicRoughnessTexture);
+        w.writeString(importedMaterial.emissiveTexture);
+    }
+}
+
+void writePrimitive(
+    SectionWriter& w,
+    const ImportedPrimitive& primitive,
+    const SceneImportSettings& settings)
+{
+    const auto& cpuMesh = primitive.mesh;
+    w.write((std::int32_t)primitive.materialIndex);
+    w.write((std::uint8_t)!cpuMesh.indices.empty());
+    if (cpuMesh.indices.empty()) {
+        return;
+    }
+
+    MeshUploadStorage storage;
+    const auto data = graphics::prepareMeshUpload(cpuMesh, settings.lodSettings, storage);
+    w.write(data.vertexFormat);
+    w.write(data.indexType);
+    w.write(data.numVertices);
+    w.writeString(data.name);
+    w.write(data.acmrBefore);
+    w.write(data.acmrAfter);
+    w.write(data.minPos);
+    w.write(data.maxPos);
+    w.write(data.boundingSphere);
+    w.writeArray(data.vertices);
+    w.writeArray(data.indices);
+    w.writeArray(data.lods);
+    w.writeArray(data.skinningData);
+
+    // for Scene::cpuMeshes
+    std::vector<glm::vec3> positions(cpuMesh.vertices.size());
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        positions[i] = cpuMesh.vertices[i].position;
+    }
+    w.writeArray(std::span<const glm::vec3>{positions});
+}
+
+void writeSkeletons(SectionWriter& w, const std::vector<Skeleton>& skeletons)
+{
+    w.writeCount(skeletons.size());
+    for (const auto& skeleton : skeletons) {
+        w.writeCount(skeleton.joints.size());
+        for (std::size_t jointId = 0; jointId < skeleton.joints.size(); ++jointId) {
+            w.writeString(skeleton.jointNames[jointId]);
+            w.writeTransform(skeleton.joints[jointId].localTransform);
+            w.writeArray(std::span{skeleton.hierarchy[jointId].children});
+        }
+        w.writeArray(std::span{skeleton.inverseBindMatrices});
+    }
+}
+
+void writeAnimations(
+    SectionWriter& w,
+    const std::unordered_map<std::string, SkeletalAnimation>& animations)
+{
+    w.writeCount(animations.size());
+    for (const auto& [name, animation] : animations) {
+        w.writeString(name);
+        w.write(animation.duration);
+        w.writeCount(animation.tracks.size());
+        for (const auto& track : animation.tracks) {
+            w.writeArray(std::span{track.translations});
+            w.writeArray(std::span{track.rotations});
+            w.writeArray(std::span{track.scales});
+        }
+    }
+}
+
+void writeLights(SectionWriter& w, const std::vector<Light>& lights)
+{
+    w.writeCount(lights.size());
+    for (const auto& light : lights) {
+        w.writeString(light.name);
+        w.write(light.type);
+        w.write(light.color);
+        w.write(light.range);
+        w.write(light.intensity);
+        w.write(light.scaleOffset);
+        w.write((std::uint8_t)light.castShadow);
+    }
+}
+
+// nodes are stored in pre-order
+void writeNode(SectionWriter& w, const SceneNode& node)
+{
+    w.writeString(node.name);
+    w.writeTransform(node.transform);
+    w.write((std::int32_t)node.meshIndex);
+    w.write((std::int32_t)node.skinId);
+    w.write((std::int32_t)node.lightId);
+    w.write((std::int32_t)node.cameraId);
+    w.writeCount(node.children.size());
+    for (const auto& child : node.children) {
+        writeNode(w, *child);
+    }
+}
+
+struct CookedPrimitive {
+    int materialIndex{-1};
+    bool loaded{false};
+    MeshUploadData data;
+    std::span<const glm::vec3> positions;
+};
+
+// CPU side of the cooked scene - its arrays point into the mapped file
+struct CookedScene {
+    std::vector<ImportedMaterial> materials;
+    std::vector<std::vector<CookedPrimitive>> meshes;
+    Scene scene; // meshes and cpuMeshes are empty
+};
+
+CookedPrimitive readPrimitive(SectionReader& r, std::size_t numMaterials)
+{
+    CookedPrimitive primitive;
+    primitive.materialIndex = r.read<std::int32_t>();
+    if (primitive.materialIndex < -1 || primitive.materialIndex >= (int)numMaterials) {
+        throw std::runtime_error("invalid material index");
+    }
+    primitive.loaded = r.read<std::uint8_t>() != 0;
+    if (!primitive.loaded) {
+        return primitive;
+    }
+
+    auto& data = primitive.data;
+    data.vertexFormat = r.read<VertexFormat>();
+    data.indexType = r.read<VkIndexType>();
+    data.numVertices = r.read<std::uint32_t>();
+    data.name = r.readString();
+    data.acmrBefore = r.read<float>();
+    data.acmrAfter = r.read<float>();
+    data.minPos = r.read<glm::vec3>();
+    data.maxPos = r.read<glm::vec3>();
+    data.boundingSphere = r.read<math::Sphere>();
+    data.vertices = r.readArray<std::byte>();
+    data.indices = r.readArray<std::byte>();
+    data.lods = r.readArray<MeshLod>();
+    data.skinningData = r.readArray<CPUMesh::SkinningData>();
+    primitive.positions = r.readArray<glm::vec3>();
+
+    if (data.vertexFormat != VertexFormat::Full && data.vertexFormat != VertexFormat::Packed &&
+        data.vertexFormat != VertexFormat::PackedQuantized) {
+        throw std::runtime_error("invalid vertex format");
+    }
+    if (data.indexType != VK_INDEX_TYPE_UINT16 && data.indexType != VK_INDEX_TYPE_UINT32) {
+        throw std::runtime_error("invalid index type");
+    }
+    const auto indexSize = data.indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+    const auto numIndices = data.indices.size() / indexSize;
+    if (data.vertices.size() != data.numVertices * graphics::getVertexSize(data.vertexFormat) ||
+        data.indices.size() % indexSize != 0 || primitive.positions.size() != data.numVertices ||
+        (!data.skinningData.empty() && data.skinningData.size() != data.numVertices)) {
+        throw std::runtime_error("invalid mesh data size");
+    }
+    if (data.lods.empty()) {
+        throw std::runtime_error("mesh doesn't have LOD 0");
+    }
+    for (const auto& lod : data.lods) {
+        if (lod.firstIndex > numIndices || lod.numIndices > numIndices - lod.firstIndex) {
+            throw std::runtime_error("LOD is out of bounds");
+        }
+    }
+
+    return primitive;
+}
+
+Skeleton readSkeleton(SectionReader& r)
+{
+    Skeleton skeleton;
+    const auto numJoints = r.readCount();
+    skeleton.joints.reserve(numJoints);
+    skeleton.jointNames.reserve(numJoints);
+    skeleton.hierarchy.reserve(numJoints);
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        skeleton.jointNames.emplace_back(r.readString());
+        skeleton.joints.push_back(Joint{
+            .id = (JointId)jointId,
+            .localTransform = r.readTransform(),
+        });
+        skeleton.hierarchy.push_back({.children = r.readVector<JointId>()});
+        for (const auto childId : skeleton.hierarchy.back().children) {
+            if (childId >= numJoints) {
+                throw std::runtime_error("invalid joint id");
+            }
+        }
+    }
+    skeleton.inverseBindMatrices = r.readVector<glm::mat4>();
+    return skeleton;
+}
+
+SkeletalAnimation readAnimation(SectionReader& r)
+{
+    SkeletalAnimation animation;
+    animation.name = r.readString();
+    animation.duration = r.read<float>();
+    animation.tracks.resize(r.readCount());
+    for (auto& track : animation.tracks) {
+        track.translations = r.readVector<glm::vec3>();
+        track.rotations = r.readVector<glm::quat>();
+        track.scales = r.readVector<glm::vec3>();
+    }
+    return animation;
+}
+
+Light readLight(SectionReader& r)
+{
+    Light light;
+    light.name = r.readString();
+    light.type = r.read<LightType>();
+    light.color = r.read<LinearColor>();
+    light.range = r.read<float>();
+    light.intensity = r.read<float>();
+    light.scaleOffset = r.read<glm::vec2>();
+    light.castShadow = r.read<std::uint8_t>() != 0;
+    return light;
+}
+
+std::unique_ptr<SceneNode> readNode(SectionReader& r)
+{
+    auto node = std::make_unique<SceneNode>();
+    node->name = r.readString();
+    node->transform = r.readTransform();
+    node->meshIndex = r.read<std::int32_t>();
+    node->skinId = r.read<std::int32_t>();
+    node->lightId = r.read<std::int32_t>();
+    node->cameraId = r.read<std::int32_t>();
+    node->children.resize(r.readCount());
+    for (auto& child : node->children) {
+        child = readNode(r);
+    }
+    return node;
+}
+
+CookedScene readCookedScene(std::span<const std::byte> file, std::uint64_t key)
+{
+    if (file.size() < sizeof(Header)) {
+        throw std::runtime_error("file is too small");
+    }
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (header.magic != COOKED_SCENE_MAGIC) {
+        throw std::runtime_error("not a cooked scene");
+    }
+    if (header.version != COOKED_SCENE_VERSION || header.key != key) {
+        throw std::runtime_error("cooked scene is outdated");
+    }
+
+    std::array<std::span<const std::byte>, NUM_SECTIONS> sections;
+    for (std::size_t i = 0; i < NUM_SECTIONS; ++i) {
+        const auto& range = header.sections[i];
+        if (range.offset > file.size() || range.size > file.size() - range.offset) {
+            throw std::runtime_error("section is out of bounds");
+        }
+        sections[i] = file.subspan(range.offset, range.size);
+    }
+    const auto data = sections[(std::size_t)Section::Data];
+    const auto getReader = [&](Section section) {
+        return SectionReader(sections[(std::size_t)section], data);
+    };
+
+    CookedScene cooked;
+
+    auto materialsReader = getReader(Section::Materials);
+    cooked.materials.resize(materialsReader.readCount());
+    for (auto& importedMaterial : cooked.materials) {
+        auto& material = importedMaterial.material;
+        material.name = materialsReader.readString();
+        material.baseColor = materialsReader.read<LinearColor>();
+        material.metallicFactor = materialsReader.read<float>();
+        material.roughnessFactor = materialsReader.read<float>();
+        material.emissiveFactor = materialsReader.read<float>();
+        importedMaterial.diffuseTexture = materialsReader.readString();
+        importedMaterial.normalMapTexture = materialsReader.readString();
+        importedMaterial.metallicRoughnessTexture = materialsReader.readString();
+        importedMaterial.emissiveTexture = materialsReader.readString();
+    }
+
+    auto meshesReader = getReader(Section::Meshes);
+    cooked.meshes.resize(meshesReader.readCount());
+    for (auto& mesh : cooked.meshes) {
+        mesh.resize(meshesReader.readCount());
+        for (auto& primitive : mesh) {
+            primitive = readPrimitive(meshesReader, cooked.materials.size());
+        }
+    }
+
+    auto& scene = cooked.scene;
+
+    auto skeletonsReader = getReader(Section::Skeletons);
+    scene.skeletons.resize(skeletonsReader.readCount());
+    for (auto& skeleton : scene.skeletons) {
+        skeleton = readSkeleton(skeletonsReader);
+    }
+
+    auto animationsReader = getReader(Section::Animations);
+    const auto numAnimations = animationsReader.readCount();
+    for (std::size_t i = 0; i < numAnimations; ++i) {
+        auto animation = readAnimation(animationsReader);
+        auto name = animation.name;
+        scene.animations.emplace(std::move(name), std::move(animation));
+    }
+
+    auto lightsReader = getReader(Section::Lights);
+    scene.lights.resize(lightsReader.readCount());
+    for (auto& light : scene.lights) {
+        light = readLight(lightsReader);
+    }
+
+    auto nodesReader = getReader(Section::Nodes);
+    scene.nodes.resize(nodesReader.readCount());
+    for (auto& node : scene.nodes) {
+        node = readNode(nodesReader);
+    }
+
+    return cooked;
+}
+
+// physics and bounding box calculation only use positions and indices of LOD 0
+CPUMesh makeCPUMesh(const CookedPrimitive& primitive)
+{
+    const auto& data = primitive.data;
+    CPUMesh cpuMesh{
+        .vertexFormat = data.vertexFormat,
+        .hasSkeleton = !data.skinningData.empty(),
+        .name = std::string{data.name},
+        .acmrBefore = data.acmrBefore,
+        .acmrAfter = data.acmrAfter,
+        .minPos = data.minPos,
+        .maxPos = data.maxPos,
+    };
+
+    cpuMesh.vertices.resize(primitive.positions.size());
+    for (std::size_t i = 0; i < primitive.positions.size(); ++i) {
+        cpuMesh.vertices[i].position = primitive.positions[i];
+    }
+
+    const auto& lod = data.lods[0];
+    cpuMesh.indices.resize(lod.numIndices);
+    if (data.indexType == VK_INDEX_TYPE_UINT16) {
+        const auto* indices = reinterpret_cast<const std::uint16_t*>(data.indices.data());
+        for (std::uint32_t i = 0; i < lod.numIndices; ++i) {
+            cpuMesh.indices[i] = indices[lod.firstIndex + i];
+        }
+    } else {
+        const auto* indices = reinterpret_cast<const std::uint32_t*>(data.indices.data());
+        std::memcpy(
+            cpuMesh.indices.data(),
+            indices + lod.firstIndex,
+            lod.numIndices * sizeof(std::uint32_t));
+    }
+
+    return cpuMesh;
+}
+
+} // end of anonymous namespace
+
+namespace util
+{
+std::uint64_t calculateCookedSceneKey(
+    const std::filesystem::path& gltfPath,
+    const SceneImportSettings& settings)
+{
+    Hasher hasher;
+    hasher.add(COOKED_SCENE_VERSION);
+    hasher.add(settings.packVertices);
+    hasher.add(settings.lodSettings.maxLods);
+    hasher.add(settings.lodSettings.reductionRatio);
+    hasher.add(settings.lodSettings.targetError);
+
+    const MappedFile gltfFile(gltfPath);
+    if (!gltfFile.isGood()) {
+        return hasher.getHash();
+    }
+    const auto gltfData = gltfFile.getData();
+    hasher.add(gltfData);
+
+    // hash external buffers (.bin) - embedded ones are already hashed
+    const auto* gltfChars = reinterpret_cast<const char*>(gltfData.data());
+    const auto root = nlohmann::json::parse(gltfChars, gltfChars + gltfData.size(), nullptr, false);
+    if (root.is_discarded() || !root.contains("buffers")) {
+        return hasher.getHash();
+    }
+    const auto fileDir = gltfPath.parent_path();
+    for (const auto& buffer : root["buffers"]) {
+        if (!buffer.contains("uri") || !buffer["uri"].is_string()) {
+            continue;
+        }
+        const auto uri = buffer["uri"].get<std::string>();
+        if (uri.starts_with("data:")) {
+            continue;
+        }
+        const MappedFile bufferFile(fileDir / uri);
+        if (bufferFile.isGood()) {
+            hasher.add(bufferFile.getData());
+        }
+    }
+
+    return hasher.getHash();
+}
+
+std::filesystem::path getCookedScenePath(
+    const std::filesystem::path& cookedDir,
+    const std::filesystem::path& gltfPath,
+    std::uint64_t key)
+{
+    return cookedDir / fmt::format("{}-{:016x}.scene", gltfPath.stem().string(), key);
+}
+
+bool cookGltfFile(
+    const std::filesystem::path& gltfPath,
+    const std::filesystem::path& cookedPath,
+    const SceneImportSettings& settings,
+    std::uint64_t key)
+{
+    const auto imported = importGltfFile(gltfPath, settings.packVertices);
+    const auto& scene = imported.scene;
+
+    DataWriter dataWriter;
+    auto sections = std::vector<SectionWriter>(NUM_SECTIONS - 1, SectionWriter(dataWriter));
+    const auto getWriter = [&](Section section) -> SectionWriter& {
+        return sections[(std::size_t)section];
+    };
+
+    writeMaterials(getWriter(Section::Materials), imported.materials);
+
+    auto& meshesWriter = getWriter(Section::Meshes);
+    meshesWriter.writeCount(imported.meshes.size());
+    for (const auto& mesh : imported.meshes) {
+        meshesWriter.writeCount(mesh.size());
+        for (const auto& primitive : mesh) {
+            writePrimitive(meshesWriter, primitive, settings);
+        }
+    }
+
+    writeSkeletons(getWriter(Section::Skeletons), scene.skeletons);
+    writeAnimations(getWriter(Section::Animations), scene.animations);
+    writeLights(getWriter(Section::Lights), scene.lights);
+
+    auto& nodesWriter = getWriter(Section::Nodes);
+    nodesWriter.writeCount(scene.nodes.size());
+    for (const auto& node : scene.nodes) {
+        writeNode(nodesWriter, *node);
+    }
+
+    Header header{
+        .magic = COOKED_SCENE_MAGIC,
+        .version = COOKED_SCENE_VERSION,
+        .key = key,
+    };
+    auto offset = sizeof(Header);
+    for (std::size_t i = 0; i < sections.size(); ++i) {
+        header.sections[i] = FileRange{.offset = offset, .size = sections[i].bytes.size()};
+        offset += sections[i].bytes.size();
+    }
+    const auto dataOffset = alignUp(offset, DATA_ALIGNMENT);
+    header.sections[(std::size_t)Section::Data] = FileRange{
+        .offset = dataOffset,
+        .size = dataWriter.data.size(),
+    };
+
+    // write to a temporary file first, so that the game never sees partially
+    // written files (e.g. if the cooker is run while the game is running)
+    std::filesystem::create_directories(cookedPath.parent_path());
+    auto tempPath = cookedPath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.good()) {
+            fmt::println("[error] failed to open '{}' for writing", tempPath.string());
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        for (const auto& section : sections) {
+            file.write(reinterpret_cast<const char*>(section.bytes.data()), section.bytes.size());
+        }
+        const std::array<char, DATA_ALIGNMENT> padding{};
+        file.write(padding.data(), (std::streamsize)(dataOffset - offset));
+        file.write(
+            reinterpret_cast<const char*>(dataWriter.data.data()), dataWriter.data.size());
+        if (!file.good()) {
+            fmt::println("[error] failed to write '{}'", tempPath.string());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cookedPath, ec);
+    if (ec) {
+        fmt::println("[error] failed to write '{}': {}", cookedPath.string(), ec.message());
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<PreparedScene> prepareCookedScene(
+    const std::filesystem::path& gltfPath,
+    const std::filesystem::path& cookedPath,
+    std::uint64_t key,
+    bool compressedTextures,
+    ThreadPool* threadPool)
+{
+    auto file = std::make_unique<MappedFile>(cookedPath);
+    if (!file->isGood()) {
+        return nullptr;
+    }
+
+    CookedScene cooked;
+    try {
+        cooked = readCookedScene(file->getData(), key);
+    } catch (const std::runtime_error& e) {
+        fmt::println("Failed to load cooked scene '{}': {}", cookedPath.string(), e.what());
+        return nullptr;
+    }
+
+    const auto fileDir = gltfPath.parent_path();
+
+    auto preparedScene = std::make_unique<PreparedScene>();
+    preparedScene->scene = std::move(cooked.scene);
+    preparedScene->scene.path = gltfPath;
+
+    prepareMaterials(*preparedScene, cooked.materials, fileDir, compressedTextures, threadPool);
+
+    preparedScene->meshes.resize(cooked.meshes.size());
+    for (std::size_t meshIdx = 0; meshIdx < cooked.meshes.size(); ++meshIdx) {
+        const auto& cookedMesh = cooked.meshes[meshIdx];
+        auto& preparedMesh = preparedScene->meshes[meshIdx];
+        preparedMesh.resize(cookedMesh.size());
+        for (std::size_t primitiveIdx = 0; primitiveIdx < cookedMesh.size(); ++primitiveIdx) {
+            const auto& cookedPrimitive = cookedMesh[primitiveIdx];
+            if (!cookedPrimitive.loaded) {
+                continue;
+            }
+
+            auto& primitive = preparedMesh[primitiveIdx];
+            primitive.loaded = true;
+            primitive.materialIndex = cookedPrimitive.materialIndex;
+            primitive.data = cookedPrimitive.data; // points into the mapped file
+            primitive.cpuMesh = makeCPUMesh(cookedPrimitive);
+        }
+    }
+
+    preparedScene->cookedFile = std::move(file);
+    return preparedScene;
+}
+
+std::optional<Scene> loadCookedScene(
+    GfxDevice& gfxDevice,
+    MeshCache& meshCache,
+    MaterialCache& materialCache,
+    const std::filesystem::path& gltfPath,
+    const std::filesystem::path& cookedPath,
+    std::uint64_t key,
+    ThreadPool* threadPool)
+{
+    // everything is validated before uploading anything to GPU
+    auto preparedScene = prepareCookedScene(
+        gltfPath, cookedPath, key, gfxDevice.hasTextureCompressionBC(), threadPool);
+    if (!preparedScene) {
+        return std::nullopt;
+    }
+
+    while (!uploadPreparedScenePart(gfxDevice, meshCache, materialCache, *preparedScene)) {}
+    return std::move(preparedScene->scene);
+}
+
+} // end of namespace util
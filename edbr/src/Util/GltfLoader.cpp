@@ -10,9 +10,12 @@
 #include <edbr/Graphics/GfxDevice.h>
 #include <edbr/Graphics/MaterialCache.h>
 #include <edbr/Graphics/MeshCache.h>
+#include <edbr/Graphics/MeshOptimization.h>
 #include <edbr/Graphics/Scene.h>
 #include <edbr/Graphics/Skeleton.h>
+#include <edbr/Graphics/VertexPacking.h>
 #include <edbr/Math/Util.h>
+#include <edbr/Util/PreparedScene.h>
 
 #define TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_NO_STB_IMAGE
@@ -187,37 +190,34 @@ LinearColor getDiffuseColor(const tinygltf::Material& material)
     return LinearColor{(float)c[0], (float)c[1], (float)c[2], (float)c[3]};
 }
 
-std::filesystem::path getNormalMapTexturePath(
+const std::string& getNormalMapTextureUri(
     const tinygltf::Model& model,
-    const tinygltf::Material& material,
-    const std::filesystem::path& fileDir)
+    const tinygltf::Material& material)
 {
     const auto textureIndex = material.normalTexture.index;
     const auto& textureId = model.textures[textureIndex];
     const auto& image = model.images[textureId.source];
-    return fileDir / image.uri;
+    return image.uri;
 }
 
-std::filesystem::path getMetallicRoughnessTexturePath(
+const std::string& getMetallicRoughnessTextureUri(
     const tinygltf::Model& model,
-    const tinygltf::Material& material,
-    const std::filesystem::path& fileDir)
+    const tinygltf::Material& material)
 {
     const auto textureIndex = material.pbrMetallicRoughness.metallicRoughnessTexture.index;
     const auto& textureId = model.textures[textureIndex];
     const auto& image = model.images[textureId.source];
-    return fileDir / image.uri;
+    return image.uri;
 }
 
-std::filesystem::path getEmissiveTexturePath(
+const std::string& getEmissiveTextureUri(
     const tinygltf::Model& model,
-    const tinygltf::Material& material,
-    const std::filesystem::path& fileDir)
+    const tinygltf::Material& material)
 {
     const auto textureIndex = material.emissiveTexture.index;
     const auto& textureId = model.textures[textureIndex];
     const auto& image = model.images[textureId.source];
-    return fileDir / image.uri;
+    return image.uri;
 }
 
 float getEmissiveStrength(const tinygltf::Material& material)
@@ -230,28 +230,46 @@ float getEmissiveStrength(const tinygltf::Material& material)
     return 1.f;
 }
 
-std::filesystem::path getDiffuseTexturePath(
+const std::string& getDiffuseTextureUri(
     const tinygltf::Model& model,
-    const tinygltf::Material& material,
-    const std::filesystem::path& fileDir)
+    const tinygltf::Material& material)
 {
     const auto textureIndex = material.pbrMetallicRoughness.baseColorTexture.index;
     const auto& textureId = model.textures[textureIndex];
     const auto& image = model.images[textureId.source];
-    return fileDir / image.uri;
+    return image.uri;
 }
 
 CPUMesh loadPrimitive(
     const tinygltf::Model& model,
     const std::string& meshName,
-    const tinygltf::Primitive& primitive)
+    const tinygltf::Primitive& primitive,
+    bool packVertices)
 {
     CPUMesh mesh{.name = meshName};
 
     if (primitive.indices != -1) { // load indices
         const auto& indexAccessor = model.accessors[primitive.indices];
-        const auto indices = getPackedBufferSpan<std::uint16_t>(model, indexAccessor);
-        mesh.indices.assign(indices.begin(), indices.end());
+        // MeshCache converts indices back to 16 bit on upload if they fit
+        switch (indexAccessor.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+            const auto indices = getPackedBufferSpan<std::uint8_t>(model, indexAccessor);
+            mesh.indices.assign(indices.begin(), indices.end());
+            break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            const auto indices = getPackedBufferSpan<std::uint16_t>(model, indexAccessor);
+            mesh.indices.assign(indices.begin(), indices.end());
+            break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+            const auto indices = getPackedBufferSpan<std::uint32_t>(model, indexAccessor);
+            mesh.indices.assign(indices.begin(), indices.end());
+            break;
+        }
+        default:
+            assert(false && "unexpected index component type");
+        }
     }
 
     // load positions
@@ -270,6 +288,10 @@ CPUMesh loadPrimitive(
         mesh.maxPos = tg2glm(posAccessor.maxValues);
     }
 
+    if (packVertices) {
+        mesh.vertexFormat = graphics::choosePackedVertexFormat(mesh.minPos, mesh.maxPos);
+    }
+
     const auto numVertices = positions.size();
 
     // load normals
@@ -325,47 +347,41 @@ CPUMesh loadPrimitive(
         }
     }
 
+    graphics::optimizeMesh(mesh);
+
     return mesh;
 }
 
-Material loadMaterial(
-    GfxDevice& gfxDevice,
+ImportedMaterial importMaterial(
     const tinygltf::Model& gltfModel,
-    const std::filesystem::path& fileDir,
     const tinygltf::Material& gltfMaterial)
 {
-    Material material{
-        .baseColor = getDiffuseColor(gltfMaterial),
-        .metallicFactor = (float)gltfMaterial.pbrMetallicRoughness.metallicFactor,
-        .roughnessFactor = (float)gltfMaterial.pbrMetallicRoughness.roughnessFactor,
-        .name = gltfMaterial.name,
+    ImportedMaterial material{
+        .material =
+            Material{
+                .baseColor = getDiffuseColor(gltfMaterial),
+                .metallicFactor = (float)gltfMaterial.pbrMetallicRoughness.metallicFactor,
+                .roughnessFactor = (float)gltfMaterial.pbrMetallicRoughness.roughnessFactor,
+                .name = gltfMaterial.name,
+            },
     };
 
     if (hasDiffuseTexture(gltfMaterial)) {
-        const auto diffusePath = getDiffuseTexturePath(gltfModel, gltfMaterial, fileDir);
-        material.diffuseTexture = gfxDevice.loadImageFromFile(
-            diffusePath, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, true);
+        material.diffuseTexture = getDiffuseTextureUri(gltfModel, gltfMaterial);
     }
 
     if (hasNormalMapTexture(gltfMaterial)) {
-        const auto normalMapPath = getNormalMapTexturePath(gltfModel, gltfMaterial, fileDir);
-        material.normalMapTexture = gfxDevice.loadImageFromFile(
-            normalMapPath, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, true);
+        material.normalMapTexture = getNormalMapTextureUri(gltfModel, gltfMaterial);
     }
 
     if (hasMetallicRoughnessTexture(gltfMaterial)) {
-        const auto metalRoughnessPath =
-            getMetallicRoughnessTexturePath(gltfModel, gltfMaterial, fileDir);
-        material.metallicRoughnessTexture = gfxDevice.loadImageFromFile(
-            metalRoughnessPath, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, true);
+        material.metallicRoughnessTexture =
+            getMetallicRoughnessTextureUri(gltfModel, gltfMaterial);
     }
 
     if (hasEmissiveTexture(gltfMaterial)) {
-        material.emissiveFactor = getEmissiveStrength(gltfMaterial);
-
-        const auto emissivePath = getEmissiveTexturePath(gltfModel, gltfMaterial, fileDir);
-        material.emissiveTexture = gfxDevice.loadImageFromFile(
-            emissivePath, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, true);
+        material.material.emissiveFactor = getEmissiveStrength(gltfMaterial);
+        material.emissiveTexture = getEmissiveTextureUri(gltfModel, gltfMaterial);
     }
 
     return material;
@@ -605,56 +621,33 @@ void loadGltfFile(tinygltf::Model& gltfModel, const std::filesystem::path& path)
 
 namespace util
 {
-Scene loadGltfFile(
-    GfxDevice& gfxDevice,
-    MeshCache& meshCache,
-    MaterialCache& materialCache,
-    const std::filesystem::path& path)
+ImportedScene importGltfFile(const std::filesystem::path& path, bool packVertices)
 {
-    const auto fileDir = path.parent_path();
-
     tinygltf::Model gltfModel;
     ::loadGltfFile(gltfModel, path);
 
     const auto& gltfScene = gltfModel.scenes[gltfModel.defaultScene];
 
-    // gltf material id -> material cache id
-    std::unordered_map<std::size_t, MaterialId> materialMapping;
+    ImportedScene imported{.scene = Scene{.path = path}};
+    auto& scene = imported.scene;
+
     // load materials
-    {
-        for (std::size_t materialIdx = 0; materialIdx < gltfModel.materials.size(); ++materialIdx) {
-            const auto& gltfMaterial = gltfModel.materials[materialIdx];
-            const auto materialId = materialCache.addMaterial(
-                gfxDevice, loadMaterial(gfxDevice, gltfModel, fileDir, gltfMaterial));
-            materialMapping.emplace(materialIdx, materialId);
-        }
+    imported.materials.reserve(gltfModel.materials.size());
+    for (const auto& gltfMaterial : gltfModel.materials) {
+        imported.materials.push_back(importMaterial(gltfModel, gltfMaterial));
     }
 
-    Scene scene{.path = path};
     // load meshes
-    scene.meshes.reserve(gltfModel.meshes.size());
+    imported.meshes.reserve(gltfModel.meshes.size());
     for (const auto& gltfMesh : gltfModel.meshes) {
-        SceneMesh mesh;
-        mesh.primitives.resize(gltfMesh.primitives.size());
-        for (std::size_t primitiveIdx = 0; primitiveIdx < gltfMesh.primitives.size();
-             ++primitiveIdx) {
-            // load on CPU
-            const auto& gltfPrimitive = gltfMesh.primitives[primitiveIdx];
-            auto cpuMesh = loadPrimitive(gltfModel, gltfMesh.name, gltfPrimitive);
-            if (cpuMesh.indices.empty()) {
-                continue;
-            }
-
-            // upload to GPU
-            auto materialId = NULL_MATERIAL_ID;
-            if (gltfPrimitive.material != -1) {
-                materialId = materialMapping.at(gltfPrimitive.material);
-            }
-            const auto meshId = meshCache.addMesh(gfxDevice, cpuMesh, materialId);
-            mesh.primitives[primitiveIdx] = meshId;
-            scene.cpuMeshes.emplace(meshId, std::move(cpuMesh));
+        auto& mesh = imported.meshes.emplace_back();
+        mesh.reserve(gltfMesh.primitives.size());
+        for (const auto& gltfPrimitive : gltfMesh.primitives) {
+            mesh.push_back(ImportedPrimitive{
+                .mesh = loadPrimitive(gltfModel, gltfMesh.name, gltfPrimitive, packVertices),
+                .materialIndex = gltfPrimitive.material,
+            });
         }
-        scene.meshes.push_back(std::move(mesh));
     }
 
     // gltf node id -> JointId
@@ -709,7 +702,25 @@ Scene loadGltfFile(
         loadNode(node, gltfNode, gltfModel);
     }
 
-    return scene;
+    return imported;
+}
+
+Scene loadGltfFile(
+    GfxDevice& gfxDevice,
+    MeshCache& meshCache,
+    MaterialCache& materialCache,
+    const std::filesystem::path& path,
+    bool packVertices,
+    ThreadPool* threadPool)
+{
+    const auto settings = SceneImportSettings{
+        .packVertices = packVertices,
+        .lodSettings = meshCache.getLodSettings(),
+        .compressedTextures = gfxDevice.hasTextureCompressionBC(),
+    };
+    auto preparedScene = prepareGltfScene(path, settings, threadPool);
+    while (!uploadPreparedScenePart(gfxDevice, meshCache, materialCache, *preparedScene)) {}
+    return std::move(preparedScene->scene);
 }
 
 } // end of namespace util
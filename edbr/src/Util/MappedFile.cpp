@@ -0,0 +1,83 @@
+#include <edbr/Util/MappedFile.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    fileHandle = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        fileHandle = nullptr;
+        return;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        return;
+    }
+
+    mappingHandle = CreateFileMappingW(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mappingHandle) {
+        return;
+    }
+
+    data = (const std::byte*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (data) {
+        size = (std::size_t)fileSize.QuadPart;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        auto* ptr = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            data = (const std::byte*)ptr;
+            size = (std::size_t)st.st_size;
+        }
+    }
+
+    // the mapping stays valid after the file is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data) {
+        munmap((void*)data, size);
+    }
+}
+#endif
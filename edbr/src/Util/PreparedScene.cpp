@@ -0,0 +1,195 @@
+#include <edbr/Util/PreparedScene.h>
+
+#include <edbr/Core/ThreadPool.h>
+#include <edbr/Graphics/GfxDevice.h>
+#include <edbr/Graphics/MaterialCache.h>
+#include <edbr/Graphics/MeshCache.h>
+
+namespace
+{
+// Returns the index of the texture in preparedScene.textures, adds it if it
+// wasn't added before. Returns -1 for empty uris.
+int addTexture(
+    PreparedScene& preparedScene,
+    const std::filesystem::path& fileDir,
+    const std::string& uri,
+    VkFormat format)
+{
+    if (uri.empty()) {
+        return -1;
+    }
+
+    auto& textures = preparedScene.textures;
+    const auto path = fileDir / uri;
+    for (std::size_t i = 0; i < textures.size(); ++i) {
+        if (textures[i].path == path && textures[i].format == format) {
+            return (int)i;
+        }
+    }
+    textures.push_back(PreparedTexture{.path = path, .format = format});
+    return (int)textures.size() - 1;
+}
+
+ImageId getTextureId(const PreparedScene& preparedScene, int textureIndex)
+{
+    if (textureIndex == -1) {
+        return NULL_IMAGE_ID;
+    }
+    return preparedScene.textureIds.at(textureIndex);
+}
+
+} // end of anonymous namespace
+
+namespace util
+{
+void prepareMaterials(
+    PreparedScene& preparedScene,
+    const std::vector<ImportedMaterial>& importedMaterials,
+    const std::filesystem::path& fileDir,
+    bool compressedTextures,
+    ThreadPool* threadPool)
+{
+    const auto addMaterialTexture = [&](const std::string& uri, VkFormat format) {
+        return addTexture(preparedScene, fileDir, uri, format);
+    };
+
+    auto& materials = preparedScene.materials;
+    materials.reserve(importedMaterials.size());
+    for (const auto& im : importedMaterials) {
+        materials.push_back(PreparedMaterial{
+            .material = im.material,
+            .diffuseTexture = addMaterialTexture(im.diffuseTexture, VK_FORMAT_R8G8B8A8_SRGB),
+            .normalMapTexture = addMaterialTexture(im.normalMapTexture, VK_FORMAT_R8G8B8A8_UNORM),
+            .metallicRoughnessTexture =
+                addMaterialTexture(im.metallicRoughnessTexture, VK_FORMAT_R8G8B8A8_UNORM),
+            .emissiveTexture = addMaterialTexture(im.emissiveTexture, VK_FORMAT_R8G8B8A8_SRGB),
+        });
+    }
+
+    // decoding is the slowest part of loading most models
+    auto& textures = preparedScene.textures;
+    const auto decodeTexture = [&](std::size_t index, std::size_t threadIndex) {
+        auto& texture = textures[index];
+        // same as ImageCache::loadImageFromFile does for mipmapped textures
+        if (compressedTextures) {
+            texture.cookedData = util::loadCookedImage(
+                texture.path, texture.format, TextureStreamer::MIN_RESIDENT_MIP_SIZE);
+        }
+        if (!texture.cookedData) {
+            texture.data = util::loadImage(texture.path);
+        }
+    };
+    if (threadPool) {
+        threadPool->parallelFor(textures.size(), decodeTexture);
+    } else {
+        for (std::size_t i = 0; i < textures.size(); ++i) {
+            decodeTexture(i, 0);
+        }
+    }
+}
+
+std::unique_ptr<PreparedScene> prepareGltfScene(
+    const std::filesystem::path& path,
+    const SceneImportSettings& settings,
+    ThreadPool* threadPool)
+{
+    const auto fileDir = path.parent_path();
+
+    auto imported = importGltfFile(path, settings.packVertices);
+
+    auto preparedScene = std::make_unique<PreparedScene>();
+    preparedScene->scene = std::move(imported.scene);
+
+    prepareMaterials(
+        *preparedScene, imported.materials, fileDir, settings.compressedTextures, threadPool);
+
+    preparedScene->meshes.resize(imported.meshes.size());
+    for (std::size_t meshIdx = 0; meshIdx < imported.meshes.size(); ++meshIdx) {
+        auto& importedMesh = imported.meshes[meshIdx];
+        auto& preparedMesh = preparedScene->meshes[meshIdx];
+        preparedMesh.resize(importedMesh.size());
+        for (std::size_t primitiveIdx = 0; primitiveIdx < importedMesh.size(); ++primitiveIdx) {
+            auto& importedPrimitive = importedMesh[primitiveIdx];
+            if (importedPrimitive.mesh.indices.empty()) {
+                continue;
+            }
+
+            auto& primitive = preparedMesh[primitiveIdx];
+            primitive.loaded = true;
+            primitive.materialIndex = importedPrimitive.materialIndex;
+            primitive.cpuMesh = std::move(importedPrimitive.mesh);
+            primitive.data = graphics::prepareMeshUpload(
+                primitive.cpuMesh, settings.lodSettings, primitive.storage);
+        }
+    }
+
+    return preparedScene;
+}
+
+bool uploadPreparedScenePart(
+    GfxDevice& gfxDevice,
+    MeshCache& meshCache,
+    MaterialCache& materialCache,
+    PreparedScene& preparedScene)
+{
+    auto& scene = preparedScene.scene;
+    auto& textureIds = preparedScene.textureIds;
+    auto& materialIds = preparedScene.materialIds;
+
+    if (textureIds.size() < preparedScene.textures.size()) {
+        auto& texture = preparedScene.textures[textureIds.size()];
+        if (texture.cookedData) {
+            textureIds.push_back(gfxDevice.loadImageFromData(
+                texture.path, *texture.cookedData, texture.format, VK_IMAGE_USAGE_SAMPLED_BIT));
+        } else {
+            textureIds.push_back(gfxDevice.loadImageFromData(
+                texture.path, texture.data, texture.format, VK_IMAGE_USAGE_SAMPLED_BIT, true));
+        }
+        // pixels are not needed anymore
+        texture.data = {};
+        texture.cookedData.reset();
+    } else if (materialIds.size() < preparedScene.materials.size()) {
+        // all textures are uploaded now - materials are cheap to add at once
+        for (const auto& pm : preparedScene.materials) {
+            auto material = pm.material;
+            material.diffuseTexture = getTextureId(preparedScene, pm.diffuseTexture);
+            material.normalMapTexture = getTextureId(preparedScene, pm.normalMapTexture);
+            material.metallicRoughnessTexture =
+                getTextureId(preparedScene, pm.metallicRoughnessTexture);
+            material.emissiveTexture = getTextureId(preparedScene, pm.emissiveTexture);
+            materialIds.push_back(materialCache.addMaterial(gfxDevice, material));
+        }
+    } else if (scene.meshes.size() < preparedScene.meshes.size()) {
+        auto& preparedMesh = preparedScene.meshes[scene.meshes.size()];
+
+        SceneMesh mesh;
+        mesh.primitives.resize(preparedMesh.size());
+        for (std::size_t primitiveIdx = 0; primitiveIdx < preparedMesh.size(); ++primitiveIdx) {
+            auto& primitive = preparedMesh[primitiveIdx];
+            if (!primitive.loaded) {
+                continue;
+            }
+
+            auto materialId = NULL_MATERIAL_ID;
+            if (primitive.materialIndex != -1) {
+                materialId = materialIds.at(primitive.materialIndex);
+            }
+            const auto meshId = meshCache.addMesh(gfxDevice, primitive.data, materialId);
+            mesh.primitives[primitiveIdx] = meshId;
+            scene.cpuMeshes.emplace(meshId, std::move(primitive.cpuMesh));
+        }
+        scene.meshes.push_back(std::move(mesh));
+        preparedMesh.clear(); // frees converted vertices and indices
+    }
+
+    const auto uploaded = textureIds.size() == preparedScene.textures.size() &&
+                          materialIds.size() == preparedScene.materials.size() &&
+                          scene.meshes.size() == preparedScene.meshes.size();
+    if (uploaded) {
+        scene.materials = materialIds;
+        scene.images = textureIds;
+    }
+    return uploaded;
+}
+
+} // end of namespace util
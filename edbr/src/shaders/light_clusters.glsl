@@ -0,0 +1,41 @@
+#ifndef LIGHT_CLUSTERS_GLSL
+#define LIGHT_CLUSTERS_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+// keep in sync with LightClusteringPipeline
+#define LIGHT_CLUSTERS_X 16
+#define LIGHT_CLUSTERS_Y 9
+#define LIGHT_CLUSTERS_Z 24
+#define NUM_LIGHT_CLUSTERS (LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z)
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+struct LightCluster {
+    uint numLights;
+    uint lightIndices[MAX_LIGHTS_PER_CLUSTER]; // indices in LightsDataBuffer
+};
+
+layout (buffer_reference, std430) buffer LightClustersBuffer {
+    LightCluster clusters[];
+};
+
+// Clusters are screen tiles split into depth slices.
+// Slices are distributed exponentially, so that the clusters near the camera are not too long.
+float getClusterSliceDepth(uint slice, float zNear, float zFar)
+{
+    return zNear * pow(zFar / zNear, float(slice) / float(LIGHT_CLUSTERS_Z));
+}
+
+// viewDepth - distance from the camera along its view direction
+uint getClusterIndex(vec2 fragCoord, vec2 screenSize, float viewDepth, float zNear, float zFar)
+{
+    uvec2 tile = uvec2(fragCoord / screenSize * vec2(LIGHT_CLUSTERS_X, LIGHT_CLUSTERS_Y));
+    tile = min(tile, uvec2(LIGHT_CLUSTERS_X - 1, LIGHT_CLUSTERS_Y - 1));
+
+    float slicePos = log(max(viewDepth, zNear) / zNear) / log(zFar / zNear);
+    uint slice = min(uint(slicePos * LIGHT_CLUSTERS_Z), LIGHT_CLUSTERS_Z - 1);
+
+    return tile.x + tile.y * LIGHT_CLUSTERS_X + slice * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y;
+}
+
+#endif // LIGHT_CLUSTERS_GLSL
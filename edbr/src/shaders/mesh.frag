@@ -12,12 +12,13 @@ layout (location = 1) in vec2 inUV;
 layout (location = 2) in vec3 inNormal;
 layout (location = 3) in vec4 inTangent;
 layout (location = 4) in mat3 inTBN;
+layout (location = 7) flat in uint inMaterialID;
 
 layout (location = 0) out vec4 outFragColor;
 
 void main()
 {
-    MaterialData material = pcs.sceneData.materials.data[pcs.materialID];
+    MaterialData material = pcs.sceneData.materials.data[inMaterialID];
 
     vec4 diffuse = sampleTexture2DLinear(material.diffuseTex, inUV);
     if (diffuse.a < 0.1) {
@@ -31,9 +32,13 @@ void main()
         // FIXME: sometimes Blender doesn't export tangents for some objects
         // for some reason. When we will start computing tangents manually,
         // this check can be removed
-        normal = sampleTexture2DLinear(material.normalTex, inUV).rgb;
-        // normal.y = 1 - normal.y; // flip to make OpenGL normal maps work
-        normal = inTBN * normalize(normal * 2.0 - 1.0);
+
+        // Z is reconstructed, so that two channel (BC5) normal maps work too
+        vec2 normalXY = sampleTexture2DLinear(material.normalTex, inUV).rg * 2.0 - 1.0;
+        // normalXY.y = -normalXY.y; // flip to make OpenGL normal maps work
+        normal.xy = normalXY;
+        normal.z = sqrt(max(1.0 - dot(normalXY, normalXY), 0.0));
+        normal = inTBN * normal;
         normal = normalize(normal);
     }
 
@@ -66,24 +71,31 @@ void main()
     vec3 v = normalize(cameraPos - fragPos);
 
     vec3 fragColor = vec3(0.0);
-    for (int i = 0; i < pcs.sceneData.numLights; i++) {
-        Light light = pcs.sceneData.lights.data[i];
 
+    // sun
+    if (pcs.sceneData.sunlightIndex != -1) {
+        Light light = pcs.sceneData.lights.data[pcs.sceneData.sunlightIndex];
         vec3 l = light.direction;
-        if (light.type != TYPE_DIRECTIONAL_LIGHT) {
-            l = normalize(light.position - fragPos);
-        }
         float NoL = clamp(dot(n, l), 0.0, 1.0);
+        float occlusion = calculateCSMOcclusion(
+                fragPos, cameraPos, NoL,
+                pcs.sceneData.csmShadowMapId, pcs.sceneData.cascadeFarPlaneZs, pcs.sceneData.csmLightSpaceTMs);
+        fragColor += calculateLight(light, fragPos, n, v, l,
+                diffuseColor, roughness, metallic, f0, occlusion);
+    }
 
-        float occlusion = 1.0;
-        if (light.type == TYPE_DIRECTIONAL_LIGHT) {
-            occlusion = calculateCSMOcclusion(
-                    fragPos, cameraPos, NoL,
-                    pcs.sceneData.csmShadowMapId, pcs.sceneData.cascadeFarPlaneZs, pcs.sceneData.csmLightSpaceTMs);
-        }
+    // point and spot lights - only the ones which affect the fragment's cluster
+    float viewDepth = -(pcs.sceneData.view * vec4(fragPos, 1.0)).z;
+    uint clusterIndex = getClusterIndex(gl_FragCoord.xy, pcs.sceneData.screenSize,
+            viewDepth, pcs.sceneData.cameraZNear, pcs.sceneData.cameraZFar);
+    uint numClusterLights = pcs.sceneData.lightClusters.clusters[clusterIndex].numLights;
+    for (uint i = 0; i < numClusterLights; i++) {
+        uint lightIndex = pcs.sceneData.lightClusters.clusters[clusterIndex].lightIndices[i];
+        Light light = pcs.sceneData.lights.data[lightIndex];
 
+        vec3 l = normalize(light.position - fragPos);
         fragColor += calculateLight(light, fragPos, n, v, l,
-                diffuseColor, roughness, metallic, f0, occlusion);
+                diffuseColor, roughness, metallic, f0, 1.0);
     }
 
     // emissive
@@ -9,12 +9,16 @@ layout (location = 1) out vec2 outUV;
 layout (location = 2) out vec3 outNormal;
 layout (location = 3) out vec4 outTangent;
 layout (location = 4) out mat3 outTBN;
+layout (location = 7) flat out uint outMaterialID;
 
 void main()
 {
-    Vertex v = pcs.vertexBuffer.vertices[gl_VertexIndex];
+    // firstInstance is set to the start of the batch in the instances buffer
+    uint drawIndex = pcs.instances.drawIndices[gl_InstanceIndex];
+    MeshDrawData dd = pcs.drawData.draws[drawIndex];
+    Vertex v = loadVertex(dd, gl_VertexIndex);
 
-    vec4 worldPos = pcs.transform * vec4(v.position, 1.0f);
+    vec4 worldPos = dd.transform * vec4(v.position, 1.0f);
 
     gl_Position = pcs.sceneData.viewProj * worldPos;
     outPos = worldPos.xyz;
@@ -22,13 +26,15 @@ void main()
     // A bit inefficient, but okay - this is needed for non-uniform scale
     // models. See: http://www.lighthouse3d.com/tutorials/glsl-12-tutorial/the-normal-matrix/
     // Simpler case, when everything is uniform
-    // outNormal = (pcs.transform * vec4(v.normal, 0.0)).xyz;
-    outNormal = mat3(transpose(inverse(pcs.transform))) * v.normal;
+    // outNormal = (dd.transform * vec4(v.normal, 0.0)).xyz;
+    outNormal = mat3(transpose(inverse(dd.transform))) * v.normal;
 
     outTangent = v.tangent;
 
-    vec3 T = normalize(vec3(pcs.transform * v.tangent));
+    vec3 T = normalize(vec3(dd.transform * v.tangent));
     vec3 N = normalize(outNormal);
     vec3 B = cross(N, T) * v.tangent.w;
     outTBN = mat3(T, B, N);
+
+    outMaterialID = dd.materialID;
 }
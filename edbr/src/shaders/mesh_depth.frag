@@ -3,26 +3,26 @@
 #extension GL_GOOGLE_include_directive : require
 
 #include "bindless.glsl"
-#include "vertex.glsl"
+#include "mesh_draw_data.glsl"
 #include "materials.glsl"
 
-layout (push_constant) uniform constants
+layout (push_constant, scalar) uniform constants
 {
-	mat4 mvp;
-	VertexBuffer vertexBuffer;
+	mat4 viewProj;
+    MeshDrawDataBuffer drawData;
+    MeshInstancesBuffer instances;
     MaterialsBuffer materials;
-    uint materialID;
 } pcs;
 
 layout (location = 0) in vec2 inUV;
+layout (location = 1) flat in uint inMaterialID;
 
 void main()
 {
-    MaterialData material = pcs.materials.data[pcs.materialID];
+    MaterialData material = pcs.materials.data[inMaterialID];
 
     vec4 diffuse = sampleTexture2DLinear(material.diffuseTex, inUV);
     if (diffuse.a < 0.1) {
         discard;
     }
 }
-
@@ -2,23 +2,27 @@
 
 #extension GL_GOOGLE_include_directive : require
 
-#include "vertex.glsl"
+#include "mesh_draw_data.glsl"
 #include "materials.glsl"
 
 layout (location = 0) out vec2 outUV;
+layout (location = 1) flat out uint outMaterialID;
 
-layout (push_constant) uniform constants
+layout (push_constant, scalar) uniform constants
 {
-	mat4 mvp;
-	VertexBuffer vertexBuffer;
+	mat4 viewProj;
+    MeshDrawDataBuffer drawData;
+    MeshInstancesBuffer instances;
     MaterialsBuffer materials;
-    uint materialID;
 } pcs;
 
 void main()
 {
-    Vertex v = pcs.vertexBuffer.vertices[gl_VertexIndex];
+    uint drawIndex = pcs.instances.drawIndices[gl_InstanceIndex];
+    MeshDrawData dd = pcs.drawData.draws[drawIndex];
+    Vertex v = loadVertex(dd, gl_VertexIndex);
 
     outUV = vec2(v.uv_x, v.uv_y);
-    gl_Position = pcs.mvp * vec4(v.position, 1.0f);
+    outMaterialID = dd.materialID;
+    gl_Position = pcs.viewProj * dd.transform * vec4(v.position, 1.0f);
 }
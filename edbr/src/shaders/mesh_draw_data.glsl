@@ -0,0 +1,37 @@
+#ifndef MESH_DRAW_DATA_GLSL
+#define MESH_DRAW_DATA_GLSL
+
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_scalar_block_layout: require
+
+#include "vertex.glsl"
+
+// keep in sync with MeshCullingPipeline::GPUMeshDrawData
+struct MeshDrawData {
+    mat4 transform;
+    vec4 boundingSphere; // xyz - center, w - radius (world space)
+    // PackedQuantized positions are decoded as positionMin + q * positionExtent
+    vec3 positionMin;
+    uint vertexFormat;
+    vec3 positionExtent;
+    uint materialID;
+    VertexBuffer vertexBuffer;
+    uint batchIndex;
+    uint batchFirstDraw;
+};
+
+Vertex loadVertex(MeshDrawData dd, uint index)
+{
+    return loadVertex(dd.vertexBuffer, dd.vertexFormat, index, dd.positionMin, dd.positionExtent);
+}
+
+layout (buffer_reference, scalar) readonly buffer MeshDrawDataBuffer {
+    MeshDrawData draws[];
+};
+
+// indices of visible draws in MeshDrawDataBuffer, indexed by gl_InstanceIndex
+layout (buffer_reference, std430) readonly buffer MeshInstancesBuffer {
+    uint drawIndices[];
+};
+
+#endif // MESH_DRAW_DATA_GLSL
@@ -2,14 +2,12 @@
 #extension GL_EXT_scalar_block_layout: require
 
 #include "scene_data.glsl"
-#include "vertex.glsl"
+#include "mesh_draw_data.glsl"
 
 layout (push_constant, scalar) uniform constants
 {
-    mat4 transform;
     SceneDataBuffer sceneData;
-    VertexBuffer vertexBuffer;
-    uint materialID;
-    uint padding;
+    MeshDrawDataBuffer drawData;
+    MeshInstancesBuffer instances;
 } pcs;
 
@@ -5,6 +5,7 @@
 #extension GL_EXT_buffer_reference : require
 
 #include "light.glsl"
+#include "light_clusters.glsl"
 #include "materials.glsl"
 
 layout (buffer_reference, scalar) readonly buffer LightsDataBuffer {
@@ -36,6 +37,12 @@ layout (buffer_reference, scalar) readonly buffer SceneDataBuffer {
     int sunlightIndex; // if -1, there's no sun
 
     MaterialsBuffer materials;
+
+    // light clusters (only non-directional lights are put into clusters)
+    LightClustersBuffer lightClusters;
+    vec2 screenSize;
+    float cameraZNear;
+    float cameraZFar;
 } sceneDataBuffer;
 
 #endif // SCENE_DATA_GLSL
@@ -3,6 +3,11 @@
 
 #extension GL_EXT_buffer_reference : require
 
+// keep in sync with VertexFormat (VertexFormat.h)
+#define VERTEX_FORMAT_FULL 0
+#define VERTEX_FORMAT_PACKED 1
+#define VERTEX_FORMAT_PACKED_QUANTIZED 2
+
 struct Vertex {
     vec3 position;
     float uv_x;
@@ -15,4 +20,63 @@ layout (buffer_reference, std430) readonly buffer VertexBuffer {
 	Vertex vertices[];
 };
 
+// keep in sync with PackedVertex (VertexFormat.h)
+struct PackedVertex {
+    uint position[3];
+    uint normal;
+    uint tangent;
+    uint uv;
+};
+
+layout (buffer_reference, std430) readonly buffer PackedVertexBuffer {
+    PackedVertex vertices[];
+};
+
+// lowest bit of the second snorm16 component of the tangent
+#define PACKED_TANGENT_SIGN_BIT (1u << 16)
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// positionMin and positionExtent are only used by quantized positions
+vec3 decodePackedPosition(PackedVertex pv, uint format, vec3 positionMin, vec3 positionExtent)
+{
+    if (format == VERTEX_FORMAT_PACKED_QUANTIZED) {
+        vec2 xy = unpackUnorm2x16(pv.position[0]);
+        float z = unpackUnorm2x16(pv.position[1]).x;
+        return positionMin + vec3(xy, z) * positionExtent;
+    }
+    return uintBitsToFloat(uvec3(pv.position[0], pv.position[1], pv.position[2]));
+}
+
+Vertex loadVertex(
+    VertexBuffer buffer,
+    uint format,
+    uint index,
+    vec3 positionMin,
+    vec3 positionExtent)
+{
+    if (format == VERTEX_FORMAT_FULL) {
+        return buffer.vertices[index];
+    }
+
+    PackedVertex pv = PackedVertexBuffer(buffer).vertices[index];
+
+    Vertex v;
+    v.position = decodePackedPosition(pv, format, positionMin, positionExtent);
+    v.normal = octDecode(unpackSnorm2x16(pv.normal));
+    float tangentSign = (pv.tangent & PACKED_TANGENT_SIGN_BIT) != 0 ? -1.0 : 1.0;
+    v.tangent = vec4(octDecode(unpackSnorm2x16(pv.tangent)), tangentSign);
+    vec2 uv = unpackHalf2x16(pv.uv);
+    v.uv_x = uv.x;
+    v.uv_y = uv.y;
+    return v;
+}
+
 #endif // VERTEX_GLSL
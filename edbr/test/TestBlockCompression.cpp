@@ -0,0 +1,251 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <edbr/Graphics/BlockCompression.h>
+
+using graphics::BlockFormat;
+
+namespace
+{
+using Block = std::array<std::uint8_t, 64>; // 4x4 RGBA8 pixels
+
+std::uint64_t readLE(const std::uint8_t* data, int numBytes)
+{
+    std::uint64_t value = 0;
+    for (int i = 0; i < numBytes; ++i) {
+        value |= (std::uint64_t)data[i] << (i * 8);
+    }
+    return value;
+}
+
+void decodeBC1(const std::uint8_t* in, Block& out)
+{
+    const auto c0 = (int)readLE(in, 2);
+    const auto c1 = (int)readLE(in + 2, 2);
+    const auto indices = readLE(in + 4, 4);
+
+    std::array<std::array<int, 3>, 4> palette;
+    for (int e = 0; e < 2; ++e) {
+        const auto c = e == 0 ? c0 : c1;
+        palette[e] = {
+            (c >> 11) << 3 | (c >> 13),
+            ((c >> 5) & 0x3f) << 2 | ((c >> 9) & 0x3),
+            (c & 0x1f) << 3 | ((c >> 2) & 0x7),
+        };
+    }
+    for (int c = 0; c < 3; ++c) {
+        if (c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        const auto index = (indices >> (i * 2)) & 0x3;
+        for (int c = 0; c < 3; ++c) {
+            out[i * 4 + c] = (std::uint8_t)palette[index][c];
+        }
+    }
+}
+
+void decodeBC4(const std::uint8_t* in, int channel, Block& out)
+{
+    const int r0 = in[0];
+    const int r1 = in[1];
+    const auto indices = readLE(in + 2, 6);
+
+    std::array<int, 8> palette{r0, r1};
+    for (int p = 2; p < 8; ++p) {
+        palette[p] = r0 > r1 ? ((8 - p) * r0 + (p - 1) * r1) / 7 :
+                     p < 6   ? ((6 - p) * r0 + (p - 1) * r1) / 5 :
+                     p == 6  ? 0 :
+                               255;
+    }
+    for (int i = 0; i < 16; ++i) {
+        out[i * 4 + channel] = (std::uint8_t)palette[(indices >> (i * 3)) & 0x7];
+    }
+}
+
+// only mode 6 is supported - that's all the encoder produces
+void decodeBC7(const std::uint8_t* in, Block& out)
+{
+    int pos = 0;
+    const auto read = [&](int numBits) {
+        int value = 0;
+        for (int i = 0; i < numBits; ++i, ++pos) {
+            value |= ((in[pos / 8] >> (pos % 8)) & 1) << i;
+        }
+        return value;
+    };
+
+    ASSERT_EQ(read(7), 1 << 6);
+    std::array<std::array<int, 4>, 2> e;
+    for (int c = 0; c < 4; ++c) {
+        e[0][c] = read(7);
+        e[1][c] = read(7);
+    }
+    const auto p0 = read(1);
+    const auto p1 = read(1);
+    for (int c = 0; c < 4; ++c) {
+        e[0][c] = e[0][c] << 1 | p0;
+        e[1][c] = e[1][c] << 1 | p1;
+    }
+
+    static constexpr std::array<int, 16> weights =
+        {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    for (int i = 0; i < 16; ++i) {
+        const auto w = weights[read(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; ++c) {
+            out[i * 4 + c] = (std::uint8_t)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+        }
+    }
+}
+
+// Returns RGBA pixels - channels which the format doesn't store are copied
+// from the original block, so that the error can be compared directly
+Block decodeBlock(BlockFormat format, const std::uint8_t* in, const Block& original)
+{
+    Block out = original;
+    switch (format) {
+    case BlockFormat::BC1:
+        decodeBC1(in, out);
+        break;
+    case BlockFormat::BC3:
+        decodeBC4(in, 3, out);
+        decodeBC1(in + 8, out);
+        break;
+    case BlockFormat::BC4:
+        decodeBC4(in, 0, out);
+        break;
+    case BlockFormat::BC5:
+        decodeBC4(in, 0, out);
+        decodeBC4(in + 8, 1, out);
+        break;
+    case BlockFormat::BC7:
+        decodeBC7(in, out);
+        break;
+    }
+    return out;
+}
+
+int maxError(const Block& a, const Block& b)
+{
+    int error = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        error = std::max(error, std::abs((int)a[i] - (int)b[i]));
+    }
+    return error;
+}
+
+Block encodeAndDecode(BlockFormat format, const Block& block)
+{
+    std::array<std::uint8_t, 16> encoded{};
+    graphics::compressBlock(format, block.data(), encoded.data());
+    return decodeBlock(format, encoded.data(), block);
+}
+
+constexpr std::array<BlockFormat, 5> ALL_FORMATS =
+    {BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7};
+
+} // end of anonymous namespace
+
+TEST(BlockCompressionTest, SolidBlocks)
+{
+    for (const auto format : ALL_FORMATS) {
+        for (const auto& color : {
+                 std::array<std::uint8_t, 4>{0, 0, 0, 255},
+                 std::array<std::uint8_t, 4>{255, 255, 255, 255},
+                 std::array<std::uint8_t, 4>{128, 64, 32, 200},
+             }) {
+            Block block;
+            for (int i = 0; i < 16; ++i) {
+                std::copy(color.begin(), color.end(), &block[i * 4]);
+            }
+            // endpoint quantization: 5 bits in BC1 (and BC3 color), 7 bits + p-bit in BC7
+            const auto tolerance = (format == BlockFormat::BC1 || format == BlockFormat::BC3) ? 4 :
+                                   format == BlockFormat::BC7                                 ? 1 :
+                                                                                                0;
+            EXPECT_LE(maxError(encodeAndDecode(format, block), block), tolerance)
+                << "format " << (int)format;
+        }
+    }
+}
+
+TEST(BlockCompressionTest, Gradients)
+{
+    // colors on a line are what range fit is good at: the error is only
+    // limited by the number of palette entries (4 in BC1, 8 in BC4, 16 in BC7)
+    Block block;
+    for (int i = 0; i < 16; ++i) {
+        block[i * 4 + 0] = (std::uint8_t)(i * 17);
+        block[i * 4 + 1] = (std::uint8_t)(255 - i * 17);
+        block[i * 4 + 2] = (std::uint8_t)(64 + i * 8);
+        block[i * 4 + 3] = (std::uint8_t)(255 - i * 4);
+    }
+    EXPECT_LE(maxError(encodeAndDecode(BlockFormat::BC1, block), block), 44);
+    EXPECT_LE(maxError(encodeAndDecode(BlockFormat::BC3, block), block), 44);
+    EXPECT_LE(maxError(encodeAndDecode(BlockFormat::BC4, block), block), 20);
+    EXPECT_LE(maxError(encodeAndDecode(BlockFormat::BC5, block), block), 20);
+    EXPECT_LE(maxError(encodeAndDecode(BlockFormat::BC7, block), block), 10);
+}
+
+TEST(BlockCompressionTest, RandomBlocks)
+{
+    // random blocks can't be encoded well, but BC7 should still beat BC1
+    std::mt19937 rng{0};
+    std::uniform_int_distribution<int> dist{0, 255};
+    double bc1ErrorSum = 0.0;
+    double bc7ErrorSum = 0.0;
+    for (int n = 0; n < 1000; ++n) {
+        Block block;
+        for (auto& v : block) {
+            v = (std::uint8_t)dist(rng);
+        }
+        for (int i = 0; i < 16; ++i) {
+            block[i * 4 + 3] = 255;
+        }
+
+        const auto errorSq = [&block](const Block& decoded) {
+            double sum = 0.0;
+            for (int i = 0; i < 16; ++i) {
+                for (int c = 0; c < 3; ++c) {
+                    const auto d = (double)block[i * 4 + c] - (double)decoded[i * 4 + c];
+                    sum += d * d;
+                }
+            }
+            return sum;
+        };
+        bc1ErrorSum += errorSq(encodeAndDecode(BlockFormat::BC1, block));
+        bc7ErrorSum += errorSq(encodeAndDecode(BlockFormat::BC7, block));
+
+        // BC7 mode 6 stores alpha of opaque blocks exactly
+        const auto bc7 = encodeAndDecode(BlockFormat::BC7, block);
+        for (int i = 0; i < 16; ++i) {
+            EXPECT_EQ(bc7[i * 4 + 3], 255);
+        }
+    }
+    EXPECT_LT(bc7ErrorSum, bc1ErrorSum);
+}
+
+TEST(BlockCompressionTest, ImageSize)
+{
+    EXPECT_EQ(graphics::getCompressedImageSize(BlockFormat::BC1, 4, 4), 8);
+    EXPECT_EQ(graphics::getCompressedImageSize(BlockFormat::BC7, 4, 4), 16);
+    EXPECT_EQ(graphics::getCompressedImageSize(BlockFormat::BC1, 1, 1), 8);
+    EXPECT_EQ(graphics::getCompressedImageSize(BlockFormat::BC5, 5, 9), 2 * 3 * 16);
+
+    // partial blocks are padded with edge pixels
+    const std::vector<std::uint8_t> pixels(3 * 2 * 4, 100);
+    const auto compressed = graphics::compressImage(BlockFormat::BC4, pixels, 3, 2);
+    ASSERT_EQ(compressed.size(), 8);
+    EXPECT_EQ(compressed[0], 100);
+    EXPECT_EQ(compressed[1], 100);
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <glm/trigonometric.hpp>
+
+#include <edbr/Graphics/Camera.h>
+#include <edbr/Graphics/FrustumCulling.h>
+#include <edbr/Math/Sphere.h>
+
+TEST(FrustumCullingTest, BatchCullingMatchesIsInFrustum)
+{
+    Camera camera;
+    camera.init(glm::radians(60.f), 0.1f, 100.f, 16.f / 9.f);
+    camera.setPosition(glm::vec3{10.f, 5.f, -3.f});
+    const auto frustum = edge::createFrustumFromCamera(camera);
+
+    std::mt19937 rng{0};
+    std::uniform_real_distribution<float> posDist{-100.f, 100.f};
+    std::uniform_real_distribution<float> radiusDist{0.1f, 5.f};
+
+    // not a multiple of 8 or 64 to test padding
+    std::vector<math::Sphere> spheresAoS(1001);
+    SphereSoA spheres;
+    for (auto& s : spheresAoS) {
+        s.center = glm::vec3{posDist(rng), posDist(rng), posDist(rng)};
+        s.radius = radiusDist(rng);
+        spheres.add(s);
+    }
+    ASSERT_EQ(spheres.size(), spheresAoS.size());
+
+    VisibilityMask mask;
+    edge::cullSpheres(frustum, spheres, mask);
+    VisibilityMask scalarMask;
+    edge::cullSpheresScalar(frustum, spheres, scalarMask);
+
+    std::size_t numVisible = 0;
+    for (std::size_t i = 0; i < spheresAoS.size(); ++i) {
+        const bool visible = edge::isInFrustum(frustum, spheresAoS[i]);
+        EXPECT_EQ(mask.isVisible(i), visible) << "sphere " << i;
+        EXPECT_EQ(scalarMask.isVisible(i), visible) << "sphere " << i;
+        if (visible) {
+            ++numVisible;
+        }
+    }
+    EXPECT_GT(numVisible, 0);
+    EXPECT_EQ(mask.countVisible(), numVisible);
+}
@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+
+#include <nlohmann/json.hpp>
+
+#include <edbr/Graphics/Vulkan/GPUMemoryStats.h>
+
+TEST(GPUMemoryStatsTest, TracksCategoriesSeparately)
+{
+    GPUMemoryStats stats;
+    stats.onAllocate(MemoryCategory::Textures, 100);
+    stats.onAllocate(MemoryCategory::Textures, 50);
+    stats.onAllocate(MemoryCategory::Meshes, 1000);
+    stats.onFree(MemoryCategory::Textures, 100);
+
+    EXPECT_EQ(stats.getCategoryStats(MemoryCategory::Textures).size, 50);
+    EXPECT_EQ(stats.getCategoryStats(MemoryCategory::Textures).count, 1);
+    EXPECT_EQ(stats.getCategoryStats(MemoryCategory::Meshes).size, 1000);
+    EXPECT_EQ(stats.getCategoryStats(MemoryCategory::Meshes).count, 1);
+    EXPECT_EQ(stats.getCategoryStats(MemoryCategory::ShadowMaps).count, 0);
+    EXPECT_EQ(stats.getTotalSize(), 1050);
+}
+
+TEST(GPUMemoryStatsTest, Json)
+{
+    GPUMemoryStats stats;
+    stats.onAllocate(MemoryCategory::RenderTargets, 4096);
+
+    const auto json = nlohmann::json::parse(stats.toJson());
+    EXPECT_EQ(json["totalSize"], 4096);
+    EXPECT_EQ(json["categories"]["render targets"]["size"], 4096);
+    EXPECT_EQ(json["categories"]["render targets"]["count"], 1);
+    EXPECT_EQ(json["categories"]["textures"]["size"], 0);
+    EXPECT_EQ(json["categories"].size(), (std::size_t)MemoryCategory::Count);
+    EXPECT_TRUE(json["heaps"].empty()); // updateHeapStats wasn't called
+}
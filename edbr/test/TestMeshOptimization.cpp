@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+#include <edbr/Graphics/CPUMesh.h>
+#include <edbr/Graphics/MeshOptimization.h>
+
+namespace
+{
+// grid of size x size quads with triangles in random order
+CPUMesh makeShuffledGrid(std::uint32_t size)
+{
+    CPUMesh mesh;
+    for (std::uint32_t y = 0; y <= size; ++y) {
+        for (std::uint32_t x = 0; x <= size; ++x) {
+            mesh.vertices.push_back(CPUMesh::Vertex{.position = glm::vec3{x, y, 0.f}});
+        }
+    }
+
+    std::vector<std::array<std::uint32_t, 3>> triangles;
+    for (std::uint32_t y = 0; y < size; ++y) {
+        for (std::uint32_t x = 0; x < size; ++x) {
+            const auto i0 = y * (size + 1) + x;
+            const auto i1 = i0 + 1;
+            const auto i2 = i0 + size + 1;
+            const auto i3 = i2 + 1;
+            triangles.push_back({i0, i2, i1});
+            triangles.push_back({i1, i2, i3});
+        }
+    }
+    std::mt19937 rng{0};
+    std::shuffle(triangles.begin(), triangles.end(), rng);
+    for (const auto& t : triangles) {
+        mesh.indices.insert(mesh.indices.end(), t.begin(), t.end());
+    }
+    return mesh;
+}
+
+// triangles as sorted lists of vertex positions - doesn't depend on vertex order
+std::vector<std::array<float, 9>> getTriangles(const CPUMesh& mesh)
+{
+    std::vector<std::array<float, 9>> triangles;
+    for (std::size_t i = 0; i < mesh.indices.size(); i += 3) {
+        std::array<std::array<float, 3>, 3> t;
+        for (int k = 0; k < 3; ++k) {
+            const auto& p = mesh.vertices[mesh.indices[i + k]].position;
+            t[k] = {p.x, p.y, p.z};
+        }
+        // keep winding order
+        std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+        auto& tri = triangles.emplace_back();
+        for (int k = 0; k < 9; ++k) {
+            tri[k] = t[k / 3][k % 3];
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+}
+
+TEST(MeshOptimizationTest, ACMR)
+{
+    // every triangle misses the cache
+    const auto indices = std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5};
+    EXPECT_FLOAT_EQ(graphics::calculateACMR(indices, 6), 3.f);
+
+    // two triangles of a quad: 4 misses
+    const auto quad = std::vector<std::uint32_t>{0, 1, 2, 2, 1, 3};
+    EXPECT_FLOAT_EQ(graphics::calculateACMR(quad, 4), 2.f);
+}
+
+TEST(MeshOptimizationTest, OptimizeMeshImprovesACMRAndKeepsTriangles)
+{
+    auto mesh = makeShuffledGrid(64);
+    // not referenced by any triangle
+    mesh.vertices.push_back(CPUMesh::Vertex{.position = glm::vec3{-1.f}});
+    const auto numVertices = mesh.vertices.size();
+    const auto trianglesBefore = getTriangles(mesh);
+
+    graphics::optimizeMesh(mesh);
+
+    EXPECT_GT(mesh.acmrBefore, 2.5f);
+    EXPECT_LT(mesh.acmrAfter, 0.8f);
+    EXPECT_FLOAT_EQ(mesh.acmrAfter, graphics::calculateACMR(mesh.indices, mesh.vertices.size()));
+
+    EXPECT_EQ(mesh.vertices.size(), numVertices - 1);
+    EXPECT_EQ(getTriangles(mesh), trianglesBefore);
+
+    // vertices are ordered by first use
+    std::uint32_t nextVertex = 0;
+    for (const auto index : mesh.indices) {
+        ASSERT_LE(index, nextVertex);
+        if (index == nextVertex) {
+            ++nextVertex;
+        }
+    }
+}
+
+TEST(MeshOptimizationTest, OverdrawOptimizationKeepsACMRWithinThreshold)
+{
+    auto mesh = makeShuffledGrid(32);
+    graphics::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    const auto acmr = graphics::calculateACMR(mesh.indices, mesh.vertices.size());
+
+    std::vector<glm::vec3> positions;
+    for (const auto& v : mesh.vertices) {
+        positions.push_back(v.position);
+    }
+    graphics::optimizeOverdraw(mesh.indices, positions, 1.05f);
+
+    // clusters start with a flushed cache, so ACMR can only be slightly worse
+    EXPECT_LE(graphics::calculateACMR(mesh.indices, mesh.vertices.size()), acmr * 1.1f);
+}
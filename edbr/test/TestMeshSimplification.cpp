@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include <glm/geometric.hpp>
+
+#include <edbr/Graphics/MeshLod.h>
+#include <edbr/Graphics/MeshSimplification.h>
+
+namespace
+{
+struct GridMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<std::uint32_t> indices;
+};
+
+// size x size quads on XZ plane, height(x, z) gives Y
+template<typename F>
+GridMesh makeGrid(std::uint32_t size, F&& height)
+{
+    GridMesh mesh;
+    for (std::uint32_t z = 0; z <= size; ++z) {
+        for (std::uint32_t x = 0; x <= size; ++x) {
+            const auto fx = (float)x / size;
+            const auto fz = (float)z / size;
+            mesh.positions.push_back(glm::vec3{fx, height(fx, fz), fz});
+        }
+    }
+    for (std::uint32_t z = 0; z < size; ++z) {
+        for (std::uint32_t x = 0; x < size; ++x) {
+            const auto i0 = z * (size + 1) + x;
+            const auto i1 = i0 + 1;
+            const auto i2 = i0 + size + 1;
+            const auto i3 = i2 + 1;
+            mesh.indices.insert(mesh.indices.end(), {i0, i2, i1, i1, i2, i3});
+        }
+    }
+    return mesh;
+}
+
+// sum of signed areas projected on XZ plane (flipped triangles subtract)
+float getProjectedArea(const GridMesh& mesh, const std::vector<std::uint32_t>& indices)
+{
+    auto area = 0.f;
+    for (std::size_t i = 0; i < indices.size(); i += 3) {
+        const auto& p0 = mesh.positions[indices[i + 0]];
+        const auto& p1 = mesh.positions[indices[i + 1]];
+        const auto& p2 = mesh.positions[indices[i + 2]];
+        area += glm::cross(p1 - p0, p2 - p0).y * 0.5f;
+    }
+    return area;
+}
+}
+
+TEST(MeshSimplificationTest, FlatGridIsSimplifiedWithoutError)
+{
+    const auto mesh = makeGrid(16, [](float, float) { return 0.f; });
+    auto indices = mesh.indices;
+    const auto error = graphics::simplifyMesh(indices, mesh.positions, 0, 0.01f);
+
+    EXPECT_EQ(error, 0.f);
+    // only the border vertices are left
+    EXPECT_LT(indices.size(), mesh.indices.size() / 4);
+    // no triangles were flipped and no holes were made
+    EXPECT_NEAR(getProjectedArea(mesh, indices), getProjectedArea(mesh, mesh.indices), 1e-4f);
+
+    // border vertices are never moved
+    for (std::uint32_t i = 0; i <= 16; ++i) {
+        EXPECT_NE(std::find(indices.begin(), indices.end(), i), indices.end());
+    }
+}
+
+TEST(MeshSimplificationTest, ErrorLimit)
+{
+    const auto mesh = makeGrid(32, [](float x, float z) {
+        return 0.2f * std::sin(x * 6.f) * std::cos(z * 6.f);
+    });
+
+    auto coarse = mesh.indices;
+    const auto coarseError = graphics::simplifyMesh(coarse, mesh.positions, 0, 0.05f);
+    auto fine = mesh.indices;
+    const auto fineError = graphics::simplifyMesh(fine, mesh.positions, 0, 0.005f);
+
+    EXPECT_LE(coarseError, 0.05f);
+    EXPECT_LE(fineError, 0.005f);
+    EXPECT_LT(coarse.size(), fine.size());
+    EXPECT_LT(fine.size(), mesh.indices.size());
+}
+
+TEST(MeshSimplificationTest, GenerateLods)
+{
+    const auto mesh = makeGrid(32, [](float x, float z) {
+        return 0.2f * std::sin(x * 6.f) * std::cos(z * 6.f);
+    });
+
+    const auto settings = MeshLodSettings{
+        .maxLods = 4,
+        .reductionRatio = 0.5f,
+        .targetError = 0.05f,
+    };
+    const auto lods = graphics::generateMeshLods(mesh.indices, mesh.positions, settings);
+    ASSERT_FALSE(lods.empty());
+    EXPECT_LE(lods.size(), settings.maxLods - 1);
+
+    auto prevNumIndices = mesh.indices.size();
+    auto prevError = 0.f;
+    for (const auto& lod : lods) {
+        EXPECT_EQ(lod.indices.size() % 3, 0);
+        EXPECT_LE(lod.indices.size(), prevNumIndices / 2 + 3);
+        EXPECT_GE(lod.error, prevError);
+        EXPECT_LE(lod.error, settings.targetError);
+        EXPECT_GT(getProjectedArea(mesh, lod.indices), 0.99f);
+        prevNumIndices = lod.indices.size();
+        prevError = lod.error;
+    }
+
+    // disabled
+    EXPECT_TRUE(graphics::generateMeshLods(mesh.indices, mesh.positions, {}).empty());
+}
+
+TEST(MeshSimplificationTest, SelectLodWithHysteresis)
+{
+    const auto lods = std::array{
+        MeshLod{.error = 0.f},
+        MeshLod{.error = 0.01f},
+        MeshLod{.error = 0.02f},
+    };
+    const auto maxPixelError = 1.f;
+    const auto hysteresis = 0.1f;
+    const auto select = [&](float projectedSize, std::uint32_t prevLod) {
+        return graphics::selectMeshLod(lods, projectedSize, maxPixelError, prevLod, hysteresis);
+    };
+
+    EXPECT_EQ(select(1000.f, 0), 0);
+    EXPECT_EQ(select(10.f, 0), 2);
+    EXPECT_EQ(select(80.f, 0), 1);
+
+    // LOD 1 error is 1 px at 100 px: switching to it needs 10% margin...
+    EXPECT_EQ(select(95.f, 0), 0);
+    EXPECT_EQ(select(85.f, 0), 1);
+    // ...and it's kept until the error is 10% over the threshold
+    EXPECT_EQ(select(105.f, 1), 1);
+    EXPECT_EQ(select(115.f, 1), 0);
+
+    // no LODs
+    EXPECT_EQ(graphics::selectMeshLod({}, 1.f, maxPixelError, 0, hysteresis), 0);
+}
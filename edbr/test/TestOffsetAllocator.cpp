@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <edbr/Graphics/OffsetAllocator.h>
+
+TEST(OffsetAllocatorTest, Allocate)
+{
+    OffsetAllocator allocator;
+    allocator.init(100);
+
+    const auto a1 = allocator.allocate(10);
+    const auto a2 = allocator.allocate(20);
+    EXPECT_EQ(a1.offset, 0);
+    EXPECT_EQ(a2.offset, 10);
+    EXPECT_EQ(allocator.getUsedSize(), 30);
+
+    const auto a3 = allocator.allocate(71);
+    EXPECT_FALSE(a3.isValid());
+
+    const auto a4 = allocator.allocate(70);
+    EXPECT_EQ(a4.offset, 30);
+    EXPECT_EQ(allocator.getNumFreeRanges(), 0);
+}
+
+TEST(OffsetAllocatorTest, FreeCoalesces)
+{
+    OffsetAllocator allocator;
+    allocator.init(100);
+
+    const auto a1 = allocator.allocate(10);
+    const auto a2 = allocator.allocate(10);
+    const auto a3 = allocator.allocate(10);
+
+    allocator.free(a1);
+    allocator.free(a3);
+    EXPECT_EQ(allocator.getNumFreeRanges(), 2); // [0, 10) and [20, 100)
+
+    allocator.free(a2);
+    EXPECT_EQ(allocator.getNumFreeRanges(), 1);
+    EXPECT_EQ(allocator.getUsedSize(), 0);
+
+    const auto a4 = allocator.allocate(100);
+    EXPECT_EQ(a4.offset, 0);
+}
+
+TEST(OffsetAllocatorTest, BestFit)
+{
+    OffsetAllocator allocator;
+    allocator.init(100);
+
+    const auto a1 = allocator.allocate(20);
+    allocator.allocate(10);
+    const auto a3 = allocator.allocate(5);
+    allocator.allocate(10);
+
+    allocator.free(a1);
+    allocator.free(a3);
+
+    // [0, 20) is bigger than [30, 35), so the latter should be used
+    const auto a5 = allocator.allocate(5);
+    EXPECT_EQ(a5.offset, 30);
+}
+
+TEST(OffsetAllocatorTest, Grow)
+{
+    OffsetAllocator allocator;
+    allocator.init(10);
+
+    allocator.allocate(5);
+    EXPECT_FALSE(allocator.allocate(10).isValid());
+
+    allocator.grow(20);
+    const auto a = allocator.allocate(10);
+    EXPECT_EQ(a.offset, 5); // free tail is merged with the grown range
+    EXPECT_EQ(allocator.getCapacity(), 20);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <edbr/Core/ThreadPool.h>
+
+#include <atomic>
+#include <vector>
+
+TEST(ThreadPoolTest, ParallelForCallsEachIndexOnce)
+{
+    ThreadPool pool(3);
+    EXPECT_EQ(pool.getNumThreads(), 4);
+
+    std::vector<std::atomic<int>> calls(1000);
+    pool.parallelFor(calls.size(), [&](std::size_t index, std::size_t threadIndex) {
+        EXPECT_LT(threadIndex, pool.getNumThreads());
+        ++calls[index];
+    });
+
+    for (const auto& c : calls) {
+        EXPECT_EQ(c, 1);
+    }
+}
+
+TEST(ThreadPoolTest, ParallelForCanBeCalledRepeatedly)
+{
+    ThreadPool pool(2);
+    std::atomic<std::size_t> sum{0};
+    for (int i = 0; i < 100; ++i) {
+        pool.parallelFor(10, [&](std::size_t index, std::size_t) { sum += index; });
+    }
+    EXPECT_EQ(sum, 100 * 45);
+}
+
+TEST(ThreadPoolTest, NoWorkers)
+{
+    ThreadPool pool(0);
+    EXPECT_EQ(pool.getNumThreads(), 1);
+
+    int numCalls = 0;
+    pool.parallelFor(5, [&](std::size_t, std::size_t threadIndex) {
+        EXPECT_EQ(threadIndex, 0);
+        ++numCalls;
+    });
+    pool.parallelFor(0, [&](std::size_t, std::size_t) { ++numCalls; });
+    EXPECT_EQ(numCalls, 5);
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include <glm/geometric.hpp>
+
+#include <edbr/Graphics/VertexPacking.h>
+
+namespace
+{
+glm::vec3 randomUnitVector(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> dist{-1.f, 1.f};
+    while (true) {
+        const auto v = glm::vec3{dist(rng), dist(rng), dist(rng)};
+        const auto len = glm::length(v);
+        if (len > 0.01f && len <= 1.f) {
+            return v / len;
+        }
+    }
+}
+}
+
+TEST(VertexPackingTest, OctEncodingRoundTrip)
+{
+    std::mt19937 rng{0};
+    for (int i = 0; i < 10000; ++i) {
+        const auto n = randomUnitVector(rng);
+        const auto e = graphics::octEncode(n);
+        EXPECT_LE(std::abs(e.x), 1.f);
+        EXPECT_LE(std::abs(e.y), 1.f);
+        EXPECT_NEAR(glm::dot(graphics::octDecode(e), n), 1.f, 1e-5f);
+    }
+
+    // axes (and the folded lower hemisphere corners)
+    for (const auto& n :
+         {glm::vec3{1.f, 0.f, 0.f},
+          glm::vec3{-1.f, 0.f, 0.f},
+          glm::vec3{0.f, 1.f, 0.f},
+          glm::vec3{0.f, -1.f, 0.f},
+          glm::vec3{0.f, 0.f, 1.f},
+          glm::vec3{0.f, 0.f, -1.f}}) {
+        EXPECT_NEAR(glm::dot(graphics::octDecode(graphics::octEncode(n)), n), 1.f, 1e-6f);
+    }
+}
+
+TEST(VertexPackingTest, ChooseFormat)
+{
+    // 1 m mesh: ~0.015 mm step
+    EXPECT_EQ(
+        graphics::choosePackedVertexFormat(glm::vec3{-0.5f}, glm::vec3{0.5f}),
+        VertexFormat::PackedQuantized);
+    // 1 km terrain: ~15 mm step
+    EXPECT_EQ(
+        graphics::choosePackedVertexFormat(glm::vec3{0.f}, glm::vec3{1000.f, 10.f, 1000.f}),
+        VertexFormat::Packed);
+
+    EXPECT_EQ(graphics::getSkinnedVertexFormat(VertexFormat::Full), VertexFormat::Full);
+    EXPECT_EQ(graphics::getSkinnedVertexFormat(VertexFormat::Packed), VertexFormat::Packed);
+    EXPECT_EQ(
+        graphics::getSkinnedVertexFormat(VertexFormat::PackedQuantized), VertexFormat::Packed);
+
+    EXPECT_EQ(graphics::getVertexSize(VertexFormat::Full) / 2, sizeof(PackedVertex));
+}
+
+TEST(VertexPackingTest, PackedVertexRoundTrip)
+{
+    const auto minPos = glm::vec3{-2.f, 0.f, -1.f};
+    const auto maxPos = glm::vec3{2.f, 3.f, 1.f};
+
+    std::mt19937 rng{1};
+    std::uniform_real_distribution<float> unitDist{0.f, 1.f};
+    for (const auto format : {VertexFormat::Packed, VertexFormat::PackedQuantized}) {
+        // half of the quantization step of the largest AABB axis
+        const auto maxPositionError =
+            (format == VertexFormat::Packed) ? 0.f : (4.f / 65535.f) * 0.5f + 1e-6f;
+        for (int i = 0; i < 1000; ++i) {
+            const auto t = glm::vec3{unitDist(rng), unitDist(rng), unitDist(rng)};
+            const auto v = CPUMesh::Vertex{
+                .position = minPos + t * (maxPos - minPos),
+                .uv_x = unitDist(rng),
+                .normal = randomUnitVector(rng),
+                .uv_y = unitDist(rng),
+                .tangent = glm::vec4{randomUnitVector(rng), (i % 2) ? 1.f : -1.f},
+            };
+
+            const auto pv = graphics::packVertex(v, format, minPos, maxPos);
+            const auto u = graphics::unpackVertex(pv, format, minPos, maxPos);
+
+            for (int c = 0; c < 3; ++c) {
+                EXPECT_NEAR(u.position[c], v.position[c], maxPositionError);
+            }
+            EXPECT_GT(glm::dot(u.normal, v.normal), 0.9999f);
+            EXPECT_GT(glm::dot(glm::vec3{u.tangent}, glm::vec3{v.tangent}), 0.9999f);
+            EXPECT_EQ(u.tangent.w, v.tangent.w);
+            // half floats have 11 bits of precision
+            EXPECT_NEAR(u.uv_x, v.uv_x, 1.f / 2048.f);
+            EXPECT_NEAR(u.uv_y, v.uv_y, 1.f / 2048.f);
+        }
+    }
+}
+
+TEST(VertexPackingTest, FlatAxisIsNotDividedByZero)
+{
+    // plane mesh: AABB has zero height
+    const auto minPos = glm::vec3{-1.f, 0.f, -1.f};
+    const auto maxPos = glm::vec3{1.f, 0.f, 1.f};
+    const auto v = CPUMesh::Vertex{
+        .position = glm::vec3{0.25f, 0.f, -0.5f},
+        .normal = glm::vec3{0.f, 1.f, 0.f},
+        .tangent = glm::vec4{1.f, 0.f, 0.f, 1.f},
+    };
+
+    const auto pv = graphics::packVertex(v, VertexFormat::PackedQuantized, minPos, maxPos);
+    const auto u = graphics::unpackVertex(pv, VertexFormat::PackedQuantized, minPos, maxPos);
+    EXPECT_NEAR(u.position.x, 0.25f, 1e-4f);
+    EXPECT_EQ(u.position.y, 0.f);
+    EXPECT_NEAR(u.position.z, -0.5f, 1e-4f);
+}
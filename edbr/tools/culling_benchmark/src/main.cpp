@@ -0,0 +1,85 @@
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <glm/trigonometric.hpp>
+
+#include <edbr/Graphics/Camera.h>
+#include <edbr/Graphics/FrustumCulling.h>
+#include <edbr/Math/Sphere.h>
+
+// Compares batch SIMD sphere culling (edge::cullSpheres) with the
+// per-sphere edge::isInFrustum which GameRenderer used before.
+namespace
+{
+constexpr int NUM_ITERATIONS = 100;
+
+template<typename F>
+double measureMs(F&& f)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < NUM_ITERATIONS; ++i) {
+        f();
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / NUM_ITERATIONS;
+}
+
+void runBenchmark(const Frustum& frustum, std::size_t numSpheres)
+{
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> posDist{-500.f, 500.f};
+    std::uniform_real_distribution<float> radiusDist{0.1f, 10.f};
+
+    std::vector<math::Sphere> spheresAoS(numSpheres);
+    SphereSoA spheres;
+    for (auto& s : spheresAoS) {
+        s.center = glm::vec3{posDist(rng), posDist(rng), posDist(rng)};
+        s.radius = radiusDist(rng);
+        spheres.add(s);
+    }
+
+    std::size_t numVisibleAoS = 0;
+    const auto aosMs = measureMs([&]() {
+        numVisibleAoS = 0;
+        for (const auto& s : spheresAoS) {
+            if (edge::isInFrustum(frustum, s)) {
+                ++numVisibleAoS;
+            }
+        }
+    });
+
+    VisibilityMask mask;
+    const auto scalarMs = measureMs([&]() { edge::cullSpheresScalar(frustum, spheres, mask); });
+    const auto numVisibleScalar = mask.countVisible();
+
+    const auto simdMs = measureMs([&]() { edge::cullSpheres(frustum, spheres, mask); });
+    const auto numVisibleSIMD = mask.countVisible();
+
+    fmt::println("{} spheres ({} visible):", numSpheres, numVisibleAoS);
+    fmt::println("  isInFrustum (AoS): {:.4f} ms", aosMs);
+    fmt::println("  cullSpheresScalar: {:.4f} ms", scalarMs);
+    fmt::println("  cullSpheres:       {:.4f} ms ({:.1f}x)", simdMs, aosMs / simdMs);
+
+    if (numVisibleScalar != numVisibleAoS || numVisibleSIMD != numVisibleAoS) {
+        fmt::println(
+            "  ERROR: results don't match ({} / {} / {})",
+            numVisibleAoS,
+            numVisibleScalar,
+            numVisibleSIMD);
+    }
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    Camera camera;
+    camera.init(glm::radians(60.f), 0.1f, 1000.f, 16.f / 9.f);
+    const auto frustum = edge::createFrustumFromCamera(camera);
+
+    runBenchmark(frustum, 10'000);
+    runBenchmark(frustum, 100'000);
+}
@@ -0,0 +1,76 @@
+#include <filesystem>
+#include <string>
+
+#include <CLI/CLI.hpp>
+
+#include <fmt/format.h>
+
+#include <edbr/Util/CookedScene.h>
+#include <edbr/Util/FS.h>
+
+int main(int argc, char** argv)
+{
+    CLI::App app{
+        "scene_cooker - a tool for cooking .gltf scenes into binary .scene files ahead of "
+        "time (see CookedScene.h). Settings must match the game's settings, otherwise the "
+        "game won't find the cooked files and will cook them again on load"};
+    argv = app.ensure_utf8(argv);
+
+    std::string in;
+    std::string outDir;
+    SceneImportSettings settings{
+        // same as in mtp
+        .lodSettings =
+            {
+                .maxLods = 4,
+                .reductionRatio = 0.5f,
+                .targetError = 0.05f,
+            },
+    };
+    bool noPackVertices{false};
+    bool force{false};
+
+    app.add_option("in", in, ".gltf file or directory with .gltf files")->required();
+    app.add_option("out_dir", outDir, "Output directory")->required();
+    app.add_flag("--no-pack-vertices", noPackVertices, "Store full (unpacked) vertices");
+    app.add_option("--max-lods", settings.lodSettings.maxLods, "Number of LODs (including LOD 0)");
+    app.add_option(
+        "--lod-reduction", settings.lodSettings.reductionRatio, "Index count ratio between LODs");
+    app.add_option("--lod-error", settings.lodSettings.targetError, "Max LOD error");
+    app.add_flag("--force", force, "Cook even if the cooked file is up to date");
+    app.validate_positionals();
+
+    CLI11_PARSE(app, argc, argv);
+
+    settings.packVertices = !noPackVertices;
+
+    int numCooked = 0;
+    int numFailed = 0;
+    const auto cook = [&](const std::filesystem::path& gltfPath) {
+        const auto key = util::calculateCookedSceneKey(gltfPath, settings);
+        const auto cookedPath = util::getCookedScenePath(outDir, gltfPath, key);
+        if (!force && std::filesystem::exists(cookedPath)) {
+            fmt::println("{} is up to date", gltfPath.string());
+            return;
+        }
+        fmt::println("{} -> {}", gltfPath.string(), cookedPath.string());
+        if (util::cookGltfFile(gltfPath, cookedPath, settings, key)) {
+            ++numCooked;
+        } else {
+            ++numFailed;
+        }
+    };
+
+    if (std::filesystem::is_directory(in)) {
+        util::foreachFileInDir(in, [&](const std::filesystem::path& p) {
+            if (p.extension() == ".gltf") {
+                cook(p);
+            }
+        });
+    } else {
+        cook(in);
+    }
+
+    fmt::println("cooked {} scene(s), {} failed", numCooked, numFailed);
+    return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+
+#include <fmt/format.h>
+
+#include <edbr/Core/ThreadPool.h>
+#include <edbr/Graphics/BlockCompression.h>
+#include <edbr/Graphics/ImageLoader.h>
+#include <edbr/Graphics/KTX2.h>
+#include <edbr/Util/FS.h>
+#include <edbr/Util/GltfLoader.h>
+
+namespace
+{
+// Determines how the texture is compressed and how its mips are generated
+enum class TextureRole {
+    Color, // diffuse and emissive
+    NormalMap,
+    Data, // metallic (B) and roughness (G)
+};
+
+struct RoleInfo {
+    graphics::BlockFormat blockFormat;
+    VkFormat format;
+    const char* name;
+};
+
+RoleInfo getRoleInfo(TextureRole role)
+{
+    switch (role) {
+    case TextureRole::Color:
+        return {graphics::BlockFormat::BC7, VK_FORMAT_BC7_SRGB_BLOCK, "color"};
+    case TextureRole::NormalMap:
+        // only XY are stored - the shader reconstructs Z
+        return {graphics::BlockFormat::BC5, VK_FORMAT_BC5_UNORM_BLOCK, "normal map"};
+    case TextureRole::Data:
+        return {graphics::BlockFormat::BC1, VK_FORMAT_BC1_RGB_UNORM_BLOCK, "data"};
+    }
+    return {};
+}
+
+using Pixels = std::vector<std::uint8_t>; // RGBA8
+
+std::uint8_t toUNorm8(float v)
+{
+    return (std::uint8_t)std::lround(std::clamp(v, 0.f, 1.f) * 255.f);
+}
+
+float linearToSRGB(float v)
+{
+    return v < 0.0031308f ? 12.92f * v : 1.055f * std::pow(v, 1.f / 2.4f) - 0.055f;
+}
+
+const std::array<float, 256>& getSRGBToLinearTable()
+{
+    static const auto table = [] {
+        std::array<float, 256> t;
+        for (int i = 0; i < 256; ++i) {
+            const auto v = (float)i / 255.f;
+            t[i] = v < 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Box filter: color textures are filtered in linear space and normals are
+// renormalized, so that the mips don't get darker/flatter
+Pixels downsample(const Pixels& src, int width, int height, TextureRole role)
+{
+    const auto dstWidth = std::max(width / 2, 1);
+    const auto dstHeight = std::max(height / 2, 1);
+    Pixels dst((std::size_t)dstWidth * dstHeight * 4);
+
+    const auto& srgbToLinear = getSRGBToLinearTable();
+    for (int y = 0; y < dstHeight; ++y) {
+        for (int x = 0; x < dstWidth; ++x) {
+            std::array<float, 4> sum{};
+            for (int i = 0; i < 4; ++i) {
+                const auto srcX = std::min(x * 2 + i % 2, width - 1);
+                const auto srcY = std::min(y * 2 + i / 2, height - 1);
+                const auto* p = &src[((std::size_t)srcY * width + srcX) * 4];
+                for (int c = 0; c < 4; ++c) {
+                    const auto v = (float)p[c] / 255.f;
+                    if (c < 3 && role == TextureRole::Color) {
+                        sum[c] += srgbToLinear[p[c]];
+                    } else if (c < 3 && role == TextureRole::NormalMap) {
+                        sum[c] += v * 2.f - 1.f;
+                    } else {
+                        sum[c] += v;
+                    }
+                }
+            }
+
+            auto* out = &dst[((std::size_t)y * dstWidth + x) * 4];
+            if (role == TextureRole::NormalMap) {
+                const auto length =
+                    std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                for (int c = 0; c < 3; ++c) {
+                    const auto n = length > 0.f ? sum[c] / length : (c == 2 ? 1.f : 0.f);
+                    out[c] = toUNorm8(n * 0.5f + 0.5f);
+                }
+            } else {
+                for (int c = 0; c < 3; ++c) {
+                    const auto v = sum[c] / 4.f;
+                    out[c] = toUNorm8(role == TextureRole::Color ? linearToSRGB(v) : v);
+                }
+            }
+            out[3] = toUNorm8(sum[3] / 4.f);
+        }
+    }
+    return dst;
+}
+
+bool cookTexture(const std::filesystem::path& path, TextureRole role)
+{
+    const auto data = util::loadImage(path);
+    if (!data.pixels) {
+        fmt::println("[error] failed to load image from '{}'", path.string());
+        return false;
+    }
+
+    const auto roleInfo = getRoleInfo(role);
+    CompressedImageData image{
+        .format = roleInfo.format,
+        .width = (std::uint32_t)data.width,
+        .height = (std::uint32_t)data.height,
+    };
+
+    int width = data.width;
+    int height = data.height;
+    Pixels pixels(data.pixels, data.pixels + (std::size_t)width * height * 4);
+    while (true) {
+        image.mips.push_back(graphics::compressImage(roleInfo.blockFormat, pixels, width, height));
+        if (width == 1 && height == 1) {
+            break;
+        }
+        pixels = downsample(pixels, width, height, role);
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    image.numMips = (std::uint32_t)image.mips.size();
+
+    return util::writeKTX2Image(util::getCookedImagePath(path), image);
+}
+
+bool isUpToDate(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    const auto cookedTime = std::filesystem::last_write_time(util::getCookedImagePath(path), ec);
+    return !ec && cookedTime >= std::filesystem::last_write_time(path);
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char** argv)
+{
+    CLI::App app{
+        "texture_cooker - a tool for cooking textures of .gltf scenes into block compressed "
+        ".ktx2 files with pre-built mips. The files are written next to the source images "
+        "and the game loads them instead of the source images (see util::loadCookedImage)"};
+    argv = app.ensure_utf8(argv);
+
+    std::string in;
+    bool force{false};
+
+    app.add_option("in", in, ".gltf file or directory with .gltf files")->required();
+    app.add_flag("--force", force, "Cook even if the cooked file is up to date");
+    app.validate_positionals();
+
+    CLI11_PARSE(app, argc, argv);
+
+    // the same image can be used by several materials and scenes
+    std::map<std::filesystem::path, TextureRole> textures;
+    const auto addTextures = [&textures](const std::filesystem::path& gltfPath) {
+        const auto scene = util::importGltfFile(gltfPath);
+        const auto fileDir = gltfPath.parent_path();
+        const auto addTexture = [&](const std::string& uri, TextureRole role) {
+            if (uri.empty()) {
+                return;
+            }
+            const auto path = (fileDir / uri).lexically_normal();
+            const auto [it, inserted] = textures.emplace(path, role);
+            if (!inserted && it->second != role) {
+                fmt::println(
+                    "[warning] '{}' is used as {} and {} texture, cooking it as {}",
+                    path.string(),
+                    getRoleInfo(it->second).name,
+                    getRoleInfo(role).name,
+                    getRoleInfo(it->second).name);
+            }
+        };
+        for (const auto& material : scene.materials) {
+            addTexture(material.diffuseTexture, TextureRole::Color);
+            addTexture(material.normalMapTexture, TextureRole::NormalMap);
+            addTexture(material.metallicRoughnessTexture, TextureRole::Data);
+            addTexture(material.emissiveTexture, TextureRole::Color);
+        }
+    };
+
+    if (std::filesystem::is_directory(in)) {
+        util::foreachFileInDir(in, [&](const std::filesystem::path& p) {
+            if (p.extension() == ".gltf") {
+                addTextures(p);
+            }
+        });
+    } else {
+        addTextures(in);
+    }
+
+    std::vector<std::pair<std::filesystem::path, TextureRole>> texturesToCook;
+    for (const auto& [path, role] : textures) {
+        if (!force && isUpToDate(path)) {
+            fmt::println("{} is up to date", path.string());
+            continue;
+        }
+        fmt::println("{} ({})", path.string(), getRoleInfo(role).name);
+        texturesToCook.emplace_back(path, role);
+    }
+
+    // encoding is slow - cook the textures in parallel
+    const auto numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    ThreadPool threadPool(numThreads - 1);
+    std::atomic<int> numFailed{0};
+    threadPool.parallelFor(texturesToCook.size(), [&](std::size_t index, std::size_t) {
+        const auto& [path, role] = texturesToCook[index];
+        if (!cookTexture(path, role)) {
+            ++numFailed;
+        }
+    });
+
+    fmt::println(
+        "cooked {} texture(s), {} failed",
+        (int)texturesToCook.size() - numFailed.load(),
+        numFailed.load());
+    return numFailed == 0 ? 0 : 1;
+}
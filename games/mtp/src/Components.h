@@ -23,6 +23,8 @@ struct MeshComponent {
     std::vector<MeshId> meshes;
     std::vector<Transform> meshTransforms;
     bool castShadow{true};
+    // LODs selected by GameRenderer::drawMesh in the previous frame
+    std::vector<std::uint32_t> meshLods;
 };
 
 struct ColliderComponent {};
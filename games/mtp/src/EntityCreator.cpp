@@ -121,13 +121,24 @@ entt::handle EntityCreator::createFromPrefab(const std::string& prefabName, bool
 }
 
 std::vector<entt::handle> EntityCreator::createEntitiesFromScene(const Scene& scene)
+{
+    return createEntitiesFromScene(scene, 0, scene.nodes.size());
+}
+
+std::vector<entt::handle> EntityCreator::createEntitiesFromScene(
+    const Scene& scene,
+    std::size_t firstNode,
+    std::size_t numNodes)
 {
     assert(postInitEntityFunc);
     assert(entityFactory.prefabExists("camera"));
     assert(entityFactory.prefabExists("light"));
+    assert(firstNode + numNodes <= scene.nodes.size());
 
     std::vector<entt::handle> createdEntities;
-    for (const auto& rootNode : scene.nodes) {
+    createdEntities.reserve(numNodes);
+    for (std::size_t i = firstNode; i < firstNode + numNodes; ++i) {
+        const auto& rootNode = scene.nodes[i];
         const auto prefabName =
             util::getPrefabNameFromSceneNode(entityFactory, *rootNode, defaultPrefabName);
         auto e = createFromNode(prefabName, scene, *rootNode);
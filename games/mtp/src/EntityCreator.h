@@ -37,6 +37,12 @@ public:
 
     entt::handle createFromPrefab(const std::string& prefabName, bool callPostInitFunc = true);
     std::vector<entt::handle> createEntitiesFromScene(const Scene& scene);
+    // Only creates entities for root nodes [firstNode, firstNode + numNodes) -
+    // allows to spread creation of big scenes over several frames
+    std::vector<entt::handle> createEntitiesFromScene(
+        const Scene& scene,
+        std::size_t firstNode,
+        std::size_t numNodes);
 
     void setPostInitEntityFunc(std::function<void(entt::handle e)> f) { postInitEntityFunc = f; }
 
@@ -11,6 +11,7 @@
 
 #include <edbr/ECS/Components/HierarchyComponent.h>
 #include <edbr/ECS/Components/MetaInfoComponent.h>
+#include <edbr/ECS/Components/MovementComponent.h>
 #include <edbr/ECS/Components/NPCComponent.h>
 #include <edbr/ECS/Components/PersistentComponent.h>
 #include <edbr/ECS/Components/SceneComponent.h>
@@ -35,6 +36,8 @@
 
 #include <glm/gtx/norm.hpp> // distance2
 
+#include <unordered_set>
+
 namespace eu = entityutil;
 
 Game::Game() :
@@ -44,6 +47,7 @@ Game::Game() :
     sceneCache(gfxDevice, meshCache, materialCache, animationCache),
     entityCreator(registry, "static_geometry", entityFactory, sceneCache),
     animationSoundSystem(audioManager),
+    levelLoader(sceneCache, entityFactory, "static_geometry"),
     cameraManager(actionListManager),
     ui(actionListManager, audioManager)
 {}
@@ -83,9 +87,17 @@ void Game::customInit()
 
     animationCache.loadAnimationData("assets/data/animation_data.json");
 
-    skyboxDir = "assets/images/skybox";
+    levelLoader.setSkyboxDir("assets/images/skybox");
 
     materialCache.init(gfxDevice);
+    // far away trees and buildings in big levels don't need full detail
+    meshCache.setLodSettings(MeshLodSettings{
+        .maxLods = 4,
+        .reductionRatio = 0.5f,
+        .targetError = 0.05f,
+    });
+    // not in assets/ - it's symlinked to the source dir
+    sceneCache.setCookedSceneDir("cooked/scenes");
     renderer.init(params.renderSize);
     spriteRenderer.init(renderer.getDrawImageFormat());
 
@@ -323,6 +335,8 @@ void Game::customUpdate(float dt)
     if (!newLevelToLoad.empty()) {
         doLevelChange();
     }
+    // uploads a part of the level which is loaded in background (if there is one)
+    levelLoader.update(maxLevelLoadTimePerFrame);
 
     // input
     auto& io = ImGui::GetIO();
@@ -623,7 +637,7 @@ void Game::customDraw()
 
 void Game::generateDrawList()
 {
-    renderer.beginDrawing();
+    renderer.beginDrawing(camera);
 
     // add lights
     const auto lights = registry.view<TransformComponent, LightComponent>();
@@ -636,11 +650,18 @@ void Game::generateDrawList()
         entt::
             exclude<SkeletonComponent, TriggerComponent, ColliderComponent, PlayerSpawnComponent>);
     for (const auto&& [e, tc, mc] : staticMeshes.each()) {
+        // shadows of entities which can't move are cached by CSMPipeline
+        auto isStatic = !registry.all_of<MovementComponent>(e);
+        if (const auto pcPtr = registry.try_get<PhysicsComponent>(e); pcPtr) {
+            isStatic = isStatic && pcPtr->type == PhysicsComponent::Type::Static;
+        }
+        mc.meshLods.resize(mc.meshes.size());
         for (std::size_t i = 0; i < mc.meshes.size(); ++i) {
             const auto meshTransform = mc.meshTransforms[i].isIdentity() ?
                                            tc.worldTransform :
                                            tc.worldTransform * mc.meshTransforms[i].asMatrix();
-            renderer.drawMesh(mc.meshes[i], meshTransform, mc.castShadow);
+            renderer.drawMesh(
+                mc.meshes[i], meshTransform, mc.castShadow, isStatic, &mc.meshLods[i]);
         }
     }
 
@@ -649,7 +670,11 @@ void Game::generateDrawList()
         registry.view<TransformComponent, MeshComponent, SkeletonComponent>();
     for (const auto&& [e, tc, mc, sc] : skinnedMeshes.each()) {
         renderer.drawSkinnedMesh(
-            mc.meshes, sc.skinnedMeshes, tc.worldTransform, sc.skeletonAnimator.getJointMatrices());
+            mc.meshes,
+            sc.skinnedMeshes,
+            tc.worldTransform,
+            sc.skeletonAnimator.getJointMatrices(),
+            sc.skeletonAnimator.getPoseVersion());
 #ifndef NDEBUG
         // 1. Not all meshes for the entity might be skinned
         // 2. Different meshes can have different joint matrices sets
@@ -683,53 +708,92 @@ void Game::generateDrawList()
     }
 }
 
-void Game::loadLevel(const std::filesystem::path& path)
+void Game::initLoadedLevel()
 {
-    bool loadedFromModel{false};
-
-    if (std::filesystem::exists(path)) {
-        level.load(path);
-    } else if (isDevEnvironment) {
-        // special level loading mode for dev environment:
-        // load from assets/models/levels/<level>/<level>.gltf
-        // Player will be destroyed and free camera will be enabled
-        // by default
-        auto levelName = path.filename().replace_extension("");
-        const auto modelPath = "assets/models/levels" / levelName / (levelName.string() + ".gltf");
-        fmt::println(
-            "level {} was not found, trying to load model from {}",
-            path.string(),
-            modelPath.string());
-        level.loadFromModel(modelPath);
-        loadedFromModel = true;
+    auto loadedLevel = levelLoader.takeLoadedLevel();
+    level = std::move(loadedLevel.level);
+    levelLoadedFromModel = loadedLevel.loadedFromModel;
+    numSpawnedLevelNodes = 0;
+
+    // load skybox (the previous level's one is not used anymore)
+    if (skyboxImageId != NULL_IMAGE_ID) {
+        gfxDevice.releaseImage(skyboxImageId);
+        skyboxImageId = NULL_IMAGE_ID;
     }
-    level.setName(path.filename().replace_extension("").string());
-
-    // load skybox
-    if (level.hasSkybox()) {
-        const auto skyboxImageId = gfxDevice.addImageToCache(
-            graphics::loadCubemap(gfxDevice, skyboxDir / level.getSkyboxName()));
-        renderer.setSkyboxImage(skyboxImageId);
-    } else {
-        // no skybox
-        renderer.setSkyboxImage(NULL_IMAGE_ID);
+    if (loadedLevel.skybox) {
+        skyboxImageId =
+            gfxDevice.addImageToCache(graphics::createCubemap(gfxDevice, *loadedLevel.skybox));
     }
+    renderer.setSkyboxImage(skyboxImageId); // NULL_IMAGE_ID - no skybox
+
+    // collision shapes were built by the loader - they're used when
+    // physics bodies are created for the spawned entities
+    const auto& scene = sceneCache.getScene(level.getSceneModelPath().string());
+    for (std::size_t meshIdx = 0; meshIdx < loadedLevel.meshShapes.size(); ++meshIdx) {
+        const auto& shapes = loadedLevel.meshShapes[meshIdx];
+        for (std::size_t primitiveIdx = 0; primitiveIdx < shapes.size(); ++primitiveIdx) {
+            if (shapes[primitiveIdx]) {
+                physicsSystem->addPrebuiltMeshShape(
+                    scene.meshes[meshIdx].primitives[primitiveIdx], shapes[primitiveIdx]);
+            }
+        }
+    }
+}
+
+bool Game::spawnLevelEntities()
+{
+    const auto& scene = sceneCache.getScene(level.getSceneModelPath().string());
 
-    // spawn entities
-    const auto& scene = sceneCache.loadOrGetScene(level.getSceneModelPath());
-    auto createdEntities = entityCreator.createEntitiesFromScene(scene);
-    (void)createdEntities; // maybe will do something with them later...
+    // big levels are spawned during several frames
+    const auto startTime = std::chrono::steady_clock::now();
+    while (numSpawnedLevelNodes < scene.nodes.size()) {
+        entityCreator.createEntitiesFromScene(scene, numSpawnedLevelNodes, 1);
+        ++numSpawnedLevelNodes;
+
+        if (std::chrono::steady_clock::now() - startTime > maxLevelLoadTimePerFrame) {
+            return false;
+        }
+    }
 
     // this will update worldTransforms to actual state
     edbr::ecs::transformSystemUpdate(registry, 0.f);
 
-    if (loadedFromModel) {
+    if (levelLoadedFromModel) {
         destroyEntity(eu::getPlayerEntity(registry));
         setCurrentCamera(findDefaultCamera());
         freeCameraMode = true;
         playerInputEnabled = false;
         cameraManager.setController(freeCameraControllerTag);
     }
+
+    return true;
+}
+
+void Game::unloadUnusedScenes()
+{
+    // scenes are owned by the level and the entities which were created from them
+    std::unordered_set<std::string> usedScenes{level.getSceneModelPath().string()};
+    for (const auto& [e, sc] : registry.view<SceneComponent>().each()) {
+        usedScenes.insert(sc.sceneName);
+        usedScenes.insert(sc.creationSceneName);
+    }
+
+    for (const auto& scenePath : sceneCache.getScenePaths()) {
+        if (usedScenes.contains(scenePath)) {
+            continue;
+        }
+        // mesh ids will be reused, so the shapes built from the meshes can't be
+        const auto& scene = sceneCache.getScene(scenePath);
+        std::vector<MeshId> meshIds;
+        meshIds.reserve(scene.cpuMeshes.size());
+        for (const auto& [meshId, cpuMesh] : scene.cpuMeshes) {
+            meshIds.push_back(meshId);
+        }
+        physicsSystem->removeMeshShapes(meshIds);
+
+        fmt::println("Unloading scene '{}'", scenePath);
+        sceneCache.unloadScene(scenePath);
+    }
 }
 
 void Game::changeLevel(
@@ -754,6 +818,9 @@ void Game::doLevelChange()
     const auto levelToLoad = newLevelToLoad;
     const auto spawnName = newLevelSpawnName;
 
+    // the level is loaded in background while the previous level fades out
+    levelLoader.startLoading(levelToLoad, isDevEnvironment);
+
     auto levelTransition = ActionList(levelTransitionListName);
 
     bool hasPreviousLevel = !level.getName().empty();
@@ -762,11 +829,21 @@ void Game::doLevelChange()
     }
 
     levelTransition.addActions(
+        waitWhile("Level loading", [this](float dt) { return !levelLoader.isLoaded(); }),
+        doNamed("Init level", [this] { initLoadedLevel(); }),
+        waitWhile("Spawn entities", [this](float dt) { return !spawnLevelEntities(); }),
+        // the player keeps its scene loaded - it's persistent
+        doNamed("Unload unused scenes", [this] { unloadUnusedScenes(); }),
+        doNamed(
+            "Defragment memory",
+            [this] {
+                if (defragmentMemoryOnLevelLoad) {
+                    gfxDevice.defragmentMemory();
+                }
+            }),
         doNamed(
             "Spawn player",
-            [this, levelToLoad, spawnName] {
-                loadLevel(levelToLoad);
-                // spawn player
+            [this, spawnName] {
                 const auto& spawnPoint =
                     spawnName.empty() ? level.getDefaultPlayerSpawnerName() : spawnName;
                 lastSpawnName = spawnPoint;
@@ -898,8 +975,13 @@ void Game::destroyEntity(entt::handle e)
     }
 
     if (auto scPtr = e.try_get<SkeletonComponent>(); scPtr) {
+        // the buffers can still be used by frames in flight
         for (const auto& skinnedMesh : scPtr->skinnedMeshes) {
-            renderer.getGfxDevice().destroyBuffer(skinnedMesh.skinnedVertexBuffer);
+            for (const auto& skinnedVertexBuffer : skinnedMesh.skinnedVertexBuffers) {
+                gfxDevice.deferDestruction([this, skinnedVertexBuffer]() {
+                    gfxDevice.destroyBuffer(skinnedVertexBuffer);
+                });
+            }
         }
     }
 
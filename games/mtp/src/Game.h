@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -30,6 +31,7 @@
 #include "EntityCreator.h"
 #include "GameUI.h"
 #include "Level.h"
+#include "LevelLoader.h"
 
 #include "AnimationSoundSystem.h"
 #include "LevelScript.h"
@@ -68,12 +70,18 @@ public:
 
     void registerLevels();
     void initUI();
-    void loadLevel(const std::filesystem::path& path);
     void changeLevel(
         const std::string& levelTag,
         const std::string& spawnName = {},
         LevelTransitionType ltt = LevelTransitionType::Teleport);
     void doLevelChange();
+    // called when levelLoader finishes loading the level
+    void initLoadedLevel();
+    // Spawns a part of level entities, returns true when all are spawned
+    bool spawnLevelEntities();
+    // Unloads the scenes (and their meshes, materials and textures) which are not
+    // used by the current level and its entities
+    void unloadUnusedScenes();
     ActionList enterLevel(LevelTransitionType ltt);
     ActionList exitLevel(LevelTransitionType ltt);
 
@@ -185,9 +193,16 @@ private:
     std::unique_ptr<PhysicsSystem> physicsSystem;
     AnimationSoundSystem animationSoundSystem;
 
-    std::filesystem::path skyboxDir;
-
     Level level;
+    LevelLoader levelLoader;
+    bool levelLoadedFromModel{false};
+    std::size_t numSpawnedLevelNodes{0};
+    ImageId skyboxImageId{NULL_IMAGE_ID};
+    // how much time level loading can take on the main thread each frame
+    std::chrono::steady_clock::duration maxLevelLoadTimePerFrame{std::chrono::milliseconds{4}};
+    // textures of the new level can be scattered over memory blocks which were left
+    // half-empty by the previous one - defragmentation stalls GPU, so it's opt-in
+    bool defragmentMemoryOnLevelLoad{false};
     std::unordered_map<std::string, std::unique_ptr<LevelScript>> levelScripts;
     std::string newLevelToLoad; // if set, will load this new level during the end of update
     std::string newLevelSpawnName;
@@ -217,6 +217,7 @@ void Game::devToolsUpdate(float dt)
         EndPropertyTable();
 
         ImGui::Checkbox("Orbit around selected entity", &orbitCameraAroundSelectedEntity);
+        ImGui::Checkbox("Defragment GPU memory on level load", &defragmentMemoryOnLevelLoad);
 
         if (ImGui::CollapsingHeader("Save files")) {
             if (ImGui::Button("Save")) {
@@ -337,7 +338,8 @@ void Game::devToolsUpdate(float dt)
     ImGui::End();
 
     const auto& imageCache = gfxDevice.getImageCache();
-    resourcesInspector.update(dt, imageCache, materialCache);
+    resourcesInspector.update(
+        dt, imageCache, materialCache, meshCache, gfxDevice.getMemoryStats());
 
     if (entityTreeView.hasSelectedEntity()) {
         if (ImGui::Begin("Selected entity")) {
@@ -4,6 +4,7 @@
 #include <edbr/ECS/Components/NPCComponent.h>
 #include <edbr/ECS/Components/NameComponent.h>
 #include <edbr/ECS/Components/SceneComponent.h>
+#include <edbr/Graphics/VertexPacking.h>
 
 namespace
 {
@@ -71,10 +72,15 @@ void Game::initEntityAnimation(entt::handle e)
     for (const auto meshId : mc.meshes) {
         const auto& mesh = meshCache.getMesh(meshId);
         SkinnedMesh sm;
-        sm.skinnedVertexBuffer = gfxDevice.createBuffer(
-            mesh.numVertices * sizeof(CPUMesh::Vertex),
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+        for (auto& skinnedVertexBuffer : sm.skinnedVertexBuffers) {
+            skinnedVertexBuffer = gfxDevice.createBuffer(
+                mesh.numVertices *
+                    graphics::getVertexSize(graphics::getSkinnedVertexFormat(mesh.vertexFormat)),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                    VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                MemoryClass::GPUOnly,
+                MemoryCategory::SkinnedMeshes);
+        }
         sc.skinnedMeshes.push_back(sm);
     }
 
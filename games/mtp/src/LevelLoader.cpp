@@ -0,0 +1,191 @@
+#include "LevelLoader.h"
+
+#include <algorithm>
+
+#include <fmt/printf.h>
+
+#include <edbr/ECS/EntityFactory.h>
+#include <edbr/SceneCache.h>
+
+#include "EntityCreator.h"
+#include "PhysicsSystem.h"
+
+namespace
+{
+// Marks meshes which will get triangle mesh collision shapes when their
+// nodes are spawned - see EntityCreator::processNode. Nodes with other
+// prefabs are skipped: their physics depends on prefab data.
+void markStaticGeometryMeshes(
+    const SceneNode& node,
+    const EntityFactory& entityFactory,
+    const std::string& staticGeometryPrefabName,
+    std::vector<bool>& needsShape)
+{
+    if (util::getPrefabNameFromSceneNode(entityFactory, node, staticGeometryPrefabName) !=
+        staticGeometryPrefabName) {
+        return;
+    }
+
+    if (node.meshIndex != -1) {
+        needsShape[node.meshIndex] = true;
+    }
+    for (const auto& childPtr : node.children) {
+        markStaticGeometryMeshes(*childPtr, entityFactory, staticGeometryPrefabName, needsShape);
+    }
+}
+
+std::vector<std::vector<JPH::Ref<JPH::Shape>>> buildStaticGeometryShapes(
+    const PreparedScene& preparedScene,
+    const EntityFactory& entityFactory,
+    const std::string& staticGeometryPrefabName)
+{
+    std::vector<bool> needsShape(preparedScene.meshes.size());
+    for (const auto& nodePtr : preparedScene.scene.nodes) {
+        markStaticGeometryMeshes(*nodePtr, entityFactory, staticGeometryPrefabName, needsShape);
+    }
+
+    std::vector<std::vector<JPH::Ref<JPH::Shape>>> meshShapes(preparedScene.meshes.size());
+    for (std::size_t meshIdx = 0; meshIdx < preparedScene.meshes.size(); ++meshIdx) {
+        if (!needsShape[meshIdx]) {
+            continue;
+        }
+        const auto& mesh = preparedScene.meshes[meshIdx];
+        meshShapes[meshIdx].resize(mesh.size());
+        for (std::size_t primitiveIdx = 0; primitiveIdx < mesh.size(); ++primitiveIdx) {
+            if (mesh[primitiveIdx].loaded) {
+                meshShapes[meshIdx][primitiveIdx] =
+                    PhysicsSystem::createMeshShape(mesh[primitiveIdx].cpuMesh);
+            }
+        }
+    }
+    return meshShapes;
+}
+
+// Runs on the worker thread - shouldn't touch anything except its arguments
+LoadedLevel loadLevel(
+    const std::filesystem::path& path,
+    bool allowLoadingFromModel,
+    const std::filesystem::path& skyboxDir,
+    const SceneCache& sceneCache,
+    const std::vector<std::string>& loadedScenes,
+    const EntityFactory& entityFactory,
+    const std::string& staticGeometryPrefabName)
+{
+    LoadedLevel loadedLevel;
+    auto& level = loadedLevel.level;
+
+    if (std::filesystem::exists(path) || !allowLoadingFromModel) {
+        level.load(path);
+    } else {
+        // special level loading mode for dev environment:
+        // load from assets/models/levels/<level>/<level>.gltf
+        // Player will be destroyed and free camera will be enabled
+        // by default
+        auto levelName = path.filename().replace_extension("");
+        const auto modelPath = "assets/models/levels" / levelName / (levelName.string() + ".gltf");
+        fmt::println(
+            "level {} was not found, trying to load model from {}",
+            path.string(),
+            modelPath.string());
+        level.loadFromModel(modelPath);
+        loadedLevel.loadedFromModel = true;
+    }
+    level.setName(path.filename().replace_extension("").string());
+
+    if (level.hasSkybox()) {
+        loadedLevel.skybox = graphics::loadCubemapData(skyboxDir / level.getSkyboxName());
+    }
+
+    const auto& scenePath = level.getSceneModelPath();
+    if (std::ranges::find(loadedScenes, scenePath.string()) == loadedScenes.end()) {
+        loadedLevel.scene = sceneCache.prepareScene(scenePath);
+        loadedLevel.meshShapes = buildStaticGeometryShapes(
+            *loadedLevel.scene, entityFactory, staticGeometryPrefabName);
+    }
+
+    return loadedLevel;
+}
+
+} // end of anonymous namespace
+
+LevelLoader::LevelLoader(
+    SceneCache& sceneCache,
+    const EntityFactory& entityFactory,
+    std::string staticGeometryPrefabName) :
+    sceneCache(sceneCache),
+    entityFactory(entityFactory),
+    staticGeometryPrefabName(std::move(staticGeometryPrefabName))
+{}
+
+void LevelLoader::startLoading(const std::filesystem::path& levelPath, bool allowLoadingFromModel)
+{
+    if (loading) {
+        // the scene still gets into the cache, only the level is discarded
+        finishLoading();
+        loadedLevel.reset();
+    }
+
+    loading = true;
+    // the cache is only modified on the main thread, so the worker gets a
+    // copy of what was loaded and doesn't prepare these scenes again
+    loadFuture = std::async(
+        std::launch::async,
+        loadLevel,
+        levelPath,
+        allowLoadingFromModel,
+        skyboxDir,
+        std::cref(sceneCache),
+        sceneCache.getScenePaths(),
+        std::cref(entityFactory),
+        staticGeometryPrefabName);
+}
+
+void LevelLoader::update(std::chrono::steady_clock::duration maxUploadTime)
+{
+    if (!loading) {
+        return;
+    }
+
+    if (!loadedLevel) {
+        using namespace std::chrono_literals;
+        if (loadFuture.wait_for(0s) != std::future_status::ready) {
+            return;
+        }
+        // rethrows exceptions from the worker
+        loadedLevel = loadFuture.get();
+    }
+
+    auto& preparedScene = loadedLevel->scene;
+    if (!preparedScene) {
+        return;
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+    while (!sceneCache.uploadPreparedScenePart(*preparedScene)) {
+        if (std::chrono::steady_clock::now() - startTime > maxUploadTime) {
+            return;
+        }
+    }
+    preparedScene.reset();
+}
+
+void LevelLoader::finishLoading()
+{
+    assert(loading);
+    if (!loadedLevel) {
+        loadedLevel = loadFuture.get();
+    }
+    if (auto& preparedScene = loadedLevel->scene) {
+        while (!sceneCache.uploadPreparedScenePart(*preparedScene)) {}
+        preparedScene.reset();
+    }
+}
+
+LoadedLevel LevelLoader::takeLoadedLevel()
+{
+    assert(isLoaded());
+    loading = false;
+    auto level = std::move(*loadedLevel);
+    loadedLevel.reset();
+    return level;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Collision/Shape/Shape.h>
+
+#include <edbr/Graphics/Cubemap.h>
+#include <edbr/Util/PreparedScene.h>
+
+#include "Level.h"
+
+class EntityFactory;
+class SceneCache;
+
+// Level loaded on CPU by LevelLoader
+struct LoadedLevel {
+    Level level;
+    bool loadedFromModel{false};
+    std::optional<CubemapData> skybox; // not set if the level doesn't have a skybox
+    // null if the scene was already loaded before
+    std::unique_ptr<PreparedScene> scene;
+    // collision shapes of static geometry: meshShapes[meshIndex][primitiveIndex]
+    // (null for meshes which don't need them)
+    std::vector<std::vector<JPH::Ref<JPH::Shape>>> meshShapes;
+};
+
+// Loads levels without blocking the main thread. The level file is parsed,
+// the level scene is imported (or read from the cooked file), its textures
+// are decoded and static geometry collision shapes are built on a worker
+// thread. Then update uploads the scene to GPU in time-sliced parts, so that
+// level transitions keep animating while the level is loading.
+// When isLoaded() returns true, the level can be taken and its entities can
+// be spawned (the scene is in the SceneCache at this point).
+class LevelLoader {
+public:
+    LevelLoader(
+        SceneCache& sceneCache,
+        const EntityFactory& entityFactory,
+        std::string staticGeometryPrefabName);
+
+    void setSkyboxDir(const std::filesystem::path& dir) { skyboxDir = dir; }
+
+    // If allowLoadingFromModel is true and the level file doesn't exist, the
+    // level is loaded from assets/models/levels/<level>/<level>.gltf
+    void startLoading(const std::filesystem::path& levelPath, bool allowLoadingFromModel);
+    // Should be called every frame. Uploads the scene if it's prepared - the
+    // uploads stop after maxUploadTime.
+    void update(std::chrono::steady_clock::duration maxUploadTime);
+
+    bool isLoading() const { return loading; }
+    bool isLoaded() const { return loading && loadedLevel && !loadedLevel->scene; }
+    LoadedLevel takeLoadedLevel();
+
+private:
+    // Waits for the worker and uploads the rest of the scene
+    void finishLoading();
+
+    SceneCache& sceneCache;
+    const EntityFactory& entityFactory;
+    std::string staticGeometryPrefabName;
+    std::filesystem::path skyboxDir;
+
+    bool loading{false};
+    std::future<LoadedLevel> loadFuture;
+    std::optional<LoadedLevel> loadedLevel; // set when the worker is finished
+};
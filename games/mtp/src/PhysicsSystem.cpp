@@ -32,6 +32,7 @@
 
 #include <tracy/Tracy.hpp>
 
+#include <algorithm>
 #include <cstdarg>
 #include <iostream>
 #include <set>
@@ -685,6 +686,48 @@ void PhysicsSystem::addEntity(entt::handle e, SceneCache& sceneCache)
     assert(!pc.bodyId.IsInvalid());
 }
 
+JPH::Ref<JPH::Shape> PhysicsSystem::createMeshShape(const CPUMesh& mesh)
+{
+    JPH::MeshShapeSettings meshSettings;
+    meshSettings.mTriangleVertices.reserve(mesh.vertices.size());
+    meshSettings.mIndexedTriangles.reserve(mesh.indices.size());
+    for (std::size_t i = 0; i < mesh.indices.size(); i += 3) {
+        auto triangle =
+            JPH::IndexedTriangle{mesh.indices[i + 0], mesh.indices[i + 1], mesh.indices[i + 2]};
+        meshSettings.mIndexedTriangles.push_back(std::move(triangle));
+    }
+    for (const auto& v : mesh.vertices) {
+        auto pos = util::glmToJoltFloat3(v.position);
+        meshSettings.mTriangleVertices.push_back(std::move(pos));
+    }
+    meshSettings.Sanitize();
+
+    auto shapeRes = meshSettings.Create();
+    if (!shapeRes.IsValid()) {
+        printf("Error: %s\n", shapeRes.GetError().c_str());
+        return nullptr;
+        // assert(false && shapeRes.GetError().c_str());
+    }
+    return shapeRes.Get();
+}
+
+void PhysicsSystem::addPrebuiltMeshShape(MeshId meshId, JPH::Ref<JPH::Shape> shape)
+{
+    prebuiltMeshShapes[meshId] = std::move(shape);
+}
+
+void PhysicsSystem::removeMeshShapes(const std::vector<MeshId>& meshIds)
+{
+    const auto isRemoved = [&meshIds](MeshId meshId) {
+        return std::find(meshIds.begin(), meshIds.end(), meshId) != meshIds.end();
+    };
+    std::erase_if(prebuiltMeshShapes, [&](const auto& pair) { return isRemoved(pair.first); });
+    // bodies which use the shapes keep references to them
+    std::erase_if(cachedMeshShapes, [&](const CachedMeshShape& cachedMesh) {
+        return std::any_of(cachedMesh.meshIds.begin(), cachedMesh.meshIds.end(), isRemoved);
+    });
+}
+
 JPH::Ref<JPH::Shape> PhysicsSystem::cacheMeshShape(
     const std::vector<const CPUMesh*>& meshes,
     const std::vector<MeshId>& meshIds,
@@ -699,30 +742,19 @@ JPH::Ref<JPH::Shape> PhysicsSystem::cacheMeshShape(
     JPH::StaticCompoundShapeSettings compoundShapeSettings;
     compoundShapeSettings.mSubShapes.reserve(meshes.size());
     for (std::size_t i = 0; i < meshes.size(); ++i) {
-        const auto& mesh = *meshes[i];
         const auto& transform = meshTransforms[i];
 
-        JPH::MeshShapeSettings meshSettings;
-        meshSettings.mTriangleVertices.reserve(mesh.vertices.size());
-        meshSettings.mIndexedTriangles.reserve(mesh.indices.size());
-        for (std::size_t i = 0; i < mesh.indices.size(); i += 3) {
-            auto triangle =
-                JPH::IndexedTriangle{mesh.indices[i + 0], mesh.indices[i + 1], mesh.indices[i + 2]};
-            meshSettings.mIndexedTriangles.push_back(std::move(triangle));
-        }
-        for (const auto& v : mesh.vertices) {
-            auto pos = util::glmToJoltFloat3(v.position);
-            meshSettings.mTriangleVertices.push_back(std::move(pos));
+        JPH::Ref<JPH::Shape> meshShape;
+        if (const auto it = prebuiltMeshShapes.find(meshIds[i]); it != prebuiltMeshShapes.end()) {
+            meshShape = it->second;
+        } else {
+            meshShape = createMeshShape(*meshes[i]);
         }
-        meshSettings.Sanitize();
-
-        auto shapeRes = meshSettings.Create();
-        if (!shapeRes.IsValid()) {
-            printf("Error: %s\n", shapeRes.GetError().c_str());
+        if (!meshShape) {
             continue;
-            // assert(false && shapeRes.GetError().c_str());
         }
-        auto scaledShape = shapeRes.Get()->ScaleShape(util::glmToJolt(transform.getScale())).Get();
+
+        auto scaledShape = meshShape->ScaleShape(util::glmToJolt(transform.getScale())).Get();
         compoundShapeSettings.AddShape(
             util::glmToJolt(transform.getPosition()),
             util::glmToJolt(transform.getHeading()),
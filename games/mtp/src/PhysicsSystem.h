@@ -193,6 +193,16 @@ public:
     // creates entity physics body
     void addEntity(entt::handle e, SceneCache& sceneCache);
 
+    // Builds a triangle mesh shape. Doesn't touch the physics system, so it
+    // can be called from any thread. Returns nullptr on failure.
+    static JPH::Ref<JPH::Shape> createMeshShape(const CPUMesh& mesh);
+    // Shapes built with createMeshShape ahead of time (e.g. during background
+    // level loading) - cacheMeshShape uses them instead of building new ones
+    void addPrebuiltMeshShape(MeshId meshId, JPH::Ref<JPH::Shape> shape);
+    // Removes the shapes built from the meshes - should be called when the meshes
+    // are removed, because their ids will be reused by other meshes
+    void removeMeshShapes(const std::vector<MeshId>& meshIds);
+
     JPH::Ref<JPH::Shape> cacheMeshShape(
         const std::vector<const CPUMesh*>& meshes,
         const std::vector<MeshId>& meshIds,
@@ -260,6 +270,7 @@ private:
         JPH::Ref<JPH::Shape> meshShape;
     };
     std::vector<CachedMeshShape> cachedMeshShapes;
+    std::unordered_map<MeshId, JPH::Ref<JPH::Shape>> prebuiltMeshShapes;
 
     std::unordered_map<std::uint32_t, entt::handle> bodyIDToEntity;
     std::vector<entt::handle> interactableEntities;